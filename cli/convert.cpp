@@ -0,0 +1,38 @@
+#include "uzuki2/convert.hpp"
+
+#include <iostream>
+#include <string>
+
+/*
+ * Converts a list between the JSON and HDF5 representations.
+ * The direction is determined from the input file, and the JSON output is
+ * Gzip-compressed if its path ends with '.gz'.
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 4) {
+        std::cerr << "usage: " << argv[0] << " INPUT OUTPUT GROUP" << std::endl;
+        std::cerr << "  Convert INPUT (JSON or HDF5) to OUTPUT (HDF5 or JSON), where GROUP is the name of the list in the HDF5 file." << std::endl;
+        return 1;
+    }
+
+    std::string input = argv[1], output = argv[2], group = argv[3];
+
+    H5::Exception::dontPrint();
+    try {
+        uzuki2::ConvertOptions options;
+        if (H5::H5File::isHdf5(input)) {
+            options.json_options.gzip = (output.size() >= 3 && output.compare(output.size() - 3, 3, ".gz") == 0);
+            uzuki2::hdf5_to_json(input, group, output, options);
+        } else {
+            uzuki2::json_to_hdf5(input, output, group, options);
+        }
+    } catch (std::exception& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    } catch (H5::Exception& e) {
+        std::cerr << "error: " << e.getDetailMsg() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
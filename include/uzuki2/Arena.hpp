@@ -0,0 +1,232 @@
+#ifndef UZUKI2_ARENA_HPP
+#define UZUKI2_ARENA_HPP
+
+#include <memory>
+#include <vector>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include "interfaces.hpp"
+
+/**
+ * @file Arena.hpp
+ * @brief Arena for objects created during a parse.
+ */
+
+namespace uzuki2 {
+
+/**
+ * @brief Monotonic arena that owns all objects created during a parse.
+ *
+ * Objects are constructed in large blocks of memory and destroyed together when the arena is destroyed.
+ * If a provisioner accepts an `Arena&` in its `new_*()` methods (see `hdf5::parse()`), the parser creates one arena per parse.
+ * Only the top-level pointer returned by the parser (i.e., `ParsedList::ptr`) owns the arena;
+ * the `std::shared_ptr<Base>` pointers passed to `List::set()` do not, so lists can store them without creating a reference cycle.
+ * Every node remains valid as long as the top-level pointer (or any copy of it) is alive.
+ *
+ * The arena also provides an interning table for strings, e.g., list names and factor levels that are repeated throughout a list.
+ * Each distinct string is stored once in the arena and subsequent occurrences are returned as views of the same characters.
+ */
+class Arena {
+public:
+    /**
+     * @param block_size Size of each block of memory, in bytes.
+     * Larger objects are allocated in their own block.
+     */
+    Arena(size_t block_size = 65536) : my_block_size(block_size) {}
+
+    /**
+     * @cond
+     */
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+        for (auto it = my_destructors.rbegin(); it != my_destructors.rend(); ++it) {
+            it->first(it->second);
+        }
+    }
+    /**
+     * @endcond
+     */
+
+public:
+    /**
+     * Construct an object in the arena.
+     * The object's destructor is called when the arena is destroyed, in reverse order of construction.
+     *
+     * @tparam Type_ Type of the object.
+     * @tparam Args_ Types of the constructor arguments.
+     * @param args Arguments to pass to the constructor.
+     *
+     * @return Pointer to the new object, which remains valid for the lifetime of the arena.
+     */
+    template<class Type_, typename ... Args_>
+    Type_* create(Args_&& ... args) {
+        auto ptr = new (allocate(sizeof(Type_), alignof(Type_))) Type_(std::forward<Args_>(args)...);
+        if constexpr(!std::is_trivially_destructible<Type_>::value) {
+            my_destructors.emplace_back([](void* p) -> void { static_cast<Type_*>(p)->~Type_(); }, ptr);
+        }
+        return ptr;
+    }
+
+    /**
+     * Intern a string in the arena.
+     *
+     * @param x String to be interned.
+     * This only needs to be valid for the duration of the call.
+     *
+     * @return View of a string with the same contents as `x`, which remains valid for the lifetime of the arena.
+     * All calls with the same contents return views with the same `data()` pointer.
+     */
+    std::string_view intern(std::string_view x) {
+        auto it = my_interned.find(x);
+        if (it != my_interned.end()) {
+            return *it;
+        }
+
+        auto ptr = static_cast<char*>(allocate(x.size(), 1));
+        if (x.size()) {
+            std::memcpy(ptr, x.data(), x.size());
+        }
+        std::string_view output(ptr, x.size());
+        my_interned.insert(output);
+        return output;
+    }
+
+    /**
+     * @return Number of distinct strings interned in the arena.
+     */
+    size_t num_interned() const {
+        return my_interned.size();
+    }
+
+    /**
+     * @return Number of blocks of memory allocated by the arena.
+     */
+    size_t num_blocks() const {
+        return my_blocks.size();
+    }
+
+private:
+    size_t my_block_size;
+    std::vector<std::unique_ptr<unsigned char[]> > my_blocks;
+    unsigned char* my_current = NULL;
+    size_t my_remaining = 0;
+    std::vector<std::pair<void (*)(void*), void*> > my_destructors;
+    std::unordered_set<std::string_view> my_interned;
+
+    void* allocate(size_t size, size_t alignment) {
+        size_t padding = (alignment - reinterpret_cast<uintptr_t>(my_current) % alignment) % alignment;
+        if (my_current == NULL || padding + size > my_remaining) {
+            size_t needed = std::max(my_block_size, size + alignment);
+            my_blocks.emplace_back(new unsigned char[needed]);
+            my_current = my_blocks.back().get();
+            my_remaining = needed;
+            padding = (alignment - reinterpret_cast<uintptr_t>(my_current) % alignment) % alignment;
+        }
+
+        auto output = my_current + padding;
+        my_current = output + size;
+        my_remaining -= padding + size;
+        return output;
+    }
+};
+
+/**
+ * @cond
+ */
+template<class Provisioner_, typename = int>
+struct uses_arena : std::false_type {};
+
+template<class Provisioner_>
+struct uses_arena<Provisioner_, decltype((void)Provisioner_::new_Nothing(std::declval<Arena&>()), 0)> : std::true_type {};
+
+// Creates nodes through the provisioner, either individually on the heap or in an arena shared by the entire parse.
+template<class Provisioner_>
+class NodeFactory {
+public:
+    NodeFactory() {
+        if constexpr(uses_arena<Provisioner_>::value) {
+            my_arena = std::make_shared<Arena>();
+        }
+    }
+
+private:
+    std::shared_ptr<Arena> my_arena;
+
+    // In arena mode, nodes are handed out as non-owning pointers, as lists that
+    // hold their children would otherwise keep their own arena alive.
+    template<class Function_>
+    auto own(std::shared_ptr<Base>& output, Function_ fun) {
+        if constexpr(uses_arena<Provisioner_>::value) {
+            auto ptr = fun(*my_arena);
+            output = std::shared_ptr<Base>(std::shared_ptr<Base>(), ptr);
+            return ptr;
+        } else {
+            auto ptr = fun();
+            output.reset(ptr);
+            return ptr;
+        }
+    }
+
+public:
+    auto new_Nothing(std::shared_ptr<Base>& output) {
+        return own(output, [&](auto& ... arena) { return Provisioner_::new_Nothing(arena...); });
+    }
+
+    auto new_External(std::shared_ptr<Base>& output, void* p) {
+        return own(output, [&](auto& ... arena) { return Provisioner_::new_External(arena..., p); });
+    }
+
+    auto new_List(std::shared_ptr<Base>& output, size_t l, bool n) {
+        return own(output, [&](auto& ... arena) { return Provisioner_::new_List(arena..., l, n); });
+    }
+
+    auto new_Integer(std::shared_ptr<Base>& output, size_t l, bool n, bool s) {
+        return own(output, [&](auto& ... arena) { return Provisioner_::new_Integer(arena..., l, n, s); });
+    }
+
+    auto new_Number(std::shared_ptr<Base>& output, size_t l, bool n, bool s) {
+        return own(output, [&](auto& ... arena) { return Provisioner_::new_Number(arena..., l, n, s); });
+    }
+
+    auto new_String(std::shared_ptr<Base>& output, size_t l, bool n, bool s, StringVector::Format f) {
+        return own(output, [&](auto& ... arena) { return Provisioner_::new_String(arena..., l, n, s, f); });
+    }
+
+    auto new_Boolean(std::shared_ptr<Base>& output, size_t l, bool n, bool s) {
+        return own(output, [&](auto& ... arena) { return Provisioner_::new_Boolean(arena..., l, n, s); });
+    }
+
+    auto new_Factor(std::shared_ptr<Base>& output, size_t l, bool n, bool s, size_t ll, bool o) {
+        return own(output, [&](auto& ... arena) { return Provisioner_::new_Factor(arena..., l, n, s, ll, o); });
+    }
+
+    // Called by the parser on each completed object, to allow the deduplicating factory to substitute an existing object.
+    std::shared_ptr<Base> finish(std::shared_ptr<Base> output) {
+        return output;
+    }
+
+    // Called by the parser on the top-level object, which is the only pointer that owns the arena.
+    std::shared_ptr<Base> release(std::shared_ptr<Base> root) {
+        if constexpr(uses_arena<Provisioner_>::value) {
+            return std::shared_ptr<Base>(my_arena, root.get());
+        } else {
+            return root;
+        }
+    }
+};
+/**
+ * @endcond
+ */
+
+}
+
+#endif
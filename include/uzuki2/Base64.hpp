@@ -0,0 +1,164 @@
+#ifndef UZUKI2_BASE64_HPP
+#define UZUKI2_BASE64_HPP
+
+#include <string>
+#include <vector>
+#include <array>
+#include <stdexcept>
+#include <cstdint>
+
+#include "ByteOrder.hpp"
+
+namespace uzuki2 {
+
+/*
+ * Base64 codec for the lossless encoding of number vectors in JSON. The
+ * decoder handles 8 characters per iteration with a table lookup and no
+ * data-dependent branches; invalid characters are flagged in the table and
+ * accumulated with a bitwise OR, so that a single check is made at the end.
+ * Only the canonical encoding is accepted, i.e., the bits before any padding
+ * should be zero, so that each vector has exactly one representation.
+ */
+inline constexpr char base64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+inline const std::array<uint8_t, 256>& base64_decoding_table() {
+    static const std::array<uint8_t, 256> table = []() {
+        std::array<uint8_t, 256> output;
+        output.fill(0x80);
+        for (int i = 0; i < 64; ++i) {
+            output[static_cast<unsigned char>(base64_alphabet[i])] = i;
+        }
+        return output;
+    }();
+    return table;
+}
+
+inline void encode_base64(const unsigned char* input, size_t n, std::string& output) {
+    size_t i = 0;
+    for (; i + 3 <= n; i += 3) {
+        uint32_t chunk = (static_cast<uint32_t>(input[i]) << 16) | (static_cast<uint32_t>(input[i + 1]) << 8) | input[i + 2];
+        output.push_back(base64_alphabet[(chunk >> 18) & 63]);
+        output.push_back(base64_alphabet[(chunk >> 12) & 63]);
+        output.push_back(base64_alphabet[(chunk >> 6) & 63]);
+        output.push_back(base64_alphabet[chunk & 63]);
+    }
+
+    size_t leftover = n - i;
+    if (leftover) {
+        uint32_t chunk = static_cast<uint32_t>(input[i]) << 16;
+        if (leftover == 2) {
+            chunk |= static_cast<uint32_t>(input[i + 1]) << 8;
+        }
+        output.push_back(base64_alphabet[(chunk >> 18) & 63]);
+        output.push_back(base64_alphabet[(chunk >> 12) & 63]);
+        output.push_back(leftover == 2 ? base64_alphabet[(chunk >> 6) & 63] : '=');
+        output.push_back('=');
+    }
+}
+
+inline size_t decoded_base64_length(size_t n, size_t padding) {
+    if (n % 4 != 0) {
+        throw std::runtime_error("length of a base64 string should be a multiple of 4");
+    }
+    return (n / 4) * 3 - padding;
+}
+
+inline size_t count_base64_padding(const char* input, size_t n) {
+    size_t padding = 0;
+    if (n && input[n - 1] == '=') {
+        ++padding;
+        if (n > 1 && input[n - 2] == '=') {
+            ++padding;
+        }
+    }
+    return padding;
+}
+
+inline size_t decoded_base64_doubles(size_t nbytes) {
+    if (nbytes % 8 != 0) {
+        throw std::runtime_error("decoded length of a base64 string should be a multiple of 8");
+    }
+    return nbytes / 8;
+}
+
+// 'output' should have space for 'total' bytes, as computed by decoded_base64_length().
+inline void decode_base64(const char* input, size_t n, size_t total, unsigned char* output) {
+    const auto& table = base64_decoding_table();
+    auto in = reinterpret_cast<const unsigned char*>(input);
+
+    // All complete groups except the last, which may contain padding.
+    size_t ngroups = (n ? n / 4 - 1 : 0);
+    uint8_t invalid = 0;
+    size_t g = 0;
+
+    for (; g + 2 <= ngroups; g += 2) {
+        const unsigned char* src = in + g * 4;
+        uint8_t a0 = table[src[0]], a1 = table[src[1]], a2 = table[src[2]], a3 = table[src[3]];
+        uint8_t b0 = table[src[4]], b1 = table[src[5]], b2 = table[src[6]], b3 = table[src[7]];
+        invalid |= a0 | a1 | a2 | a3 | b0 | b1 | b2 | b3;
+
+        unsigned char* dest = output + g * 3;
+        dest[0] = (a0 << 2) | (a1 >> 4);
+        dest[1] = (a1 << 4) | (a2 >> 2);
+        dest[2] = (a2 << 6) | a3;
+        dest[3] = (b0 << 2) | (b1 >> 4);
+        dest[4] = (b1 << 4) | (b2 >> 2);
+        dest[5] = (b2 << 6) | b3;
+    }
+
+    for (; g < ngroups; ++g) {
+        const unsigned char* src = in + g * 4;
+        uint8_t a0 = table[src[0]], a1 = table[src[1]], a2 = table[src[2]], a3 = table[src[3]];
+        invalid |= a0 | a1 | a2 | a3;
+        unsigned char* dest = output + g * 3;
+        dest[0] = (a0 << 2) | (a1 >> 4);
+        dest[1] = (a1 << 4) | (a2 >> 2);
+        dest[2] = (a2 << 6) | a3;
+    }
+
+    if (n) {
+        const unsigned char* src = in + ngroups * 4;
+        size_t remaining = total - ngroups * 3;
+        uint8_t a0 = table[src[0]], a1 = table[src[1]];
+        uint8_t a2 = (remaining >= 2 ? table[src[2]] : 0);
+        uint8_t a3 = (remaining == 3 ? table[src[3]] : 0);
+        invalid |= a0 | a1 | a2 | a3;
+
+        // Bits that are discarded by the padding should be zero.
+        if ((remaining == 1 && (a1 & 0xF)) || (remaining == 2 && (a2 & 0x3))) {
+            invalid |= 0x40;
+        }
+
+        unsigned char* dest = output + ngroups * 3;
+        dest[0] = (a0 << 2) | (a1 >> 4);
+        if (remaining >= 2) {
+            dest[1] = (a1 << 4) | (a2 >> 2);
+        }
+        if (remaining == 3) {
+            dest[2] = (a2 << 6) | a3;
+        }
+    }
+
+    if (invalid & 0x80) {
+        throw std::runtime_error("invalid character in a base64 string");
+    }
+    if (invalid & 0x40) {
+        throw std::runtime_error("non-zero padding bits in a base64 string");
+    }
+}
+
+// Number vectors are packed as little-endian doubles. Long strings can be
+// decoded in pieces of a multiple of 32 characters (i.e., 3 doubles), in which
+// case 'padded' should be false for all but the last piece.
+inline void decode_base64_doubles(const char* input, size_t n, std::vector<double>& output, bool padded = true) {
+    size_t nbytes = decoded_base64_length(n, padded ? count_base64_padding(input, n) : 0);
+    output.resize(decoded_base64_doubles(nbytes));
+    decode_base64(input, n, nbytes, reinterpret_cast<unsigned char*>(output.data()));
+    if (!is_little_endian()) {
+        swap_bytes(output.data(), output.size());
+    }
+}
+
+}
+
+#endif
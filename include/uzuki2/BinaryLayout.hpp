@@ -0,0 +1,94 @@
+#ifndef UZUKI2_BINARY_LAYOUT_HPP
+#define UZUKI2_BINARY_LAYOUT_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+#include "ByteOrder.hpp"
+
+namespace uzuki2 {
+
+namespace binary {
+
+/*
+ * Constants for the binary format, shared by the parser and the writer. See
+ * docs/specifications/binary.md for the layout; all integers are unsigned and
+ * little-endian, and all blocks start at multiples of 8 bytes from the start
+ * of the file, so that they can be used directly from a memory mapping.
+ */
+inline constexpr char magic[8] = { 'U', 'Z', 'U', 'K', 'I', '2', 'B', 'N' };
+
+inline constexpr uint32_t format_major = 1;
+inline constexpr uint32_t format_minor = 0;
+
+inline constexpr size_t header_size = 64;
+inline constexpr size_t node_size = 64;
+inline constexpr size_t block_alignment = 8;
+
+enum : uint8_t {
+    FLAG_SCALAR = 1,
+    FLAG_NAMED = 2,
+    FLAG_ORDERED = 4,
+    FLAG_MISSING = 8
+};
+
+// Byte offsets of the fields in the header and in each node record.
+enum : size_t {
+    HEADER_MAJOR = 8,
+    HEADER_MINOR = 12,
+    HEADER_NUM_NODES = 16,
+    HEADER_NODES = 24,
+    HEADER_NUM_CHILDREN = 32,
+    HEADER_CHILDREN = 40,
+    HEADER_FILE_SIZE = 48,
+    HEADER_RESERVED = 56
+};
+
+enum : size_t {
+    NODE_TYPE = 0,
+    NODE_FLAGS = 1,
+    NODE_FORMAT = 2,
+    NODE_RESERVED = 3,
+    NODE_LENGTH = 8,
+    NODE_VALUES = 16,
+    NODE_LEVELS = 24,
+    NODE_NUM_LEVELS = 32,
+    NODE_MISSING = 40,
+    NODE_NAMES = 48,
+    NODE_RESERVED_TAIL = 56
+};
+
+template<typename Type_>
+Type_ load_le(const unsigned char* ptr) {
+    Type_ output = 0;
+    for (size_t b = 0; b < sizeof(Type_); ++b) {
+        output |= static_cast<Type_>(ptr[b]) << (8 * b);
+    }
+    return output;
+}
+
+template<typename Type_>
+void store_le(unsigned char* ptr, Type_ value) {
+    for (size_t b = 0; b < sizeof(Type_); ++b) {
+        ptr[b] = static_cast<unsigned char>(value >> (8 * b));
+    }
+}
+
+inline bool is_zero(const unsigned char* ptr, size_t n) {
+    for (size_t b = 0; b < n; ++b) {
+        if (ptr[b]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline uint64_t align_block(uint64_t offset) {
+    return (offset + block_alignment - 1) / block_alignment * block_alignment;
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef UZUKI2_BYTE_ORDER_HPP
+#define UZUKI2_BYTE_ORDER_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <utility>
+
+namespace uzuki2 {
+
+/*
+ * Helpers for the little-endian representations in the base64 encoding of
+ * JSON number vectors and in the binary format. Values are only swapped on
+ * big-endian machines, so the conversions are no-ops on most platforms.
+ */
+inline bool is_little_endian() {
+    uint16_t probe = 1;
+    unsigned char first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+template<typename Type_>
+void swap_bytes(Type_* values, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        auto bytes = reinterpret_cast<unsigned char*>(values + i);
+        for (size_t b = 0; b < sizeof(Type_) / 2; ++b) {
+            std::swap(bytes[b], bytes[sizeof(Type_) - 1 - b]);
+        }
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,863 @@
+#ifndef UZUKI2_COLUMNAR_HPP
+#define UZUKI2_COLUMNAR_HPP
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+#include "interfaces.hpp"
+#include "Arena.hpp"
+
+/**
+ * @file Columnar.hpp
+ * @brief Columnar representation of the parsed objects.
+ */
+
+namespace uzuki2 {
+
+/**
+ * @brief Typed buffer with inline storage for scalars.
+ *
+ * @tparam Type_ Type of the values.
+ *
+ * Buffers of length 0 or 1 store their value inline, avoiding a heap allocation for the scalars that are common in R lists.
+ * Longer buffers are allocated once at construction.
+ */
+template<typename Type_>
+class ColumnBuffer {
+public:
+    /**
+     * @param n Length of the buffer.
+     * All values are zero-initialized.
+     */
+    ColumnBuffer(size_t n) : my_size(n) {
+        if (n > 1) {
+            my_heap.resize(n);
+        }
+    }
+
+    /**
+     * @return Length of the buffer.
+     */
+    size_t size() const {
+        return my_size;
+    }
+
+    /**
+     * @return Pointer to the start of the buffer.
+     */
+    Type_* data() {
+        return (my_size > 1 ? my_heap.data() : &my_inline);
+    }
+
+    /**
+     * @return Pointer to the start of the buffer.
+     */
+    const Type_* data() const {
+        return (my_size > 1 ? my_heap.data() : &my_inline);
+    }
+
+private:
+    size_t my_size;
+    Type_ my_inline = Type_();
+    std::vector<Type_> my_heap;
+};
+
+/**
+ * @brief Validity bitmap for a column.
+ *
+ * Bits are packed in least-significant-bit order, where a set bit indicates that the element is present (i.e., not missing).
+ * This matches the validity bitmaps of the Arrow columnar format.
+ * The bitmap is only allocated when the first missing value is reported.
+ */
+class ColumnValidity {
+public:
+    /**
+     * @param n Length of the column.
+     */
+    ColumnValidity(size_t n) : my_size(n) {}
+
+    /**
+     * @param i Index of the element to mark as missing.
+     */
+    void set_missing(size_t i) {
+        allocate();
+        uint8_t& current = my_bits[i / 8];
+        uint8_t mask = (1u << (i % 8));
+        if (current & mask) {
+            current &= ~mask;
+            ++my_null_count;
+        }
+    }
+
+    /**
+     * @param start Index of the first element of the block.
+     * @param bitmap Packed bitmap of missing elements, see `Vector::set_missing_block()`.
+     * @param n Number of elements in the block.
+     */
+    void set_missing_block(size_t start, const uint8_t* bitmap, size_t n) {
+        size_t nbytes = (n + 7) / 8;
+        for (size_t b = 0; b < nbytes; ++b) {
+            if (bitmap[b] == 0) {
+                continue;
+            }
+            size_t last = std::min(n, b * 8 + 8);
+            for (size_t j = b * 8; j < last; ++j) {
+                if (bitmap[b] & (1u << (j % 8))) {
+                    set_missing(start + j);
+                }
+            }
+        }
+    }
+
+    /**
+     * @param i Index of an element.
+     * @return Whether the element is missing.
+     */
+    bool is_missing(size_t i) const {
+        return !my_bits.empty() && !(my_bits[i / 8] & (1u << (i % 8)));
+    }
+
+    /**
+     * @return Number of missing elements.
+     */
+    size_t null_count() const {
+        return my_null_count;
+    }
+
+    /**
+     * @return Pointer to the validity bitmap, or `NULL` if no elements are missing.
+     */
+    const uint8_t* bitmap() const {
+        return (my_bits.empty() ? NULL : my_bits.data());
+    }
+
+private:
+    size_t my_size;
+    size_t my_null_count = 0;
+    std::vector<uint8_t> my_bits;
+
+    void allocate() {
+        if (my_bits.empty()) {
+            my_bits.resize((my_size + 7) / 8, 0xFF);
+        }
+    }
+};
+
+/**
+ * @brief Column of strings stored in a single character arena.
+ *
+ * Each string is defined by a start position and a length in the arena.
+ * Strings are appended to the arena as they are set, so re-setting an element leaves its previous contents in the arena.
+ * Strings set from a dictionary share the characters of their distinct string, so the arena only holds one copy of each.
+ */
+class StringColumn {
+public:
+    /**
+     * @param n Number of strings.
+     */
+    StringColumn(size_t n = 0) : my_starts(n), my_lengths(n) {}
+
+    /**
+     * @return Number of strings.
+     */
+    size_t size() const {
+        return my_starts.size();
+    }
+
+    /**
+     * @param i Index of the string.
+     * @param ptr Pointer to the characters of the string.
+     * @param len Length of the string.
+     */
+    void set(size_t i, const char* ptr, size_t len) {
+        my_starts[i] = my_chars.size();
+        my_lengths[i] = len;
+        my_chars.append(ptr, len);
+    }
+
+    /**
+     * @param start Index of the first string in the block.
+     * @param data Concatenated contents of the strings, see `StringVector::set_block()`.
+     * @param offsets Offsets of the strings in `data`, of length `n + 1`.
+     * @param n Number of strings in the block.
+     */
+    void set_block(size_t start, const char* data, const size_t* offsets, size_t n) {
+        size_t base = my_chars.size();
+        my_chars.append(data + offsets[0], offsets[n] - offsets[0]);
+        for (size_t j = 0; j < n; ++j) {
+            my_starts[start + j] = base + (offsets[j] - offsets[0]);
+            my_lengths[start + j] = offsets[j + 1] - offsets[j];
+        }
+    }
+
+    /**
+     * @param data Concatenated contents of the distinct strings, see `StringVector::set_dictionary()`.
+     * @param offsets Offsets of the distinct strings in `data`, of length `nlevels + 1`.
+     * @param nlevels Number of distinct strings.
+     * @param codes Index of the distinct string for each element, of length equal to `size()`.
+     * Elements with negative codes are not modified.
+     */
+    void set_dictionary(const char* data, const size_t* offsets, size_t nlevels, const int32_t* codes) {
+        size_t base = my_chars.size();
+        my_chars.append(data, offsets[nlevels]);
+        for (size_t i = 0, n = size(); i < n; ++i) {
+            auto c = codes[i];
+            if (c >= 0) {
+                my_starts[i] = base + offsets[c];
+                my_lengths[i] = offsets[c + 1] - offsets[c];
+            }
+        }
+    }
+
+    /**
+     * @param i Index of the string.
+     * @return View into the arena for the string.
+     * This is invalidated by any further calls to `set()` or `set_block()`.
+     */
+    std::string_view get(size_t i) const {
+        return std::string_view(my_chars.data() + my_starts[i], my_lengths[i]);
+    }
+
+    /**
+     * @return Pointer to the start of the character arena.
+     */
+    const char* chars() const {
+        return my_chars.data();
+    }
+
+    /**
+     * @return Size of the character arena.
+     */
+    size_t chars_size() const {
+        return my_chars.size();
+    }
+
+    /**
+     * @return Pointer to an array of start positions in the arena, one per string.
+     */
+    const size_t* starts() const {
+        return my_starts.data();
+    }
+
+    /**
+     * @return Pointer to an array of string lengths.
+     */
+    const size_t* lengths() const {
+        return my_lengths.data();
+    }
+
+private:
+    std::vector<size_t> my_starts;
+    std::vector<size_t> my_lengths;
+    std::string my_chars;
+};
+
+/**
+ * @brief Column of strings interned in an `Arena`.
+ *
+ * This is used for list names and factor levels, which are often repeated throughout a list.
+ * Each element is a view of a string that is stored once in the arena for the entire parse.
+ * Names of vector elements are usually unique, so they are stored in a `StringColumn` instead to avoid the cost of interning each element.
+ */
+class InternedColumn {
+public:
+    /**
+     * @param arena Arena in which to intern the strings.
+     * This should outlive the column.
+     * @param n Number of strings.
+     */
+    InternedColumn(Arena& arena, size_t n) : my_arena(&arena), my_values(n) {}
+
+    /**
+     * @return Number of strings.
+     */
+    size_t size() const {
+        return my_values.size();
+    }
+
+    /**
+     * @param i Index of the string.
+     * @param x Contents of the string.
+     */
+    void set(size_t i, std::string_view x) {
+        my_values[i] = my_arena->intern(x);
+    }
+
+    /**
+     * @param start Index of the first string in the block.
+     * @param data Pointer to the concatenated contents of all strings in the block.
+     * @param offsets Pointer to an array of length `n + 1`, containing the start and end offsets of each string in `data`.
+     * @param n Number of strings in the block.
+     */
+    void set_block(size_t start, const char* data, const size_t* offsets, size_t n) {
+        for (size_t j = 0; j < n; ++j) {
+            my_values[start + j] = my_arena->intern(std::string_view(data + offsets[j], offsets[j + 1] - offsets[j]));
+        }
+    }
+
+    /**
+     * @param i Index of the string.
+     * @return View of the string.
+     * Equal strings have the same `data()` pointer.
+     */
+    std::string_view get(size_t i) const {
+        return my_values[i];
+    }
+
+private:
+    Arena* my_arena;
+    std::vector<std::string_view> my_values;
+};
+
+/**
+ * @brief Common storage for columnar vectors.
+ *
+ * @tparam Interface_ Vector interface to implement.
+ */
+template<class Interface_>
+class ColumnarVector : public Interface_ {
+public:
+    /**
+     * @param l Length of the vector.
+     * @param n Whether the vector is named.
+     * @param s Whether the vector was represented on file as a scalar.
+     */
+    ColumnarVector(size_t l, bool n, bool s) : my_length(l), my_validity(l), my_names(n ? l : 0), my_named(n), my_scalar(s) {}
+
+    /**
+     * @cond
+     */
+    size_t size() const {
+        return my_length;
+    }
+
+    void set_name(size_t i, std::string n) {
+        my_names.set(i, n.data(), n.size());
+    }
+
+    void set_name_view(size_t i, std::string_view n) {
+        my_names.set(i, n.data(), n.size());
+    }
+
+    void set_name_block(size_t start, const char* data, const size_t* offsets, size_t n) {
+        my_names.set_block(start, data, offsets, n);
+    }
+
+    void set_missing(size_t i) {
+        my_validity.set_missing(i);
+    }
+
+    void set_missing_block(size_t start, const uint8_t* bitmap, size_t n) {
+        my_validity.set_missing_block(start, bitmap, n);
+    }
+    /**
+     * @endcond
+     */
+
+    /**
+     * @return Validity of each element.
+     */
+    const ColumnValidity& validity() const {
+        return my_validity;
+    }
+
+    /**
+     * @return Whether the vector is named.
+     */
+    bool has_names() const {
+        return my_named;
+    }
+
+    /**
+     * @return Names of the vector elements.
+     * This should only be used if `has_names()` is true.
+     */
+    const StringColumn& names() const {
+        return my_names;
+    }
+
+    /**
+     * @return Whether the vector was represented on file as a scalar.
+     */
+    bool is_scalar() const {
+        return my_scalar;
+    }
+
+protected:
+    /**
+     * @cond
+     */
+    size_t my_length;
+    ColumnValidity my_validity;
+    StringColumn my_names;
+    bool my_named;
+    bool my_scalar;
+    /**
+     * @endcond
+     */
+};
+
+/**
+ * @brief Columnar integer vector.
+ */
+class ColumnarIntegerVector final : public ColumnarVector<IntegerVector> {
+public:
+    /**
+     * @param l Length of the vector.
+     * @param n Whether the vector is named.
+     * @param s Whether the vector was represented on file as a scalar.
+     */
+    ColumnarIntegerVector(size_t l, bool n, bool s) : ColumnarVector<IntegerVector>(l, n, s), my_values(l) {}
+
+    /**
+     * @cond
+     */
+    void set(size_t i, int32_t v) {
+        my_values.data()[i] = v;
+    }
+
+    void set_block(size_t start, const int32_t* values, size_t n) {
+        std::copy_n(values, n, my_values.data() + start);
+    }
+    /**
+     * @endcond
+     */
+
+    /**
+     * @return Pointer to the values.
+     * Values of missing elements are unspecified.
+     */
+    const int32_t* values() const {
+        return my_values.data();
+    }
+
+private:
+    ColumnBuffer<int32_t> my_values;
+};
+
+/**
+ * @brief Columnar double-precision vector.
+ */
+class ColumnarNumberVector final : public ColumnarVector<NumberVector> {
+public:
+    /**
+     * @param l Length of the vector.
+     * @param n Whether the vector is named.
+     * @param s Whether the vector was represented on file as a scalar.
+     */
+    ColumnarNumberVector(size_t l, bool n, bool s) : ColumnarVector<NumberVector>(l, n, s), my_values(l) {}
+
+    /**
+     * @cond
+     */
+    void set(size_t i, double v) {
+        my_values.data()[i] = v;
+    }
+
+    void set_block(size_t start, const double* values, size_t n) {
+        std::copy_n(values, n, my_values.data() + start);
+    }
+    /**
+     * @endcond
+     */
+
+    /**
+     * @return Pointer to the values.
+     * Values of missing elements are unspecified.
+     */
+    const double* values() const {
+        return my_values.data();
+    }
+
+private:
+    ColumnBuffer<double> my_values;
+};
+
+/**
+ * @brief Columnar boolean vector.
+ *
+ * Values are stored as a bitmap in least-significant-bit order.
+ */
+class ColumnarBooleanVector final : public ColumnarVector<BooleanVector> {
+public:
+    /**
+     * @param l Length of the vector.
+     * @param n Whether the vector is named.
+     * @param s Whether the vector was represented on file as a scalar.
+     */
+    ColumnarBooleanVector(size_t l, bool n, bool s) : ColumnarVector<BooleanVector>(l, n, s), my_bits((l + 7) / 8) {}
+
+    /**
+     * @cond
+     */
+    void set(size_t i, bool v) {
+        uint8_t& current = my_bits.data()[i / 8];
+        uint8_t mask = (1u << (i % 8));
+        current = (v ? (current | mask) : (current & ~mask));
+    }
+
+    void set_block(size_t start, const int32_t* values, size_t n) {
+        for (size_t j = 0; j < n; ++j) {
+            set(start + j, values[j] != 0);
+        }
+    }
+    /**
+     * @endcond
+     */
+
+    /**
+     * @param i Index of the element.
+     * @return Value of the element.
+     */
+    bool get(size_t i) const {
+        return my_bits.data()[i / 8] & (1u << (i % 8));
+    }
+
+    /**
+     * @return Pointer to the bitmap of values.
+     * Values of missing elements are unspecified.
+     */
+    const uint8_t* values() const {
+        return my_bits.data();
+    }
+
+private:
+    ColumnBuffer<uint8_t> my_bits;
+};
+
+/**
+ * @brief Columnar string vector.
+ */
+class ColumnarStringVector final : public ColumnarVector<StringVector> {
+public:
+    /**
+     * @param l Length of the vector.
+     * @param n Whether the vector is named.
+     * @param s Whether the vector was represented on file as a scalar.
+     * @param f Format of the strings.
+     */
+    ColumnarStringVector(size_t l, bool n, bool s, StringVector::Format f) : ColumnarVector<StringVector>(l, n, s), my_values(l), my_format(f) {}
+
+    /**
+     * @cond
+     */
+    void set(size_t i, std::string v) {
+        my_values.set(i, v.data(), v.size());
+    }
+
+    void set_view(size_t i, std::string_view v) {
+        my_values.set(i, v.data(), v.size());
+    }
+
+    void set_dictionary(const char* data, const size_t* offsets, size_t nlevels, const int32_t* codes) {
+        my_values.set_dictionary(data, offsets, nlevels, codes);
+    }
+
+    void set_block(size_t start, const char* data, const size_t* offsets, size_t n) {
+        my_values.set_block(start, data, offsets, n);
+    }
+    /**
+     * @endcond
+     */
+
+    /**
+     * @return Values of the strings.
+     * Values of missing elements are unspecified.
+     */
+    const StringColumn& values() const {
+        return my_values;
+    }
+
+    /**
+     * @return Format of the strings.
+     */
+    StringVector::Format format() const {
+        return my_format;
+    }
+
+private:
+    StringColumn my_values;
+    StringVector::Format my_format;
+};
+
+/**
+ * @brief Columnar factor.
+ */
+class ColumnarFactor final : public ColumnarVector<Factor> {
+public:
+    /**
+     * @param arena Arena for the current parse, in which the levels are interned.
+     * @param l Length of the factor.
+     * @param n Whether the factor is named.
+     * @param s Whether the factor was represented on file as a scalar.
+     * @param ll Number of levels.
+     * @param o Whether the levels are ordered.
+     */
+    ColumnarFactor(Arena& arena, size_t l, bool n, bool s, size_t ll, bool o) : ColumnarVector<Factor>(l, n, s), my_codes(l), my_levels(arena, ll), my_ordered(o) {}
+
+    /**
+     * @cond
+     */
+    void set(size_t i, size_t v) {
+        my_codes.data()[i] = v;
+    }
+
+    void set_block(size_t start, const int32_t* values, size_t n) {
+        std::copy_n(values, n, my_codes.data() + start);
+    }
+
+    void set_level(size_t il, std::string vl) {
+        my_levels.set(il, vl);
+    }
+
+    void set_level_view(size_t il, std::string_view vl) {
+        my_levels.set(il, vl);
+    }
+    /**
+     * @endcond
+     */
+
+    /**
+     * @return Pointer to the integer codes, referencing elements of `levels()`.
+     * Codes of missing elements are unspecified.
+     */
+    const int32_t* codes() const {
+        return my_codes.data();
+    }
+
+    /**
+     * @return Levels of the factor.
+     */
+    const InternedColumn& levels() const {
+        return my_levels;
+    }
+
+    /**
+     * @return Whether the levels are ordered.
+     */
+    bool is_ordered() const {
+        return my_ordered;
+    }
+
+private:
+    ColumnBuffer<int32_t> my_codes;
+    InternedColumn my_levels;
+    bool my_ordered;
+};
+
+/**
+ * @brief Columnar list.
+ */
+class ColumnarList final : public List {
+public:
+    /**
+     * @param arena Arena for the current parse, in which the names are interned.
+     * @param l Length of the list.
+     * @param n Whether the list is named.
+     */
+    ColumnarList(Arena& arena, size_t l, bool n) : my_values(l), my_names(arena, n ? l : 0), my_named(n) {}
+
+    /**
+     * @cond
+     */
+    size_t size() const {
+        return my_values.size();
+    }
+
+    void set(size_t i, std::shared_ptr<Base> v) {
+        my_values[i] = v.get();
+    }
+
+    void set_name(size_t i, std::string n) {
+        my_names.set(i, n);
+    }
+
+    void set_name_view(size_t i, std::string_view n) {
+        my_names.set(i, n);
+    }
+
+    void set_name_block(size_t start, const char* data, const size_t* offsets, size_t n) {
+        my_names.set_block(start, data, offsets, n);
+    }
+    /**
+     * @endcond
+     */
+
+    /**
+     * @return Non-owning pointers to the list elements.
+     * These are owned by the `Arena` of the parse that created this list.
+     */
+    const std::vector<const Base*>& values() const {
+        return my_values;
+    }
+
+    /**
+     * @return Whether the list is named.
+     */
+    bool has_names() const {
+        return my_named;
+    }
+
+    /**
+     * @return Names of the list elements.
+     * This should only be used if `has_names()` is true.
+     */
+    const InternedColumn& names() const {
+        return my_names;
+    }
+
+private:
+    std::vector<const Base*> my_values;
+    InternedColumn my_names;
+    bool my_named;
+};
+
+/**
+ * @brief Columnar representation of R's `NULL`.
+ */
+class ColumnarNothing final : public Nothing {};
+
+/**
+ * @brief Columnar representation of an external reference.
+ */
+class ColumnarExternal final : public External {
+public:
+    /**
+     * @param p Pointer to the external object.
+     */
+    ColumnarExternal(void* p) : my_ptr(p) {}
+
+    /**
+     * @return Pointer to the external object.
+     */
+    void* get() const {
+        return my_ptr;
+    }
+
+private:
+    void* my_ptr;
+};
+
+/**
+ * @brief Provisioner for columnar objects.
+ *
+ * This creates objects that store their contents in contiguous typed buffers, preallocated to the lengths supplied by the parser.
+ * Missing values are recorded in lazily allocated validity bitmaps, and strings are stored in a single character arena per vector.
+ * All classes are `final`, so the parsers can call their methods without virtual dispatch.
+ * All objects from a single parse are constructed in the same `Arena`, so lists only hold non-owning pointers to their elements,
+ * and the entire tree is released at once when the last `std::shared_ptr` from the parse (e.g., `ParsedList::ptr`) is destroyed.
+ * Users can pass this class as the `Provisioner_` in `hdf5::parse()` or `json::parse()`,
+ * and cast the resulting `Base` pointers to the corresponding `Columnar*` class based on `Base::type()`.
+ */
+struct ColumnarProvisioner {
+    /**
+     * @param arena Arena for the current parse.
+     * @return A new `NULL` object.
+     */
+    static ColumnarNothing* new_Nothing(Arena& arena) {
+        return arena.create<ColumnarNothing>();
+    }
+
+    /**
+     * @param arena Arena for the current parse.
+     * @param p Pointer to an external object.
+     * @return A new external reference.
+     */
+    static ColumnarExternal* new_External(Arena& arena, void* p) {
+        return arena.create<ColumnarExternal>(p);
+    }
+
+    /**
+     * @param arena Arena for the current parse.
+     * @param l Length of the list.
+     * @param n Whether the list is named.
+     * @return A new list.
+     */
+    static ColumnarList* new_List(Arena& arena, size_t l, bool n) {
+        return arena.create<ColumnarList>(arena, l, n);
+    }
+
+    /**
+     * @param arena Arena for the current parse.
+     * @param l Length of the vector.
+     * @param n Whether the vector is named.
+     * @param s Whether the vector was represented on file as a scalar.
+     * @return A new integer vector.
+     */
+    static ColumnarIntegerVector* new_Integer(Arena& arena, size_t l, bool n, bool s) {
+        return arena.create<ColumnarIntegerVector>(l, n, s);
+    }
+
+    /**
+     * @param arena Arena for the current parse.
+     * @param l Length of the vector.
+     * @param n Whether the vector is named.
+     * @param s Whether the vector was represented on file as a scalar.
+     * @return A new double-precision vector.
+     */
+    static ColumnarNumberVector* new_Number(Arena& arena, size_t l, bool n, bool s) {
+        return arena.create<ColumnarNumberVector>(l, n, s);
+    }
+
+    /**
+     * @param arena Arena for the current parse.
+     * @param l Length of the vector.
+     * @param n Whether the vector is named.
+     * @param s Whether the vector was represented on file as a scalar.
+     * @param f Format of the strings.
+     * @return A new string vector.
+     */
+    static ColumnarStringVector* new_String(Arena& arena, size_t l, bool n, bool s, StringVector::Format f) {
+        return arena.create<ColumnarStringVector>(l, n, s, f);
+    }
+
+    /**
+     * @param arena Arena for the current parse.
+     * @param l Length of the vector.
+     * @param n Whether the vector is named.
+     * @param s Whether the vector was represented on file as a scalar.
+     * @return A new boolean vector.
+     */
+    static ColumnarBooleanVector* new_Boolean(Arena& arena, size_t l, bool n, bool s) {
+        return arena.create<ColumnarBooleanVector>(l, n, s);
+    }
+
+    /**
+     * @param arena Arena for the current parse.
+     * @param l Length of the factor.
+     * @param n Whether the factor is named.
+     * @param s Whether the factor was represented on file as a scalar.
+     * @param ll Number of levels.
+     * @param o Whether the levels are ordered.
+     * @return A new factor.
+     */
+    static ColumnarFactor* new_Factor(Arena& arena, size_t l, bool n, bool s, size_t ll, bool o) {
+        return arena.create<ColumnarFactor>(arena, l, n, s, ll, o);
+    }
+};
+
+/**
+ * @cond
+ */
+// Used by consumers of the columnar objects (e.g., exporters and writers) to check that the tree was created by the ColumnarProvisioner.
+template<class Column_>
+const Column_* cast_columnar(const Base* ptr, const char* context) {
+    auto out = dynamic_cast<const Column_*>(ptr);
+    if (out == NULL) {
+        throw std::runtime_error(std::string(context) + " requires objects created by the ColumnarProvisioner");
+    }
+    return out;
+}
+/**
+ * @endcond
+ */
+
+}
+
+#endif
@@ -0,0 +1,718 @@
+#ifndef UZUKI2_DEDUPLICATOR_HPP
+#define UZUKI2_DEDUPLICATOR_HPP
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
+
+#include "interfaces.hpp"
+#include "Arena.hpp"
+#include "DictionaryEncoder.hpp"
+
+namespace uzuki2 {
+
+/**
+ * @cond
+ */
+/*
+ * Hash-consing of identical subtrees. With a NodeFactory<Deduplicated<P> >,
+ * the parser fills staging objects that only record their contents. Once an
+ * object is complete (i.e., all of its children have been finished), its
+ * contents are hashed into a 64-bit key; if an object with the same key has
+ * been seen before and its staged contents compare equal, the previously
+ * provisioned object is reused, otherwise the staged contents are replayed
+ * into a new object from P. Lists are keyed on the identities of their
+ * (already deduplicated) children, so each list is only hashed once.
+ *
+ * The staged copy of each unique object is kept for the comparison, so the
+ * cache costs about as much memory as the unique content. The size of the
+ * hashed contents is computed before hashing, and objects that exceed the size
+ * limit are provisioned without hashing or caching. Vectors whose length alone
+ * guarantees that they will exceed the limit are not staged at all, so that
+ * the parser fills the provisioned object directly.
+ */
+template<class Provisioner_>
+struct Deduplicated {};
+
+// 64-bit FNV-1a.
+class ContentHasher {
+public:
+    void append_bytes(const void* data, size_t n) {
+        auto ptr = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < n; ++i) {
+            my_hash ^= ptr[i];
+            my_hash *= 1099511628211ull;
+        }
+    }
+
+    uint64_t hash() const {
+        return my_hash;
+    }
+
+private:
+    uint64_t my_hash = 14695981039346656037ull;
+};
+
+template<typename Value_>
+void append_value(ContentHasher& key, const Value_& x) {
+    key.append_bytes(&x, sizeof(Value_));
+}
+
+inline void append_value(ContentHasher& key, const std::string& x) {
+    append_value(key, x.size());
+    key.append_bytes(x.data(), x.size());
+}
+
+// Number of bytes that append_value() would hash.
+template<typename Value_>
+size_t value_size(const Value_&) {
+    return sizeof(Value_);
+}
+
+inline size_t value_size(const std::string& x) {
+    return sizeof(size_t) + x.size();
+}
+
+inline size_t strings_size(const std::vector<std::string>& x) {
+    size_t total = 0;
+    for (const auto& y : x) {
+        total += value_size(y);
+    }
+    return total;
+}
+
+// Bitwise comparison to match the hash, e.g., so that NaNs are equal to themselves.
+template<typename Value_>
+bool same_value(const Value_& left, const Value_& right) {
+    return std::memcmp(&left, &right, sizeof(Value_)) == 0;
+}
+
+inline bool same_value(const std::string& left, const std::string& right) {
+    return left == right;
+}
+
+inline void pack_strings(const std::vector<std::string>& strings, std::string& data, std::vector<size_t>& offsets) {
+    offsets.clear();
+    offsets.reserve(strings.size() + 1);
+    offsets.push_back(0);
+    for (const auto& x : strings) {
+        data += x;
+        offsets.push_back(data.size());
+    }
+}
+
+template<class Host_>
+void replay_names(const std::vector<std::string>& names, Host_* host) {
+    if (names.empty()) {
+        return;
+    }
+    std::string data;
+    std::vector<size_t> offsets;
+    pack_strings(names, data, offsets);
+    host->set_name_block(0, data.data(), offsets.data(), names.size());
+}
+
+template<class Interface_, typename Value_>
+class StagedVector : public Interface_ {
+public:
+    StagedVector(size_t l, bool n, bool s) : my_values(l), my_missing(l), my_scalar(s) {
+        if (n) {
+            my_names.resize(l);
+        }
+    }
+
+    size_t size() const {
+        return my_values.size();
+    }
+
+    // Lower bound for vector_size(), based only on the arguments to the constructor.
+    static size_t minimum_size(size_t l, bool n) {
+        size_t per_element = sizeof(uint8_t) + (std::is_same<Value_, std::string>::value ? sizeof(size_t) : sizeof(Value_));
+        if (n) {
+            per_element += sizeof(size_t);
+        }
+        return sizeof(Type) + sizeof(size_t) + 2 * sizeof(bool) + l * per_element;
+    }
+
+    void set_missing(size_t i) {
+        my_missing[i] = 1;
+    }
+
+    void set_missing_block(size_t start, const uint8_t* bitmap, size_t n) {
+        for (size_t j = 0; j < n; ++j) {
+            if (bitmap[j / 8] & (1u << (j % 8))) {
+                my_missing[start + j] = 1;
+            }
+        }
+    }
+
+    void set_name(size_t i, std::string n) {
+        my_names[i] = std::move(n);
+    }
+
+    void set_name_view(size_t i, std::string_view n) {
+        my_names[i] = n;
+    }
+
+    void set_name_block(size_t start, const char* data, const size_t* offsets, size_t n) {
+        for (size_t j = 0; j < n; ++j) {
+            my_names[start + j].assign(data + offsets[j], offsets[j + 1] - offsets[j]);
+        }
+    }
+
+protected:
+    std::vector<Value_> my_values;
+    std::vector<uint8_t> my_missing;
+    std::vector<std::string> my_names;
+    bool my_scalar;
+
+    void fingerprint_vector(ContentHasher& key) const {
+        append_value(key, this->type());
+        append_value(key, size());
+        append_value(key, my_scalar);
+        append_value(key, !my_names.empty());
+
+        // Values of missing elements are ignored, as these may be arbitrary placeholders.
+        const Value_ empty{};
+        for (size_t i = 0, n = size(); i < n; ++i) {
+            append_value(key, my_missing[i]);
+            const Value_& x = (my_missing[i] ? empty : my_values[i]);
+            append_value(key, x);
+        }
+        for (const auto& x : my_names) {
+            append_value(key, x);
+        }
+    }
+
+    size_t vector_size() const {
+        size_t total = sizeof(Type) + sizeof(size_t) + 2 * sizeof(bool) + size() * sizeof(uint8_t);
+        if constexpr(std::is_same<Value_, std::string>::value) {
+            for (size_t i = 0, n = size(); i < n; ++i) {
+                total += (my_missing[i] ? value_size(std::string()) : value_size(my_values[i]));
+            }
+        } else {
+            total += size() * sizeof(Value_);
+        }
+        return total + strings_size(my_names);
+    }
+
+    bool same_vector(const StagedVector& other) const {
+        if (my_scalar != other.my_scalar || my_missing != other.my_missing || my_names != other.my_names) {
+            return false;
+        }
+        for (size_t i = 0, n = size(); i < n; ++i) {
+            if (!my_missing[i] && !same_value(my_values[i], other.my_values[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template<class Host_>
+    void replay_missing(Host_* host) const {
+        size_t n = size();
+        std::vector<uint8_t> bitmap((n + 7) / 8);
+        bool any = false;
+        for (size_t i = 0; i < n; ++i) {
+            if (my_missing[i]) {
+                bitmap[i / 8] |= (1u << (i % 8));
+                any = true;
+            }
+        }
+        if (any) {
+            host->set_missing_block(0, bitmap.data(), n);
+        }
+    }
+};
+
+class StagedIntegerVector final : public StagedVector<IntegerVector, int32_t> {
+public:
+    StagedIntegerVector(size_t l, bool n, bool s) : StagedVector(l, n, s) {}
+
+    void set(size_t i, int32_t v) {
+        my_values[i] = v;
+    }
+
+    void set_block(size_t start, const int32_t* values, size_t n) {
+        std::copy_n(values, n, my_values.begin() + start);
+    }
+
+    size_t fingerprint_size() const {
+        return vector_size();
+    }
+
+    void fingerprint(ContentHasher& key) const {
+        fingerprint_vector(key);
+    }
+
+    bool same_as(const StagedVector& other) const {
+        return same_vector(other);
+    }
+
+    template<class Nodes_>
+    void provision(Nodes_& nodes, std::shared_ptr<Base>& output) const {
+        auto ptr = nodes.new_Integer(output, size(), !my_names.empty(), my_scalar);
+        ptr->set_block(0, my_values.data(), size());
+        replay_missing(ptr);
+        replay_names(my_names, ptr);
+    }
+};
+
+class StagedNumberVector final : public StagedVector<NumberVector, double> {
+public:
+    StagedNumberVector(size_t l, bool n, bool s) : StagedVector(l, n, s) {}
+
+    void set(size_t i, double v) {
+        my_values[i] = v;
+    }
+
+    void set_block(size_t start, const double* values, size_t n) {
+        std::copy_n(values, n, my_values.begin() + start);
+    }
+
+    size_t fingerprint_size() const {
+        return vector_size();
+    }
+
+    void fingerprint(ContentHasher& key) const {
+        fingerprint_vector(key);
+    }
+
+    bool same_as(const StagedVector& other) const {
+        return same_vector(other);
+    }
+
+    template<class Nodes_>
+    void provision(Nodes_& nodes, std::shared_ptr<Base>& output) const {
+        auto ptr = nodes.new_Number(output, size(), !my_names.empty(), my_scalar);
+        ptr->set_block(0, my_values.data(), size());
+        replay_missing(ptr);
+        replay_names(my_names, ptr);
+    }
+};
+
+class StagedBooleanVector final : public StagedVector<BooleanVector, int32_t> {
+public:
+    StagedBooleanVector(size_t l, bool n, bool s) : StagedVector(l, n, s) {}
+
+    void set(size_t i, bool v) {
+        my_values[i] = v;
+    }
+
+    void set_block(size_t start, const int32_t* values, size_t n) {
+        std::copy_n(values, n, my_values.begin() + start);
+    }
+
+    size_t fingerprint_size() const {
+        return vector_size();
+    }
+
+    void fingerprint(ContentHasher& key) const {
+        fingerprint_vector(key);
+    }
+
+    bool same_as(const StagedVector& other) const {
+        return same_vector(other);
+    }
+
+    template<class Nodes_>
+    void provision(Nodes_& nodes, std::shared_ptr<Base>& output) const {
+        auto ptr = nodes.new_Boolean(output, size(), !my_names.empty(), my_scalar);
+        ptr->set_block(0, my_values.data(), size());
+        replay_missing(ptr);
+        replay_names(my_names, ptr);
+    }
+};
+
+class StagedFactor final : public StagedVector<Factor, int32_t> {
+public:
+    StagedFactor(size_t l, bool n, bool s, size_t ll, bool o) : StagedVector(l, n, s), my_levels(ll), my_ordered(o) {}
+
+    void set(size_t i, size_t v) {
+        my_values[i] = v;
+    }
+
+    void set_block(size_t start, const int32_t* values, size_t n) {
+        std::copy_n(values, n, my_values.begin() + start);
+    }
+
+    void set_level(size_t il, std::string vl) {
+        my_levels[il] = std::move(vl);
+    }
+
+    void set_level_view(size_t il, std::string_view vl) {
+        my_levels[il] = vl;
+    }
+
+    size_t fingerprint_size() const {
+        return vector_size() + sizeof(bool) + sizeof(size_t) + strings_size(my_levels);
+    }
+
+    void fingerprint(ContentHasher& key) const {
+        fingerprint_vector(key);
+        append_value(key, my_ordered);
+        append_value(key, my_levels.size());
+        for (const auto& l : my_levels) {
+            append_value(key, l);
+        }
+    }
+
+    bool same_as(const StagedFactor& other) const {
+        return same_vector(other) && my_ordered == other.my_ordered && my_levels == other.my_levels;
+    }
+
+    template<class Nodes_>
+    void provision(Nodes_& nodes, std::shared_ptr<Base>& output) const {
+        auto ptr = nodes.new_Factor(output, size(), !my_names.empty(), my_scalar, my_levels.size(), my_ordered);
+        ptr->set_block(0, my_values.data(), size());
+        replay_missing(ptr);
+        for (size_t l = 0, nl = my_levels.size(); l < nl; ++l) {
+            ptr->set_level_view(l, my_levels[l]);
+        }
+        replay_names(my_names, ptr);
+    }
+
+private:
+    std::vector<std::string> my_levels;
+    bool my_ordered;
+};
+
+class StagedStringVector final : public StagedVector<StringVector, std::string> {
+public:
+    StagedStringVector(size_t l, bool n, bool s, StringVector::Format f) : StagedVector(l, n, s), my_format(f) {}
+
+    void set(size_t i, std::string v) {
+        my_values[i] = std::move(v);
+    }
+
+    void set_view(size_t i, std::string_view v) {
+        my_values[i] = v;
+    }
+
+    void set_block(size_t start, const char* data, const size_t* offsets, size_t n) {
+        for (size_t j = 0; j < n; ++j) {
+            my_values[start + j].assign(data + offsets[j], offsets[j + 1] - offsets[j]);
+        }
+    }
+
+    void set_dictionary(const char* data, const size_t* offsets, size_t nlevels, const int32_t* codes) {
+        for (size_t i = 0, n = size(); i < n; ++i) {
+            auto c = codes[i];
+            if (c >= 0) {
+                my_values[i].assign(data + offsets[c], offsets[c + 1] - offsets[c]);
+            }
+        }
+        my_dictionary_levels = nlevels;
+    }
+
+    size_t fingerprint_size() const {
+        return vector_size() + sizeof(StringVector::Format);
+    }
+
+    void fingerprint(ContentHasher& key) const {
+        fingerprint_vector(key);
+        append_value(key, my_format);
+    }
+
+    bool same_as(const StagedStringVector& other) const {
+        return same_vector(other) && my_format == other.my_format;
+    }
+
+    template<class Nodes_>
+    void provision(Nodes_& nodes, std::shared_ptr<Base>& output) const {
+        auto ptr = nodes.new_String(output, size(), !my_names.empty(), my_scalar, my_format);
+
+        // Re-encoding if the parser delivered a dictionary, so that the provisioned object sees the same calls as it would without deduplication.
+        // The empty strings of missing elements are not counted as levels, as they are marked as missing before the encoder checks its limit.
+        maybe_dictionary_encode(ptr, my_dictionary_levels, [&](auto* host) -> void {
+            std::string data;
+            std::vector<size_t> offsets;
+            pack_strings(my_values, data, offsets);
+            host->set_block(0, data.data(), offsets.data(), size());
+            replay_missing(host);
+        });
+
+        replay_names(my_names, ptr);
+    }
+
+private:
+    StringVector::Format my_format;
+    size_t my_dictionary_levels = 0;
+};
+
+class StagedNothing final : public Nothing {
+public:
+    size_t fingerprint_size() const {
+        return sizeof(Type);
+    }
+
+    void fingerprint(ContentHasher& key) const {
+        append_value(key, type());
+    }
+
+    bool same_as(const StagedNothing&) const {
+        return true;
+    }
+
+    template<class Nodes_>
+    void provision(Nodes_& nodes, std::shared_ptr<Base>& output) const {
+        nodes.new_Nothing(output);
+    }
+};
+
+class StagedExternal final : public External {
+public:
+    StagedExternal(void* p) : my_ptr(p) {}
+
+    size_t fingerprint_size() const {
+        return sizeof(Type) + sizeof(void*);
+    }
+
+    void fingerprint(ContentHasher& key) const {
+        append_value(key, type());
+        append_value(key, my_ptr);
+    }
+
+    bool same_as(const StagedExternal& other) const {
+        return my_ptr == other.my_ptr;
+    }
+
+    template<class Nodes_>
+    void provision(Nodes_& nodes, std::shared_ptr<Base>& output) const {
+        nodes.new_External(output, my_ptr);
+    }
+
+private:
+    void* my_ptr;
+};
+
+class StagedList final : public List {
+public:
+    StagedList(size_t l, bool n) : my_values(l) {
+        if (n) {
+            my_names.resize(l);
+        }
+    }
+
+    size_t size() const {
+        return my_values.size();
+    }
+
+    void set(size_t i, std::shared_ptr<Base> v) {
+        my_values[i] = std::move(v);
+    }
+
+    void set_name(size_t i, std::string n) {
+        my_names[i] = std::move(n);
+    }
+
+    void set_name_view(size_t i, std::string_view n) {
+        my_names[i] = n;
+    }
+
+    void set_name_block(size_t start, const char* data, const size_t* offsets, size_t n) {
+        for (size_t j = 0; j < n; ++j) {
+            my_names[start + j].assign(data + offsets[j], offsets[j + 1] - offsets[j]);
+        }
+    }
+
+    size_t fingerprint_size() const {
+        return sizeof(Type) + sizeof(size_t) + sizeof(bool) + size() * sizeof(Base*) + strings_size(my_names);
+    }
+
+    // Children have already been deduplicated, so identical children are the same object.
+    void fingerprint(ContentHasher& key) const {
+        append_value(key, type());
+        append_value(key, size());
+        append_value(key, !my_names.empty());
+        for (const auto& x : my_values) {
+            append_value(key, x.get());
+        }
+        for (const auto& x : my_names) {
+            append_value(key, x);
+        }
+    }
+
+    bool same_as(const StagedList& other) const {
+        return my_values == other.my_values && my_names == other.my_names;
+    }
+
+    template<class Nodes_>
+    void provision(Nodes_& nodes, std::shared_ptr<Base>& output) const {
+        auto ptr = nodes.new_List(output, size(), !my_names.empty());
+        for (size_t i = 0, n = size(); i < n; ++i) {
+            ptr->set(i, my_values[i]);
+        }
+        replay_names(my_names, ptr);
+    }
+
+private:
+    std::vector<std::shared_ptr<Base> > my_values;
+    std::vector<std::string> my_names;
+};
+
+template<class Provisioner_>
+class NodeFactory<Deduplicated<Provisioner_> > {
+private:
+    NodeFactory<Provisioner_> my_nodes;
+    size_t my_max_size;
+
+    // Objects with the same hash are distinguished by comparing their staged contents.
+    struct CachedObject {
+        std::shared_ptr<Base> staged;
+        std::shared_ptr<Base> provisioned;
+    };
+    std::unordered_map<uint64_t, std::vector<CachedObject> > my_cache;
+
+    // Objects that were provisioned without staging, which are returned as-is by finish().
+    std::unordered_set<const Base*> my_direct;
+
+    template<class Staged_, typename ... Args_>
+    static Staged_* stage(std::shared_ptr<Base>& output, Args_ ... args) {
+        auto ptr = new Staged_(args...);
+        output.reset(ptr);
+        return ptr;
+    }
+
+    template<class Vector_>
+    Vector_* direct(const std::shared_ptr<Base>& output, Vector_* ptr) {
+        my_direct.insert(output.get());
+        return ptr;
+    }
+
+    template<class Function_>
+    static void visit(Base* ptr, Function_ fun) {
+        switch (ptr->type()) {
+            case INTEGER:
+                fun(static_cast<StagedIntegerVector*>(ptr));
+                break;
+            case NUMBER:
+                fun(static_cast<StagedNumberVector*>(ptr));
+                break;
+            case STRING:
+                fun(static_cast<StagedStringVector*>(ptr));
+                break;
+            case BOOLEAN:
+                fun(static_cast<StagedBooleanVector*>(ptr));
+                break;
+            case FACTOR:
+                fun(static_cast<StagedFactor*>(ptr));
+                break;
+            case LIST:
+                fun(static_cast<StagedList*>(ptr));
+                break;
+            case NOTHING:
+                fun(static_cast<StagedNothing*>(ptr));
+                break;
+            case EXTERNAL:
+                fun(static_cast<StagedExternal*>(ptr));
+                break;
+        }
+    }
+
+public:
+    NodeFactory(size_t max_size) : my_max_size(max_size) {}
+
+    auto new_Nothing(std::shared_ptr<Base>& output) {
+        return stage<StagedNothing>(output);
+    }
+
+    auto new_External(std::shared_ptr<Base>& output, void* p) {
+        return stage<StagedExternal>(output, p);
+    }
+
+    auto new_List(std::shared_ptr<Base>& output, size_t l, bool n) {
+        return stage<StagedList>(output, l, n);
+    }
+
+    // Vectors that are already over the size limit based on their length would never be cached, so they skip the staged copy.
+    IntegerVector* new_Integer(std::shared_ptr<Base>& output, size_t l, bool n, bool s) {
+        if (StagedIntegerVector::minimum_size(l, n) > my_max_size) {
+            return direct(output, my_nodes.new_Integer(output, l, n, s));
+        }
+        return stage<StagedIntegerVector>(output, l, n, s);
+    }
+
+    NumberVector* new_Number(std::shared_ptr<Base>& output, size_t l, bool n, bool s) {
+        if (StagedNumberVector::minimum_size(l, n) > my_max_size) {
+            return direct(output, my_nodes.new_Number(output, l, n, s));
+        }
+        return stage<StagedNumberVector>(output, l, n, s);
+    }
+
+    StringVector* new_String(std::shared_ptr<Base>& output, size_t l, bool n, bool s, StringVector::Format f) {
+        if (StagedStringVector::minimum_size(l, n) > my_max_size) {
+            return direct(output, my_nodes.new_String(output, l, n, s, f));
+        }
+        return stage<StagedStringVector>(output, l, n, s, f);
+    }
+
+    BooleanVector* new_Boolean(std::shared_ptr<Base>& output, size_t l, bool n, bool s) {
+        if (StagedBooleanVector::minimum_size(l, n) > my_max_size) {
+            return direct(output, my_nodes.new_Boolean(output, l, n, s));
+        }
+        return stage<StagedBooleanVector>(output, l, n, s);
+    }
+
+    Factor* new_Factor(std::shared_ptr<Base>& output, size_t l, bool n, bool s, size_t ll, bool o) {
+        if (StagedFactor::minimum_size(l, n) > my_max_size) {
+            return direct(output, my_nodes.new_Factor(output, l, n, s, ll, o));
+        }
+        return stage<StagedFactor>(output, l, n, s, ll, o);
+    }
+
+    std::shared_ptr<Base> finish(std::shared_ptr<Base> staged) {
+        if (my_direct.erase(staged.get())) {
+            return staged;
+        }
+
+        size_t size = 0;
+        visit(staged.get(), [&](auto* ptr) -> void { size = ptr->fingerprint_size(); });
+
+        std::shared_ptr<Base> output;
+        if (size > my_max_size) {
+            visit(staged.get(), [&](auto* ptr) -> void { ptr->provision(my_nodes, output); });
+            return output;
+        }
+
+        ContentHasher key;
+        visit(staged.get(), [&](auto* ptr) -> void { ptr->fingerprint(key); });
+
+        auto& candidates = my_cache[key.hash()];
+        for (const auto& cached : candidates) {
+            if (cached.staged->type() != staged->type()) {
+                continue;
+            }
+            bool same = false;
+            visit(staged.get(), [&](auto* ptr) -> void {
+                typedef typename std::remove_pointer<decltype(ptr)>::type Staged;
+                same = ptr->same_as(*static_cast<const Staged*>(cached.staged.get()));
+            });
+            if (same) {
+                return cached.provisioned;
+            }
+        }
+
+        visit(staged.get(), [&](auto* ptr) -> void { ptr->provision(my_nodes, output); });
+        candidates.push_back(CachedObject{ std::move(staged), output });
+        return output;
+    }
+
+    std::shared_ptr<Base> release(std::shared_ptr<Base> root) {
+        return my_nodes.release(std::move(root));
+    }
+};
+/**
+ * @endcond
+ */
+
+}
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef UZUKI2_DICTIONARY_ENCODER_HPP
+#define UZUKI2_DICTIONARY_ENCODER_HPP
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <cstdint>
+
+/**
+ * @file DictionaryEncoder.hpp
+ * @brief Dictionary encoding of string vectors during parsing.
+ */
+
+namespace uzuki2 {
+
+/**
+ * @cond
+ */
+/*
+ * Sits between the parser and a StringVector, collecting the distinct
+ * strings and a code per element. If the number of distinct strings stays
+ * within the limit, the vector is delivered in one set_dictionary() call at
+ * the end; otherwise, the codes so far are expanded back into strings and
+ * the remaining elements are passed through unchanged.
+ *
+ * Only levels that are used by non-missing elements count towards the limit.
+ * Encoding is abandoned as soon as an added string exceeds the limit, so
+ * large vectors with many distinct strings are not held in the dictionary.
+ * Inside set_block(), one extra level is tolerated for the placeholder of
+ * missing values, which is only released by the following
+ * set_missing_block(); the exact limit is then enforced before the next
+ * set*() call and in finish().
+ */
+template<class Host_>
+class DictionaryEncoder {
+public:
+    DictionaryEncoder(Host_* host, size_t max_levels) : my_host(host), my_max_levels(max_levels), my_codes(host->size(), -1) {}
+
+    size_t size() const {
+        return my_host->size();
+    }
+
+    void set(size_t i, std::string x) {
+        set_view(i, x);
+    }
+
+    void set_view(size_t i, std::string_view x) {
+        check_limit();
+        if (my_encoding) {
+            add(i, x, my_max_levels);
+        } else {
+            my_host->set_view(i, x);
+        }
+    }
+
+    void set_block(size_t start, const char* data, const size_t* offsets, size_t n) {
+        check_limit();
+        if (!my_encoding) {
+            my_host->set_block(start, data, offsets, n);
+            return;
+        }
+
+        for (size_t j = 0; j < n; ++j) {
+            std::string_view x(data + offsets[j], offsets[j + 1] - offsets[j]);
+            if (my_encoding) {
+                add(start + j, x, my_max_levels + 1);
+            } else {
+                my_host->set_view(start + j, x);
+            }
+        }
+    }
+
+    void set_missing(size_t i) {
+        if (my_encoding) {
+            release(i);
+        }
+        my_host->set_missing(i);
+    }
+
+    void set_missing_block(size_t start, const uint8_t* bitmap, size_t n) {
+        if (my_encoding) {
+            for (size_t j = 0; j < n; ++j) {
+                if (bitmap[j / 8] & (1u << (j % 8))) {
+                    release(start + j);
+                }
+            }
+        }
+        my_host->set_missing_block(start, bitmap, n);
+    }
+
+    void finish() {
+        check_limit();
+        if (!my_encoding) {
+            return;
+        }
+
+        // Dropping levels that are no longer used by any element, e.g., placeholders in fixed-width blocks.
+        std::vector<int32_t> remapping(my_levels.size(), -1);
+        std::string data;
+        std::vector<size_t> offsets(1);
+        for (size_t l = 0; l < my_levels.size(); ++l) {
+            if (my_counts[l]) {
+                remapping[l] = offsets.size() - 1;
+                data += my_levels[l];
+                offsets.push_back(data.size());
+            }
+        }
+        for (auto& c : my_codes) {
+            if (c >= 0) {
+                c = remapping[c];
+            }
+        }
+
+        my_host->set_dictionary(data.data(), offsets.data(), offsets.size() - 1, my_codes.data());
+    }
+
+private:
+    Host_* my_host;
+    size_t my_max_levels;
+    bool my_encoding = true;
+    std::vector<int32_t> my_codes;
+    std::deque<std::string> my_levels; // deque to keep the lookup keys valid.
+    std::vector<size_t> my_counts; // number of elements using each level.
+    size_t my_used = 0; // number of levels with non-zero counts.
+    std::unordered_map<std::string_view, int32_t> my_lookup;
+
+    void release(size_t i) {
+        auto& c = my_codes[i];
+        if (c >= 0) {
+            if (--my_counts[c] == 0) {
+                --my_used;
+            }
+            c = -1;
+        }
+    }
+
+    void add(size_t i, std::string_view x, size_t limit) {
+        int32_t code;
+        auto it = my_lookup.find(x);
+        if (it != my_lookup.end()) {
+            code = it->second;
+        } else {
+            code = my_levels.size();
+            my_levels.emplace_back(x);
+            my_counts.push_back(0);
+            my_lookup[my_levels.back()] = code;
+        }
+
+        release(i);
+        my_codes[i] = code;
+        if (my_counts[code]++ == 0) {
+            if (++my_used > limit) {
+                abandon();
+            }
+        }
+    }
+
+    void check_limit() {
+        if (my_encoding && my_used > my_max_levels) {
+            abandon();
+        }
+    }
+
+    void abandon() {
+        my_encoding = false;
+        for (size_t i = 0, n = my_codes.size(); i < n; ++i) {
+            auto c = my_codes[i];
+            if (c >= 0) {
+                my_host->set_view(i, my_levels[c]);
+            }
+        }
+        my_lookup.clear();
+        my_levels.clear();
+        my_counts.clear();
+        my_codes.clear();
+    }
+};
+
+template<class Host_, class Function_>
+void maybe_dictionary_encode(Host_* host, size_t max_levels, Function_ fun) {
+    if (max_levels) {
+        DictionaryEncoder<Host_> encoder(host, max_levels);
+        fun(&encoder);
+        encoder.finish();
+    } else {
+        fun(host);
+    }
+}
+
+/**
+ * @endcond
+ */
+
+}
+
+#endif
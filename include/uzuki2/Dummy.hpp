@@ -4,6 +4,7 @@
 #include <vector>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <cstdint>
 
 #include "interfaces.hpp"
@@ -24,8 +25,12 @@ public:
     DummyIntegerVector(size_t l, bool, bool) : my_length(l) {}
     size_t size() const { return my_length; }
     void set(size_t, int32_t) {}
+    void set_block(size_t, const int32_t*, size_t) {}
     void set_missing(size_t) {}
+    void set_missing_block(size_t, const uint8_t*, size_t) {}
     void set_name(size_t, std::string) {}
+    void set_name_view(size_t, std::string_view) {}
+    void set_name_block(size_t, const char*, const size_t*, size_t) {}
 private:
     size_t my_length;
 };
@@ -35,8 +40,12 @@ public:
     DummyNumberVector(size_t l, bool, bool) : my_length(l) {}
     size_t size() const { return my_length; }
     void set(size_t, double) {}
+    void set_block(size_t, const double*, size_t) {}
     void set_missing(size_t) {}
+    void set_missing_block(size_t, const uint8_t*, size_t) {}
     void set_name(size_t, std::string) {}
+    void set_name_view(size_t, std::string_view) {}
+    void set_name_block(size_t, const char*, const size_t*, size_t) {}
 private:
     size_t my_length;
 };
@@ -46,8 +55,14 @@ public:
     DummyStringVector(size_t l, bool, bool, StringVector::Format) : my_length(l) {}
     size_t size() const { return my_length; }
     void set(size_t, std::string) {}
+    void set_view(size_t, std::string_view) {}
+    void set_block(size_t, const char*, const size_t*, size_t) {}
+    void set_dictionary(const char*, const size_t*, size_t, const int32_t*) {}
     void set_missing(size_t) {}
+    void set_missing_block(size_t, const uint8_t*, size_t) {}
     void set_name(size_t, std::string) {}
+    void set_name_view(size_t, std::string_view) {}
+    void set_name_block(size_t, const char*, const size_t*, size_t) {}
 private:
     size_t my_length;
 };
@@ -57,8 +72,12 @@ public:
     DummyBooleanVector(size_t l, bool, bool) : my_length(l) {}
     size_t size() const { return my_length; }
     void set(size_t, bool) {}
+    void set_block(size_t, const int32_t*, size_t) {}
     void set_missing(size_t) {}
+    void set_missing_block(size_t, const uint8_t*, size_t) {}
     void set_name(size_t, std::string) {}
+    void set_name_view(size_t, std::string_view) {}
+    void set_name_block(size_t, const char*, const size_t*, size_t) {}
 private:
     size_t my_length;
 };
@@ -68,9 +87,14 @@ public:
     DummyFactor(size_t l, bool, bool, size_t, bool) : my_length(l) {}
     size_t size() const { return my_length; }
     void set(size_t, size_t) {}
+    void set_block(size_t, const int32_t*, size_t) {}
     void set_missing(size_t) {}
+    void set_missing_block(size_t, const uint8_t*, size_t) {}
     void set_name(size_t, std::string) {}
+    void set_name_view(size_t, std::string_view) {}
+    void set_name_block(size_t, const char*, const size_t*, size_t) {}
     void set_level(size_t, std::string) {}
+    void set_level_view(size_t, std::string_view) {}
 private:
     size_t my_length;
 };
@@ -87,6 +111,8 @@ public:
     size_t size() const { return my_length; }
     void set(size_t, std::shared_ptr<Base>) {}
     void set_name(size_t, std::string) {}
+    void set_name_view(size_t, std::string_view) {}
+    void set_name_block(size_t, const char*, const size_t*, size_t) {}
 private:
     size_t my_length;
 };
@@ -94,27 +120,27 @@ private:
 /** Dummy provisioner. **/
 
 struct DummyProvisioner {
-    static Nothing* new_Nothing() { return (new DummyNothing); }
+    static DummyNothing* new_Nothing() { return (new DummyNothing); }
 
-    static External* new_External(void*) { return (new DummyExternal); }
+    static DummyExternal* new_External(void*) { return (new DummyExternal); }
 
     template<class ... Args_>
-    static List* new_List(Args_&& ... args) { return (new DummyList(std::forward<Args_>(args)...)); }
+    static DummyList* new_List(Args_&& ... args) { return (new DummyList(std::forward<Args_>(args)...)); }
 
     template<class ... Args_>
-    static IntegerVector* new_Integer(Args_&& ... args) { return (new DummyIntegerVector(std::forward<Args_>(args)...)); }
+    static DummyIntegerVector* new_Integer(Args_&& ... args) { return (new DummyIntegerVector(std::forward<Args_>(args)...)); }
 
     template<class ... Args_>
-    static NumberVector* new_Number(Args_&& ... args) { return (new DummyNumberVector(std::forward<Args_>(args)...)); }
+    static DummyNumberVector* new_Number(Args_&& ... args) { return (new DummyNumberVector(std::forward<Args_>(args)...)); }
 
     template<class ... Args_>
-    static StringVector* new_String(Args_&& ... args) { return (new DummyStringVector(std::forward<Args_>(args)...)); }
+    static DummyStringVector* new_String(Args_&& ... args) { return (new DummyStringVector(std::forward<Args_>(args)...)); }
 
     template<class ... Args_>
-    static BooleanVector* new_Boolean(Args_&& ... args) { return (new DummyBooleanVector(std::forward<Args_>(args)...)); }
+    static DummyBooleanVector* new_Boolean(Args_&& ... args) { return (new DummyBooleanVector(std::forward<Args_>(args)...)); }
 
     template<class ... Args_>
-    static Factor* new_Factor(Args_&& ... args) { return (new DummyFactor(std::forward<Args_>(args)...)); }
+    static DummyFactor* new_Factor(Args_&& ... args) { return (new DummyFactor(std::forward<Args_>(args)...)); }
 };
 /**
  * @endcond
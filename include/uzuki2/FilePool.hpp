@@ -0,0 +1,192 @@
+#ifndef UZUKI2_FILE_POOL_HPP
+#define UZUKI2_FILE_POOL_HPP
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <filesystem>
+#include <system_error>
+#include <stdexcept>
+#include <cstdint>
+
+#ifndef UZUKI2_FILE_POOL_USE_STAT
+#if __has_include(<sys/stat.h>)
+#define UZUKI2_FILE_POOL_USE_STAT 1
+#else
+#define UZUKI2_FILE_POOL_USE_STAT 0
+#endif
+#endif
+
+#if UZUKI2_FILE_POOL_USE_STAT
+#include <sys/stat.h>
+#endif
+
+#include "H5Cpp.h"
+
+/**
+ * @file FilePool.hpp
+ * @brief Pool of open HDF5 file handles.
+ */
+
+namespace uzuki2 {
+
+namespace hdf5 {
+
+/**
+ * @brief Pool of open HDF5 file handles.
+ *
+ * This caches up to a fixed number of read-only `H5::H5File` handles so that repeated parsing of the same file does not need to re-open it,
+ * i.e., re-read the superblock and discard the metadata cache on every call.
+ * Handles are keyed by the file path, and each handle is checked against the file's modification time, size and (where `stat()` is available) device and inode numbers.
+ * If any of these differ from when the file was opened, e.g., because the file was replaced or truncated, the file is re-opened on the next request.
+ * A file that is modified in place without changing its size, within the resolution of the file system's modification times, will not be detected;
+ * applications that do so should call `clear()` after each modification.
+ * Once the pool is full, the least recently used handle is evicted.
+ *
+ * A pool can be shared across threads, as all access to the cached handles is protected by a mutex.
+ * Note that the HDF5 library itself is only safe to call from multiple threads if it was built with thread safety enabled.
+ *
+ * Evicted handles are released by the pool but remain valid for any caller that is still holding a copy.
+ * The same applies to stale handles that are dropped when a file has changed.
+ * However, HDF5 identifies an already-open file by its device and inode numbers,
+ * so if a file is modified in place while any handle (or object opened from it) is still alive,
+ * re-opening it will re-use HDF5's existing state for that file and may not reflect the modifications.
+ * Applications should release all handles to a file before modifying it in place, or replace the file via a rename instead.
+ *
+ * Files are opened without holding the pool's mutex, so a slow open does not block requests for other files.
+ * If multiple threads request the same uncached file at once, each may open it, but only one handle is kept in the pool.
+ */
+class FilePool {
+public:
+    /**
+     * @param capacity Maximum number of open handles to cache.
+     * If zero, files are always opened anew.
+     */
+    FilePool(size_t capacity = 16) : my_capacity(capacity) {}
+
+    /**
+     * @param path Path to a HDF5 file.
+     * @return Read-only handle to the file.
+     * This is either taken from the pool or freshly opened and added to the pool.
+     */
+    H5::H5File open(const std::string& path) {
+        auto current = stamp(path);
+
+        {
+            std::lock_guard<std::mutex> lock(my_lock);
+            auto found = my_index.find(path);
+            if (found != my_index.end()) {
+                auto it = found->second;
+                if (it->stamp == current) {
+                    my_entries.splice(my_entries.begin(), my_entries, it);
+                    return it->handle;
+                }
+                my_entries.erase(it);
+                my_index.erase(found);
+            }
+        }
+
+        // Opening the file may be slow, so it is done outside the lock.
+        H5::H5File handle(path, H5F_ACC_RDONLY);
+        if (my_capacity == 0) {
+            return handle;
+        }
+
+        std::lock_guard<std::mutex> lock(my_lock);
+        auto found = my_index.find(path);
+        if (found != my_index.end()) {
+            auto it = found->second;
+            if (it->stamp == current) {
+                // Another thread opened the same file in the meantime, so we use its handle and drop ours.
+                my_entries.splice(my_entries.begin(), my_entries, it);
+                return it->handle;
+            }
+            my_entries.erase(it);
+            my_index.erase(found);
+        }
+
+        my_entries.push_front(Entry{ path, current, handle });
+        my_index[path] = my_entries.begin();
+        while (my_entries.size() > my_capacity) {
+            my_index.erase(my_entries.back().path);
+            my_entries.pop_back();
+        }
+
+        return handle;
+    }
+
+    /**
+     * @return Number of handles currently in the pool.
+     */
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(my_lock);
+        return my_entries.size();
+    }
+
+    /**
+     * @return Maximum number of handles in the pool.
+     */
+    size_t capacity() const {
+        return my_capacity;
+    }
+
+    /**
+     * Release all handles in the pool.
+     */
+    void clear() {
+        std::lock_guard<std::mutex> lock(my_lock);
+        my_index.clear();
+        my_entries.clear();
+    }
+
+private:
+    struct FileStamp {
+        std::filesystem::file_time_type mtime;
+        uintmax_t size = 0;
+        uint64_t device = 0;
+        uint64_t inode = 0;
+
+        bool operator==(const FileStamp& other) const {
+            return mtime == other.mtime && size == other.size && device == other.device && inode == other.inode;
+        }
+    };
+
+    static FileStamp stamp(const std::string& path) {
+        FileStamp output;
+        std::error_code ec;
+        output.mtime = std::filesystem::last_write_time(path, ec);
+        if (!ec) {
+            output.size = std::filesystem::file_size(path, ec);
+        }
+        if (ec) {
+            throw std::runtime_error("failed to query the status of '" + path + "'; " + ec.message());
+        }
+
+#if UZUKI2_FILE_POOL_USE_STAT
+        struct stat info;
+        if (::stat(path.c_str(), &info) == 0) {
+            output.device = info.st_dev;
+            output.inode = info.st_ino;
+        }
+#endif
+        return output;
+    }
+
+    struct Entry {
+        std::string path;
+        FileStamp stamp;
+        H5::H5File handle;
+    };
+
+    size_t my_capacity;
+    mutable std::mutex my_lock;
+    std::list<Entry> my_entries;
+    std::unordered_map<std::string, std::list<Entry>::iterator> my_index;
+};
+
+}
+
+}
+
+#endif
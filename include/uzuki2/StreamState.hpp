@@ -0,0 +1,187 @@
+#ifndef UZUKI2_STREAM_STATE_HPP
+#define UZUKI2_STREAM_STATE_HPP
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+
+#include "interfaces.hpp"
+
+namespace uzuki2 {
+
+/*
+ * Tracks the nesting of lists and vectors for the streaming writers, so that
+ * the JSON and HDF5 backends reject the same misuse with the same messages.
+ * Only the current path from the root is stored, not the objects themselves,
+ * so memory usage depends on the nesting depth rather than the list size.
+ * External indices are recorded and validated at the end, as is done by the
+ * ExternalTracker on the read side.
+ */
+class StreamState {
+public:
+    struct Frame {
+        Frame(Type t, bool n, bool s, int32_t l) : type(t), named(n), scalar(s), num_levels(l) {}
+        Type type;
+        bool named;
+        bool scalar;
+        int32_t num_levels;
+        size_t length = 0;
+        size_t names_length = 0;
+    };
+
+    bool empty() const {
+        return my_stack.empty();
+    }
+
+    Frame& top() {
+        return my_stack.back();
+    }
+
+    const std::string& name() const {
+        return my_name;
+    }
+
+public:
+    void set_name(std::string_view name) {
+        if (my_stack.empty() || my_stack.back().type != LIST || !my_stack.back().named) {
+            throw std::runtime_error("names can only be supplied for children of a named list");
+        }
+        if (my_has_name) {
+            throw std::runtime_error("name has already been supplied for the next child");
+        }
+        my_name = name;
+        my_has_name = true;
+    }
+
+    // Registers a new object in the current list, returning its position therein.
+    size_t add_object() {
+        if (my_stack.empty()) {
+            if (my_root_added) {
+                throw std::runtime_error("only one top-level object can be written");
+            }
+            my_root_added = true;
+            return 0;
+        }
+
+        auto& parent = my_stack.back();
+        if (parent.type != LIST) {
+            throw std::runtime_error("objects can only be added to a list");
+        }
+        if (parent.named && !my_has_name) {
+            throw std::runtime_error("each child of a named list should have a name");
+        }
+        my_has_name = false;
+        return parent.length++;
+    }
+
+    void push(Type type, bool named, bool scalar = false, int32_t num_levels = 0) {
+        my_stack.emplace_back(type, named, scalar, num_levels);
+    }
+
+    // Validates a block of values for the current vector, returning the position of its first element.
+    // The block is only counted by commit_append(), so that the backends can run their own checks (e.g., for placeholder collisions) beforehand;
+    // a failed append then leaves the state unchanged.
+    size_t check_append(Type type, size_t n, bool has_names) const {
+        if (my_stack.empty() || my_stack.back().type == LIST) {
+            throw std::runtime_error("values can only be appended to a vector");
+        }
+
+        const auto& current = my_stack.back();
+        if (current.type != type) {
+            throw std::runtime_error("type of the appended values does not match the current vector");
+        }
+        if (current.scalar && current.length + n > 1) {
+            throw std::runtime_error("scalar vectors should contain exactly one value");
+        }
+        if (has_names && !current.named) {
+            throw std::runtime_error("names cannot be supplied for an unnamed vector");
+        }
+
+        return current.length;
+    }
+
+    void commit_append(size_t n) {
+        my_stack.back().length += n;
+    }
+
+    // Names of a vector may be supplied separately from its values, e.g., when converting from a format that stores them after the values.
+    size_t append_names(size_t n) {
+        if (my_stack.empty() || my_stack.back().type == LIST) {
+            throw std::runtime_error("names can only be appended to a vector");
+        }
+
+        auto& current = my_stack.back();
+        if (!current.named) {
+            throw std::runtime_error("names cannot be supplied for an unnamed vector");
+        }
+
+        size_t offset = current.names_length;
+        current.names_length += n;
+        return offset;
+    }
+
+    void check_codes(const int32_t* codes, size_t n, const uint8_t* missing) const {
+        int32_t num_levels = my_stack.back().num_levels;
+        for (size_t i = 0; i < n; ++i) {
+            if (!(missing && missing[i]) && (codes[i] < 0 || codes[i] >= num_levels)) {
+                throw std::runtime_error("factor codes should be non-negative and less than the number of levels");
+            }
+        }
+    }
+
+    Frame pop(bool list) {
+        if (my_stack.empty() || (my_stack.back().type == LIST) != list) {
+            throw std::runtime_error(list ? "no list to end" : "no vector to end");
+        }
+
+        auto current = my_stack.back();
+        if (current.scalar && current.length != 1) {
+            throw std::runtime_error("scalar vectors should contain exactly one value");
+        }
+        if (!list && current.named && current.names_length != current.length) {
+            throw std::runtime_error("number of names should be equal to the number of values");
+        }
+        if (list && my_has_name) {
+            throw std::runtime_error("name was supplied without a subsequent child");
+        }
+
+        my_stack.pop_back();
+        return current;
+    }
+
+    void add_external(size_t index) {
+        my_indices.push_back(index);
+    }
+
+    void finish() {
+        if (!my_root_added) {
+            throw std::runtime_error("no object was written");
+        }
+        if (!my_stack.empty()) {
+            throw std::runtime_error("all lists and vectors should be ended before finishing");
+        }
+
+        std::sort(my_indices.begin(), my_indices.end());
+        for (size_t i = 0, n = my_indices.size(); i < n; ++i) {
+            if (i != my_indices[i]) {
+                throw std::runtime_error("set of \"index\" values for type \"external\" should be consecutive starting from zero");
+            }
+        }
+    }
+
+private:
+    std::vector<Frame> my_stack;
+    bool my_root_added = false;
+
+    bool my_has_name = false;
+    std::string my_name;
+
+    std::vector<size_t> my_indices;
+};
+
+}
+
+#endif
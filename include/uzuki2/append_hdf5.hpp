@@ -0,0 +1,316 @@
+#ifndef UZUKI2_APPEND_HDF5_HPP
+#define UZUKI2_APPEND_HDF5_HPP
+
+#include <vector>
+#include <string>
+#include <optional>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+
+#include "H5Cpp.h"
+
+#include "interfaces.hpp"
+#include "Version.hpp"
+#include "Dummy.hpp"
+#include "parse_hdf5.hpp"
+#include "parse_hdf5_subset.hpp"
+#include "write_hdf5.hpp"
+
+#include "ritsuko/hdf5/hdf5.hpp"
+
+/**
+ * @file append_hdf5.hpp
+ * @brief Append elements to a list in an existing HDF5 file.
+ */
+
+namespace uzuki2 {
+
+namespace hdf5 {
+
+/**
+ * @brief Options for appending to a list in a HDF5 file.
+ */
+struct AppendOptions {
+    /**
+     * Path to the list to be extended, relative to the top-level object.
+     * If empty, the new element is appended to the top-level list.
+     */
+    Path path;
+
+    /**
+     * Options for writing the new element.
+     */
+    WriteOptions write;
+
+    /**
+     * Buffer size, in terms of the number of elements, to use for reading existing names.
+     */
+    hsize_t buffer_size = 10000;
+
+    /**
+     * Whether to scan the entire file to check that `num_external` is equal to the number of existing external references.
+     * If false, only the external indices of the new element are checked, so the cost of each append does not depend on the size of the file.
+     */
+    bool check_num_external = false;
+};
+
+/**
+ * @cond
+ */
+inline H5::Group open_list_for_append(const H5::Group& handle, const Path& path, hsize_t buffer_size) {
+    H5::Group current = handle;
+    for (const auto& element : path) {
+        auto object_type = ritsuko::hdf5::open_and_load_scalar_string_attribute(current, "uzuki_object");
+        if (object_type != "list") {
+            throw std::runtime_error("cannot select elements from a non-list object");
+        }
+
+        auto dhandle = ritsuko::hdf5::open_group(current, "data");
+        size_t len = dhandle.getNumObjs();
+        std::vector<std::string> names;
+        if (element.by_name() && current.exists("names")) {
+            names = load_names(current, len, buffer_size);
+        }
+
+        auto istr = std::to_string(resolve_path_element(element, len, names));
+        current = ritsuko::hdf5::open_group(dhandle, istr.c_str());
+    }
+
+    auto object_type = ritsuko::hdf5::open_and_load_scalar_string_attribute(current, "uzuki_object");
+    if (object_type != "list") {
+        throw std::runtime_error("elements can only be appended to a list");
+    }
+    return current;
+}
+
+/*
+ * Only the object types and external indices are read, so that 'num_external'
+ * can be checked without loading the contents of any vectors.
+ */
+inline void collect_external_indices(const H5::Group& handle, std::vector<size_t>& indices) {
+    auto object_type = ritsuko::hdf5::open_and_load_scalar_string_attribute(handle, "uzuki_object");
+    if (object_type == "list") {
+        auto dhandle = ritsuko::hdf5::open_group(handle, "data");
+        size_t len = dhandle.getNumObjs();
+        for (size_t i = 0; i < len; ++i) {
+            auto istr = std::to_string(i);
+            collect_external_indices(ritsuko::hdf5::open_group(dhandle, istr.c_str()), indices);
+        }
+    } else if (object_type == "external") {
+        indices.push_back(load_external_index(handle, std::numeric_limits<int32_t>::max()));
+    }
+}
+
+inline void check_num_external(const H5::Group& handle, size_t num_external) {
+    std::vector<size_t> indices;
+    collect_external_indices(handle, indices);
+    if (indices.size() != num_external) {
+        throw std::runtime_error("'num_external' should be equal to the number of external references in the file (" + std::to_string(indices.size()) + ")");
+    }
+
+    std::sort(indices.begin(), indices.end());
+    for (size_t i = 0; i < num_external; ++i) {
+        if (indices[i] != i) {
+            throw std::runtime_error("set of \"index\" values for type \"external\" should be consecutive starting from zero");
+        }
+    }
+}
+
+inline void check_appended_external_indices(const H5::Group& handle, size_t num_external, size_t num_appended) {
+    std::vector<size_t> indices;
+    collect_external_indices(handle, indices);
+    if (indices.size() != num_appended) {
+        throw std::runtime_error("number of external references in the new element should be equal to " + std::to_string(num_appended));
+    }
+
+    std::sort(indices.begin(), indices.end());
+    for (size_t i = 0; i < num_appended; ++i) {
+        if (indices[i] != num_external + i) {
+            throw std::runtime_error("set of \"index\" values for type \"external\" in the new element should be consecutive starting from 'num_external'");
+        }
+    }
+}
+
+/*
+ * Names written by write() are fixed-width strings in a dataset of fixed
+ * size, which cannot hold another name. These are rewritten once into an
+ * extendible dataset of variable-length strings, as used by the StreamWriter,
+ * so that subsequent appends only need to write the new name. The original
+ * names are moved aside until the rewritten names are in place, so if this
+ * throws, the existing names are left unchanged.
+ */
+inline void append_list_name(const H5::Group& handle, size_t len, const std::string& name, const AppendOptions& options) {
+    auto nhandle = open_names(handle, len);
+
+    hsize_t maxdim;
+    nhandle.getSpace().getSimpleExtentDims(NULL, &maxdim);
+    if (maxdim == H5S_UNLIMITED && nhandle.getDataType().isVariableStr()) {
+        const char* ptr = name.c_str();
+        try {
+            extend_and_write(nhandle, len, 1, &ptr, vls_string_type());
+        } catch (...) {
+            hsize_t original = len;
+            H5Dset_extent(nhandle.getId(), &original);
+            throw;
+        }
+        return;
+    }
+
+    // The rewritten names are staged in a temporary dataset, which only replaces the original once it is complete.
+    const char* staging = "names.tmp";
+    if (handle.exists(staging)) {
+        handle.unlink(staging);
+    }
+
+    try {
+        auto rewritten = create_extendible_dataset(handle, staging, vls_string_type(), options.write);
+        ritsuko::hdf5::Stream1dStringDataset stream(&nhandle, len, options.buffer_size);
+        std::vector<std::string> block;
+        VlsBlock vls;
+        hsize_t written = 0;
+
+        auto flush = [&]() -> void {
+            auto ptrs = vls.fill(block.size(), [&](size_t i) -> std::string_view { return block[i]; });
+            extend_and_write(rewritten, written, block.size(), ptrs, vls_string_type());
+            written += block.size();
+            block.clear();
+        };
+
+        for (size_t i = 0; i < len; ++i, stream.next()) {
+            block.push_back(stream.steal());
+            if (block.size() >= options.buffer_size) {
+                flush();
+            }
+        }
+        block.push_back(name);
+        flush();
+
+    } catch (...) {
+        if (handle.exists(staging)) {
+            handle.unlink(staging);
+        }
+        throw;
+    }
+
+    nhandle.close();
+    const char* backup = "names.old";
+    if (handle.exists(backup)) {
+        handle.unlink(backup);
+    }
+
+    auto gid = handle.getId();
+    if (H5Lmove(gid, "names", gid, backup, H5P_DEFAULT, H5P_DEFAULT) < 0) {
+        handle.unlink(staging);
+        throw std::runtime_error("failed to move the original list names aside");
+    }
+    if (H5Lmove(gid, staging, gid, "names", H5P_DEFAULT, H5P_DEFAULT) < 0) {
+        H5Lmove(gid, backup, gid, "names", H5P_DEFAULT, H5P_DEFAULT);
+        handle.unlink(staging);
+        throw std::runtime_error("failed to replace the list names with the rewritten dataset");
+    }
+    handle.unlink(backup);
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Append an element to a list in an existing HDF5 file, without rewriting the rest of the file.
+ * The new element is written to `data/<n>` of the list, where `n` is the current length of the list; if the list is named, `name` is added to its `names`.
+ * Only the affected parts of the file are validated, i.e., the list itself and the new element.
+ * The external indices in the new element are checked against `num_external`;
+ * the rest of the file is only scanned for external references if `AppendOptions::check_num_external = true`.
+ * If an error occurs, the new element and name are removed so that the file is left as it was.
+ *
+ * The top-level object should have an `uzuki_version` of 1.3 or later, matching the layout used by `write()`.
+ * The first time that a name is appended to a list created by `write()`, its `names` are rewritten into an extendible dataset;
+ * subsequent appends only need to write the new name.
+ *
+ * @param handle Handle to the HDF5 group containing the top-level object.
+ * @param object Pointer to the new element, see `write()` for requirements.
+ * @param name Name of the new element.
+ * This should be supplied if and only if the list is named.
+ * @param num_external Number of external references already in the file.
+ * Any external references in `object` are assigned indices starting from this value.
+ * If `AppendOptions::check_num_external = true`, an error is raised if this does not match the external references in the file.
+ * @param options Optional parameters.
+ *
+ * @return Pointers to the external objects in `object`, ordered by their assigned `index`.
+ */
+inline std::vector<void*> append(const H5::Group& handle, const Base* object, const std::optional<std::string>& name, size_t num_external, const AppendOptions& options = AppendOptions()) {
+    auto version = load_version(handle);
+    if (version.lt(1, 3)) {
+        throw std::runtime_error("appending requires an 'uzuki_version' of 1.3 or later");
+    }
+    if (options.check_num_external) {
+        check_num_external(handle, num_external);
+    }
+
+    auto lhandle = open_list_for_append(handle, options.path, options.buffer_size);
+    auto dhandle = ritsuko::hdf5::open_group(lhandle, "data");
+    size_t len = dhandle.getNumObjs();
+
+    bool named = lhandle.exists("names");
+    if (named) {
+        if (!name.has_value()) {
+            throw std::runtime_error("a name should be supplied when appending to a named list");
+        }
+        open_names(lhandle, len);
+    } else if (name.has_value()) {
+        throw std::runtime_error("a name cannot be supplied when appending to an unnamed list");
+    }
+
+    auto istr = std::to_string(len);
+    if (dhandle.exists(istr)) {
+        throw std::runtime_error("list elements should be stored in consecutive groups starting from '0'");
+    }
+
+    Writer writer(options.write, num_external);
+    try {
+        auto chandle = dhandle.createGroup(istr);
+        writer.write(object, chandle);
+        check_appended_external_indices(chandle, num_external, writer.externals.size());
+
+        NodeFactory<DummyProvisioner> nodes;
+        DummyExternals ext(num_external + writer.externals.size());
+        Options popt;
+        popt.buffer_size = options.buffer_size;
+        parse_inner<DummyProvisioner>(chandle, ext, nodes, version, popt);
+
+        if (named) {
+            append_list_name(lhandle, len, *name, options);
+        }
+    } catch (...) {
+        if (dhandle.exists(istr)) {
+            dhandle.unlink(istr);
+        }
+        throw;
+    }
+
+    return std::move(writer.externals);
+}
+
+/**
+ * Append an element to a list in an existing HDF5 file, given the file path.
+ * See the other `append()` overload for details.
+ *
+ * @param file Path to the HDF5 file.
+ * @param group Name of the group containing the top-level object.
+ * @param object Pointer to the new element.
+ * @param name Name of the new element, for named lists.
+ * @param num_external Number of external references already in the file.
+ * @param options Optional parameters.
+ *
+ * @return Pointers to the external objects in `object`, ordered by their assigned `index`.
+ */
+inline std::vector<void*> append(const std::string& file, const std::string& group, const Base* object, const std::optional<std::string>& name, size_t num_external, const AppendOptions& options = AppendOptions()) {
+    H5::H5File handle(file, H5F_ACC_RDWR);
+    return append(ritsuko::hdf5::open_group(handle, group.c_str()), object, name, num_external, options);
+}
+
+}
+
+}
+
+#endif
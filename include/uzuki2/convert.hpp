@@ -0,0 +1,1712 @@
+#ifndef UZUKI2_CONVERT_HPP
+#define UZUKI2_CONVERT_HPP
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <stdexcept>
+#include <memory>
+#include <limits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <optional>
+
+#include "H5Cpp.h"
+#include "byteme/byteme.hpp"
+#include "ritsuko/ritsuko.hpp"
+
+#include "interfaces.hpp"
+#include "Version.hpp"
+#include "parse_hdf5.hpp"
+#include "parse_json.hpp"
+#include "write_hdf5.hpp"
+#include "write_json.hpp"
+#include "Base64.hpp"
+
+/**
+ * @file convert.hpp
+ * @brief Convert lists between the HDF5 and JSON representations.
+ */
+
+namespace uzuki2 {
+
+/**
+ * @brief Options for converting between representations.
+ */
+struct ConvertOptions {
+    /**
+     * Number of elements in each block of values that is passed from the reader to the writer.
+     */
+    size_t buffer_size = 10000;
+
+    /**
+     * Maximum number of bytes of object metadata to hold in memory during the first pass of `json::convert_file()`.
+     * This is applied separately to the fixed-size records for each object and to the list names, factor levels and missing indices.
+     * Beyond this, the metadata is moved to a temporary file and read back as each object is written.
+     */
+    size_t spill_limit = 1048576;
+
+    /**
+     * Options for the `hdf5::StreamWriter`, when converting to HDF5.
+     * The `stream_*_placeholder` options are only used by `json::convert_file()` if no unused placeholder can be found for a vector,
+     * as it otherwise chooses a placeholder for each vector that does not collide with any of its values.
+     */
+    hdf5::WriteOptions hdf5_options;
+
+    /**
+     * Options for the `json::StreamWriter`, when converting to JSON.
+     */
+    json::WriteOptions json_options;
+};
+
+/**
+ * @cond
+ */
+/*
+ * Hosts for the parse_* functions in parse_hdf5.hpp that forward each block
+ * of values to a stream writer instead of storing them. The HDF5 parsers
+ * deliver values in order, either as whole blocks (followed by a bitmap of
+ * missing values) or one element at a time, so only the current block is
+ * held in memory.
+ */
+template<typename Type_, class Flush_>
+class ForwardingHost {
+public:
+    ForwardingHost(size_t length, size_t block_size, Flush_ flush) : my_length(length), my_block_size(std::max(block_size, static_cast<size_t>(1))), my_flush(std::move(flush)) {}
+
+    size_t size() const {
+        return my_length;
+    }
+
+    void set_block(size_t, const Type_* values, size_t n) {
+        flush();
+        my_values.insert(my_values.end(), values, values + n);
+        my_missing.resize(n);
+    }
+
+    void set_missing_block(size_t, const uint8_t* bitmap, size_t n) {
+        for (size_t j = 0; j < n; ++j) {
+            my_missing[j] = (bitmap[j / 8] >> (j % 8)) & 1;
+        }
+    }
+
+    void set(size_t, Type_ value) {
+        my_values.push_back(value);
+        my_missing.push_back(0);
+        maybe_flush();
+    }
+
+    void set_missing(size_t) {
+        my_values.push_back(Type_());
+        my_missing.push_back(1);
+        maybe_flush();
+    }
+
+    void flush() {
+        if (!my_values.empty()) {
+            my_flush(my_values.data(), my_values.size(), my_missing.data());
+            my_values.clear();
+            my_missing.clear();
+        }
+    }
+
+private:
+    void maybe_flush() {
+        if (my_values.size() >= my_block_size) {
+            flush();
+        }
+    }
+
+    size_t my_length;
+    size_t my_block_size;
+    Flush_ my_flush;
+    std::vector<Type_> my_values;
+    std::vector<uint8_t> my_missing;
+};
+
+template<typename Type_, class Flush_>
+ForwardingHost<Type_, Flush_> make_forwarding_host(size_t length, size_t block_size, Flush_ flush) {
+    return ForwardingHost<Type_, Flush_>(length, block_size, std::move(flush));
+}
+
+template<class Flush_>
+class ForwardingStringHost {
+public:
+    ForwardingStringHost(size_t length, size_t block_size, Flush_ flush) : my_length(length), my_block_size(std::max(block_size, static_cast<size_t>(1))), my_flush(std::move(flush)), my_offsets(1) {}
+
+    size_t size() const {
+        return my_length;
+    }
+
+    void set_block(size_t, const char* data, const size_t* offsets, size_t n) {
+        flush();
+        my_chars.insert(my_chars.end(), data + offsets[0], data + offsets[n]);
+        for (size_t j = 1; j <= n; ++j) {
+            my_offsets.push_back(offsets[j] - offsets[0]);
+        }
+        my_missing.resize(n);
+    }
+
+    void set_missing_block(size_t, const uint8_t* bitmap, size_t n) {
+        for (size_t j = 0; j < n; ++j) {
+            my_missing[j] = (bitmap[j / 8] >> (j % 8)) & 1;
+        }
+    }
+
+    void set_view(size_t, std::string_view x) {
+        my_chars.insert(my_chars.end(), x.begin(), x.end());
+        my_offsets.push_back(my_chars.size());
+        my_missing.push_back(0);
+        maybe_flush();
+    }
+
+    void set(size_t i, std::string x) {
+        set_view(i, x);
+    }
+
+    void set_missing(size_t) {
+        my_offsets.push_back(my_chars.size());
+        my_missing.push_back(1);
+        maybe_flush();
+    }
+
+    // For use with extract_names().
+    void set_name(size_t i, std::string x) {
+        set_view(i, x);
+    }
+
+    void set_name_block(size_t start, const char* data, const size_t* offsets, size_t n) {
+        set_block(start, data, offsets, n);
+    }
+
+    void flush() {
+        size_t n = my_missing.size();
+        if (n == 0) {
+            return;
+        }
+
+        my_views.clear();
+        for (size_t j = 0; j < n; ++j) {
+            my_views.emplace_back(my_chars.data() + my_offsets[j], my_offsets[j + 1] - my_offsets[j]);
+        }
+        my_flush(my_views.data(), n, my_missing.data());
+
+        my_chars.clear();
+        my_offsets.resize(1);
+        my_missing.clear();
+    }
+
+private:
+    void maybe_flush() {
+        if (my_missing.size() >= my_block_size) {
+            flush();
+        }
+    }
+
+    size_t my_length;
+    size_t my_block_size;
+    Flush_ my_flush;
+    std::vector<char> my_chars;
+    std::vector<size_t> my_offsets;
+    std::vector<uint8_t> my_missing;
+    std::vector<std::string_view> my_views;
+};
+
+template<class Flush_>
+ForwardingStringHost<Flush_> make_forwarding_string_host(size_t length, size_t block_size, Flush_ flush) {
+    return ForwardingStringHost<Flush_>(length, block_size, std::move(flush));
+}
+
+template<class Writer_>
+void convert_hdf5_object(const H5::Group& handle, Writer_& writer, const Version& version, size_t buffer_size) try {
+    auto object_type = ritsuko::hdf5::open_and_load_scalar_string_attribute(handle, "uzuki_object");
+
+    if (object_type == "list") {
+        auto dhandle = ritsuko::hdf5::open_group(handle, "data");
+        size_t len = dhandle.getNumObjs();
+
+        // List names are streamed alongside the children, as each name is needed before its child.
+        bool named = handle.exists("names");
+        H5::DataSet nhandle;
+        std::unique_ptr<ritsuko::hdf5::Stream1dStringDataset> names;
+        if (named) {
+            nhandle = hdf5::open_names(handle, len);
+            names.reset(new ritsuko::hdf5::Stream1dStringDataset(&nhandle, len, buffer_size));
+        }
+
+        writer.begin_list(named);
+        for (size_t i = 0; i < len; ++i) {
+            if (named) {
+                writer.name(names->steal());
+                names->next();
+            }
+            auto istr = std::to_string(i);
+            convert_hdf5_object(ritsuko::hdf5::open_group(dhandle, istr.c_str()), writer, version, buffer_size);
+        }
+        writer.end_list();
+
+    } else if (object_type == "vector") {
+        auto vector_type = ritsuko::hdf5::open_and_load_scalar_string_attribute(handle, "uzuki_type");
+
+        auto dhandle = ritsuko::hdf5::open_dataset(handle, "data");
+        size_t len = ritsuko::hdf5::get_1d_length(dhandle.getSpace(), true);
+        bool is_scalar = (len == 0);
+        if (is_scalar) {
+            len = 1;
+        }
+        bool named = handle.exists("names");
+
+        if (vector_type == "integer") {
+            writer.begin_integer(named, is_scalar);
+            auto host = make_forwarding_host<int32_t>(len, buffer_size, [&](const int32_t* values, size_t n, const uint8_t* missing) -> void {
+                writer.append_integers(values, n, missing);
+            });
+            hdf5::parse_integer_like(dhandle, &host, is_scalar, [](int32_t) -> void {}, version, buffer_size);
+            host.flush();
+
+        } else if (vector_type == "boolean") {
+            writer.begin_boolean(named, is_scalar);
+            std::vector<uint8_t> converted;
+            auto host = make_forwarding_host<int32_t>(len, buffer_size, [&](const int32_t* values, size_t n, const uint8_t* missing) -> void {
+                converted.assign(values, values + n);
+                writer.append_booleans(converted.data(), n, missing);
+            });
+            hdf5::parse_integer_like(
+                dhandle,
+                &host,
+                is_scalar,
+                [&](int32_t x) -> void {
+                    if (x != 0 && x != 1) {
+                        throw std::runtime_error("boolean values should be 0 or 1");
+                    }
+                },
+                version,
+                buffer_size
+            );
+            host.flush();
+
+        } else if (hdf5::is_factor_type(vector_type, version)) {
+            auto levhandle = hdf5::open_levels(handle);
+            hsize_t levlen = ritsuko::hdf5::get_1d_length(levhandle.getSpace(), false);
+            std::vector<std::string> levels;
+            levels.reserve(levlen);
+            ritsuko::hdf5::Stream1dStringDataset stream(&levhandle, levlen, buffer_size);
+            for (hsize_t i = 0; i < levlen; ++i, stream.next()) {
+                levels.push_back(stream.steal());
+            }
+
+            writer.begin_factor(levels, hdf5::load_ordered(handle, vector_type), named, is_scalar);
+            auto host = make_forwarding_host<int32_t>(len, buffer_size, [&](const int32_t* values, size_t n, const uint8_t* missing) -> void {
+                writer.append_codes(values, n, missing);
+            });
+            hdf5::parse_integer_like(dhandle, &host, is_scalar, [](int32_t) -> void {}, version, buffer_size);
+            host.flush();
+
+        } else if (hdf5::is_vls_type(vector_type, version)) {
+            ritsuko::hdf5::vls::validate_pointer_datatype(dhandle.getCompType(), 64, 64);
+            auto hhandle = ritsuko::hdf5::vls::open_heap(handle, "heap");
+            writer.begin_string(named, is_scalar);
+            auto host = make_forwarding_string_host(len, buffer_size, [&](const std::string_view* values, size_t n, const uint8_t* missing) -> void {
+                writer.append_strings(values, n, missing);
+            });
+            hdf5::parse_vls(dhandle, hhandle, &host, len, is_scalar, buffer_size);
+            host.flush();
+
+        } else if (hdf5::is_string_type(vector_type, version)) {
+            auto format = hdf5::load_format(handle, vector_type, version);
+            writer.begin_string(named, is_scalar, format);
+            auto host = make_forwarding_string_host(len, buffer_size, [&](const std::string_view* values, size_t n, const uint8_t* missing) -> void {
+                writer.append_strings(values, n, missing);
+            });
+            hdf5::parse_string_like(
+                dhandle,
+                &host,
+                is_scalar,
+                [&](const char* x, size_t n) -> void {
+                    if (format == StringVector::DATE && !ritsuko::is_date(x, n)) {
+                        throw std::runtime_error("dates should follow YYYY-MM-DD formatting");
+                    } else if (format == StringVector::DATETIME && !ritsuko::is_rfc3339(x, n)) {
+                        throw std::runtime_error("date-times should follow the Internet Date/Time format");
+                    }
+                },
+                buffer_size
+            );
+            host.flush();
+
+        } else if (vector_type == "number") {
+            writer.begin_number(named, is_scalar);
+            auto host = make_forwarding_host<double>(len, buffer_size, [&](const double* values, size_t n, const uint8_t* missing) -> void {
+                writer.append_numbers(values, n, missing);
+            });
+            hdf5::parse_numbers(dhandle, &host, is_scalar, [](double) -> void {}, version, buffer_size);
+            host.flush();
+
+        } else {
+            throw std::runtime_error("unknown vector type '" + vector_type + "'");
+        }
+
+        if (named) {
+            auto host = make_forwarding_string_host(len, buffer_size, [&](const std::string_view* names, size_t n, const uint8_t*) -> void {
+                writer.append_names(names, n);
+            });
+            hdf5::extract_names(handle, &host, buffer_size);
+            host.flush();
+        }
+        writer.end_vector();
+
+    } else if (object_type == "nothing") {
+        writer.nothing();
+
+    } else if (object_type == "external") {
+        writer.external(hdf5::load_external_index(handle, std::numeric_limits<int32_t>::max()));
+
+    } else {
+        throw std::runtime_error("unknown uzuki2 object type '" + object_type + "'");
+    }
+
+} catch (std::exception& e) {
+    throw std::runtime_error("failed to convert object at '" + ritsuko::hdf5::get_name(handle) + "'; " + std::string(e.what()));
+}
+
+/*
+ * Pull-based JSON tokenizer over a byteme::Reader. Unlike millijson, this
+ * never builds a document; each string or number is materialized only while
+ * it is being passed to the writer.
+ */
+class JsonCursor {
+public:
+    JsonCursor(byteme::Reader& reader) : my_reader(reader) {
+        my_remaining = my_reader.load();
+        my_buffer = my_reader.buffer();
+        my_available = my_reader.available();
+        refill();
+    }
+
+    bool valid() const {
+        return my_position < my_available;
+    }
+
+    char get() const {
+        return my_buffer[my_position];
+    }
+
+    void advance() {
+        ++my_position;
+        refill();
+    }
+
+    size_t position() const {
+        return my_overall + my_position;
+    }
+
+    char next_token() {
+        while (valid() && std::isspace(static_cast<unsigned char>(get()))) {
+            advance();
+        }
+        if (!valid()) {
+            throw std::runtime_error("unexpected end of the JSON document");
+        }
+        return get();
+    }
+
+    void expect(char c) {
+        if (next_token() != c) {
+            throw std::runtime_error("expected '" + std::string(1, c) + "' at position " + std::to_string(position()) + " of the JSON document");
+        }
+        advance();
+    }
+
+    // Returns true if another element follows, false if the closing character was reached.
+    bool next_element(char close, bool first) {
+        char c = next_token();
+        if (c == close) {
+            advance();
+            return false;
+        }
+        if (!first) {
+            expect(',');
+        }
+        return true;
+    }
+
+    void read_string(std::string& output) {
+        read_string_pieces(output, std::numeric_limits<size_t>::max(), [](const char*, size_t) -> void {});
+    }
+
+    // Long strings are passed to 'fun' in pieces of exactly 'limit' characters, leaving the last piece in 'output'.
+    template<class Function_>
+    void read_string_pieces(std::string& output, size_t limit, Function_ fun) {
+        expect('"');
+        output.clear();
+        while (true) {
+            if (output.size() > limit) {
+                fun(output.data(), limit);
+                output.erase(0, limit);
+            }
+            if (!valid()) {
+                throw std::runtime_error("unterminated string in the JSON document");
+            }
+            char c = get();
+            advance();
+            if (c == '"') {
+                break;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                throw std::runtime_error("unescaped control character at position " + std::to_string(position() - 1) + " of the JSON document");
+            } else if (c != '\\') {
+                output.push_back(c);
+                continue;
+            }
+
+            if (!valid()) {
+                throw std::runtime_error("unterminated string in the JSON document");
+            }
+            char e = get();
+            advance();
+            switch (e) {
+                case '"': output.push_back('"'); break;
+                case '\\': output.push_back('\\'); break;
+                case '/': output.push_back('/'); break;
+                case 'b': output.push_back('\b'); break;
+                case 'f': output.push_back('\f'); break;
+                case 'n': output.push_back('\n'); break;
+                case 'r': output.push_back('\r'); break;
+                case 't': output.push_back('\t'); break;
+                case 'u':
+                    {
+                        uint32_t code = read_hex4();
+                        if (code >= 0xDC00 && code < 0xE000) {
+                            throw std::runtime_error("unpaired surrogate in the JSON document");
+                        } else if (code >= 0xD800 && code < 0xDC00) {
+                            if (!valid() || get() != '\\') {
+                                throw std::runtime_error("unpaired surrogate in the JSON document");
+                            }
+                            advance();
+                            if (!valid() || get() != 'u') {
+                                throw std::runtime_error("unpaired surrogate in the JSON document");
+                            }
+                            advance();
+                            uint32_t low = read_hex4();
+                            if (low < 0xDC00 || low >= 0xE000) {
+                                throw std::runtime_error("unpaired surrogate in the JSON document");
+                            }
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        append_utf8(code, output);
+                    }
+                    break;
+                default:
+                    throw std::runtime_error("unknown escape sequence in the JSON document");
+            }
+        }
+    }
+
+    // Only accepts numbers in the JSON grammar, i.e., no leading zeros or '+', and at least one digit around the '.' and after the exponent.
+    double read_number() {
+        my_token.clear();
+        next_token();
+        size_t start = position();
+
+        take_if([](char c) -> bool { return c == '-'; });
+        bool valid_number;
+        if (take_if([](char c) -> bool { return c == '0'; })) {
+            valid_number = !(valid() && std::isdigit(static_cast<unsigned char>(get())));
+        } else {
+            valid_number = take_digits();
+        }
+        if (valid_number && take_if([](char c) -> bool { return c == '.'; })) {
+            valid_number = take_digits();
+        }
+        if (valid_number && take_if([](char c) -> bool { return c == 'e' || c == 'E'; })) {
+            take_if([](char c) -> bool { return c == '+' || c == '-'; });
+            valid_number = take_digits();
+        }
+        if (!valid_number) {
+            throw std::runtime_error("invalid number at position " + std::to_string(start) + " of the JSON document");
+        }
+
+        double output = 0;
+        auto res = std::from_chars(my_token.data(), my_token.data() + my_token.size(), output);
+        if (res.ec != std::errc() || res.ptr != my_token.data() + my_token.size()) {
+            throw std::runtime_error("invalid number '" + my_token + "' in the JSON document");
+        }
+        return output;
+    }
+
+    void read_literal(const char* expected) {
+        next_token();
+        for (const char* x = expected; *x; ++x) {
+            if (!valid() || get() != *x) {
+                throw std::runtime_error("expected '" + std::string(expected) + "' at position " + std::to_string(position()) + " of the JSON document");
+            }
+            advance();
+        }
+    }
+
+    void skip_value() {
+        char c = next_token();
+        if (c == '{' || c == '[') {
+            char close = (c == '{' ? '}' : ']');
+            advance();
+            bool first = true;
+            while (next_element(close, first)) {
+                if (c == '{') {
+                    read_string(my_token);
+                    expect(':');
+                }
+                skip_value();
+                first = false;
+            }
+        } else if (c == '"') {
+            read_string(my_token);
+        } else if (c == 't') {
+            read_literal("true");
+        } else if (c == 'f') {
+            read_literal("false");
+        } else if (c == 'n') {
+            read_literal("null");
+        } else {
+            read_number();
+        }
+    }
+
+    // Checks that only whitespace follows the root object.
+    void finish() {
+        while (valid() && std::isspace(static_cast<unsigned char>(get()))) {
+            advance();
+        }
+        if (valid()) {
+            throw std::runtime_error("invalid JSON with trailing non-space characters at position " + std::to_string(position()));
+        }
+    }
+
+private:
+    void refill() {
+        while (my_position >= my_available && my_remaining) {
+            my_overall += my_available;
+            my_remaining = my_reader.load();
+            my_buffer = my_reader.buffer();
+            my_available = my_reader.available();
+            my_position = 0;
+        }
+    }
+
+    template<class Condition_>
+    bool take_if(Condition_ condition) {
+        if (!valid() || !condition(get())) {
+            return false;
+        }
+        my_token.push_back(get());
+        advance();
+        return true;
+    }
+
+    bool take_digits() {
+        bool found = false;
+        while (take_if([](char c) -> bool { return std::isdigit(static_cast<unsigned char>(c)); })) {
+            found = true;
+        }
+        return found;
+    }
+
+    uint32_t read_hex4() {
+        uint32_t code = 0;
+        for (int i = 0; i < 4; ++i) {
+            if (!valid() || !std::isxdigit(static_cast<unsigned char>(get()))) {
+                throw std::runtime_error("invalid unicode escape in the JSON document");
+            }
+            char h = get();
+            code = code * 16 + (std::isdigit(static_cast<unsigned char>(h)) ? h - '0' : (std::tolower(h) - 'a' + 10));
+            advance();
+        }
+        return code;
+    }
+
+    static void append_utf8(uint32_t code, std::string& output) {
+        if (code < 0x80) {
+            output.push_back(code);
+        } else if (code < 0x800) {
+            output.push_back(0xC0 | (code >> 6));
+            output.push_back(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            output.push_back(0xE0 | (code >> 12));
+            output.push_back(0x80 | ((code >> 6) & 0x3F));
+            output.push_back(0x80 | (code & 0x3F));
+        } else {
+            output.push_back(0xF0 | (code >> 18));
+            output.push_back(0x80 | ((code >> 12) & 0x3F));
+            output.push_back(0x80 | ((code >> 6) & 0x3F));
+            output.push_back(0x80 | (code & 0x3F));
+        }
+    }
+
+    byteme::Reader& my_reader;
+    bool my_remaining = false;
+    const unsigned char* my_buffer = NULL;
+    size_t my_available = 0;
+    size_t my_position = 0;
+    size_t my_overall = 0;
+    std::string my_token;
+};
+
+/*
+ * Append-only store for the metadata collected by the first pass, i.e., the
+ * fixed-size record for each object as well as its list names, factor levels
+ * and base64 missing indices. Like json::NameSpill, the contents are held in
+ * memory up to a limit and moved to a temporary file beyond that.
+ */
+class ScanSpill {
+public:
+    ScanSpill(size_t limit) : my_limit(limit) {}
+
+    ~ScanSpill() {
+        if (my_file) {
+            std::fclose(my_file);
+        }
+    }
+
+    ScanSpill(const ScanSpill&) = delete;
+    ScanSpill& operator=(const ScanSpill&) = delete;
+
+    uint64_t size() const {
+        return my_size;
+    }
+
+    void put(const void* buffer, size_t n) {
+        auto ptr = static_cast<const char*>(buffer);
+        if (!my_file) {
+            if (my_memory.size() + n <= my_limit) {
+                my_memory.insert(my_memory.end(), ptr, ptr + n);
+                my_size += n;
+                return;
+            }
+            my_file = std::tmpfile();
+            if (!my_file) {
+                throw std::runtime_error("failed to create a temporary file for the JSON metadata");
+            }
+            write_file(my_memory.data(), my_memory.size());
+            my_memory.clear();
+            my_memory.shrink_to_fit();
+        }
+        write_file(ptr, n);
+        my_size += n;
+    }
+
+    void put_string(const std::string& x) {
+        uint64_t len = x.size();
+        put(&len, sizeof(len));
+        put(x.data(), x.size());
+    }
+
+    void put_number(double x) {
+        put(&x, sizeof(x));
+    }
+
+    // Overwrites previously stored contents, e.g., a placeholder that was reserved before the contents were known.
+    void set(uint64_t offset, const void* buffer, size_t n) {
+        if (!my_file) {
+            std::memcpy(my_memory.data() + offset, buffer, n);
+            return;
+        }
+        if (std::fseek(my_file, offset, SEEK_SET) != 0) {
+            throw std::runtime_error("failed to write JSON metadata to a temporary file");
+        }
+        write_file(static_cast<const char*>(buffer), n);
+        if (std::fseek(my_file, 0, SEEK_END) != 0) {
+            throw std::runtime_error("failed to write JSON metadata to a temporary file");
+        }
+    }
+
+    void get(uint64_t offset, void* buffer, size_t n) const {
+        if (!my_file) {
+            std::memcpy(buffer, my_memory.data() + offset, n);
+            return;
+        }
+        if (std::fseek(my_file, offset, SEEK_SET) != 0 || std::fread(buffer, 1, n, my_file) != n) {
+            throw std::runtime_error("failed to read JSON metadata from a temporary file");
+        }
+    }
+
+    void get_string(uint64_t offset, std::string& output) const {
+        uint64_t len;
+        get(offset, &len, sizeof(len));
+        output.resize(len);
+        get(offset + sizeof(len), output.data(), len);
+    }
+
+private:
+    void write_file(const char* buffer, size_t n) {
+        if (std::fwrite(buffer, 1, n, my_file) != n) {
+            throw std::runtime_error("failed to write JSON metadata to a temporary file");
+        }
+    }
+
+    size_t my_limit;
+    uint64_t my_size = 0;
+    std::vector<char> my_memory;
+    FILE* my_file = NULL;
+};
+
+/*
+ * Sequential reader from an offset in a ScanSpill, which holds no more than
+ * 'buffer_size' bytes at a time.
+ */
+class SpillCursor {
+public:
+    SpillCursor(const ScanSpill& spill, uint64_t offset, size_t buffer_size) : my_spill(spill), my_offset(offset), my_buffer_size(std::max(buffer_size, static_cast<size_t>(1))) {}
+
+    void get(void* output, size_t n) {
+        auto optr = static_cast<char*>(output);
+        while (n) {
+            if (my_position == my_available) {
+                refill();
+            }
+            size_t take = std::min(n, my_available - my_position);
+            std::memcpy(optr, my_buffer.data() + my_position, take);
+            optr += take;
+            n -= take;
+            my_position += take;
+        }
+    }
+
+    void get_string(std::string& output) {
+        uint64_t len;
+        get(&len, sizeof(len));
+        output.resize(len);
+        get(output.data(), len);
+    }
+
+    double get_number() {
+        double output;
+        get(&output, sizeof(output));
+        return output;
+    }
+
+    void skip(uint64_t n) {
+        uint64_t buffered = my_available - my_position;
+        if (n <= buffered) {
+            my_position += n;
+        } else {
+            my_offset += n - buffered;
+            my_position = my_available;
+        }
+    }
+
+private:
+    void refill() {
+        my_available = std::min(static_cast<uint64_t>(my_buffer_size), my_spill.size() - my_offset);
+        if (my_available == 0) {
+            throw std::runtime_error("reached the end of the JSON metadata");
+        }
+        my_buffer.resize(my_buffer_size);
+        my_spill.get(my_offset, my_buffer.data(), my_available);
+        my_offset += my_available;
+        my_position = 0;
+    }
+
+    const ScanSpill& my_spill;
+    uint64_t my_offset;
+    size_t my_buffer_size;
+    std::vector<char> my_buffer;
+    size_t my_available = 0;
+    size_t my_position = 0;
+};
+
+/*
+ * Values in the 'values' of an object that could collide with a missing
+ * placeholder, collected in the first pass so that the second pass can choose
+ * a placeholder that is absent from each vector, like hdf5::write() does. The
+ * type and version of an object may only be known after its values, so every
+ * number and string is recorded regardless of type, including the decoded
+ * contents of any base64 string; this only makes the choice more conservative.
+ * Only the first 64 candidates for each placeholder are tracked.
+ */
+struct PlaceholderUsage {
+    bool has_nan = false;
+    bool has_max_integer = false;
+    uint64_t integers = 0; // bit k is set if INT32_MIN + k is present.
+    uint64_t numbers = 0; // bit k is set if the k-th double above -Inf is present.
+    uint64_t strings = 0; // bit k is set if "NA" followed by k underscores is present.
+
+    static uint64_t negative_infinity_bits() {
+        double ninf = -std::numeric_limits<double>::infinity();
+        uint64_t bits;
+        std::memcpy(&bits, &ninf, sizeof(double));
+        return bits;
+    }
+
+    void add_number(double x) {
+        if (std::isnan(x)) {
+            has_nan = true;
+            return;
+        }
+
+        if (x == std::numeric_limits<int32_t>::max()) {
+            has_max_integer = true;
+        }
+        double offset = x - static_cast<double>(std::numeric_limits<int32_t>::min());
+        if (offset >= 0 && offset < 64 && offset == std::floor(offset)) {
+            integers |= static_cast<uint64_t>(1) << static_cast<int>(offset);
+        }
+
+        // Stepping towards +Inf from a negative double decrements its bit pattern.
+        if (std::signbit(x)) {
+            uint64_t bits, ninf = negative_infinity_bits();
+            std::memcpy(&bits, &x, sizeof(double));
+            if (bits <= ninf && ninf - bits < 64) {
+                numbers |= static_cast<uint64_t>(1) << (ninf - bits);
+            }
+        }
+    }
+
+    void add_string(std::string_view x) {
+        if (x == "NaN") {
+            has_nan = true;
+        } else if (x == "-Inf") {
+            numbers |= 1;
+        }
+        if (x.size() >= 2 && x.compare(0, 2, "NA") == 0 && x.find_first_not_of('_', 2) == std::string_view::npos) {
+            add_na_like(x.size());
+        }
+    }
+
+    // For strings that are checked in pieces, where 'length' is that of a string consisting of "NA" followed by underscores.
+    void add_na_like(uint64_t length) {
+        if (length - 2 < 64) {
+            strings |= static_cast<uint64_t>(1) << (length - 2);
+        }
+    }
+
+    // Each choice is empty if all candidates are used, in which case the writer falls back to its default.
+    std::optional<int32_t> choose_integer() const {
+        if (!(integers & 1)) {
+            return std::numeric_limits<int32_t>::min(); // same as R's NA_integer_.
+        } else if (!has_max_integer) {
+            return std::numeric_limits<int32_t>::max();
+        }
+        for (int k = 1; k < 64; ++k) {
+            if (!((integers >> k) & 1)) {
+                return std::numeric_limits<int32_t>::min() + k;
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::optional<double> choose_number() const {
+        // All NaNs are considered missing with a NaN placeholder, so we can only use it if no NaNs are present.
+        if (!has_nan) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        for (int k = 0; k < 64; ++k) {
+            if (!((numbers >> k) & 1)) {
+                uint64_t bits = negative_infinity_bits() - k;
+                double output;
+                std::memcpy(&output, &bits, sizeof(double));
+                return output;
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::optional<std::string> choose_string() const {
+        for (int k = 0; k < 64; ++k) {
+            if (!((strings >> k) & 1)) {
+                return "NA" + std::string(k, '_');
+            }
+        }
+        return std::nullopt;
+    }
+};
+
+/*
+ * JSON objects may list their properties in any order, e.g., the names or
+ * levels may follow the values. So, we make a first pass to collect the
+ * metadata for each object, skipping over the values; the second pass then
+ * streams the values into the writer, reading back each object's metadata as
+ * it goes. The fixed-size fields of each object are stored as a record in one
+ * ScanSpill, in pre-order; its strings, list names, levels and missing indices
+ * are stored in another ScanSpill and referenced by their offsets. Only the
+ * objects that are currently open are held in memory by either pass.
+ */
+struct JsonObjectRecord {
+    bool named = false;
+    bool scalar = false;
+    bool has_values = false;
+    bool has_format = false;
+    bool ordered = false;
+    bool has_levels = false;
+    bool has_index = false;
+    double index = 0;
+    bool has_encoding = false;
+    PlaceholderUsage usage;
+
+    // Length and padding of a string in 'values', to determine the length of base64-encoded numbers before decoding.
+    uint64_t values_length = 0;
+    size_t values_padding = 0;
+
+    // Position of the first non-number in 'missing', or -1 if 'missing' is not an array.
+    bool invalid_missing = false;
+    size_t invalid_missing_at = 0;
+
+    // Number of objects nested in the 'values', which immediately follow this object in the pre-order.
+    size_t num_descendants = 0;
+
+    uint64_t names_offset = 0;
+    size_t num_names = 0;
+    uint64_t levels_offset = 0;
+    size_t num_levels = 0;
+    uint64_t missing_offset = 0;
+    size_t num_missing = 0;
+
+    uint64_t type_offset = 0;
+    uint64_t format_offset = 0;
+    uint64_t encoding_offset = 0;
+};
+
+struct JsonObjectInfo : public JsonObjectRecord {
+    std::string type;
+    std::string format;
+    std::string encoding;
+};
+
+inline JsonObjectInfo load_json_object_info(SpillCursor& records, const ScanSpill& spill) {
+    JsonObjectInfo info;
+    records.get(static_cast<JsonObjectRecord*>(&info), sizeof(JsonObjectRecord));
+    spill.get_string(info.type_offset, info.type);
+    spill.get_string(info.format_offset, info.format);
+    spill.get_string(info.encoding_offset, info.encoding);
+    return info;
+}
+
+inline size_t spill_string_array(JsonCursor& cursor, ScanSpill& spill, std::string& scratch, const std::string& path, const char* property) {
+    if (cursor.next_token() != '[') {
+        throw std::runtime_error("expected an array in '" + path + "." + property + "'");
+    }
+    cursor.advance();
+    size_t count = 0;
+    while (cursor.next_element(']', count == 0)) {
+        if (cursor.next_token() != '"') {
+            throw std::runtime_error("expected a string at '" + path + "." + property + "[" + std::to_string(count) + "]'");
+        }
+        cursor.read_string(scratch);
+        spill.put_string(scratch);
+        ++count;
+    }
+    return count;
+}
+
+// Number of characters in each piece of a base64-encoded string, i.e., a multiple of 32 characters for 3 doubles.
+inline size_t base64_piece_length(size_t buffer_size) {
+    return (std::max(buffer_size, static_cast<size_t>(1)) + 2) / 3 * 32;
+}
+
+inline void scan_json_object(JsonCursor& cursor, ScanSpill& records, ScanSpill& spill, const std::string& path, size_t buffer_size, std::string* version) {
+    if (cursor.next_token() != '{') {
+        throw std::runtime_error("each R object should be represented by a JSON object at '" + path + "'");
+    }
+    cursor.advance();
+
+    // Reserving the record now, so that records are stored in pre-order; it is filled in once the object is closed.
+    JsonObjectInfo info;
+    uint64_t slot = records.size();
+    records.put(static_cast<JsonObjectRecord*>(&info), sizeof(JsonObjectRecord));
+    std::string key;
+    bool first = true;
+
+    auto expect_string = [&](std::string& output) -> void {
+        if (cursor.next_token() != '"') {
+            throw std::runtime_error("expected a string at '" + path + "." + key + "'");
+        }
+        cursor.read_string(output);
+    };
+
+    while (cursor.next_element('}', first)) {
+        first = false;
+        cursor.read_string(key);
+        cursor.expect(':');
+
+        if (key == "type") {
+            expect_string(info.type);
+
+        } else if (key == "values") {
+            info.has_values = true;
+            char c = cursor.next_token();
+            if (c == '"') {
+                info.scalar = true;
+                size_t trailing = 0;
+                bool na_like = true;
+                std::vector<double> decoded;
+                bool decodable = true;
+                auto tally = [&](const char* piece, size_t n, bool padded) -> void {
+                    for (size_t i = 0; i < n; ++i) {
+                        trailing = (piece[i] == '=' ? trailing + 1 : 0);
+                        uint64_t at = info.values_length + i;
+                        na_like = na_like && piece[i] == (at < 2 ? "NA"[at] : '_');
+                    }
+                    info.values_length += n;
+
+                    // Errors are ignored here, as they are reported in the second pass if this is a base64-encoded number vector.
+                    if (decodable) {
+                        try {
+                            decode_base64_doubles(piece, n, decoded, padded);
+                        } catch (std::exception&) {
+                            decodable = false;
+                            return;
+                        }
+                        for (auto x : decoded) {
+                            info.usage.add_number(x);
+                        }
+                    }
+                };
+                cursor.read_string_pieces(key, base64_piece_length(buffer_size), [&](const char* piece, size_t n) -> void { tally(piece, n, false); });
+                tally(key.data(), key.size(), true);
+                info.values_padding = std::min(trailing, static_cast<size_t>(2));
+
+                if (info.values_length == key.size()) {
+                    info.usage.add_string(key);
+                } else if (na_like) {
+                    info.usage.add_na_like(info.values_length);
+                }
+                continue;
+
+            } else if (c != '[') {
+                info.scalar = true;
+                if (c == '-' || std::isdigit(static_cast<unsigned char>(c))) {
+                    info.usage.add_number(cursor.read_number());
+                } else {
+                    cursor.skip_value();
+                }
+                continue;
+            }
+
+            cursor.advance();
+            uint64_t before = records.size();
+            size_t count = 0;
+            while (cursor.next_element(']', count == 0)) {
+                char e = cursor.next_token();
+                if (e == '{') {
+                    scan_json_object(cursor, records, spill, path + ".values[" + std::to_string(count) + "]", buffer_size, NULL);
+                } else if (e == '"') {
+                    cursor.read_string(key);
+                    info.usage.add_string(key);
+                } else if (e == '-' || std::isdigit(static_cast<unsigned char>(e))) {
+                    info.usage.add_number(cursor.read_number());
+                } else {
+                    cursor.skip_value();
+                }
+                ++count;
+            }
+            info.num_descendants += (records.size() - before) / sizeof(JsonObjectRecord);
+
+        } else if (key == "names") {
+            info.named = true;
+            if (info.type.empty() || info.type == "list") {
+                info.names_offset = spill.size();
+                info.num_names = spill_string_array(cursor, spill, key, path, "names");
+            } else {
+                cursor.skip_value();
+            }
+
+        } else if (key == "levels") {
+            info.has_levels = true;
+            info.levels_offset = spill.size();
+            info.num_levels = spill_string_array(cursor, spill, key, path, "levels");
+
+        } else if (key == "format") {
+            info.has_format = true;
+            expect_string(info.format);
+
+        } else if (key == "ordered") {
+            char c = cursor.next_token();
+            if (c == 't') {
+                cursor.read_literal("true");
+                info.ordered = true;
+            } else if (c == 'f') {
+                cursor.read_literal("false");
+                info.ordered = false;
+            } else {
+                throw std::runtime_error("expected a boolean at '" + path + ".ordered'");
+            }
+
+        } else if (key == "index") {
+            char c = cursor.next_token();
+            if (!(c == '-' || std::isdigit(static_cast<unsigned char>(c)))) {
+                throw std::runtime_error("expected a number at '" + path + ".index'");
+            }
+            info.has_index = true;
+            info.index = cursor.read_number();
+
+        } else if (key == "encoding") {
+            info.has_encoding = true;
+            expect_string(info.encoding);
+
+        } else if (key == "missing") {
+            // Only validated in the second pass, as this is ignored for objects other than base64-encoded numbers.
+            info.invalid_missing = false;
+            info.missing_offset = spill.size();
+            info.num_missing = 0;
+            if (cursor.next_token() != '[') {
+                info.invalid_missing = true;
+                info.invalid_missing_at = -1;
+                cursor.skip_value();
+                continue;
+            }
+            cursor.advance();
+            size_t count = 0;
+            while (cursor.next_element(']', count == 0)) {
+                char c = cursor.next_token();
+                if (c == '-' || std::isdigit(static_cast<unsigned char>(c))) {
+                    spill.put_number(cursor.read_number());
+                    ++info.num_missing;
+                } else {
+                    if (!info.invalid_missing) {
+                        info.invalid_missing = true;
+                        info.invalid_missing_at = count;
+                    }
+                    cursor.skip_value();
+                }
+                ++count;
+            }
+
+        } else if (key == "version" && version) {
+            expect_string(*version);
+
+        } else {
+            cursor.skip_value();
+        }
+    }
+
+    if (info.type.empty()) {
+        throw std::runtime_error("missing 'type' property for JSON object at '" + path + "'");
+    }
+
+    info.type_offset = spill.size();
+    spill.put_string(info.type);
+    info.format_offset = spill.size();
+    spill.put_string(info.format);
+    info.encoding_offset = spill.size();
+    spill.put_string(info.encoding);
+    records.set(slot, static_cast<JsonObjectRecord*>(&info), sizeof(JsonObjectRecord));
+}
+
+/*
+ * Reads the elements of a vector's 'values' and passes them to the writer in
+ * blocks. Each element is checked with the same functions as in parse_json.hpp.
+ */
+class JsonValueStreamer {
+public:
+    JsonValueStreamer(JsonCursor& cursor, size_t buffer_size, const std::string& path, const Version& version) :
+        my_cursor(cursor), my_block_size(std::max(buffer_size, static_cast<size_t>(1))), my_path(path), my_version(version) {}
+
+    // 'element' is called with a flag indicating whether the next element is null; 'flush' is called on each full block.
+    template<class Element_, class Flush_>
+    void stream(bool scalar, Element_ element, Flush_ flush) {
+        if (scalar) {
+            read_element(element, flush);
+        } else {
+            if (my_cursor.next_token() != '[') {
+                throw std::runtime_error("expected an array in '" + my_path + ".values'");
+            }
+            my_cursor.advance();
+            while (my_cursor.next_element(']', my_count == 0)) {
+                read_element(element, flush);
+            }
+        }
+
+        if (!missing.empty()) {
+            flush();
+            missing.clear();
+        }
+    }
+
+    // Location of the current element, for error messages.
+    std::string where() const {
+        return my_path + ".values[" + std::to_string(my_count) + "]";
+    }
+
+    int32_t read_integer() {
+        char c = my_cursor.next_token();
+        if (!(c == '-' || std::isdigit(static_cast<unsigned char>(c)))) {
+            throw std::runtime_error("expected a number at '" + where() + "'");
+        }
+        bool is_missing = false;
+        auto val = json::check_integer_value(my_cursor.read_number(), my_version, is_missing, [&]() -> std::string { return where(); });
+        if (is_missing) {
+            missing.back() = 1;
+            return 0;
+        }
+        return val;
+    }
+
+public:
+    std::vector<uint8_t> missing;
+    std::string scratch;
+
+private:
+    template<class Element_, class Flush_>
+    void read_element(Element_& element, Flush_& flush) {
+        missing.push_back(0);
+        if (my_cursor.next_token() == 'n') {
+            my_cursor.read_literal("null");
+            missing.back() = 1;
+            element(true);
+        } else {
+            element(false);
+        }
+        ++my_count;
+
+        if (missing.size() >= my_block_size) {
+            flush();
+            missing.clear();
+        }
+    }
+
+    JsonCursor& my_cursor;
+    size_t my_block_size;
+    const std::string& my_path;
+    const Version& my_version;
+    size_t my_count = 0;
+};
+
+/*
+ * Decodes a base64-encoded 'values' string in pieces of a whole number of
+ * doubles and passes each piece to the writer, so that neither the string nor
+ * the decoded vector is held in memory. The missing indices are sorted so that
+ * they can be matched to each piece in turn.
+ */
+template<class Writer_>
+void convert_base64_numbers(JsonCursor& cursor, Writer_& writer, const JsonObjectInfo& info, const ScanSpill& spill, const std::string& path, size_t buffer_size) {
+    auto rethrow = [&](const std::exception& e) -> void {
+        throw std::runtime_error(std::string(e.what()) + " at '" + path + ".values'");
+    };
+
+    size_t n = 0;
+    try {
+        n = decoded_base64_doubles(decoded_base64_length(info.values_length, info.values_padding));
+    } catch (std::exception& e) {
+        rethrow(e);
+    }
+
+    if (info.invalid_missing) {
+        if (info.invalid_missing_at == static_cast<size_t>(-1)) {
+            throw std::runtime_error("expected an array in '" + path + ".missing'");
+        }
+        throw std::runtime_error("expected a number at '" + path + ".missing[" + std::to_string(info.invalid_missing_at) + "]'");
+    }
+
+    std::vector<std::pair<size_t, size_t> > indices; // index and position in 'missing'.
+    indices.reserve(info.num_missing);
+    SpillCursor icursor(spill, info.missing_offset, buffer_size);
+    for (size_t i = 0; i < info.num_missing; ++i) {
+        auto idx = json::check_missing_index(icursor.get_number(), n, [&]() -> std::string { return path + ".missing[" + std::to_string(i) + "]"; });
+        indices.emplace_back(idx, i);
+    }
+    std::sort(indices.begin(), indices.end());
+    for (size_t i = 1; i < indices.size(); ++i) {
+        if (indices[i].first == indices[i - 1].first) {
+            throw std::runtime_error("detected duplicate index at '" + path + ".missing[" + std::to_string(indices[i].second) + "]'");
+        }
+    }
+
+    std::vector<double> values;
+    std::vector<uint8_t> missing;
+    size_t start = 0;
+    auto next = indices.begin();
+    auto emit = [&](const char* piece, size_t m, bool padded) -> void {
+        try {
+            decode_base64_doubles(piece, m, values, padded);
+        } catch (std::exception& e) {
+            rethrow(e);
+        }
+
+        size_t count = values.size();
+        missing.assign(count, 0);
+        for (; next != indices.end() && next->first < start + count; ++next) {
+            missing[next->first - start] = 1;
+        }
+        if (count) {
+            writer.append_numbers(values.data(), count, missing.data());
+        }
+        start += count;
+    };
+
+    std::string buffer;
+    cursor.read_string_pieces(buffer, base64_piece_length(buffer_size), [&](const char* piece, size_t m) -> void { emit(piece, m, false); });
+    emit(buffer.data(), buffer.size(), true);
+}
+
+template<class Writer_>
+void convert_json_object(JsonCursor& cursor, Writer_& writer, SpillCursor& records, const ScanSpill& spill, const std::string& path, const Version& version, size_t buffer_size) {
+    // Non-objects in a list's 'values' are skipped by the first pass, so they have no record to load.
+    if (cursor.next_token() != '{') {
+        throw std::runtime_error("each R object should be represented by a JSON object at '" + path + "'");
+    }
+    auto info = load_json_object_info(records, spill);
+    const auto& type = info.type;
+
+    enum { OTHER, INTEGER_LIKE, BOOLEAN_LIKE, NUMBER_LIKE, BASE64_NUMBER_LIKE, STRING_LIKE, LIST_LIKE } kind = OTHER;
+    StringVector::Format format = StringVector::NONE;
+
+    if (type == "nothing") {
+        writer.nothing();
+
+    } else if (type == "external") {
+        if (!info.has_index) {
+            throw std::runtime_error("expected 'index' property for 'external' type at '" + path + "'");
+        }
+        // The upper bound is checked by the writer, as the number of externals is not known here.
+        writer.external(json::check_external_index(info.index, std::numeric_limits<size_t>::max(), path));
+
+    } else if (type == "list") {
+        kind = LIST_LIKE;
+        writer.begin_list(info.named);
+
+    } else if (type == "integer") {
+        kind = INTEGER_LIKE;
+        writer.begin_integer(info.named, info.scalar, info.usage.choose_integer());
+
+    } else if (type == "factor" || (version.equals(1, 0) && type == "ordered")) {
+        if (!info.has_levels) {
+            throw std::runtime_error("expected 'levels' property for object at '" + path + "'");
+        }
+        kind = INTEGER_LIKE;
+
+        // Levels are only held in memory while the factor is being written.
+        std::vector<std::string> levels(info.num_levels);
+        SpillCursor lcursor(spill, info.levels_offset, buffer_size);
+        for (auto& l : levels) {
+            lcursor.get_string(l);
+        }
+        bool ordered = (type == "ordered" || info.ordered);
+        writer.begin_factor(levels, ordered, info.named, info.scalar);
+
+    } else if (type == "boolean") {
+        kind = BOOLEAN_LIKE;
+        writer.begin_boolean(info.named, info.scalar);
+
+    } else if (type == "number") {
+        kind = NUMBER_LIKE;
+        if (!version.lt(1, 3) && info.has_encoding) {
+            json::check_encoding(info.encoding, path);
+            kind = BASE64_NUMBER_LIKE;
+            writer.begin_number(info.named, false, info.usage.choose_number());
+        } else {
+            writer.begin_number(info.named, info.scalar, info.usage.choose_number());
+        }
+
+    } else if (type == "string" || (version.equals(1, 0) && (type == "date" || type == "date-time"))) {
+        kind = STRING_LIKE;
+        format = json::check_string_format(type, (info.has_format ? &info.format : NULL), version, path);
+        writer.begin_string(info.named, info.scalar, format, info.usage.choose_string());
+
+    } else {
+        throw std::runtime_error("unknown object type '" + type + "' at '" + path + ".type'");
+    }
+
+    if (kind != OTHER && !info.has_values) {
+        throw std::runtime_error("expected 'values' property for object at '" + path + "'");
+    }
+
+    JsonValueStreamer streamer(cursor, buffer_size, path, version);
+    std::vector<int32_t> integers;
+    std::vector<uint8_t> booleans;
+    std::vector<double> numbers;
+    std::vector<char> chars;
+    std::vector<size_t> offsets;
+    std::vector<std::string_view> views;
+
+    auto flush_strings = [&](auto fun) -> void {
+        views.clear();
+        for (size_t i = 0, n = offsets.size(); i < n; ++i) {
+            size_t end = (i + 1 < n ? offsets[i + 1] : chars.size());
+            views.emplace_back(chars.data() + offsets[i], end - offsets[i]);
+        }
+        fun();
+        chars.clear();
+        offsets.clear();
+    };
+
+    cursor.advance();
+    std::string key;
+    bool first = true;
+    size_t num_children = 0;
+
+    while (cursor.next_element('}', first)) {
+        first = false;
+        cursor.read_string(key);
+        cursor.expect(':');
+
+        if (key == "values" && kind == LIST_LIKE) {
+            if (cursor.next_token() != '[') {
+                throw std::runtime_error("expected an array in '" + path + ".values'");
+            }
+            cursor.advance();
+
+            // List names are read back from the spill alongside the children, as each name is needed before its child.
+            SpillCursor names(spill, info.names_offset, buffer_size);
+            std::string name;
+            while (cursor.next_element(']', num_children == 0)) {
+                if (info.named) {
+                    if (num_children >= info.num_names) {
+                        throw std::runtime_error("length of 'names' and 'values' should be the same in '" + path + "'");
+                    }
+                    names.get_string(name);
+                    writer.name(name);
+                }
+                convert_json_object(cursor, writer, records, spill, path + ".values[" + std::to_string(num_children) + "]", version, buffer_size);
+                ++num_children;
+            }
+
+        } else if (key == "values" && kind == INTEGER_LIKE) {
+            bool is_factor = (type != "integer");
+            streamer.stream(info.scalar,
+                [&](bool missing) -> void { integers.push_back(missing ? 0 : streamer.read_integer()); },
+                [&]() -> void {
+                    if (is_factor) {
+                        writer.append_codes(integers.data(), integers.size(), streamer.missing.data());
+                    } else {
+                        writer.append_integers(integers.data(), integers.size(), streamer.missing.data());
+                    }
+                    integers.clear();
+                }
+            );
+
+        } else if (key == "values" && kind == BOOLEAN_LIKE) {
+            streamer.stream(info.scalar,
+                [&](bool missing) -> void {
+                    bool val = false;
+                    if (!missing) {
+                        char c = cursor.next_token();
+                        if (c == 't') {
+                            cursor.read_literal("true");
+                            val = true;
+                        } else if (c == 'f') {
+                            cursor.read_literal("false");
+                        } else {
+                            throw std::runtime_error("expected a boolean at '" + streamer.where() + "'");
+                        }
+                    }
+                    booleans.push_back(val);
+                },
+                [&]() -> void {
+                    writer.append_booleans(booleans.data(), booleans.size(), streamer.missing.data());
+                    booleans.clear();
+                }
+            );
+
+        } else if (key == "values" && kind == NUMBER_LIKE) {
+            streamer.stream(info.scalar,
+                [&](bool missing) -> void {
+                    double val = 0;
+                    if (!missing) {
+                        char c = cursor.next_token();
+                        if (c == '"') {
+                            cursor.read_string(streamer.scratch);
+                            val = json::check_number_string(streamer.scratch, [&]() -> std::string { return streamer.where(); });
+                        } else if (c == '-' || std::isdigit(static_cast<unsigned char>(c))) {
+                            val = cursor.read_number();
+                        } else {
+                            throw std::runtime_error("expected a number at '" + streamer.where() + "'");
+                        }
+                    }
+                    numbers.push_back(val);
+                },
+                [&]() -> void {
+                    writer.append_numbers(numbers.data(), numbers.size(), streamer.missing.data());
+                    numbers.clear();
+                }
+            );
+
+        } else if (key == "values" && kind == BASE64_NUMBER_LIKE) {
+            if (cursor.next_token() != '"') {
+                throw std::runtime_error("expected a base64-encoded string at '" + path + ".values'");
+            }
+            convert_base64_numbers(cursor, writer, info, spill, path, buffer_size);
+
+        } else if (key == "values" && kind == STRING_LIKE) {
+            streamer.stream(info.scalar,
+                [&](bool missing) -> void {
+                    offsets.push_back(chars.size());
+                    if (!missing) {
+                        if (cursor.next_token() != '"') {
+                            throw std::runtime_error("expected a string at '" + streamer.where() + "'");
+                        }
+                        auto& str = streamer.scratch;
+                        cursor.read_string(str);
+                        json::check_string_value(format, str, path);
+                        chars.insert(chars.end(), str.begin(), str.end());
+                    }
+                },
+                [&]() -> void {
+                    flush_strings([&]() -> void { writer.append_strings(views.data(), views.size(), streamer.missing.data()); });
+                }
+            );
+
+        } else if (key == "names" && kind != LIST_LIKE && kind != OTHER) {
+            if (cursor.next_token() != '[') {
+                throw std::runtime_error("expected an array in '" + path + ".names'");
+            }
+            cursor.advance();
+            size_t count = 0;
+            while (cursor.next_element(']', count == 0)) {
+                if (cursor.next_token() != '"') {
+                    throw std::runtime_error("expected a string at '" + path + ".names[" + std::to_string(count) + "]'");
+                }
+                auto& str = streamer.scratch;
+                cursor.read_string(str);
+                offsets.push_back(chars.size());
+                chars.insert(chars.end(), str.begin(), str.end());
+                if (offsets.size() >= buffer_size) {
+                    flush_strings([&]() -> void { writer.append_names(views.data(), views.size()); });
+                }
+                ++count;
+            }
+            flush_strings([&]() -> void { writer.append_names(views.data(), views.size()); });
+
+        } else {
+            cursor.skip_value();
+        }
+    }
+
+    if (kind == LIST_LIKE) {
+        if (info.named && num_children != info.num_names) {
+            throw std::runtime_error("length of 'names' and 'values' should be the same in '" + path + "'");
+        }
+        writer.end_list();
+    } else {
+        // Objects nested in the skipped 'values' of a non-list were still scanned in the first pass.
+        records.skip(info.num_descendants * sizeof(JsonObjectRecord));
+        if (kind != OTHER) {
+            writer.end_vector();
+        }
+    }
+}
+
+template<class Function_>
+void with_json_file_reader(const std::string& file, Function_ fun) {
+    std::unique_ptr<byteme::Reader> ptr;
+    if (byteme::is_gzip(file.c_str())) {
+        ptr.reset(new byteme::GzipFileReader(file.c_str(), {}));
+    } else {
+        ptr.reset(new byteme::RawFileReader(file.c_str(), {}));
+    }
+    fun(*ptr);
+}
+/**
+ * @endcond
+ */
+
+namespace hdf5 {
+
+/**
+ * Stream a list from a HDF5 group into a stream writer, e.g., `json::StreamWriter`.
+ * Each vector is read and written in blocks, so the list is never fully loaded into memory.
+ * Factor levels, string formats, names and missing values are preserved.
+ *
+ * @tparam Writer_ A stream writer class, i.e., `json::StreamWriter` or `hdf5::StreamWriter`.
+ * @param handle Handle to the HDF5 group containing the list.
+ * @param writer Instance of the stream writer.
+ * This should not have been used to write any objects.
+ * `Writer_::finish()` is called upon successful conversion.
+ * @param options Optional parameters.
+ */
+template<class Writer_>
+void convert(const H5::Group& handle, Writer_& writer, const ConvertOptions& options = ConvertOptions()) {
+    auto version = load_version(handle);
+    convert_hdf5_object(handle, writer, version, options.buffer_size);
+    writer.finish();
+}
+
+}
+
+namespace json {
+
+/**
+ * Stream a list from a JSON file into a stream writer, e.g., `hdf5::StreamWriter`.
+ * The file is read twice: once to collect the type, levels and other metadata for each object,
+ * and again to pass the values and names to `writer` in blocks.
+ * The metadata for each object from the first pass, including its list names, factor levels and missing indices,
+ * is moved to a temporary file if it exceeds `ConvertOptions::spill_limit` and is read back as each object is written.
+ * Beyond this limit, the memory usage depends on the nesting depth of the list, but not on the number of objects or the length of the vectors or their names.
+ *
+ * @tparam Writer_ A stream writer class, i.e., `json::StreamWriter` or `hdf5::StreamWriter`.
+ * @param file Path to a (possibly Gzip-compressed) JSON file.
+ * @param writer Instance of the stream writer.
+ * This should not have been used to write any objects.
+ * `Writer_::finish()` is called upon successful conversion.
+ * @param options Optional parameters.
+ */
+template<class Writer_>
+void convert_file(const std::string& file, Writer_& writer, const ConvertOptions& options = ConvertOptions()) {
+    ScanSpill records(options.spill_limit);
+    ScanSpill spill(options.spill_limit);
+    std::string version_string;
+    with_json_file_reader(file, [&](byteme::Reader& reader) -> void {
+        JsonCursor cursor(reader);
+        scan_json_object(cursor, records, spill, "", options.buffer_size, &version_string);
+        cursor.finish();
+    });
+
+    Version version;
+    if (!version_string.empty()) {
+        auto vraw = ritsuko::parse_version_string(version_string.c_str(), version_string.size(), /* skip_patch = */ true);
+        version.major = vraw.major;
+        version.minor = vraw.minor;
+    }
+
+    with_json_file_reader(file, [&](byteme::Reader& reader) -> void {
+        JsonCursor cursor(reader);
+        SpillCursor rcursor(records, 0, options.buffer_size);
+        convert_json_object(cursor, writer, rcursor, spill, "", version, options.buffer_size);
+    });
+    writer.finish();
+}
+
+}
+
+/**
+ * Convert a list from a JSON file to a HDF5 file, without loading the entire list into memory.
+ * See `json::convert_file()` for details.
+ *
+ * @param json_file Path to a (possibly Gzip-compressed) JSON file.
+ * @param hdf5_file Path to the output HDF5 file.
+ * Any existing file is overwritten.
+ * @param name Name of the group in which to write the list.
+ * @param options Optional parameters.
+ */
+inline void json_to_hdf5(const std::string& json_file, const std::string& hdf5_file, const std::string& name, const ConvertOptions& options = ConvertOptions()) {
+    H5::H5File handle(hdf5_file, H5F_ACC_TRUNC);
+    hdf5::StreamWriter writer(handle.createGroup(name), options.hdf5_options);
+    json::convert_file(json_file, writer, options);
+}
+
+/**
+ * Convert a list from a HDF5 file to a JSON file, without loading the entire list into memory.
+ * See `hdf5::convert()` for details.
+ *
+ * @param hdf5_file Path to the HDF5 file.
+ * @param name Name of the group containing the list.
+ * @param json_file Path to the output JSON file.
+ * This is Gzip-compressed if `json::WriteOptions::gzip = true` in `ConvertOptions::json_options`.
+ * @param options Optional parameters.
+ */
+inline void hdf5_to_json(const std::string& hdf5_file, const std::string& name, const std::string& json_file, const ConvertOptions& options = ConvertOptions()) {
+    H5::H5File handle(hdf5_file, H5F_ACC_RDONLY);
+    std::unique_ptr<byteme::Writer> ptr;
+    if (options.json_options.gzip) {
+        ptr.reset(new byteme::GzipFileWriter(json_file.c_str(), {}));
+    } else {
+        ptr.reset(new byteme::RawFileWriter(json_file.c_str(), {}));
+    }
+
+    json::StreamWriter writer(*ptr, options.json_options);
+    hdf5::convert(ritsuko::hdf5::open_group(handle, name.c_str()), writer, options);
+    ptr->finish();
+}
+
+}
+
+#endif
@@ -0,0 +1,395 @@
+#ifndef UZUKI2_EXPORT_ARROW_HPP
+#define UZUKI2_EXPORT_ARROW_HPP
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <limits>
+#include <stdexcept>
+#include <cstdint>
+
+#include "interfaces.hpp"
+#include "Columnar.hpp"
+
+/**
+ * @file export_arrow.hpp
+ * @brief Export parsed lists via the Arrow C data interface.
+ */
+
+/**
+ * @cond
+ */
+// Standard definitions from https://arrow.apache.org/docs/format/CDataInterface.html.
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+    const char* format;
+    const char* name;
+    const char* metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema** children;
+    struct ArrowSchema* dictionary;
+    void (*release)(struct ArrowSchema*);
+    void* private_data;
+};
+
+struct ArrowArray {
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void** buffers;
+    struct ArrowArray** children;
+    struct ArrowArray* dictionary;
+    void (*release)(struct ArrowArray*);
+    void* private_data;
+};
+
+#endif
+/**
+ * @endcond
+ */
+
+namespace uzuki2 {
+
+/**
+ * @namespace uzuki2::arrow
+ * @brief Export parsed lists via the Arrow C data interface.
+ *
+ * Objects created by the `ColumnarProvisioner` can be exported as `ArrowArray`/`ArrowSchema` pairs without copying their values, validity bitmaps or string contents.
+ * The exported arrays hold a reference to the parsed objects, which are kept alive until the arrays are released.
+ */
+namespace arrow {
+
+/**
+ * @cond
+ */
+struct SchemaPrivate {
+    std::string format;
+    std::string name;
+    std::vector<ArrowSchema*> children;
+    ArrowSchema* dictionary = NULL;
+};
+
+inline void release_schema(ArrowSchema* schema) {
+    auto priv = static_cast<SchemaPrivate*>(schema->private_data);
+    for (auto child : priv->children) {
+        if (child->release) {
+            child->release(child);
+        }
+        delete child;
+    }
+    if (priv->dictionary) {
+        if (priv->dictionary->release) {
+            priv->dictionary->release(priv->dictionary);
+        }
+        delete priv->dictionary;
+    }
+    delete priv;
+    schema->release = NULL;
+}
+
+inline void fill_schema(ArrowSchema* schema, std::string format, std::string name, int64_t flags) {
+    auto priv = new SchemaPrivate;
+    priv->format = std::move(format);
+    priv->name = std::move(name);
+    schema->format = priv->format.c_str();
+    schema->name = priv->name.c_str();
+    schema->metadata = NULL;
+    schema->flags = flags;
+    schema->n_children = 0;
+    schema->children = NULL;
+    schema->dictionary = NULL;
+    schema->release = release_schema;
+    schema->private_data = priv;
+}
+
+inline ArrowSchema* add_schema_child(ArrowSchema* schema) {
+    auto priv = static_cast<SchemaPrivate*>(schema->private_data);
+    priv->children.push_back(new ArrowSchema);
+    priv->children.back()->release = NULL;
+    schema->n_children = priv->children.size();
+    schema->children = priv->children.data();
+    return priv->children.back();
+}
+
+struct ArrayPrivate {
+    std::shared_ptr<const Base> owner;
+    std::vector<const void*> buffers;
+    std::vector<ArrowArray*> children;
+    ArrowArray* dictionary = NULL;
+    std::vector<int32_t> offsets32;
+    std::vector<int64_t> offsets64;
+    std::string chars;
+};
+
+inline void release_array(ArrowArray* array) {
+    auto priv = static_cast<ArrayPrivate*>(array->private_data);
+    for (auto child : priv->children) {
+        if (child->release) {
+            child->release(child);
+        }
+        delete child;
+    }
+    if (priv->dictionary) {
+        if (priv->dictionary->release) {
+            priv->dictionary->release(priv->dictionary);
+        }
+        delete priv->dictionary;
+    }
+    delete priv;
+    array->release = NULL;
+}
+
+inline ArrayPrivate* fill_array(ArrowArray* array, std::shared_ptr<const Base> owner, int64_t length, int64_t null_count, std::vector<const void*> buffers) {
+    auto priv = new ArrayPrivate;
+    priv->owner = std::move(owner);
+    priv->buffers = std::move(buffers);
+    array->length = length;
+    array->null_count = null_count;
+    array->offset = 0;
+    array->n_buffers = priv->buffers.size();
+    array->buffers = priv->buffers.data();
+    array->n_children = 0;
+    array->children = NULL;
+    array->dictionary = NULL;
+    array->release = release_array;
+    array->private_data = priv;
+    return priv;
+}
+
+inline ArrowArray* add_array_child(ArrowArray* array) {
+    auto priv = static_cast<ArrayPrivate*>(array->private_data);
+    priv->children.push_back(new ArrowArray);
+    priv->children.back()->release = NULL;
+    array->n_children = priv->children.size();
+    array->children = priv->children.data();
+    return priv->children.back();
+}
+
+template<typename Offset_>
+const Offset_* fill_offsets(const StringColumn& strings, std::vector<Offset_>& offsets, std::string& chars, const char*& data) {
+    size_t n = strings.size();
+    auto starts = strings.starts();
+    auto lengths = strings.lengths();
+
+    // Strings written in order are already contiguous in the arena, so we can point to it directly.
+    bool contiguous = true;
+    size_t position = (n ? starts[0] : 0);
+    for (size_t i = 0; i < n && contiguous; ++i) {
+        contiguous = (starts[i] == position);
+        position += lengths[i];
+    }
+
+    offsets.resize(n + 1);
+    if (contiguous) {
+        size_t first = (n ? starts[0] : 0);
+        for (size_t i = 0; i < n; ++i) {
+            offsets[i] = starts[i] - first;
+        }
+        offsets[n] = position - first;
+        data = strings.chars() + first;
+    } else {
+        offsets[0] = 0;
+        for (size_t i = 0; i < n; ++i) {
+            chars.append(strings.chars() + starts[i], lengths[i]);
+            offsets[i + 1] = chars.size();
+        }
+        data = chars.data();
+    }
+
+    return offsets.data();
+}
+
+inline void export_strings(const StringColumn& strings, const ColumnValidity& validity, std::shared_ptr<const Base> owner, ArrowArray* array, ArrowSchema* schema, const std::string& name) {
+    size_t n = strings.size();
+    auto priv = fill_array(array, std::move(owner), n, validity.null_count(), { validity.bitmap(), NULL, NULL });
+
+    const char* data = NULL;
+    if (strings.chars_size() <= static_cast<size_t>(std::numeric_limits<int32_t>::max())) {
+        priv->buffers[1] = fill_offsets(strings, priv->offsets32, priv->chars, data);
+        fill_schema(schema, "u", name, ARROW_FLAG_NULLABLE);
+    } else {
+        priv->buffers[1] = fill_offsets(strings, priv->offsets64, priv->chars, data);
+        fill_schema(schema, "U", name, ARROW_FLAG_NULLABLE);
+    }
+    priv->buffers[2] = data;
+}
+
+// Interned strings are scattered throughout the arena, so they need to be copied into a contiguous buffer.
+inline void export_interned(const InternedColumn& strings, std::shared_ptr<const Base> owner, ArrowArray* array, ArrowSchema* schema, const std::string& name) {
+    size_t n = strings.size();
+    auto priv = fill_array(array, std::move(owner), n, 0, { NULL, NULL, NULL });
+    priv->offsets64.resize(n + 1);
+    priv->offsets64[0] = 0;
+    for (size_t i = 0; i < n; ++i) {
+        auto x = strings.get(i);
+        priv->chars.append(x.data(), x.size());
+        priv->offsets64[i + 1] = priv->chars.size();
+    }
+
+    if (priv->chars.size() <= static_cast<size_t>(std::numeric_limits<int32_t>::max())) {
+        priv->offsets32.insert(priv->offsets32.end(), priv->offsets64.begin(), priv->offsets64.end());
+        priv->offsets64.clear();
+        priv->buffers[1] = priv->offsets32.data();
+        fill_schema(schema, "u", name, ARROW_FLAG_NULLABLE);
+    } else {
+        priv->buffers[1] = priv->offsets64.data();
+        fill_schema(schema, "U", name, ARROW_FLAG_NULLABLE);
+    }
+    priv->buffers[2] = priv->chars.data();
+}
+
+inline void export_vector(std::shared_ptr<const Base> object, ArrowArray* array, ArrowSchema* schema, const std::string& name) {
+    auto ptr = object.get();
+    switch (ptr->type()) {
+        case INTEGER:
+            {
+                auto iptr = cast_columnar<ColumnarIntegerVector>(ptr, "Arrow export");
+                const auto& validity = iptr->validity();
+                fill_array(array, std::move(object), iptr->size(), validity.null_count(), { validity.bitmap(), iptr->values() });
+                fill_schema(schema, "i", name, ARROW_FLAG_NULLABLE);
+            }
+            break;
+        case NUMBER:
+            {
+                auto dptr = cast_columnar<ColumnarNumberVector>(ptr, "Arrow export");
+                const auto& validity = dptr->validity();
+                fill_array(array, std::move(object), dptr->size(), validity.null_count(), { validity.bitmap(), dptr->values() });
+                fill_schema(schema, "g", name, ARROW_FLAG_NULLABLE);
+            }
+            break;
+        case BOOLEAN:
+            {
+                auto bptr = cast_columnar<ColumnarBooleanVector>(ptr, "Arrow export");
+                const auto& validity = bptr->validity();
+                fill_array(array, std::move(object), bptr->size(), validity.null_count(), { validity.bitmap(), bptr->values() });
+                fill_schema(schema, "b", name, ARROW_FLAG_NULLABLE);
+            }
+            break;
+        case STRING:
+            {
+                auto sptr = cast_columnar<ColumnarStringVector>(ptr, "Arrow export");
+                export_strings(sptr->values(), sptr->validity(), std::move(object), array, schema, name);
+            }
+            break;
+        case FACTOR:
+            {
+                auto fptr = cast_columnar<ColumnarFactor>(ptr, "Arrow export");
+                const auto& validity = fptr->validity();
+                auto priv = fill_array(array, object, fptr->size(), validity.null_count(), { validity.bitmap(), fptr->codes() });
+                fill_schema(schema, "i", name, ARROW_FLAG_NULLABLE | (fptr->is_ordered() ? ARROW_FLAG_DICTIONARY_ORDERED : 0));
+
+                priv->dictionary = new ArrowArray;
+                array->dictionary = priv->dictionary;
+                auto spriv = static_cast<SchemaPrivate*>(schema->private_data);
+                spriv->dictionary = new ArrowSchema;
+                schema->dictionary = spriv->dictionary;
+                export_interned(fptr->levels(), std::move(object), array->dictionary, schema->dictionary, "");
+            }
+            break;
+        default:
+            throw std::runtime_error("expected a vector for Arrow export");
+    }
+}
+
+inline void export_list(std::shared_ptr<const Base> object, ArrowArray* array, ArrowSchema* schema, const std::string& name);
+
+// Each list element becomes a field of a struct of length 1.
+// Vectors are wrapped in a list array with a single entry, as they may have different lengths.
+inline void export_field(std::shared_ptr<const Base> object, ArrowArray* array, ArrowSchema* schema, const std::string& name) {
+    auto type = object->type();
+    if (type == LIST) {
+        export_list(std::move(object), array, schema, name);
+    } else if (type == NOTHING || type == EXTERNAL) {
+        fill_array(array, std::move(object), 1, 1, {});
+        fill_schema(schema, "n", name, ARROW_FLAG_NULLABLE);
+    } else {
+        auto length = static_cast<const Vector*>(object.get())->size();
+        if (length > static_cast<size_t>(std::numeric_limits<int32_t>::max())) {
+            throw std::runtime_error("vector is too long for an Arrow list array");
+        }
+        auto priv = fill_array(array, object, 1, 0, { NULL, NULL });
+        priv->offsets32 = std::vector<int32_t>{ 0, static_cast<int32_t>(length) };
+        priv->buffers[1] = priv->offsets32.data();
+        fill_schema(schema, "+l", name, ARROW_FLAG_NULLABLE);
+        export_vector(std::move(object), add_array_child(array), add_schema_child(schema), "item");
+    }
+}
+
+inline void export_list(std::shared_ptr<const Base> object, ArrowArray* array, ArrowSchema* schema, const std::string& name) {
+    auto lptr = cast_columnar<ColumnarList>(object.get(), "Arrow export");
+    fill_array(array, object, 1, 0, { NULL });
+    fill_schema(schema, "+s", name, ARROW_FLAG_NULLABLE);
+
+    const auto& values = lptr->values();
+    for (size_t i = 0; i < values.size(); ++i) {
+        std::string field_name;
+        if (lptr->has_names()) {
+            field_name = std::string(lptr->names().get(i));
+        }
+        export_field(std::shared_ptr<const Base>(object, values[i]), add_array_child(array), add_schema_child(schema), field_name);
+    }
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Export a parsed object via the Arrow C data interface.
+ * The object and all of its nested objects should have been created by the `ColumnarProvisioner`.
+ *
+ * Vectors are exported as Arrow arrays of the same length, with the validity bitmap derived from the missing values:
+ *
+ * - Integer vectors are exported as `int32` arrays.
+ * - Number vectors are exported as `float64` arrays.
+ * - Boolean vectors are exported as (bit-packed) `bool` arrays.
+ * - String vectors are exported as `utf8` arrays, or `large_utf8` arrays if the total length of the strings exceeds the range of a 32-bit signed integer.
+ * - Factors are exported as dictionary-encoded arrays with `int32` indices and `utf8` levels.
+ *
+ * Lists are exported as `struct` arrays of length 1, with one field per list element, named according to the list names (or empty if the list is unnamed).
+ * Vectors inside a list are wrapped in a `list` array with a single entry, as different vectors may have different lengths.
+ * `NULL` and external objects inside a list are exported as `null` arrays of length 1.
+ * Names of vector elements are not exported.
+ *
+ * Values, validity bitmaps and (for strings written in order) the string contents are not copied.
+ * Only the factor levels are copied into a contiguous buffer, as they are interned individually in the parse's `Arena`.
+ * Instead, the exported arrays hold a reference to `object` that is released by the `ArrowArray::release` callback.
+ *
+ * @param object The parsed object, typically the root of a `ParsedList`.
+ * This should be a vector or a list.
+ * @param[out] array Pointer to an uninitialized `ArrowArray`, to be filled with the array data.
+ * @param[out] schema Pointer to an uninitialized `ArrowSchema`, to be filled with the schema.
+ */
+inline void export_object(std::shared_ptr<const Base> object, ArrowArray* array, ArrowSchema* schema) {
+    array->release = NULL;
+    schema->release = NULL;
+    try {
+        if (object->type() == LIST) {
+            export_list(std::move(object), array, schema, "");
+        } else {
+            export_vector(std::move(object), array, schema, "");
+        }
+    } catch (...) {
+        if (array->release) {
+            array->release(array);
+        }
+        if (schema->release) {
+            schema->release(schema);
+        }
+        throw;
+    }
+}
+
+}
+
+}
+
+#endif
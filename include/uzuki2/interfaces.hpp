@@ -2,6 +2,7 @@
 #define UZUKI2_INTERFACES_HPP
 
 #include <string>
+#include <string_view>
 #include <memory>
 #include <vector>
 #include <cstdint>
@@ -87,12 +88,60 @@ public:
      */
     virtual void set_name(size_t i, std::string n) = 0;
 
+    /**
+     * Set the name of a vector element from a view into a buffer owned by the parser.
+     * By default, this calls `set_name()` with a copy, but subclasses may override it to store the characters directly, e.g., in their own string arena.
+     * This method should only be called if the `Vector` instance was conclassed with support for names.
+     *
+     * @param i Index of a vector element.
+     * @param n Name for the vector element.
+     * This is only valid for the duration of the call.
+     */
+    virtual void set_name_view(size_t i, std::string_view n) {
+        set_name(i, std::string(n));
+    }
+
+    /**
+     * Set the names of a contiguous block of vector elements.
+     * By default, this calls `set_name()` for each element, but subclasses may override it to avoid constructing a `std::string` per name.
+     * This method should only be called if the `Vector` instance was conclassed with support for names.
+     *
+     * @param start Index of the first vector element in the block.
+     * @param data Pointer to a character buffer containing the concatenated names of all elements in the block.
+     * @param offsets Pointer to an array of length `n + 1`.
+     * The name of the `j`-th element in the block is defined by the characters in `[data + offsets[j], data + offsets[j + 1])`.
+     * @param n Number of elements in the block.
+     */
+    virtual void set_name_block(size_t start, const char* data, const size_t* offsets, size_t n) {
+        for (size_t j = 0; j < n; ++j) {
+            set_name(start + j, std::string(data + offsets[j], data + offsets[j + 1]));
+        }
+    }
+
     /**
      * Indicate that a vector element is missing.
      *
      * @param i Index of a vector element to be marked as missing.
      */
     virtual void set_missing(size_t i) = 0;
+
+    /**
+     * Indicate that some elements in a contiguous block of the vector are missing.
+     * By default, this calls `set_missing()` for each missing element, but subclasses may override it to use the bitmap directly, e.g., as a validity mask.
+     *
+     * @param start Index of the first vector element in the block.
+     * @param bitmap Pointer to a packed bitmap of length `ceil(n / 8)`.
+     * The `j`-th element of the block is missing if bit `j % 8` (counting from the least significant bit) of `bitmap[j / 8]` is set.
+     * Unused bits in the last byte are always zero.
+     * @param n Number of elements in the block.
+     */
+    virtual void set_missing_block(size_t start, const uint8_t* bitmap, size_t n) {
+        for (size_t j = 0; j < n; ++j) {
+            if (bitmap[j / 8] & (1u << (j % 8))) {
+                set_missing(start + j);
+            }
+        }
+    }
 };
 
 /**
@@ -111,6 +160,22 @@ public:
      * @param v Value of the vector element.
      */
     virtual void set(size_t i, int32_t v) = 0;
+
+    /**
+     * Set a contiguous block of vector elements.
+     * By default, this calls `set()` for each element, but subclasses may override it to copy the block directly.
+     * Some elements of the block may subsequently be marked as missing by `set_missing_block()` or `set_missing()`;
+     * the values of such elements are set to zero by the parser and should be ignored.
+     *
+     * @param start Index of the first vector element in the block.
+     * @param values Pointer to an array of length `n`, containing the values of the elements in the block.
+     * @param n Number of elements in the block.
+     */
+    virtual void set_block(size_t start, const int32_t* values, size_t n) {
+        for (size_t j = 0; j < n; ++j) {
+            set(start + j, values[j]);
+        }
+    }
 };
 
 /**
@@ -129,6 +194,22 @@ public:
      * @param v Value of the vector element.
      */
     virtual void set(size_t i, double v) = 0;
+
+    /**
+     * Set a contiguous block of vector elements.
+     * By default, this calls `set()` for each element, but subclasses may override it to copy the block directly.
+     * Some elements of the block may subsequently be marked as missing by `set_missing_block()` or `set_missing()`;
+     * the values of such elements are set to zero by the parser and should be ignored.
+     *
+     * @param start Index of the first vector element in the block.
+     * @param values Pointer to an array of length `n`, containing the values of the elements in the block.
+     * @param n Number of elements in the block.
+     */
+    virtual void set_block(size_t start, const double* values, size_t n) {
+        for (size_t j = 0; j < n; ++j) {
+            set(start + j, values[j]);
+        }
+    }
 };
 
 /**
@@ -148,6 +229,58 @@ public:
      */
     virtual void set(size_t i, std::string v) = 0;
 
+    /**
+     * Set a vector element from a view into a buffer owned by the parser.
+     * By default, this calls `set()` with a copy, but subclasses may override it to store the characters directly, e.g., in their own string arena.
+     *
+     * @param i Index of a vector element.
+     * @param v Value of the vector element.
+     * This is only valid for the duration of the call.
+     */
+    virtual void set_view(size_t i, std::string_view v) {
+        set(i, std::string(v));
+    }
+
+    /**
+     * Set a contiguous block of vector elements.
+     * By default, this calls `set()` for each element, but subclasses may override it to avoid constructing a `std::string` per element.
+     * Some elements of the block may subsequently be marked as missing by `set_missing_block()` or `set_missing()`, which takes precedence over the value set here.
+     *
+     * @param start Index of the first vector element in the block.
+     * @param data Pointer to a character buffer containing the concatenated contents of all strings in the block.
+     * @param offsets Pointer to an array of length `n + 1`.
+     * The `j`-th string in the block is defined by the characters in `[data + offsets[j], data + offsets[j + 1])`.
+     * @param n Number of elements in the block.
+     */
+    virtual void set_block(size_t start, const char* data, const size_t* offsets, size_t n) {
+        for (size_t j = 0; j < n; ++j) {
+            set(start + j, std::string(data + offsets[j], data + offsets[j + 1]));
+        }
+    }
+
+    /**
+     * Set all vector elements from a dictionary of distinct strings.
+     * This is only called if dictionary encoding was requested in the parsing options and the vector has few distinct strings,
+     * in which case it is called once after all missing elements have been marked by `set_missing()` or `set_missing_block()`.
+     * By default, this calls `set_view()` for each non-missing element, but subclasses may override it to store the codes directly.
+     *
+     * @param data Pointer to a character buffer containing the concatenated contents of all distinct strings.
+     * @param offsets Pointer to an array of length `nlevels + 1`.
+     * The `l`-th distinct string is defined by the characters in `[data + offsets[l], data + offsets[l + 1])`.
+     * @param nlevels Number of distinct strings.
+     * @param codes Pointer to an array of length equal to `size()`, containing the index of the distinct string for each element.
+     * Missing elements have negative codes.
+     */
+    virtual void set_dictionary(const char* data, const size_t* offsets, size_t nlevels, const int32_t* codes) {
+        (void)nlevels;
+        for (size_t i = 0, n = size(); i < n; ++i) {
+            auto c = codes[i];
+            if (c >= 0) {
+                set_view(i, std::string_view(data + offsets[c], offsets[c + 1] - offsets[c]));
+            }
+        }
+    }
+
     /**
      * Format constraints to apply to the strings.
      *
@@ -178,6 +311,23 @@ public:
      * @param v Value of the vector element.
      */
     virtual void set(size_t i, bool v) = 0;
+
+    /**
+     * Set a contiguous block of vector elements.
+     * By default, this calls `set()` for each element, but subclasses may override it to copy the block directly.
+     * Some elements of the block may subsequently be marked as missing by `set_missing_block()` or `set_missing()`;
+     * the values of such elements are set to zero by the parser and should be ignored.
+     *
+     * @param start Index of the first vector element in the block.
+     * @param values Pointer to an array of length `n`, containing the values of the elements in the block.
+     * Each value is either 0 (false) or 1 (true).
+     * @param n Number of elements in the block.
+     */
+    virtual void set_block(size_t start, const int32_t* values, size_t n) {
+        for (size_t j = 0; j < n; ++j) {
+            set(start + j, values[j] != 0);
+        }
+    }
 };
 
 /**
@@ -200,6 +350,23 @@ public:
      */
     virtual void set(size_t i, size_t v) = 0;
 
+    /**
+     * Set a contiguous block of vector elements.
+     * By default, this calls `set()` for each element, but subclasses may override it to copy the block directly.
+     * Some elements of the block may subsequently be marked as missing by `set_missing_block()` or `set_missing()`;
+     * the values of such elements are set to zero by the parser and should be ignored.
+     *
+     * @param start Index of the first vector element in the block.
+     * @param values Pointer to an array of length `n`, containing the values of the elements in the block.
+     * Each value is a non-negative integer index that references the levels.
+     * @param n Number of elements in the block.
+     */
+    virtual void set_block(size_t start, const int32_t* values, size_t n) {
+        for (size_t j = 0; j < n; ++j) {
+            set(start + j, static_cast<size_t>(values[j]));
+        }
+    }
+
     /**
      * Set the levels of the factor.
      *
@@ -207,6 +374,18 @@ public:
      * @param vl Value of the level element.
      */
     virtual void set_level(size_t il, std::string vl) = 0;
+
+    /**
+     * Set a level of the factor from a view into a buffer owned by the parser.
+     * By default, this calls `set_level()` with a copy, but subclasses may override it to store the characters directly.
+     *
+     * @param il Index of the level element.
+     * @param vl Value of the level element.
+     * This is only valid for the duration of the call.
+     */
+    virtual void set_level_view(size_t il, std::string_view vl) {
+        set_level(il, std::string(vl));
+    }
 };
 
 /**
@@ -261,6 +440,36 @@ public:
      * @param n Name for the list element.
      */
     virtual void set_name(size_t i, std::string n) = 0;
+
+    /**
+     * Set the name of a list element from a view into a buffer owned by the parser.
+     * By default, this calls `set_name()` with a copy.
+     * This should only be called if this `List` instance was conclassed with support for names.
+     *
+     * @param i Index of a list element.
+     * @param n Name for the list element.
+     * This is only valid for the duration of the call.
+     */
+    virtual void set_name_view(size_t i, std::string_view n) {
+        set_name(i, std::string(n));
+    }
+
+    /**
+     * Set the names of a contiguous block of list elements.
+     * By default, this calls `set_name()` for each element, but subclasses may override it to avoid constructing a `std::string` per name.
+     * This should only be called if this `List` instance was conclassed with support for names.
+     *
+     * @param start Index of the first list element in the block.
+     * @param data Pointer to a character buffer containing the concatenated names of all elements in the block.
+     * @param offsets Pointer to an array of length `n + 1`.
+     * The name of the `j`-th element in the block is defined by the characters in `[data + offsets[j], data + offsets[j + 1])`.
+     * @param n Number of elements in the block.
+     */
+    virtual void set_name_block(size_t start, const char* data, const size_t* offsets, size_t n) {
+        for (size_t j = 0; j < n; ++j) {
+            set_name(start + j, std::string(data + offsets[j], data + offsets[j + 1]));
+        }
+    }
 };
 
 }
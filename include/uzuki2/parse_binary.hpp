@@ -0,0 +1,660 @@
+#ifndef UZUKI2_PARSE_BINARY_HPP
+#define UZUKI2_PARSE_BINARY_HPP
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <unordered_set>
+#include <type_traits>
+#include <limits>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+
+#ifndef UZUKI2_BINARY_USE_MMAP
+#if __has_include(<sys/mman.h>) && __has_include(<sys/stat.h>) && __has_include(<fcntl.h>) && __has_include(<unistd.h>)
+#define UZUKI2_BINARY_USE_MMAP 1
+#else
+#define UZUKI2_BINARY_USE_MMAP 0
+#endif
+#endif
+
+#if UZUKI2_BINARY_USE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "ritsuko/ritsuko.hpp"
+
+#include "interfaces.hpp"
+#include "Dummy.hpp"
+#include "ExternalTracker.hpp"
+#include "ParsedList.hpp"
+#include "Arena.hpp"
+#include "Deduplicator.hpp"
+#include "BinaryLayout.hpp"
+
+/**
+ * @file parse_binary.hpp
+ * @brief Parsing methods for binary files.
+ */
+
+namespace uzuki2 {
+
+/**
+ * @namespace uzuki2::binary
+ * @brief Parse an R list from a memory-mappable binary file.
+ *
+ * The binary format stores each object as a fixed-size record in a node table, with the values, missingness and names of each vector in contiguous little-endian blocks.
+ * Parsing involves no conversion of text, as each block is passed to the provisioner as a pointer into the file contents;
+ * the load time is mostly determined by the speed at which the pages of the file can be mapped into memory.
+ * For `parse_file()`, the mapping is owned by the returned top-level pointer, so provisioners may keep these pointers instead of copying the blocks.
+ * See `write()` to create such files.
+ */
+namespace binary {
+
+/**
+ * @brief Options for binary file parsing.
+ */
+struct Options {
+    /**
+     * Whether to throw an error if the top-level R object is not an R list.
+     */
+    bool strict_list = true;
+
+    /**
+     * Whether to deduplicate identical objects in `parse_buffer()` and `parse_file()`.
+     * See `json::Options::deduplicate` for details.
+     */
+    bool deduplicate = false;
+
+    /**
+     * Maximum size of an object's contents for deduplication, in bytes, when `deduplicate = true`.
+     * See `json::Options::deduplicate_max_size` for details.
+     */
+    size_t deduplicate_max_size = 1048576;
+};
+
+/**
+ * @cond
+ */
+class BinaryReader {
+public:
+    // 'data' should be aligned to block_alignment bytes.
+    BinaryReader(const unsigned char* data, size_t size) : my_data(data), my_size(size) {
+        if (my_size < header_size) {
+            throw std::runtime_error("binary file is too small to contain a header");
+        }
+        if (std::memcmp(my_data, magic, sizeof(magic)) != 0) {
+            throw std::runtime_error("binary file does not start with the expected signature");
+        }
+
+        auto major = load_le<uint32_t>(my_data + HEADER_MAJOR);
+        if (major != format_major) {
+            throw std::runtime_error("unsupported major version " + std::to_string(major) + " of the binary format");
+        }
+        version = Version(major, load_le<uint32_t>(my_data + HEADER_MINOR));
+
+        if (load_le<uint64_t>(my_data + HEADER_FILE_SIZE) != my_size) {
+            throw std::runtime_error("size of the binary file does not match the size recorded in its header");
+        }
+        if (!is_zero(my_data + HEADER_RESERVED, header_size - HEADER_RESERVED)) {
+            throw std::runtime_error("reserved fields of the binary file header should be zero");
+        }
+
+        num_nodes = load_le<uint64_t>(my_data + HEADER_NUM_NODES);
+        if (num_nodes == 0) {
+            throw std::runtime_error("binary file should contain at least one node");
+        }
+        my_nodes = load_le<uint64_t>(my_data + HEADER_NODES);
+        check_block(my_nodes, num_nodes, node_size, "node table");
+
+        num_children = load_le<uint64_t>(my_data + HEADER_NUM_CHILDREN);
+        my_children = load_le<uint64_t>(my_data + HEADER_CHILDREN);
+        check_block(my_children, num_children, sizeof(uint64_t), "child table");
+    }
+
+public:
+    Version version;
+    uint64_t num_nodes;
+    uint64_t num_children;
+
+private:
+    const unsigned char* my_data;
+    size_t my_size;
+    uint64_t my_nodes;
+    uint64_t my_children;
+
+public:
+    const unsigned char* node(size_t i) const {
+        return my_data + my_nodes + i * node_size;
+    }
+
+    uint64_t child(size_t i) const {
+        return load_le<uint64_t>(my_data + my_children + i * sizeof(uint64_t));
+    }
+
+    void check_block(uint64_t offset, uint64_t count, size_t element_size, const std::string& what) const {
+        if (offset % block_alignment != 0) {
+            throw std::runtime_error(what + " should start at a multiple of " + std::to_string(block_alignment) + " bytes");
+        }
+        if (offset > my_size || count > (my_size - offset) / element_size) {
+            throw std::runtime_error(what + " extends past the end of the binary file");
+        }
+    }
+
+    // On little-endian machines, this returns a pointer into the file contents; otherwise, the values are copied into 'scratch' and swapped.
+    template<typename Type_>
+    const Type_* array(uint64_t offset, size_t n, std::vector<Type_>& scratch, const std::string& what) const {
+        check_block(offset, n, sizeof(Type_), what);
+        auto ptr = my_data + offset;
+        if (is_little_endian()) {
+            return reinterpret_cast<const Type_*>(ptr);
+        }
+        scratch.resize(n);
+        if (n) {
+            std::memcpy(scratch.data(), ptr, n * sizeof(Type_));
+        }
+        swap_bytes(scratch.data(), n);
+        return scratch.data();
+    }
+
+    // A string block is a uint64 array of 'n + 1' offsets, followed by the characters.
+    const char* strings(uint64_t offset, size_t n, std::vector<size_t>& scratch, const size_t*& offsets, const std::string& what) const {
+        if (n == static_cast<size_t>(-1)) {
+            throw std::runtime_error(what + " extends past the end of the binary file");
+        }
+
+        if constexpr(std::is_same<size_t, uint64_t>::value) {
+            offsets = array<uint64_t>(offset, n + 1, scratch, what);
+        } else {
+            std::vector<uint64_t> raw;
+            auto ptr = array<uint64_t>(offset, n + 1, raw, what);
+            scratch.assign(ptr, ptr + n + 1);
+            offsets = scratch.data();
+        }
+
+        if (offsets[0] != 0) {
+            throw std::runtime_error("first offset should be zero in " + what);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            if (offsets[i] > offsets[i + 1]) {
+                throw std::runtime_error("offsets should be non-decreasing in " + what);
+            }
+        }
+
+        uint64_t start = offset + (n + 1) * sizeof(uint64_t);
+        if (offsets[n] > my_size - start) {
+            throw std::runtime_error("characters in " + what + " extend past the end of the binary file");
+        }
+        return reinterpret_cast<const char*>(my_data + start);
+    }
+
+    const uint8_t* bitmap(uint64_t offset, size_t n, const std::string& what) const {
+        size_t nbytes = n / 8 + (n % 8 != 0);
+        check_block(offset, nbytes, 1, what);
+        auto ptr = my_data + offset;
+        if (n % 8 && (ptr[nbytes - 1] >> (n % 8))) {
+            throw std::runtime_error("unused bits should be zero in " + what);
+        }
+        return ptr;
+    }
+};
+
+// Values of missing elements are required to be zero, consistent with what the other parsers pass to the provisioner.
+template<typename Type_>
+void check_missing_zero(const Type_* values, const uint8_t* bitmap, size_t n, const std::string& path) {
+    for (size_t b = 0, nbytes = (n + 7) / 8; b < nbytes; ++b) {
+        if (bitmap[b] == 0) {
+            continue;
+        }
+        for (size_t j = b * 8, last = std::min(n, b * 8 + 8); j < last; ++j) {
+            if ((bitmap[b] & (1u << (j % 8))) && values[j] != 0) {
+                throw std::runtime_error("missing elements should have values of zero at '" + path + ".values'");
+            }
+        }
+    }
+}
+
+inline bool is_missing(const uint8_t* bitmap, size_t i) {
+    return bitmap && (bitmap[i / 8] & (1u << (i % 8)));
+}
+
+template<class Destination_>
+void fill_vector_contents(const BinaryReader& reader, const unsigned char* node, Destination_* ptr, size_t len, const uint8_t* bitmap, const std::string& path) {
+    if (bitmap) {
+        ptr->set_missing_block(0, bitmap, len);
+    }
+
+    if (node[NODE_FLAGS] & FLAG_NAMED) {
+        std::vector<size_t> scratch;
+        const size_t* offsets;
+        auto chars = reader.strings(load_le<uint64_t>(node + NODE_NAMES), len, scratch, offsets, "names at '" + path + "'");
+        ptr->set_name_block(0, chars, offsets, len);
+    }
+}
+
+template<class Provisioner_, class Externals_>
+std::shared_ptr<Base> parse_node(const BinaryReader& reader, uint64_t index, Externals_& ext, NodeFactory<Provisioner_>& nodes, std::vector<uint8_t>& visited, const std::string& path) {
+    if (visited[index]) {
+        throw std::runtime_error("node " + std::to_string(index) + " should only be referenced once at '" + path + "'");
+    }
+    visited[index] = 1;
+
+    auto node = reader.node(index);
+    auto type = node[NODE_TYPE];
+    auto flags = node[NODE_FLAGS];
+    auto format = node[NODE_FORMAT];
+    uint64_t len = load_le<uint64_t>(node + NODE_LENGTH);
+
+    if (type > EXTERNAL) {
+        throw std::runtime_error("unknown object type " + std::to_string(type) + " at '" + path + "'");
+    }
+    if (flags & ~(FLAG_SCALAR | FLAG_NAMED | FLAG_ORDERED | FLAG_MISSING)) {
+        throw std::runtime_error("unknown flags for object at '" + path + "'");
+    }
+
+    bool vector = is_vector(static_cast<Type>(type));
+    if ((flags & FLAG_SCALAR) && (!vector || len != 1)) {
+        throw std::runtime_error("only vectors of length 1 can be scalars at '" + path + "'");
+    }
+    if ((flags & FLAG_NAMED) && !vector && type != LIST) {
+        throw std::runtime_error("only vectors and lists can be named at '" + path + "'");
+    }
+    if ((flags & FLAG_MISSING) && !vector) {
+        throw std::runtime_error("only vectors can have missing values at '" + path + "'");
+    }
+    if ((flags & FLAG_ORDERED) && type != FACTOR) {
+        throw std::runtime_error("only factors can be ordered at '" + path + "'");
+    }
+    if (format != StringVector::NONE && (type != STRING || format > StringVector::DATETIME)) {
+        throw std::runtime_error("unsupported format " + std::to_string(format) + " at '" + path + "'");
+    }
+    if (!is_zero(node + NODE_RESERVED, NODE_LENGTH - NODE_RESERVED) || !is_zero(node + NODE_RESERVED_TAIL, node_size - NODE_RESERVED_TAIL)) {
+        throw std::runtime_error("reserved fields of the node should be zero at '" + path + "'");
+    }
+
+    bool named = flags & FLAG_NAMED;
+    bool scalar = flags & FLAG_SCALAR;
+    const uint8_t* bitmap = NULL;
+    if (flags & FLAG_MISSING) {
+        bitmap = reader.bitmap(load_le<uint64_t>(node + NODE_MISSING), len, "missing values at '" + path + "'");
+    }
+    uint64_t values_offset = load_le<uint64_t>(node + NODE_VALUES);
+    auto values_what = "values at '" + path + "'";
+
+    std::shared_ptr<Base> output;
+    switch (type) {
+        case INTEGER:
+            {
+                std::vector<int32_t> scratch;
+                auto values = reader.array<int32_t>(values_offset, len, scratch, values_what);
+                if (bitmap) {
+                    check_missing_zero(values, bitmap, len, path);
+                }
+                auto ptr = nodes.new_Integer(output, len, named, scalar);
+                if (len) {
+                    ptr->set_block(0, values, len);
+                }
+                fill_vector_contents(reader, node, ptr, len, bitmap, path);
+            }
+            break;
+
+        case NUMBER:
+            {
+                std::vector<double> scratch;
+                auto values = reader.array<double>(values_offset, len, scratch, values_what);
+                if (bitmap) {
+                    check_missing_zero(values, bitmap, len, path);
+                }
+                auto ptr = nodes.new_Number(output, len, named, scalar);
+                if (len) {
+                    ptr->set_block(0, values, len);
+                }
+                fill_vector_contents(reader, node, ptr, len, bitmap, path);
+            }
+            break;
+
+        case BOOLEAN:
+            {
+                std::vector<int32_t> scratch;
+                auto values = reader.array<int32_t>(values_offset, len, scratch, values_what);
+                for (size_t i = 0; i < len; ++i) {
+                    if (values[i] != 0 && values[i] != 1) {
+                        throw std::runtime_error("boolean values should be 0 or 1 at '" + path + ".values'");
+                    }
+                }
+                if (bitmap) {
+                    check_missing_zero(values, bitmap, len, path);
+                }
+                auto ptr = nodes.new_Boolean(output, len, named, scalar);
+                if (len) {
+                    ptr->set_block(0, values, len);
+                }
+                fill_vector_contents(reader, node, ptr, len, bitmap, path);
+            }
+            break;
+
+        case STRING:
+            {
+                std::vector<size_t> scratch;
+                const size_t* offsets;
+                auto chars = reader.strings(values_offset, len, scratch, offsets, values_what);
+                for (size_t i = 0; i < len; ++i) {
+                    std::string_view x(chars + offsets[i], offsets[i + 1] - offsets[i]);
+                    if (is_missing(bitmap, i)) {
+                        if (!x.empty()) {
+                            throw std::runtime_error("missing elements should be empty strings at '" + path + ".values'");
+                        }
+                    } else if (format == StringVector::DATE && !ritsuko::is_date(x.data(), x.size())) {
+                        throw std::runtime_error("dates should follow YYYY-MM-DD formatting in '" + path + ".values'");
+                    } else if (format == StringVector::DATETIME && !ritsuko::is_rfc3339(x.data(), x.size())) {
+                        throw std::runtime_error("date-times should follow the Internet Date/Time format in '" + path + ".values'");
+                    }
+                }
+
+                auto ptr = nodes.new_String(output, len, named, scalar, static_cast<StringVector::Format>(format));
+                if (len) {
+                    ptr->set_block(0, chars, offsets, len);
+                }
+                fill_vector_contents(reader, node, ptr, len, bitmap, path);
+            }
+            break;
+
+        case FACTOR:
+            {
+                uint64_t nlevels = load_le<uint64_t>(node + NODE_NUM_LEVELS);
+                if (nlevels > static_cast<uint64_t>(std::numeric_limits<int32_t>::max())) {
+                    throw std::runtime_error("number of levels should fit in a 32-bit signed integer at '" + path + "'");
+                }
+
+                std::vector<int32_t> scratch;
+                auto codes = reader.array<int32_t>(values_offset, len, scratch, values_what);
+                for (size_t i = 0; i < len; ++i) {
+                    if (codes[i] < 0 || static_cast<uint64_t>(codes[i]) >= nlevels) {
+                        if (!(codes[i] == 0 && is_missing(bitmap, i))) {
+                            throw std::runtime_error("factor indices of out of range of levels in '" + path + "'");
+                        }
+                    }
+                }
+                if (bitmap) {
+                    check_missing_zero(codes, bitmap, len, path);
+                }
+
+                std::vector<size_t> lscratch;
+                const size_t* loffsets;
+                auto lchars = reader.strings(load_le<uint64_t>(node + NODE_LEVELS), nlevels, lscratch, loffsets, "levels at '" + path + "'");
+
+                auto ptr = nodes.new_Factor(output, len, named, scalar, nlevels, flags & FLAG_ORDERED);
+                if (len) {
+                    ptr->set_block(0, codes, len);
+                }
+
+                std::unordered_set<std::string_view> existing; // views into the file contents, which outlive this loop.
+                for (size_t l = 0; l < nlevels; ++l) {
+                    std::string_view level(lchars + loffsets[l], loffsets[l + 1] - loffsets[l]);
+                    if (existing.find(level) != existing.end()) {
+                        throw std::runtime_error("detected duplicate string at '" + path + ".levels[" + std::to_string(l) + "]'");
+                    }
+                    ptr->set_level_view(l, level);
+                    existing.insert(level);
+                }
+
+                fill_vector_contents(reader, node, ptr, len, bitmap, path);
+            }
+            break;
+
+        case LIST:
+            {
+                if (values_offset > reader.num_children || len > reader.num_children - values_offset) {
+                    throw std::runtime_error("children extend past the end of the child table at '" + path + "'");
+                }
+
+                auto ptr = nodes.new_List(output, len, named);
+                for (size_t i = 0; i < len; ++i) {
+                    auto cindex = reader.child(values_offset + i);
+                    if (cindex <= index || cindex >= reader.num_nodes) {
+                        throw std::runtime_error("child indices should be greater than the parent index and less than the number of nodes at '" + path + "'");
+                    }
+                    ptr->set(i, parse_node<Provisioner_>(reader, cindex, ext, nodes, visited, path + ".values[" + std::to_string(i) + "]"));
+                }
+
+                if (named) {
+                    std::vector<size_t> scratch;
+                    const size_t* offsets;
+                    auto chars = reader.strings(load_le<uint64_t>(node + NODE_NAMES), len, scratch, offsets, "names at '" + path + "'");
+                    ptr->set_name_block(0, chars, offsets, len);
+                }
+            }
+            break;
+
+        case NOTHING:
+            nodes.new_Nothing(output);
+            break;
+
+        case EXTERNAL:
+            if (len >= ext.size()) {
+                throw std::runtime_error("external index out of range at '" + path + ".index'");
+            }
+            nodes.new_External(output, ext.get(len));
+            break;
+    }
+
+    return nodes.finish(std::move(output));
+}
+
+template<class Provisioner_, class Externals_>
+ParsedList parse_aligned(const unsigned char* buffer, size_t len, Externals_ ext, const Options& options) {
+    BinaryReader reader(buffer, len);
+
+    ExternalTracker etrack(std::move(ext));
+    std::vector<uint8_t> visited(reader.num_nodes);
+    std::shared_ptr<Base> output;
+    if (options.deduplicate) {
+        NodeFactory<Deduplicated<Provisioner_> > nodes(options.deduplicate_max_size);
+        output = nodes.release(parse_node<Deduplicated<Provisioner_> >(reader, 0, etrack, nodes, visited, ""));
+    } else {
+        NodeFactory<Provisioner_> nodes;
+        output = nodes.release(parse_node<Provisioner_>(reader, 0, etrack, nodes, visited, ""));
+    }
+
+    for (uint64_t i = 1; i < reader.num_nodes; ++i) {
+        if (!visited[i]) {
+            throw std::runtime_error("node " + std::to_string(i) + " is not referenced by any list");
+        }
+    }
+
+    if (options.strict_list && output->type() != LIST) {
+        throw std::runtime_error("top-level object should represent an R list");
+    }
+    etrack.validate();
+
+    return ParsedList(std::move(output), reader.version);
+}
+
+/*
+ * Read-only view of the file contents. On POSIX systems, the file is mapped
+ * into memory, so pages are only read from disk when the parser touches
+ * them; otherwise, we fall back to reading the entire file into a buffer.
+ */
+class MappedFile {
+public:
+    MappedFile(const std::string& file) {
+#if UZUKI2_BINARY_USE_MMAP
+        int fd = ::open(file.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("failed to open '" + file + "'");
+        }
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("failed to obtain the size of '" + file + "'");
+        }
+
+        my_size = info.st_size;
+        if (my_size) {
+            void* ptr = ::mmap(NULL, my_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (ptr == MAP_FAILED) {
+                throw std::runtime_error("failed to map '" + file + "' into memory");
+            }
+            ::posix_madvise(ptr, my_size, POSIX_MADV_WILLNEED);
+            my_mapped = ptr;
+        } else {
+            ::close(fd);
+        }
+#else
+        std::ifstream handle(file, std::ios::binary | std::ios::ate);
+        if (!handle) {
+            throw std::runtime_error("failed to open '" + file + "'");
+        }
+        my_size = handle.tellg();
+        my_fallback.resize(my_size / sizeof(uint64_t) + 1); // uint64_t for alignment.
+        handle.seekg(0);
+        if (!handle.read(reinterpret_cast<char*>(my_fallback.data()), my_size)) {
+            throw std::runtime_error("failed to read '" + file + "'");
+        }
+#endif
+    }
+
+    ~MappedFile() {
+#if UZUKI2_BINARY_USE_MMAP
+        if (my_mapped) {
+            ::munmap(my_mapped, my_size);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const {
+#if UZUKI2_BINARY_USE_MMAP
+        return static_cast<const unsigned char*>(my_mapped);
+#else
+        return reinterpret_cast<const unsigned char*>(my_fallback.data());
+#endif
+    }
+
+    size_t size() const {
+        return my_size;
+    }
+
+private:
+    size_t my_size = 0;
+#if UZUKI2_BINARY_USE_MMAP
+    void* my_mapped = NULL;
+#else
+    std::vector<uint64_t> my_fallback;
+#endif
+};
+/**
+ * @endcond
+ */
+
+/**
+ * Parse a buffer containing the contents of a binary file created by `write()`.
+ * Each vector is passed to the provisioner as a single block that points directly into `buffer`,
+ * i.e., `set_block()`, `set_missing_block()` and `set_name_block()` are called once per vector with no intermediate copies on little-endian machines.
+ *
+ * The block pointers are only guaranteed to be valid for the duration of each call, as they may refer to a temporary copy of `buffer` (if it is not aligned) or to byte-swapped values (on big-endian machines).
+ * Provisioners should copy the contents of each block unless the caller can guarantee otherwise, e.g., by keeping an aligned `buffer` alive on a little-endian machine.
+ *
+ * @tparam Provisioner_ A class namespace defining static methods for creating new `Base` objects.
+ * See `hdf5::parse()` for more details.
+ * @tparam Externals_ Class describing how to resolve external references for type `EXTERNAL`.
+ * See `hdf5::parse()` for more details.
+ *
+ * @param[in] buffer Pointer to an array containing the binary file contents.
+ * If this is not aligned to 8 bytes, the contents are copied into an aligned buffer before parsing.
+ * @param len Length of the buffer in bytes.
+ * @param ext Instance of an external reference resolver class.
+ * @param options Options for parsing.
+ *
+ * @return A `ParsedList` containing a pointer to the root `Base` object.
+ * The version is that of the binary format, not the JSON or HDF5 specifications.
+ *
+ * Any invalid representations in `buffer` will cause an error to be thrown.
+ */
+template<class Provisioner_, class Externals_>
+ParsedList parse_buffer(const unsigned char* buffer, size_t len, Externals_ ext, const Options& options) {
+    if (reinterpret_cast<uintptr_t>(buffer) % block_alignment != 0) {
+        std::vector<uint64_t> aligned(len / sizeof(uint64_t) + 1);
+        std::memcpy(aligned.data(), buffer, len);
+        return parse_aligned<Provisioner_>(reinterpret_cast<const unsigned char*>(aligned.data()), len, std::move(ext), options);
+    }
+    return parse_aligned<Provisioner_>(buffer, len, std::move(ext), options);
+}
+
+/**
+ * Parse a binary file created by `write()`.
+ * On POSIX systems, the file is memory-mapped, otherwise it is read into memory; see `parse_buffer()` for details.
+ *
+ * The mapping is owned by the top-level pointer in the returned `ParsedList`, in the same manner as an `Arena`.
+ * On little-endian machines, the block pointers passed to the provisioner remain valid as long as that pointer (or a copy of it) is alive,
+ * so provisioners may store them instead of copying the contents of each vector.
+ * On big-endian machines, the blocks are byte-swapped copies that are only valid for the duration of each call.
+ *
+ * @tparam Provisioner_ A class namespace defining static methods for creating new `Base` objects.
+ * See `hdf5::parse()` for more details.
+ * @tparam Externals_ Class describing how to resolve external references for type `EXTERNAL`.
+ * See `hdf5::parse()` for more details.
+ *
+ * @param file Path to the binary file.
+ * @param ext Instance of an external reference resolver class.
+ * @param options Options for parsing.
+ *
+ * @return A `ParsedList` containing a pointer to the root `Base` object.
+ *
+ * Any invalid representations in `file` will cause an error to be thrown.
+ */
+template<class Provisioner_, class Externals_>
+ParsedList parse_file(const std::string& file, Externals_ ext, const Options& options) {
+    auto mapped = std::make_shared<MappedFile>(file);
+    auto output = parse_aligned<Provisioner_>(mapped->data(), mapped->size(), std::move(ext), options);
+
+    // The mapping is declared first so that it outlives the tree, in case any destructors refer to the blocks.
+    struct MappedRoot {
+        std::shared_ptr<MappedFile> mapped;
+        std::shared_ptr<Base> root;
+    };
+    auto owner = std::make_shared<MappedRoot>(MappedRoot{ std::move(mapped), output.ptr });
+    output.ptr = std::shared_ptr<Base>(owner, owner->root.get());
+    return output;
+}
+
+/**
+ * Validate a buffer containing the contents of a binary file against the format expected by `parse_buffer()`.
+ * Any invalid representations will cause an error to be thrown.
+ *
+ * @param[in] buffer Pointer to an array containing the binary file contents.
+ * @param len Length of the buffer in bytes.
+ * @param num_external Expected number of external references.
+ * @param options Options for parsing.
+ */
+inline void validate_buffer(const unsigned char* buffer, size_t len, int num_external, const Options& options) {
+    parse_buffer<DummyProvisioner>(buffer, len, DummyExternals(num_external), options);
+}
+
+/**
+ * Validate a binary file against the format expected by `parse_file()`.
+ * Any invalid representations will cause an error to be thrown.
+ *
+ * @param file Path to the binary file.
+ * @param num_external Expected number of external references.
+ * @param options Options for parsing.
+ */
+inline void validate_file(const std::string& file, int num_external, const Options& options) {
+    parse_file<DummyProvisioner>(file, DummyExternals(num_external), options);
+}
+
+}
+
+}
+
+#endif
@@ -5,10 +5,15 @@
 #include <vector>
 #include <cctype>
 #include <string>
+#include <string_view>
 #include <cstring>
 #include <stdexcept>
 #include <cstdint>
+#include <cmath>
+#include <algorithm>
 #include <unordered_set>
+#include <optional>
+#include <limits>
 
 #include "H5Cpp.h"
 
@@ -17,6 +22,11 @@
 #include "ExternalTracker.hpp"
 #include "Version.hpp"
 #include "ParsedList.hpp"
+#include "FilePool.hpp"
+#include "static_interfaces.hpp"
+#include "Arena.hpp"
+#include "DictionaryEncoder.hpp"
+#include "Deduplicator.hpp"
 
 #include "ritsuko/ritsuko.hpp"
 #include "ritsuko/hdf5/hdf5.hpp"
@@ -39,6 +49,48 @@ namespace uzuki2 {
  */
 namespace hdf5 {
 
+/**
+ * @brief Options for HDF5 file parsing.
+ */
+struct Options {
+    /**
+     * Buffer size, in terms of the number of elements, to use for reading data from HDF5 datasets.
+     */
+    hsize_t buffer_size = 10000;
+
+    /**
+     * Whether to throw an error if the top-level R object is not an R list.
+     */
+    bool strict_list = true;
+
+    /**
+     * Pool of file handles to use in the overloads that accept a file path.
+     * If `NULL`, each call opens and closes the file itself.
+     * Otherwise, the file is obtained from the pool, which should outlive the call.
+     */
+    FilePool* file_pool = NULL;
+
+    /**
+     * Maximum number of distinct strings for dictionary encoding of string vectors.
+     * If positive, each non-scalar string vector with no more than this many distinct strings is delivered via `StringVector::set_dictionary()`.
+     * If zero, dictionary encoding is disabled.
+     */
+    size_t max_dictionary_levels = 0;
+
+    /**
+     * Whether to deduplicate identical objects in `parse()`.
+     * See `json::Options::deduplicate` for details.
+     * This option is also respected by `parse_subset()` and `LazyObject::load()`, but is ignored by `parse_range()` as it only creates a single vector.
+     */
+    bool deduplicate = false;
+
+    /**
+     * Maximum size of an object's contents for deduplication, in bytes, when `deduplicate = true`.
+     * See `json::Options::deduplicate_max_size` for details.
+     */
+    size_t deduplicate_max_size = 1048576;
+};
+
 /**
  * @cond
  */
@@ -53,14 +105,122 @@ inline H5::DataSet check_scalar_dataset(const H5::Group& handle, const char* nam
     return dhandle;
 }
 
-template<class Host_, class Function_>
-void parse_integer_like(const H5::DataSet& handle, Host_* ptr, bool is_scalar, Function_ check, const Version& version, hsize_t buffer_size) try {
+/*
+ * Missing value placeholders are detected for an entire block of values at a time.
+ * Each kernel fills a byte mask and returns the number of missing values, 
+ * using branch-free loops that can be auto-vectorized by the compiler.
+ * This allows us to skip the per-element comparison for the (common) blocks without any missing values.
+ */
+template<typename Type_>
+size_t mark_equal_placeholders(const Type_* values, size_t n, Type_ placeholder, uint8_t* mask) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        mask[i] = (values[i] == placeholder);
+        count += mask[i];
+    }
+    return count;
+}
+
+inline size_t mark_identical_placeholders(const double* values, size_t n, double placeholder, uint8_t* mask) {
+    // Comparing the bit patterns so that the NaN payload is also considered.
+    uint64_t target;
+    std::memcpy(&target, &placeholder, sizeof(double));
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t current;
+        std::memcpy(&current, values + i, sizeof(double));
+        mask[i] = (current == target);
+        count += mask[i];
+    }
+    return count;
+}
+
+inline size_t mark_nan_placeholders(const double* values, size_t n, uint8_t* mask) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        mask[i] = std::isnan(values[i]);
+        count += mask[i];
+    }
+    return count;
+}
+
+inline void pack_missing_bitmap(const uint8_t* mask, size_t n, std::vector<uint8_t>& bitmap) {
+    bitmap.clear();
+    bitmap.resize((n + 7) / 8);
+    for (size_t j = 0; j < n; ++j) {
+        bitmap[j / 8] |= static_cast<uint8_t>(mask[j] << (j % 8));
+    }
+}
+
+template<typename Type_>
+struct MissingWorkspace {
+    std::vector<uint8_t> mask;
+    std::vector<uint8_t> bitmap;
+    std::vector<Type_> values;
+};
+
+/*
+ * Blocks without missing values are passed directly to set_block(). Otherwise,
+ * the block is copied with zeros in place of the placeholders, so that the
+ * entire block can still be passed to set_block(), followed by a bitmap of the
+ * missing elements in set_missing_block().
+ */
+template<class Host_, typename Type_, class Function_, class Mark_>
+void fill_block_with_mask(Host_* ptr, hsize_t start, const Type_* values, size_t n, Function_& check, bool has_missing, Mark_& mark, MissingWorkspace<Type_>& work) {
+    size_t nmissing = 0;
+    if (has_missing) {
+        work.mask.resize(n);
+        nmissing = mark(values, n, work.mask.data());
+    }
+
+    if (nmissing == 0) {
+        for (size_t i = 0; i < n; ++i) {
+            check(values[i]);
+        }
+        ptr->set_block(start, values, n);
+        return;
+    }
+
+    const auto& mask = work.mask;
+    work.values.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        if (mask[i]) {
+            work.values[i] = 0;
+        } else {
+            check(values[i]);
+            work.values[i] = values[i];
+        }
+    }
+    ptr->set_block(start, work.values.data(), n);
+
+    pack_missing_bitmap(mask.data(), n, work.bitmap);
+    ptr->set_missing_block(start, work.bitmap.data(), n);
+}
+
+template<class Host_, typename Type_, class Function_, class Mark_>
+void fill_from_stream(Host_* ptr, ritsuko::hdf5::Stream1dNumericDataset<Type_>& stream, hsize_t full_length, Function_& check, bool has_missing, Mark_& mark) {
+    MissingWorkspace<Type_> work;
+    hsize_t i = 0;
+    while (i < full_length) {
+        auto block = stream.get_many();
+        size_t n = std::min(static_cast<hsize_t>(block.second), full_length - i);
+        fill_block_with_mask(ptr, i, block.first, n, check, has_missing, mark, work);
+        stream.next(n);
+        i += n;
+    }
+}
+
+/*
+ * The prepare_* functions check the datatype of each dataset and load its missing value placeholder, if any.
+ * These are separated from the parse_* functions so that they can be re-used without reading the dataset contents.
+ */
+inline bool prepare_integer_like(const H5::DataSet& handle, const Version& version, int32_t& missing_value) {
     if (ritsuko::hdf5::exceeds_integer_limit(handle, 32, true)) {
         throw std::runtime_error("dataset cannot be represented by 32-bit signed integers");
     }
 
     bool has_missing = false;
-    int32_t missing_value = -2147483648;
+    missing_value = -2147483648;
     if (version.equals(1, 0)) {
         has_missing = true;
     } else {
@@ -73,43 +233,118 @@ void parse_integer_like(const H5::DataSet& handle, Host_* ptr, bool is_scalar, F
         }
     }
 
-    auto set = [&](hsize_t i, int32_t x) -> void {
-        if (has_missing && x == missing_value) {
-            ptr->set_missing(i);
-        } else {
-            check(x);
-            ptr->set(i, x);
+    return has_missing;
+}
+
+inline bool prepare_numbers(const H5::DataSet& handle, const Version& version, double& missing_value) {
+    if (version.lt(1, 3)) {
+        if (handle.getTypeClass() != H5T_FLOAT) {
+            throw std::runtime_error("expected a floating-point dataset");
         }
+    } else {
+        if (ritsuko::hdf5::exceeds_float_limit(handle, 64)) {
+            throw std::runtime_error("dataset cannot be represented by 64-bit floats");
+        }
+    }
+
+    bool has_missing = false;
+    missing_value = 0;
+    if (version.equals(1, 0)) {
+        has_missing = true;
+        missing_value = ritsuko::r_missing_value();
+    } else {
+        const char* placeholder_name = "missing-value-placeholder";
+        has_missing = handle.attrExists(placeholder_name);
+        if (has_missing) {
+            auto attr = handle.openAttribute(placeholder_name);
+            ritsuko::hdf5::check_numeric_missing_placeholder_attribute(handle, attr, /* type_class_only = */ version.lt(1, 2));
+            attr.read(H5::PredType::NATIVE_DOUBLE, &missing_value);
+        }
+    }
+
+    return has_missing;
+}
+
+inline std::optional<std::string> prepare_string_like(const H5::DataSet& handle) {
+    if (!ritsuko::hdf5::is_utf8_string(handle)) {
+        throw std::runtime_error("expected a datatype that can be represented by a UTF-8 encoded string");
+    }
+    return ritsuko::hdf5::open_and_load_optional_string_missing_placeholder(handle, "missing-value-placeholder");
+}
+
+template<class Host_, class Function_>
+void parse_integer_like(const H5::DataSet& handle, Host_* ptr, bool is_scalar, Function_ check, const Version& version, hsize_t buffer_size) try {
+    int32_t missing_value;
+    bool has_missing = prepare_integer_like(handle, version, missing_value);
+
+    auto mark = [&](const int32_t* values, size_t n, uint8_t* mask) -> size_t {
+        return mark_equal_placeholders(values, n, missing_value, mask);
     };
 
     if (is_scalar) {
         int32_t value;
         handle.read(&value, H5::PredType::NATIVE_INT32);
-        set(0, value);
+        MissingWorkspace<int32_t> work;
+        fill_block_with_mask(ptr, 0, &value, 1, check, has_missing, mark, work);
     } else {
         hsize_t full_length = ptr->size();
         ritsuko::hdf5::Stream1dNumericDataset<int32_t> stream(&handle, full_length, buffer_size);
-        for (hsize_t i = 0; i < full_length; ++i, stream.next()) {
-            set(i, stream.get());
-        }
+        fill_from_stream(ptr, stream, full_length, check, has_missing, mark);
     }
 
 } catch (std::exception& e) {
     throw std::runtime_error("failed to load integer dataset at '" + ritsuko::hdf5::get_name(handle) + "'; " + std::string(e.what()));
 }
 
-template<class Host_, class Function_>
-void parse_string_like(const H5::DataSet& handle, Host_* ptr, bool is_scalar, Function_ check, hsize_t buffer_size) try {
-    if (!ritsuko::hdf5::is_utf8_string(handle)) {
-        throw std::runtime_error("expected a datatype that can be represented by a UTF-8 encoded string");
+/*
+ * Reads a fixed-length string dataset in blocks of raw bytes. Each string is
+ * truncated at its first NUL and compacted in place, so that each block is
+ * delivered as a contiguous character buffer with an array of n + 1 offsets
+ * rather than as one std::string per element.
+ */
+template<class Function_>
+void stream_fixed_strings(const H5::DataSet& handle, hsize_t full_length, hsize_t buffer_size, Function_ fun) {
+    auto dtype = handle.getDataType();
+    size_t width = dtype.getSize();
+    hsize_t block_size = std::max(static_cast<hsize_t>(1), std::min(buffer_size, full_length));
+    std::vector<char> buffer(block_size * width);
+    std::vector<size_t> offsets(block_size + 1);
+
+    H5::DataSpace dspace(1, &full_length);
+    H5::DataSpace mspace(1, &block_size);
+    constexpr hsize_t zero = 0;
+
+    for (hsize_t start = 0; start < full_length; start += block_size) {
+        hsize_t n = std::min(block_size, full_length - start);
+        dspace.selectHyperslab(H5S_SELECT_SET, &n, &start);
+        mspace.selectHyperslab(H5S_SELECT_SET, &n, &zero);
+        handle.read(buffer.data(), dtype, mspace, dspace);
+
+        char* base = buffer.data();
+        size_t pos = 0;
+        for (hsize_t j = 0; j < n; ++j) {
+            const char* src = base + j * width;
+            auto nul = static_cast<const char*>(std::memchr(src, '\0', width));
+            size_t len = (nul == NULL ? width : static_cast<size_t>(nul - src));
+            if (base + pos != src) {
+                std::memmove(base + pos, src, len);
+            }
+            pos += len;
+            offsets[j + 1] = pos;
+        }
+
+        fun(start, static_cast<size_t>(n), static_cast<const char*>(base), static_cast<const size_t*>(offsets.data()));
     }
+}
 
-    auto missingness = ritsuko::hdf5::open_and_load_optional_string_missing_placeholder(handle, "missing-value-placeholder");
+template<class Host_, class Function_>
+void parse_string_like(const H5::DataSet& handle, Host_* ptr, bool is_scalar, Function_ check, hsize_t buffer_size) try {
+    auto missingness = prepare_string_like(handle);
     auto set = [&](hsize_t i, std::string x) -> void { 
         if (missingness.has_value() && x == *missingness) {
             ptr->set_missing(i);
         } else {
-            check(x);
+            check(x.c_str(), x.size());
             ptr->set(i, std::move(x));
         }
     };
@@ -117,6 +352,31 @@ void parse_string_like(const H5::DataSet& handle, Host_* ptr, bool is_scalar, Fu
     if (is_scalar) {
         auto x = ritsuko::hdf5::load_scalar_string_dataset(handle);
         set(0, std::move(x));
+
+    } else if (!handle.getDataType().isVariableStr()) {
+        std::vector<uint8_t> mask, bitmap;
+        stream_fixed_strings(handle, ptr->size(), buffer_size, [&](hsize_t start, size_t n, const char* data, const size_t* offsets) -> void {
+            mask.clear();
+            mask.resize(n);
+            size_t nmissing = 0;
+            for (size_t j = 0; j < n; ++j) {
+                const char* x = data + offsets[j];
+                size_t len = offsets[j + 1] - offsets[j];
+                if (missingness.has_value() && len == missingness->size() && std::equal(x, x + len, missingness->begin())) {
+                    mask[j] = 1;
+                    ++nmissing;
+                } else {
+                    check(x, len);
+                }
+            }
+
+            ptr->set_block(start, data, offsets, n);
+            if (nmissing) {
+                pack_missing_bitmap(mask.data(), n, bitmap);
+                ptr->set_missing_block(start, bitmap.data(), n);
+            }
+        });
+
     } else {
         hsize_t full_length = ptr->size();
         ritsuko::hdf5::Stream1dStringDataset stream(&handle, full_length, buffer_size);
@@ -131,70 +391,38 @@ void parse_string_like(const H5::DataSet& handle, Host_* ptr, bool is_scalar, Fu
 
 template<class Host_, class Function_>
 void parse_numbers(const H5::DataSet& handle, Host_* ptr, bool is_scalar, Function_ check, const Version& version, hsize_t buffer_size) try {
-    if (version.lt(1, 3)) {
-        if (handle.getTypeClass() != H5T_FLOAT) {
-            throw std::runtime_error("expected a floating-point dataset");
-        }
-    } else {
-        if (ritsuko::hdf5::exceeds_float_limit(handle, 64)) {
-            throw std::runtime_error("dataset cannot be represented by 64-bit floats");
-        }
-    }
-
-    bool has_missing = false;
-    double missing_value = 0;
-    if (version.equals(1, 0)) {
-        has_missing = true;
-        missing_value = ritsuko::r_missing_value();
-    } else {
-        const char* placeholder_name = "missing-value-placeholder";
-        has_missing = handle.attrExists(placeholder_name);
-        if (has_missing) {
-            auto attr = handle.openAttribute(placeholder_name);
-            ritsuko::hdf5::check_numeric_missing_placeholder_attribute(handle, attr, /* type_class_only = */ version.lt(1, 2));
-            attr.read(H5::PredType::NATIVE_DOUBLE, &missing_value);
-        }
-    }
+    double missing_value;
+    bool has_missing = prepare_numbers(handle, version, missing_value);
 
+    // Resolving the comparison mode once, rather than branching on it for every value.
     bool should_compare_nan = version.lt(1, 3);
     bool is_placeholder_nan = std::isnan(missing_value);
-    auto is_missing_value = [&](double val) -> bool {
+    auto mark = [&](const double* values, size_t n, uint8_t* mask) -> size_t {
         if (should_compare_nan) {
-            return ritsuko::are_floats_identical(&val, &missing_value);
+            return mark_identical_placeholders(values, n, missing_value, mask);
         } else if (is_placeholder_nan) {
-            return std::isnan(val);
-        } else {
-            return val == missing_value;
-        }
-    };
-
-    auto set = [&](hsize_t i, double x) -> void {
-        if (has_missing && is_missing_value(x)) {
-            ptr->set_missing(i);
+            return mark_nan_placeholders(values, n, mask);
         } else {
-            check(x);
-            ptr->set(i, x);
+            return mark_equal_placeholders(values, n, missing_value, mask);
         }
     };
 
     if (is_scalar) {
         double val;
         handle.read(&val, H5::PredType::NATIVE_DOUBLE);
-        set(0, val);
+        MissingWorkspace<double> work;
+        fill_block_with_mask(ptr, 0, &val, 1, check, has_missing, mark, work);
     } else {
         hsize_t full_length = ptr->size();
         ritsuko::hdf5::Stream1dNumericDataset<double> stream(&handle, full_length, buffer_size);
-        for (hsize_t i = 0; i < full_length; ++i, stream.next()) {
-            set(i, stream.get());
-        }
+        fill_from_stream(ptr, stream, full_length, check, has_missing, mark);
     }
 
 } catch (std::exception& e) {
     throw std::runtime_error("failed to load floating-point dataset at '" + ritsuko::hdf5::get_name(handle) + "'; " + std::string(e.what()));
 }
 
-template<class Host_>
-void extract_names(const H5::Group& handle, Host_* ptr, hsize_t buffer_size) try {
+inline H5::DataSet open_names(const H5::Group& handle, size_t len) {
     if (handle.childObjType("names") != H5O_TYPE_DATASET) {
         throw std::runtime_error("expected a dataset");
     }
@@ -204,309 +432,525 @@ void extract_names(const H5::Group& handle, Host_* ptr, hsize_t buffer_size) try
         throw std::runtime_error("expected a datatype that can be represented by a UTF-8 encoded string");
     }
 
-    size_t len = ptr->size();
     size_t nlen = ritsuko::hdf5::get_1d_length(nhandle.getSpace(), false);
     if (nlen != len) {
         throw std::runtime_error("number of names should be equal to the object length");
     }
 
-    ritsuko::hdf5::Stream1dStringDataset stream(&nhandle, nlen, buffer_size);
-    for (size_t i = 0; i < nlen; ++i, stream.next()) {
-        ptr->set_name(i, stream.steal());
+    return nhandle;
+}
+
+template<class Host_>
+void extract_names(const H5::Group& handle, Host_* ptr, hsize_t buffer_size) try {
+    size_t nlen = ptr->size();
+    auto nhandle = open_names(handle, nlen);
+    if (!nhandle.getDataType().isVariableStr()) {
+        stream_fixed_strings(nhandle, nlen, buffer_size, [&](hsize_t start, size_t n, const char* data, const size_t* offsets) -> void {
+            ptr->set_name_block(start, data, offsets, n);
+        });
+    } else {
+        ritsuko::hdf5::Stream1dStringDataset stream(&nhandle, nlen, buffer_size);
+        for (size_t i = 0; i < nlen; ++i, stream.next()) {
+            ptr->set_name(i, stream.steal());
+        }
     }
 } catch (std::exception& e) {
     throw std::runtime_error("failed to load names at '" + ritsuko::hdf5::get_name(handle) + "'; " + std::string(e.what()));
 }
 
-template<class Provisioner_, class Externals_>
-std::shared_ptr<Base> parse_inner(const H5::Group& handle, Externals_& ext, const Version& version, hsize_t buffer_size) try {
-    // Deciding what type we're dealing with.
-    auto object_type = ritsuko::hdf5::open_and_load_scalar_string_attribute(handle, "uzuki_object");
-    std::shared_ptr<Base> output;
-
-    if (object_type == "list") {
-        auto dhandle = ritsuko::hdf5::open_group(handle, "data");
-        size_t len = dhandle.getNumObjs();
+inline std::vector<std::string> load_names(const H5::Group& handle, size_t len, hsize_t buffer_size) {
+    struct NameCollector {
+        size_t size() const { return values.size(); }
+        void set_name(size_t i, std::string n) { values[i] = std::move(n); }
+        void set_name_block(size_t start, const char* data, const size_t* offsets, size_t n) {
+            for (size_t j = 0; j < n; ++j) {
+                values[start + j].assign(data + offsets[j], data + offsets[j + 1]);
+            }
+        }
+        std::vector<std::string> values;
+    };
 
-        bool named = handle.exists("names");
-        auto lptr = Provisioner_::new_List(len, named);
-        output.reset(lptr);
+    NameCollector collector;
+    collector.values.resize(len);
+    extract_names(handle, &collector, buffer_size);
+    return std::move(collector.values);
+}
 
-        try {
-            for (size_t i = 0; i < len; ++i) {
-                auto istr = std::to_string(i);
-                auto lhandle = ritsuko::hdf5::open_group(dhandle, istr.c_str());
-                lptr->set(i, parse_inner<Provisioner_>(lhandle, ext, version, buffer_size));
+inline void load_levels(const H5::DataSet& handle, hsize_t len, hsize_t buffer_size, std::string& data, std::vector<size_t>& offsets) {
+    offsets.clear();
+    offsets.reserve(len + 1);
+    offsets.push_back(0);
+    if (!handle.getDataType().isVariableStr()) {
+        stream_fixed_strings(handle, len, buffer_size, [&](hsize_t, size_t n, const char* block, const size_t* boffsets) -> void {
+            data.append(block, boffsets[n]);
+            for (size_t j = 1; j <= n; ++j) {
+                offsets.push_back(offsets.back() + boffsets[j] - boffsets[j - 1]);
             }
-        } catch (std::exception& e) {
-            throw std::runtime_error("failed to parse list contents in 'data'; " + std::string(e.what()));
+        });
+    } else {
+        ritsuko::hdf5::Stream1dStringDataset stream(&handle, len, buffer_size);
+        for (hsize_t i = 0; i < len; ++i, stream.next()) {
+            data += stream.get();
+            offsets.push_back(data.size());
         }
+    }
+}
 
-        if (named) {
-            extract_names(handle, lptr, buffer_size);
-        }
+inline bool is_factor_type(const std::string& vector_type, const Version& version) {
+    return vector_type == "factor" || (version.equals(1, 0) && vector_type == "ordered");
+}
 
-    } else if (object_type == "vector") {
-        auto vector_type = ritsuko::hdf5::open_and_load_scalar_string_attribute(handle, "uzuki_type");
+inline bool is_vls_type(const std::string& vector_type, const Version& version) {
+    return vector_type == "vls" && !version.lt(1, 4);
+}
 
-        auto dhandle = ritsuko::hdf5::open_dataset(handle, "data");
-        size_t len = ritsuko::hdf5::get_1d_length(dhandle.getSpace(), true);
-        bool is_scalar = (len == 0);
-        if (is_scalar) {
-            len = 1;
-        }
+typedef ritsuko::hdf5::vls::Pointer<uint64_t, uint64_t> VlsPointer;
 
-        bool named = handle.exists("names");
+/*
+ * Reads the heap slices for a block of VLS pointers. The pointers are sorted
+ * by offset and adjacent or overlapping slices are merged, so that each
+ * contiguous run of the heap is read with a single call to HDF5. Strings are
+ * then passed to the callback as views into the combined buffer.
+ */
+class VlsHeapReader {
+public:
+    VlsHeapReader(const H5::DataSet& heap) : my_heap(heap) {
+        my_heap_length = ritsuko::hdf5::get_1d_length(my_heap, false);
+        my_heap_space.setExtentSimple(1, &my_heap_length);
+    }
 
-        if (vector_type == "integer") {
-            auto iptr = Provisioner_::new_Integer(len, named, is_scalar);
-            output.reset(iptr);
-            parse_integer_like(
-                dhandle,
-                iptr,
-                is_scalar,
-                [](int32_t) -> void {},
-                version,
-                buffer_size
-            );
-
-        } else if (vector_type == "boolean") {
-            auto bptr = Provisioner_::new_Boolean(len, named, is_scalar);
-            output.reset(bptr);
-            parse_integer_like(
-                dhandle,
-                bptr,
-                is_scalar,
-                [&](int32_t x) -> void { 
-                    if (x != 0 && x != 1) {
-                        throw std::runtime_error("boolean values should be 0 or 1");
-                    }
-                },
-                version,
-                buffer_size
-            );
-
-        } else if (vector_type == "factor" || (version.equals(1, 0) && vector_type == "ordered")) {
-            auto levhandle = ritsuko::hdf5::open_dataset(handle, "levels");
-            if (!ritsuko::hdf5::is_utf8_string(levhandle)) {
-                throw std::runtime_error("expected a datatype that can be represented by a UTF-8 encoded string");
+    template<class Function_>
+    void read(const H5::DataSet& pointer_handle, const VlsPointer* pointers, size_t n, Function_ fun) {
+        my_order.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            const auto& x = pointers[i];
+            if (x.offset > my_heap_length || x.length > my_heap_length - x.offset) {
+                throw std::runtime_error("VLS array pointers at '" + ritsuko::hdf5::get_name(pointer_handle) + "' are out of range of the heap");
             }
+            my_order[i] = i;
+        }
 
-            int32_t levlen = ritsuko::hdf5::get_1d_length(levhandle.getSpace(), false);
-            bool ordered = false;
-            if (vector_type == "ordered") {
-                ordered = true;
-            } else if (handle.exists("ordered")) {
-                auto ohandle = check_scalar_dataset(handle, "ordered");
-                if (ritsuko::hdf5::exceeds_integer_limit(ohandle, 32, true)) {
-                    throw std::runtime_error("'ordered' value cannot be represented by a 32-bit integer");
-                }
-                int32_t tmp_ordered = 0;
-                ohandle.read(&tmp_ordered, H5::PredType::NATIVE_INT32);
-                ordered = tmp_ordered > 0;
+        // Pointers are usually written in order, so we can often skip the sort.
+        auto by_offset = [&](size_t l, size_t r) -> bool { return pointers[l].offset < pointers[r].offset; };
+        if (!std::is_sorted(my_order.begin(), my_order.end(), by_offset)) {
+            std::sort(my_order.begin(), my_order.end(), by_offset);
+        }
+
+        // Merging the slices into runs and figuring out where each string lives in the buffer.
+        my_positions.resize(n);
+        my_runs.clear();
+        hsize_t total = 0;
+        for (auto i : my_order) {
+            const auto& x = pointers[i];
+            if (my_runs.empty() || x.offset > my_runs.back().end) {
+                my_runs.push_back(Run{ x.offset, x.offset, total });
+            }
+            auto& current = my_runs.back();
+            hsize_t end = x.offset + x.length;
+            if (end > current.end) {
+                total += end - current.end;
+                current.end = end;
             }
+            my_positions[i] = current.position + (x.offset - current.start);
+        }
 
-            auto fptr = Provisioner_::new_Factor(len, named, is_scalar, levlen, ordered);
-            output.reset(fptr);
-            parse_integer_like(
-                dhandle,
-                fptr,
-                is_scalar,
-                [&](int32_t x) -> void { 
-                    if (x < 0 || x >= levlen) {
-                        throw std::runtime_error("factor codes should be non-negative and less than the number of levels");
-                    }
-                },
-                version,
-                buffer_size
-            );
-
-            std::unordered_set<std::string> present;
-            ritsuko::hdf5::Stream1dStringDataset stream(&levhandle, levlen, buffer_size);
-            for (int32_t i = 0; i < levlen; ++i, stream.next()) {
-                auto x = stream.steal();
-                if (present.find(x) != present.end()) {
-                    throw std::runtime_error("levels should be unique");
-                }
-                fptr->set_level(i, x); 
-                present.insert(std::move(x));
+        my_buffer.resize(total);
+        for (const auto& run : my_runs) {
+            hsize_t count = run.end - run.start;
+            if (count == 0) {
+                continue;
             }
+            H5::DataSpace mspace(1, &count);
+            my_heap_space.selectHyperslab(H5S_SELECT_SET, &count, &(run.start));
+            my_heap.read(my_buffer.data() + run.position, H5::PredType::NATIVE_UINT8, mspace, my_heap_space);
+        }
 
-        } else if (vector_type == "vls" && !version.lt(1, 4)) {
-            ritsuko::hdf5::vls::validate_pointer_datatype(dhandle.getCompType(), 64, 64);
-            auto hhandle = ritsuko::hdf5::vls::open_heap(handle, "heap");
-            auto missingness = ritsuko::hdf5::open_and_load_optional_string_missing_placeholder(dhandle, "missing-value-placeholder");
+        auto cptr = reinterpret_cast<const char*>(my_buffer.data());
+        for (size_t i = 0; i < n; ++i) {
+            auto start = cptr + my_positions[i];
+            fun(i, std::string_view(start, ritsuko::hdf5::find_string_length(start, pointers[i].length)));
+        }
+    }
 
-            auto ptr = Provisioner_::new_String(len, named, is_scalar, StringVector::NONE);
-            output.reset(ptr);
+private:
+    const H5::DataSet& my_heap;
+    hsize_t my_heap_length;
+    H5::DataSpace my_heap_space;
 
-            if (is_scalar) {
-                ritsuko::hdf5::vls::Pointer<uint64_t, uint64_t> vlsptr;
-                dhandle.read(&vlsptr, ritsuko::hdf5::vls::define_pointer_datatype<uint64_t, uint64_t>());
+    struct Run {
+        hsize_t start;
+        hsize_t end;
+        hsize_t position;
+    };
+    std::vector<Run> my_runs;
+    std::vector<size_t> my_order;
+    std::vector<hsize_t> my_positions;
+    std::vector<uint8_t> my_buffer;
+};
 
-                hsize_t len = vlsptr.length;
-                H5::DataSpace mspace(1, &len);
-                hsize_t offset = vlsptr.offset;
-                hsize_t hlen = ritsuko::hdf5::get_1d_length(hhandle, false);
-                H5::DataSpace dspace(1, &hlen);
-                dspace.selectHyperslab(H5S_SELECT_SET, &len, &offset);
+template<class Host_>
+void parse_vls(const H5::DataSet& dhandle, const H5::DataSet& hhandle, Host_* ptr, hsize_t len, bool is_scalar, hsize_t buffer_size) {
+    auto missingness = ritsuko::hdf5::open_and_load_optional_string_missing_placeholder(dhandle, "missing-value-placeholder");
+    auto ptype = ritsuko::hdf5::vls::define_pointer_datatype<uint64_t, uint64_t>();
+    VlsHeapReader reader(hhandle);
 
-                std::vector<uint8_t> buffer(vlsptr.length);
-                hhandle.read(buffer.data(), H5::PredType::NATIVE_UINT8, mspace, dspace);
-                auto cptr = reinterpret_cast<const char*>(buffer.data());
-                std::string str(cptr, cptr + ritsuko::hdf5::find_string_length(cptr, vlsptr.length));
+    hsize_t offset = 0;
+    auto store = [&](size_t i, std::string_view x) -> void {
+        if (missingness.has_value() && x == *missingness) {
+            ptr->set_missing(offset + i);
+        } else {
+            ptr->set_view(offset + i, x);
+        }
+    };
 
-                if (missingness.has_value() && str == *missingness) {
-                    ptr->set_missing(0);
-                } else {
-                    ptr->set(0, std::move(str));
-                }
+    if (is_scalar) {
+        VlsPointer vlsptr;
+        dhandle.read(&vlsptr, ptype);
+        reader.read(dhandle, &vlsptr, 1, store);
+        return;
+    }
 
-            } else {
-                ritsuko::hdf5::vls::Stream1dArray<uint64_t, uint64_t> stream(&dhandle, &hhandle, len, buffer_size);
-                for (hsize_t i = 0; i < len; ++i, stream.next()) {
-                    auto x = stream.steal();
-                    if (missingness.has_value() && x == *missingness) {
-                        ptr->set_missing(i);
-                    } else {
-                        ptr->set(i, std::move(x));
-                    }
-                }
+    hsize_t block_size = std::max(static_cast<hsize_t>(1), std::min(buffer_size, len));
+    std::vector<VlsPointer> pointers(block_size);
+    H5::DataSpace dspace(1, &len);
+    H5::DataSpace mspace(1, &block_size);
+    constexpr hsize_t zero = 0;
+
+    for (; offset < len; offset += block_size) {
+        hsize_t n = std::min(block_size, len - offset);
+        dspace.selectHyperslab(H5S_SELECT_SET, &n, &offset);
+        mspace.selectHyperslab(H5S_SELECT_SET, &n, &zero);
+        dhandle.read(pointers.data(), ptype, mspace, dspace);
+        reader.read(dhandle, pointers.data(), n, store);
+    }
+}
+
+inline bool is_string_type(const std::string& vector_type, const Version& version) {
+    return vector_type == "string" || (version.equals(1, 0) && (vector_type == "date" || vector_type == "date-time"));
+}
+
+inline H5::DataSet open_levels(const H5::Group& handle) {
+    auto levhandle = ritsuko::hdf5::open_dataset(handle, "levels");
+    if (!ritsuko::hdf5::is_utf8_string(levhandle)) {
+        throw std::runtime_error("expected a datatype that can be represented by a UTF-8 encoded string");
+    }
+    return levhandle;
+}
+
+inline bool load_ordered(const H5::Group& handle, const std::string& vector_type) {
+    bool ordered = false;
+    if (vector_type == "ordered") {
+        ordered = true;
+    } else if (handle.exists("ordered")) {
+        auto ohandle = check_scalar_dataset(handle, "ordered");
+        if (ritsuko::hdf5::exceeds_integer_limit(ohandle, 32, true)) {
+            throw std::runtime_error("'ordered' value cannot be represented by a 32-bit integer");
+        }
+        int32_t tmp_ordered = 0;
+        ohandle.read(&tmp_ordered, H5::PredType::NATIVE_INT32);
+        ordered = tmp_ordered > 0;
+    }
+    return ordered;
+}
+
+inline StringVector::Format load_format(const H5::Group& handle, const std::string& vector_type, const Version& version) {
+    StringVector::Format format = StringVector::NONE;
+    if (version.equals(1, 0)) {
+        if (vector_type == "date") {
+            format = StringVector::DATE;
+        } else if (vector_type == "date-time") {
+            format = StringVector::DATETIME;
+        }
+
+    } else if (handle.exists("format")) {
+        auto fhandle = check_scalar_dataset(handle, "format");
+        if (!ritsuko::hdf5::is_utf8_string(fhandle)) {
+            throw std::runtime_error("expected a datatype that can be represented by a UTF-8 encoded string");
+        }
+        auto x = ritsuko::hdf5::load_scalar_string_dataset(fhandle);
+        if (x == "date") {
+            format = StringVector::DATE;
+        } else if (x == "date-time") {
+            format = StringVector::DATETIME;
+        } else {
+            throw std::runtime_error("unsupported format '" + x + "'");
+        }
+    }
+    return format;
+}
+
+inline int32_t load_external_index(const H5::Group& handle, size_t num_external) {
+    auto ihandle = ritsuko::hdf5::open_dataset(handle, "index");
+    if (ritsuko::hdf5::exceeds_integer_limit(ihandle, 32, true)) {
+        throw std::runtime_error("external index at 'index' cannot be represented by a 32-bit signed integer");
+    }
+
+    auto ispace = ihandle.getSpace();
+    int idims = ispace.getSimpleExtentNdims();
+    if (idims != 0) {
+        throw std::runtime_error("expected scalar dataset at 'index'");
+    } 
+
+    int32_t idx;
+    ihandle.read(&idx, H5::PredType::NATIVE_INT32);
+    if (idx < 0 || static_cast<size_t>(idx) >= num_external) {
+        throw std::runtime_error("external index out of range at 'index'");
+    }
+
+    return idx;
+}
+
+template<class Host_>
+void fill_levels(const H5::DataSet& levhandle, size_t levlen, Host_* ptr, hsize_t buffer_size) {
+    // Levels are packed into a single buffer, so that the uniqueness check can use views instead of copying each level.
+    std::string levdata;
+    std::vector<size_t> levoffsets;
+    load_levels(levhandle, levlen, buffer_size, levdata, levoffsets);
+
+    std::unordered_set<std::string_view> present;
+    present.reserve(levlen);
+    for (size_t i = 0; i < levlen; ++i) {
+        std::string_view x(levdata.data() + levoffsets[i], levoffsets[i + 1] - levoffsets[i]);
+        if (!present.insert(x).second) {
+            throw std::runtime_error("levels should be unique");
+        }
+        ptr->set_level_view(i, x);
+    }
+}
+
+// Each format gets its own check, so that it can be inlined into the parsing loop.
+template<class Function_>
+void with_format_check(StringVector::Format format, Function_ fun) {
+    if (format == StringVector::DATE) {
+        fun([](const char* x, size_t n) -> void {
+            if (!ritsuko::is_date(x, n)) {
+                 throw std::runtime_error("dates should follow YYYY-MM-DD formatting");
+            }
+        });
+    } else if (format == StringVector::DATETIME) {
+        fun([](const char* x, size_t n) -> void {
+            if (!ritsuko::is_rfc3339(x, n)) {
+                 throw std::runtime_error("date-times should follow the Internet Date/Time format");
             }
+        });
+    } else {
+        fun([](const char*, size_t) -> void {});
+    }
+}
 
-        } else if (vector_type == "string" || (version.equals(1, 0) && (vector_type == "date" || vector_type == "date-time"))) {
-            StringVector::Format format = StringVector::NONE;
-            if (version.equals(1, 0)) {
-                if (vector_type == "date") {
-                    format = StringVector::DATE;
-                } else if (vector_type == "date-time") {
-                    format = StringVector::DATETIME;
-                }
+/*
+ * Type dispatch and validity checks for vectors, shared by parse_inner() and
+ * parse_range_inner(). The Reader_ only decides which elements are read from
+ * the 'data' and 'names' datasets, via the following methods:
+ *
+ * - integers(host, check), for integer, boolean and factor datasets.
+ * - numbers(host), for floating-point datasets.
+ * - strings(host, check), for string datasets, where check(x, n) is applied to each non-missing string.
+ * - vls(heap, host), for VLS pointer datasets.
+ * - names(host), for the 'names' dataset.
+ */
+template<class Provisioner_, class Reader_>
+void parse_vector(
+    const H5::Group& handle,
+    const std::string& vector_type,
+    const H5::DataSet& dhandle,
+    size_t len,
+    bool is_scalar,
+    bool named,
+    Reader_& reader,
+    NodeFactory<Provisioner_>& nodes,
+    std::shared_ptr<Base>& output,
+    const Version& version,
+    const Options& options)
+{
+    // Names are extracted with the concrete type returned by the provisioner, to avoid virtual calls where possible.
+    auto add_names = [&](auto* ptr) -> void {
+        if (named) {
+            reader.names(ptr);
+        }
+    };
 
-            } else if (handle.exists("format")) {
-                auto fhandle = check_scalar_dataset(handle, "format");
-                if (!ritsuko::hdf5::is_utf8_string(fhandle)) {
-                    throw std::runtime_error("expected a datatype that can be represented by a UTF-8 encoded string");
-                }
-                auto x = ritsuko::hdf5::load_scalar_string_dataset(fhandle);
-                if (x == "date") {
-                    format = StringVector::DATE;
-                } else if (x == "date-time") {
-                    format = StringVector::DATETIME;
-                } else {
-                    throw std::runtime_error("unsupported format '" + x + "'");
-                }
+    size_t max_dictionary_levels = (is_scalar ? 0 : options.max_dictionary_levels);
+
+    if (vector_type == "integer") {
+        auto iptr = nodes.new_Integer(output, len, named, is_scalar);
+        reader.integers(iptr, [](int32_t) -> void {});
+        add_names(iptr);
+
+    } else if (vector_type == "boolean") {
+        auto bptr = nodes.new_Boolean(output, len, named, is_scalar);
+        reader.integers(bptr, [](int32_t x) -> void { 
+            if (x != 0 && x != 1) {
+                throw std::runtime_error("boolean values should be 0 or 1");
             }
+        });
+        add_names(bptr);
+
+    } else if (is_factor_type(vector_type, version)) {
+        auto levhandle = open_levels(handle);
+        hsize_t levlen = ritsuko::hdf5::get_1d_length(levhandle.getSpace(), false);
+        if (levlen > static_cast<hsize_t>(std::numeric_limits<int32_t>::max())) {
+            throw std::runtime_error("number of levels should fit in a 32-bit signed integer");
+        }
+        bool ordered = load_ordered(handle, vector_type);
 
-            auto sptr = Provisioner_::new_String(len, named, is_scalar, format);
-            output.reset(sptr);
-            if (format == StringVector::NONE) {
-                parse_string_like(
-                    dhandle,
-                    sptr,
-                    is_scalar,
-                    [](const std::string&) -> void {},
-                    buffer_size
-                );
-
-            } else if (format == StringVector::DATE) {
-                parse_string_like(
-                    dhandle,
-                    sptr,
-                    is_scalar,
-                    [&](const std::string& x) -> void {
-                        if (!ritsuko::is_date(x.c_str(), x.size())) {
-                             throw std::runtime_error("dates should follow YYYY-MM-DD formatting");
-                        }
-                    },
-                    buffer_size
-                );
-
-            } else if (format == StringVector::DATETIME) {
-                parse_string_like(
-                    dhandle,
-                    sptr,
-                    is_scalar,
-                    [&](const std::string& x) -> void {
-                        if (!ritsuko::is_rfc3339(x.c_str(), x.size())) {
-                             throw std::runtime_error("date-times should follow the Internet Date/Time format");
-                        }
-                    },
-                    buffer_size
-                );
+        auto fptr = nodes.new_Factor(output, len, named, is_scalar, levlen, ordered);
+        int32_t max_code = levlen;
+        reader.integers(fptr, [&](int32_t x) -> void { 
+            if (x < 0 || x >= max_code) {
+                throw std::runtime_error("factor codes should be non-negative and less than the number of levels");
             }
+        });
+
+        fill_levels(levhandle, levlen, fptr, options.buffer_size);
+        add_names(fptr);
+
+    } else if (is_vls_type(vector_type, version)) {
+        ritsuko::hdf5::vls::validate_pointer_datatype(dhandle.getCompType(), 64, 64);
+        auto hhandle = ritsuko::hdf5::vls::open_heap(handle, "heap");
+        auto sptr = nodes.new_String(output, len, named, is_scalar, StringVector::NONE);
+        maybe_dictionary_encode(sptr, max_dictionary_levels, [&](auto* host) -> void {
+            reader.vls(hhandle, host);
+        });
+        add_names(sptr);
+
+    } else if (is_string_type(vector_type, version)) {
+        StringVector::Format format = load_format(handle, vector_type, version);
+        auto sptr = nodes.new_String(output, len, named, is_scalar, format);
+        maybe_dictionary_encode(sptr, max_dictionary_levels, [&](auto* host) -> void {
+            with_format_check(format, [&](auto check) -> void {
+                reader.strings(host, check);
+            });
+        });
+        add_names(sptr);
+
+    } else if (vector_type == "number") {
+        auto dptr = nodes.new_Number(output, len, named, is_scalar);
+        reader.numbers(dptr);
+        add_names(dptr);
 
-        } else if (vector_type == "number") {
-            auto dptr = Provisioner_::new_Number(len, named, is_scalar);
-            output.reset(dptr);
-            parse_numbers(
-                dhandle,
-                dptr,
-                is_scalar,
-                [](double) -> void {},
-                version,
-                buffer_size
-            );
+    } else {
+        throw std::runtime_error("unknown vector type '" + vector_type + "'");
+    }
+}
 
-        } else {
-            throw std::runtime_error("unknown vector type '" + vector_type + "'");
+// Reads all elements of a vector, for parse_vector().
+struct FullVectorReader {
+    const H5::Group& handle;
+    const H5::DataSet& dhandle;
+    hsize_t len;
+    bool is_scalar;
+    const Version& version;
+    hsize_t buffer_size;
+
+    template<class Host_, class Function_>
+    void integers(Host_* host, Function_ check) {
+        parse_integer_like(dhandle, host, is_scalar, std::move(check), version, buffer_size);
+    }
+
+    template<class Host_>
+    void numbers(Host_* host) {
+        parse_numbers(dhandle, host, is_scalar, [](double) -> void {}, version, buffer_size);
+    }
+
+    template<class Host_, class Function_>
+    void strings(Host_* host, Function_ check) {
+        parse_string_like(dhandle, host, is_scalar, std::move(check), buffer_size);
+    }
+
+    template<class Host_>
+    void vls(const H5::DataSet& hhandle, Host_* host) {
+        parse_vls(dhandle, hhandle, host, len, is_scalar, buffer_size);
+    }
+
+    template<class Host_>
+    void names(Host_* host) {
+        extract_names(handle, host, buffer_size);
+    }
+};
+
+template<class Provisioner_, class Externals_>
+std::shared_ptr<Base> parse_inner(const H5::Group& handle, Externals_& ext, NodeFactory<Provisioner_>& nodes, const Version& version, const Options& options) try {
+    hsize_t buffer_size = options.buffer_size;
+
+    // Deciding what type we're dealing with.
+    auto object_type = ritsuko::hdf5::open_and_load_scalar_string_attribute(handle, "uzuki_object");
+    std::shared_ptr<Base> output;
+
+    if (object_type == "list") {
+        auto dhandle = ritsuko::hdf5::open_group(handle, "data");
+        size_t len = dhandle.getNumObjs();
+
+        bool named = handle.exists("names");
+        auto lptr = nodes.new_List(output, len, named);
+
+        try {
+            for (size_t i = 0; i < len; ++i) {
+                auto istr = std::to_string(i);
+                auto lhandle = ritsuko::hdf5::open_group(dhandle, istr.c_str());
+                lptr->set(i, parse_inner<Provisioner_>(lhandle, ext, nodes, version, options));
+            }
+        } catch (std::exception& e) {
+            throw std::runtime_error("failed to parse list contents in 'data'; " + std::string(e.what()));
         }
 
         if (named) {
-            auto vptr = static_cast<Vector*>(output.get());
-            extract_names(handle, vptr, buffer_size);
+            extract_names(handle, lptr, buffer_size);
         }
 
-    } else if (object_type == "nothing") {
-        output.reset(Provisioner_::new_Nothing());
+    } else if (object_type == "vector") {
+        auto vector_type = ritsuko::hdf5::open_and_load_scalar_string_attribute(handle, "uzuki_type");
 
-    } else if (object_type == "external") {
-        auto ihandle = ritsuko::hdf5::open_dataset(handle, "index");
-        if (ritsuko::hdf5::exceeds_integer_limit(ihandle, 32, true)) {
-            throw std::runtime_error("external index at 'index' cannot be represented by a 32-bit signed integer");
+        auto dhandle = ritsuko::hdf5::open_dataset(handle, "data");
+        size_t len = ritsuko::hdf5::get_1d_length(dhandle.getSpace(), true);
+        bool is_scalar = (len == 0);
+        if (is_scalar) {
+            len = 1;
         }
 
-        auto ispace = ihandle.getSpace();
-        int idims = ispace.getSimpleExtentNdims();
-        if (idims != 0) {
-            throw std::runtime_error("expected scalar dataset at 'index'");
-        } 
+        bool named = handle.exists("names");
+        FullVectorReader reader{ handle, dhandle, len, is_scalar, version, buffer_size };
+        parse_vector(handle, vector_type, dhandle, len, is_scalar, named, reader, nodes, output, version, options);
 
-        int32_t idx;
-        ihandle.read(&idx, H5::PredType::NATIVE_INT32);
-        if (idx < 0 || static_cast<size_t>(idx) >= ext.size()) {
-            throw std::runtime_error("external index out of range at 'index'");
-        }
+    } else if (object_type == "nothing") {
+        nodes.new_Nothing(output);
 
-        output.reset(Provisioner_::new_External(ext.get(idx)));
+    } else if (object_type == "external") {
+        auto idx = load_external_index(handle, ext.size());
+        nodes.new_External(output, ext.get(idx));
 
     } else {
         throw std::runtime_error("unknown uzuki2 object type '" + object_type + "'");
     }
 
-    return output;
+    return nodes.finish(std::move(output));
 } catch (std::exception& e) {
     throw std::runtime_error("failed to load object at '" + ritsuko::hdf5::get_name(handle) + "'; " + std::string(e.what()));
     return nullptr; // for consistency.
 }
-/**
- * @endcond
- */
+
+inline Version load_version(const H5::Group& handle) {
+    Version version;
+    if (handle.attrExists("uzuki_version")) {
+        auto ver_str = ritsuko::hdf5::open_and_load_scalar_string_attribute(handle, "uzuki_version");
+        auto vraw = ritsuko::parse_version_string(ver_str.c_str(), ver_str.size(), /* skip_patch = */ true);
+        version.major = vraw.major;
+        version.minor = vraw.minor;
+    }
+    return version;
+}
+
+inline H5::H5File open_file(const std::string& file, const Options& options) {
+    if (options.file_pool) {
+        return options.file_pool->open(file);
+    } else {
+        return H5::H5File(file, H5F_ACC_RDONLY);
+    }
+}
 
 /**
- * @brief Options for HDF5 file parsing.
+ * @endcond
  */
-struct Options {
-    /**
-     * Buffer size, in terms of the number of elements, to use for reading data from HDF5 datasets.
-     */
-    hsize_t buffer_size = 10000;
-
-    /**
-     * Whether to throw an error if the top-level R object is not an R list.
-     */
-    bool strict_list = true;
-};
 
 /**
  * @tparam Provisioner_ A class namespace defining static methods for creating new `Base` objects.
@@ -546,6 +990,17 @@ struct Options {
  *   If `s = true` and `l = 1`, the lone index was represented on file as a scalar integer.
  *   If `o = true`, the levels should be assumed to be sorted.
  *
+ * Each method may return a pointer to a more derived type than listed above.
+ * The parser uses the returned pointer type as-is, so if it refers to a `final` class, all calls to its methods can be resolved at compile time.
+ * This is most easily achieved by deriving from the CRTP bases in `static_interfaces.hpp`, e.g., `class MyIntegers final : public StaticIntegerVector<MyIntegers>`,
+ * which also implement the block methods (e.g., `IntegerVector::set_block()`) with direct calls to the subclass's `set()`.
+ *
+ * Alternatively, each method may accept an `Arena&` as its first argument, e.g., `IntegerVector* new_Integer(Arena& a, size_t l, bool n, bool s)`.
+ * (This is detected from the signature of `new_Nothing()` and applies to all methods.)
+ * In this case, the method should construct the object with `Arena::create()`, and the parser will use the same arena for all objects in the parse.
+ * Only the top-level pointer in the returned `ParsedList` owns the arena, and the entire tree is released in one pass when the last copy of it is destroyed.
+ * The pointers passed to `List::set()` are non-owning, so lists may store them (or their raw pointers) without keeping the arena alive.
+ *
  * @section external-contract Externals requirements
  * The `Externals_` class is expected to provide the following `const` methods:
  *
@@ -555,16 +1010,16 @@ struct Options {
  */
 template<class Provisioner_, class Externals_>
 ParsedList parse(const H5::Group& handle, Externals_ ext, const Options& options) {
-    Version version;
-    if (handle.attrExists("uzuki_version")) {
-        auto ver_str = ritsuko::hdf5::open_and_load_scalar_string_attribute(handle, "uzuki_version");
-        auto vraw = ritsuko::parse_version_string(ver_str.c_str(), ver_str.size(), /* skip_patch = */ true);
-        version.major = vraw.major;
-        version.minor = vraw.minor;
-    }
-
+    auto version = load_version(handle);
     ExternalTracker etrack(std::move(ext));
-    auto ptr = parse_inner<Provisioner_>(handle, etrack, version, options.buffer_size);
+    std::shared_ptr<Base> ptr;
+    if (options.deduplicate) {
+        NodeFactory<Deduplicated<Provisioner_> > nodes(options.deduplicate_max_size);
+        ptr = nodes.release(parse_inner<Deduplicated<Provisioner_> >(handle, etrack, nodes, version, options));
+    } else {
+        NodeFactory<Provisioner_> nodes;
+        ptr = nodes.release(parse_inner<Provisioner_>(handle, etrack, nodes, version, options));
+    }
 
     if (options.strict_list && ptr->type() != LIST) {
         throw std::runtime_error("top-level object should represent an R list");
@@ -592,7 +1047,7 @@ ParsedList parse(const H5::Group& handle, Externals_ ext, const Options& options
  */
 template<class Provisioner_, class Externals_>
 ParsedList parse(const std::string& file, const std::string& name, Externals_ ext, Options options = Options()) {
-    H5::H5File handle(file, H5F_ACC_RDONLY);
+    auto handle = open_file(file, options);
     return parse<Provisioner_>(ritsuko::hdf5::open_group(handle, name.c_str()), std::move(ext), options);
 }
 
@@ -0,0 +1,411 @@
+#ifndef UZUKI2_PARSE_HDF5_LAZY_HPP
+#define UZUKI2_PARSE_HDF5_LAZY_HPP
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <cstdint>
+
+#include "H5Cpp.h"
+
+#include "interfaces.hpp"
+#include "ExternalTracker.hpp"
+#include "Version.hpp"
+#include "parse_hdf5.hpp"
+
+#include "ritsuko/hdf5/hdf5.hpp"
+#include "ritsuko/hdf5/vls/vls.hpp"
+
+/**
+ * @file parse_hdf5_lazy.hpp
+ * @brief Lazy parsing of lists from HDF5 files.
+ */
+
+namespace uzuki2 {
+
+namespace hdf5 {
+
+/**
+ * @cond
+ */
+struct LazyContext {
+    H5::H5File file;
+    H5::Group handle;
+    Version version;
+    Options options;
+    std::vector<void*> externals;
+};
+
+class LazyExternals {
+public:
+    LazyExternals(const std::vector<void*>& ptrs) : my_ptrs(ptrs) {}
+
+    void* get(size_t i) const {
+        return my_ptrs[i];
+    }
+
+    size_t size() const {
+        return my_ptrs.size();
+    }
+
+private:
+    const std::vector<void*>& my_ptrs;
+};
+
+class LazyScanner;
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Lazy proxy for an R object in a HDF5 file.
+ *
+ * Instances of this class are created by `parse_lazy()`, which only validates the structure of each object, i.e., its attributes, datatypes and lengths.
+ * The contents of the `data`, `levels` and `names` datasets are only read when `load()` or `names()` is called,
+ * at which point the remaining checks (e.g., on the values of factor codes or booleans) are also performed.
+ * Each instance holds a reference to the underlying HDF5 file, which is kept open for as long as any proxy is alive.
+ */
+class LazyObject {
+public:
+    /**
+     * @return Type of the object.
+     */
+    Type type() const {
+        return my_type;
+    }
+
+    /**
+     * @return For lists, the number of list elements.
+     * For vectors, the length of the vector.
+     * For all other types, zero is returned.
+     */
+    size_t size() const {
+        return my_length;
+    }
+
+    /**
+     * @return Whether the list or vector has names.
+     */
+    bool has_names() const {
+        return my_named;
+    }
+
+    /**
+     * @return Whether the vector was represented on file as a scalar.
+     * Always false for non-vector types.
+     */
+    bool is_scalar() const {
+        return my_scalar;
+    }
+
+    /**
+     * @return Format of the strings, only relevant if `type()` is `STRING`.
+     */
+    StringVector::Format format() const {
+        return my_format;
+    }
+
+    /**
+     * @return Name of the HDF5 group containing this object, relative to the group supplied to `parse_lazy()`.
+     * This is empty for the top-level object.
+     */
+    const std::string& path() const {
+        return my_path;
+    }
+
+    /**
+     * This should only be called if `type()` is `LIST`.
+     *
+     * @param i Index of the list element.
+     * @return Proxy for the list element.
+     */
+    const LazyObject& get(size_t i) const {
+        return my_children[i];
+    }
+
+    /**
+     * This should only be called if `has_names()` is true.
+     * The `names` dataset is read from file on every call.
+     *
+     * @return Names of the list or vector elements.
+     */
+    std::vector<std::string> names() const {
+        return load_names(open(), my_length, my_context->options.buffer_size);
+    }
+
+    /**
+     * Read the object's contents from file, using the same code path as `parse()`.
+     * For lists, the contents of all nested objects are also read.
+     * The file is accessed on every call, so callers should hold onto the result if it is to be used repeatedly.
+     *
+     * @tparam Provisioner_ A class namespace defining static methods for creating new `Base` objects, see `parse()` for details.
+     * @return Pointer to the loaded object.
+     */
+    template<class Provisioner_>
+    std::shared_ptr<Base> load() const {
+        LazyExternals ext(my_context->externals);
+        const auto& options = my_context->options;
+        if (options.deduplicate) {
+            NodeFactory<Deduplicated<Provisioner_> > nodes(options.deduplicate_max_size);
+            return nodes.release(parse_inner<Deduplicated<Provisioner_> >(open(), ext, nodes, my_context->version, options));
+        } else {
+            NodeFactory<Provisioner_> nodes;
+            return nodes.release(parse_inner<Provisioner_>(open(), ext, nodes, my_context->version, options));
+        }
+    }
+
+private:
+    std::shared_ptr<const LazyContext> my_context;
+    std::string my_path;
+
+    Type my_type = NOTHING;
+    size_t my_length = 0;
+    bool my_named = false;
+    bool my_scalar = false;
+    StringVector::Format my_format = StringVector::NONE;
+    std::vector<LazyObject> my_children;
+
+    H5::Group open() const {
+        if (my_path.empty()) {
+            return my_context->handle;
+        } else {
+            return my_context->handle.openGroup(my_path);
+        }
+    }
+
+    friend class LazyScanner;
+};
+
+/**
+ * @brief Lazily parsed list from a HDF5 file.
+ */
+struct LazyParsedList {
+    /**
+     * Version of the **uzuki2** specification.
+     */
+    Version version;
+
+    /**
+     * Proxy for the top-level object.
+     */
+    LazyObject root;
+};
+
+/**
+ * @cond
+ */
+class LazyScanner {
+public:
+    LazyScanner(std::shared_ptr<LazyContext> context, size_t num_external) : my_context(std::move(context)), my_num_external(num_external) {}
+
+private:
+    std::shared_ptr<LazyContext> my_context;
+    size_t my_num_external;
+
+public:
+    std::vector<int32_t> external_indices;
+
+public:
+    static std::string join(const std::string& parent, const std::string& child) {
+        if (parent.empty()) {
+            return child;
+        } else {
+            return parent + "/" + child;
+        }
+    }
+
+    LazyObject scan(const H5::Group& handle, std::string path) try {
+        const auto& version = my_context->version;
+        auto object_type = ritsuko::hdf5::open_and_load_scalar_string_attribute(handle, "uzuki_object");
+
+        LazyObject output;
+        output.my_context = my_context;
+        output.my_path = std::move(path);
+
+        if (object_type == "list") {
+            auto dhandle = ritsuko::hdf5::open_group(handle, "data");
+            size_t len = dhandle.getNumObjs();
+            output.my_type = LIST;
+            output.my_length = len;
+            output.my_named = handle.exists("names");
+
+            try {
+                output.my_children.reserve(len);
+                for (size_t i = 0; i < len; ++i) {
+                    auto istr = std::to_string(i);
+                    auto lhandle = ritsuko::hdf5::open_group(dhandle, istr.c_str());
+                    output.my_children.push_back(scan(lhandle, join(output.my_path, "data/" + istr)));
+                }
+            } catch (std::exception& e) {
+                throw std::runtime_error("failed to parse list contents in 'data'; " + std::string(e.what()));
+            }
+
+            if (output.my_named) {
+                check_names(handle, len);
+            }
+
+        } else if (object_type == "vector") {
+            auto vector_type = ritsuko::hdf5::open_and_load_scalar_string_attribute(handle, "uzuki_type");
+
+            auto dhandle = ritsuko::hdf5::open_dataset(handle, "data");
+            size_t len = ritsuko::hdf5::get_1d_length(dhandle.getSpace(), true);
+            output.my_scalar = (len == 0);
+            if (output.my_scalar) {
+                len = 1;
+            }
+            output.my_length = len;
+            output.my_named = handle.exists("names");
+
+            if (vector_type == "integer" || vector_type == "boolean") {
+                output.my_type = (vector_type == "integer" ? INTEGER : BOOLEAN);
+                check_integer_like(dhandle);
+
+            } else if (is_factor_type(vector_type, version)) {
+                output.my_type = FACTOR;
+                auto levhandle = open_levels(handle);
+                ritsuko::hdf5::get_1d_length(levhandle.getSpace(), false);
+                load_ordered(handle, vector_type);
+                check_integer_like(dhandle);
+
+            } else if (is_vls_type(vector_type, version)) {
+                output.my_type = STRING;
+                ritsuko::hdf5::vls::validate_pointer_datatype(dhandle.getCompType(), 64, 64);
+                ritsuko::hdf5::vls::open_heap(handle, "heap");
+                ritsuko::hdf5::open_and_load_optional_string_missing_placeholder(dhandle, "missing-value-placeholder");
+
+            } else if (is_string_type(vector_type, version)) {
+                output.my_type = STRING;
+                output.my_format = load_format(handle, vector_type, version);
+                try {
+                    prepare_string_like(dhandle);
+                } catch (std::exception& e) {
+                    throw std::runtime_error("failed to load string dataset at '" + ritsuko::hdf5::get_name(dhandle) + "'; " + std::string(e.what()));
+                }
+
+            } else if (vector_type == "number") {
+                output.my_type = NUMBER;
+                try {
+                    double placeholder;
+                    prepare_numbers(dhandle, version, placeholder);
+                } catch (std::exception& e) {
+                    throw std::runtime_error("failed to load floating-point dataset at '" + ritsuko::hdf5::get_name(dhandle) + "'; " + std::string(e.what()));
+                }
+
+            } else {
+                throw std::runtime_error("unknown vector type '" + vector_type + "'");
+            }
+
+            if (output.my_named) {
+                check_names(handle, len);
+            }
+
+        } else if (object_type == "nothing") {
+            output.my_type = NOTHING;
+
+        } else if (object_type == "external") {
+            output.my_type = EXTERNAL;
+            external_indices.push_back(load_external_index(handle, my_num_external));
+
+        } else {
+            throw std::runtime_error("unknown uzuki2 object type '" + object_type + "'");
+        }
+
+        return output;
+    } catch (std::exception& e) {
+        throw std::runtime_error("failed to load object at '" + ritsuko::hdf5::get_name(handle) + "'; " + std::string(e.what()));
+    }
+
+private:
+    void check_integer_like(const H5::DataSet& dhandle) try {
+        int32_t placeholder;
+        prepare_integer_like(dhandle, my_context->version, placeholder);
+    } catch (std::exception& e) {
+        throw std::runtime_error("failed to load integer dataset at '" + ritsuko::hdf5::get_name(dhandle) + "'; " + std::string(e.what()));
+    }
+
+    static void check_names(const H5::Group& handle, size_t len) try {
+        open_names(handle, len);
+    } catch (std::exception& e) {
+        throw std::runtime_error("failed to load names at '" + ritsuko::hdf5::get_name(handle) + "'; " + std::string(e.what()));
+    }
+};
+
+template<class Externals_>
+LazyParsedList scan_lazy(std::shared_ptr<LazyContext> context, Externals_ ext, const Options& options) {
+    ExternalTracker etrack(std::move(ext));
+    LazyScanner scanner(context, etrack.size());
+    auto root = scanner.scan(context->handle, "");
+
+    if (options.strict_list && root.type() != LIST) {
+        throw std::runtime_error("top-level object should represent an R list");
+    }
+
+    context->externals.resize(etrack.size());
+    for (auto idx : scanner.external_indices) {
+        context->externals[idx] = etrack.get(idx);
+    }
+    etrack.validate();
+
+    return LazyParsedList{ context->version, std::move(root) };
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Lazily parse HDF5 file contents using the **uzuki2** specification, given the group handle.
+ * This only validates the structure of the list, i.e., the attributes, datatypes and lengths of all objects;
+ * the contents of each object are only read when `LazyObject::load()` is called.
+ * This is useful for large lists where only a few components are of interest.
+ *
+ * @tparam Externals_ Class describing how to resolve external references for type `EXTERNAL`, see `parse()` for details.
+ *
+ * @param handle Handle for a HDF5 group corresponding to the list.
+ * @param ext Instance of an external reference resolver class.
+ * All external references are resolved during this call.
+ * @param options Optional parameters.
+ *
+ * @return A `LazyParsedList` containing a proxy for the top-level object.
+ * Any structural errors will cause an error to be thrown.
+ */
+template<class Externals_>
+LazyParsedList parse_lazy(const H5::Group& handle, Externals_ ext, const Options& options) {
+    auto context = std::make_shared<LazyContext>();
+    context->handle = handle;
+    context->version = load_version(handle);
+    context->options = options;
+    return scan_lazy(std::move(context), std::move(ext), options);
+}
+
+/**
+ * Lazily parse HDF5 file contents using the **uzuki2** specification, given the file path.
+ * The file is kept open until all proxies in the returned `LazyParsedList` are destroyed.
+ *
+ * @tparam Externals_ Class describing how to resolve external references for type `EXTERNAL`, see `parse()` for details.
+ *
+ * @param file Path to a HDF5 file.
+ * @param name Name of the HDF5 group containing the list in `file`.
+ * @param ext Instance of an external reference resolver class.
+ * All external references are resolved during this call.
+ * @param options Optional parameters.
+ *
+ * @return A `LazyParsedList` containing a proxy for the top-level object.
+ * Any structural errors will cause an error to be thrown.
+ */
+template<class Externals_>
+LazyParsedList parse_lazy(const std::string& file, const std::string& name, Externals_ ext, Options options = Options()) {
+    auto context = std::make_shared<LazyContext>();
+    context->file = open_file(file, options);
+    context->handle = ritsuko::hdf5::open_group(context->file, name.c_str());
+    context->version = load_version(context->handle);
+    context->options = options;
+    return scan_lazy(std::move(context), std::move(ext), options);
+}
+
+
+}
+
+}
+
+#endif
@@ -0,0 +1,579 @@
+#ifndef UZUKI2_PARSE_HDF5_SUBSET_HPP
+#define UZUKI2_PARSE_HDF5_SUBSET_HPP
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+#include "H5Cpp.h"
+
+#include "interfaces.hpp"
+#include "Version.hpp"
+#include "ParsedList.hpp"
+#include "parse_hdf5.hpp"
+
+#include "ritsuko/ritsuko.hpp"
+#include "ritsuko/hdf5/hdf5.hpp"
+#include "ritsuko/hdf5/vls/vls.hpp"
+
+/**
+ * @file parse_hdf5_subset.hpp
+ * @brief Parse selected components or ranges of a list in a HDF5 file.
+ */
+
+namespace uzuki2 {
+
+namespace hdf5 {
+
+/**
+ * @brief Component of a path to a nested object.
+ *
+ * Each component refers to a list element by its 0-based index or by its name.
+ * Names are resolved against the `names` dataset of the list; if duplicate names are present, the first match is used.
+ */
+class PathElement {
+public:
+    /**
+     * @tparam Integer_ Integer type, other than `bool`.
+     * @param i Index of the list element, should be non-negative.
+     */
+    template<typename Integer_, typename std::enable_if<std::is_integral<Integer_>::value && !std::is_same<Integer_, bool>::value, int>::type = 0>
+    PathElement(Integer_ i) : my_index(i) {
+        if constexpr(std::is_signed<Integer_>::value) {
+            if (i < 0) {
+                throw std::runtime_error("index of a list element should be non-negative");
+            }
+        }
+    }
+
+    /**
+     * @param n Name of the list element.
+     */
+    PathElement(std::string n) : my_name(std::move(n)), my_by_name(true) {}
+
+    /**
+     * @param n Name of the list element.
+     */
+    PathElement(const char* n) : PathElement(std::string(n)) {}
+
+    /**
+     * @return Whether this component refers to a list element by name.
+     */
+    bool by_name() const {
+        return my_by_name;
+    }
+
+    /**
+     * @return Index of the list element, only meaningful if `by_name()` is false.
+     */
+    size_t index() const {
+        return my_index;
+    }
+
+    /**
+     * @return Name of the list element, only meaningful if `by_name()` is true.
+     */
+    const std::string& name() const {
+        return my_name;
+    }
+
+private:
+    size_t my_index = 0;
+    std::string my_name;
+    bool my_by_name = false;
+};
+
+/**
+ * Path to a nested object, where each successive element refers to a child of the list referenced by the previous element.
+ * An empty path refers to the top-level object itself.
+ */
+typedef std::vector<PathElement> Path;
+
+/**
+ * @brief Selection of elements from a vector.
+ *
+ * This selects the elements at `start`, `start + stride`, `start + 2 * stride`, etc. until `count` elements are obtained.
+ */
+struct Range {
+    /**
+     * Index of the first selected element.
+     */
+    hsize_t start = 0;
+
+    /**
+     * Number of selected elements.
+     */
+    hsize_t count = 0;
+
+    /**
+     * Distance between consecutive selected elements, should be positive.
+     * A value of 1 selects a contiguous range.
+     */
+    hsize_t stride = 1;
+};
+
+/**
+ * @cond
+ */
+inline std::string describe_path_element(const PathElement& element) {
+    if (element.by_name()) {
+        return "'" + element.name() + "'";
+    } else {
+        return std::to_string(element.index());
+    }
+}
+
+inline size_t resolve_path_element(const PathElement& element, size_t len, const std::vector<std::string>& names) {
+    if (!element.by_name()) {
+        if (element.index() >= len) {
+            throw std::runtime_error("requested element " + describe_path_element(element) + " is out of range for a list of length " + std::to_string(len));
+        }
+        return element.index();
+    } else {
+        size_t index = std::find(names.begin(), names.end(), element.name()) - names.begin();
+        if (index == names.size()) {
+            throw std::runtime_error("no list element named " + describe_path_element(element));
+        }
+        return index;
+    }
+}
+
+template<class Provisioner_, class Externals_>
+std::shared_ptr<Base> parse_subset_inner(const H5::Group& handle, const std::vector<const Path*>& paths, size_t depth, Externals_& ext, NodeFactory<Provisioner_>& nodes, const Version& version, const Options& options) {
+    for (auto p : paths) {
+        if (p->size() == depth) {
+            return parse_inner<Provisioner_>(handle, ext, nodes, version, options);
+        }
+    }
+
+    try {
+        auto object_type = ritsuko::hdf5::open_and_load_scalar_string_attribute(handle, "uzuki_object");
+        if (object_type != "list") {
+            throw std::runtime_error("cannot select elements from a non-list object");
+        }
+
+        auto dhandle = ritsuko::hdf5::open_group(handle, "data");
+        size_t len = dhandle.getNumObjs();
+        bool named = handle.exists("names");
+
+        // Resolving each path element to an index.
+        std::vector<std::string> names;
+        if (named) {
+            names = load_names(handle, len, options.buffer_size);
+        }
+
+        std::map<size_t, std::vector<const Path*> > selected;
+        for (auto p : paths) {
+            selected[resolve_path_element((*p)[depth], len, names)].push_back(p);
+        }
+
+        std::shared_ptr<Base> output;
+        auto lptr = nodes.new_List(output, len, named);
+
+        try {
+            for (size_t i = 0; i < len; ++i) {
+                auto sIt = selected.find(i);
+                if (sIt == selected.end()) {
+                    std::shared_ptr<Base> placeholder;
+                    nodes.new_Nothing(placeholder);
+                    lptr->set(i, nodes.finish(std::move(placeholder)));
+                } else {
+                    auto istr = std::to_string(i);
+                    auto lhandle = ritsuko::hdf5::open_group(dhandle, istr.c_str());
+                    lptr->set(i, parse_subset_inner<Provisioner_>(lhandle, sIt->second, depth + 1, ext, nodes, version, options));
+                }
+            }
+        } catch (std::exception& e) {
+            throw std::runtime_error("failed to parse list contents in 'data'; " + std::string(e.what()));
+        }
+
+        for (size_t i = 0; i < names.size(); ++i) {
+            lptr->set_name(i, std::move(names[i]));
+        }
+
+        return nodes.finish(std::move(output));
+
+    } catch (std::exception& e) {
+        throw std::runtime_error("failed to load object at '" + ritsuko::hdf5::get_name(handle) + "'; " + std::string(e.what()));
+    }
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Parse selected components of a list in a HDF5 file, given the group handle.
+ * Only the HDF5 groups along each path are visited, so the cost of parsing scales with the size of the selected objects rather than the entire list.
+ *
+ * Each list along a path is created with `Provisioner_::new_List()` with its full length and names.
+ * The object at the end of each path is fully parsed, along with all of its nested objects.
+ * All unselected list elements are replaced with placeholder objects created by `Provisioner_::new_Nothing()`.
+ *
+ * External indices in the selected objects are checked against the number of available external references in `ext`.
+ * However, it is not possible to check that the indices are consecutive as the unselected objects are never visited.
+ *
+ * @tparam Provisioner_ A class namespace defining static methods for creating new `Base` objects, see `parse()` for details.
+ * @tparam Externals_ Class describing how to resolve external references for type `EXTERNAL`, see `parse()` for details.
+ *
+ * @param handle Handle for a HDF5 group corresponding to the list.
+ * @param paths Paths to the objects of interest.
+ * @param ext Instance of an external reference resolver class.
+ * @param options Optional parameters.
+ *
+ * @return A `ParsedList` containing a pointer to the root `Base` object.
+ * Any invalid representations along the paths or in the selected objects will cause an error to be thrown.
+ */
+template<class Provisioner_, class Externals_>
+ParsedList parse_subset(const H5::Group& handle, const std::vector<Path>& paths, Externals_ ext, const Options& options) {
+    auto version = load_version(handle);
+
+    std::vector<const Path*> ptrs;
+    ptrs.reserve(paths.size());
+    for (const auto& p : paths) {
+        ptrs.push_back(&p);
+    }
+
+    std::shared_ptr<Base> ptr;
+    if (options.deduplicate) {
+        NodeFactory<Deduplicated<Provisioner_> > nodes(options.deduplicate_max_size);
+        ptr = nodes.release(parse_subset_inner<Deduplicated<Provisioner_> >(handle, ptrs, 0, ext, nodes, version, options));
+    } else {
+        NodeFactory<Provisioner_> nodes;
+        ptr = nodes.release(parse_subset_inner<Provisioner_>(handle, ptrs, 0, ext, nodes, version, options));
+    }
+
+    if (options.strict_list && ptr->type() != LIST) {
+        throw std::runtime_error("top-level object should represent an R list");
+    }
+
+    return ParsedList(std::move(ptr), std::move(version));
+}
+
+/**
+ * Parse selected components of a list in a HDF5 file, given the file path.
+ * See the other `parse_subset()` overload for details.
+ *
+ * @tparam Provisioner_ A class namespace defining static methods for creating new `Base` objects, see `parse()` for details.
+ * @tparam Externals_ Class describing how to resolve external references for type `EXTERNAL`, see `parse()` for details.
+ *
+ * @param file Path to a HDF5 file.
+ * @param name Name of the HDF5 group containing the list in `file`.
+ * @param paths Paths to the objects of interest.
+ * @param ext Instance of an external reference resolver class.
+ * @param options Optional parameters.
+ *
+ * @return A `ParsedList` containing a pointer to the root `Base` object.
+ */
+template<class Provisioner_, class Externals_>
+ParsedList parse_subset(const std::string& file, const std::string& name, const std::vector<Path>& paths, Externals_ ext, Options options = Options()) {
+    auto handle = open_file(file, options);
+    return parse_subset<Provisioner_>(ritsuko::hdf5::open_group(handle, name.c_str()), paths, std::move(ext), options);
+}
+
+/**
+ * @cond
+ */
+inline H5::Group open_path(const H5::Group& handle, const Path& path, hsize_t buffer_size) {
+    H5::Group current = handle;
+    for (const auto& element : path) {
+        try {
+            auto object_type = ritsuko::hdf5::open_and_load_scalar_string_attribute(current, "uzuki_object");
+            if (object_type != "list") {
+                throw std::runtime_error("cannot select elements from a non-list object");
+            }
+
+            auto dhandle = ritsuko::hdf5::open_group(current, "data");
+            size_t len = dhandle.getNumObjs();
+            std::vector<std::string> names;
+            if (element.by_name() && current.exists("names")) {
+                names = load_names(current, len, buffer_size);
+            }
+
+            auto istr = std::to_string(resolve_path_element(element, len, names));
+            current = ritsuko::hdf5::open_group(dhandle, istr.c_str());
+        } catch (std::exception& e) {
+            throw std::runtime_error("failed to load object at '" + ritsuko::hdf5::get_name(current) + "'; " + std::string(e.what()));
+        }
+    }
+    return current;
+}
+
+template<class Function_>
+void iterate_range_blocks(const H5::DataSet& handle, const Range& range, hsize_t buffer_size, Function_ fun) {
+    hsize_t full_length = ritsuko::hdf5::get_1d_length(handle.getSpace(), false);
+    hsize_t block_size = std::max(static_cast<hsize_t>(1), std::min(buffer_size, range.count));
+    H5::DataSpace dspace(1, &full_length);
+    H5::DataSpace mspace(1, &block_size);
+    constexpr hsize_t zero = 0;
+
+    for (hsize_t done = 0; done < range.count; done += block_size) {
+        hsize_t n = std::min(block_size, range.count - done);
+        hsize_t start = range.start + done * range.stride;
+        dspace.selectHyperslab(H5S_SELECT_SET, &n, &start, &(range.stride));
+        mspace.selectHyperslab(H5S_SELECT_SET, &n, &zero);
+        fun(done, n, mspace, dspace);
+    }
+}
+
+template<class Host_, class Function_>
+void parse_integer_range(const H5::DataSet& handle, Host_* ptr, const Range& range, Function_ check, const Version& version, hsize_t buffer_size) try {
+    int32_t missing_value;
+    bool has_missing = prepare_integer_like(handle, version, missing_value);
+    auto mark = [&](const int32_t* values, size_t n, uint8_t* mask) -> size_t {
+        return mark_equal_placeholders(values, n, missing_value, mask);
+    };
+
+    std::vector<int32_t> buffer;
+    MissingWorkspace<int32_t> work;
+    iterate_range_blocks(handle, range, buffer_size, [&](hsize_t offset, hsize_t n, const H5::DataSpace& mspace, const H5::DataSpace& dspace) -> void {
+        buffer.resize(n);
+        handle.read(buffer.data(), H5::PredType::NATIVE_INT32, mspace, dspace);
+        fill_block_with_mask(ptr, offset, buffer.data(), n, check, has_missing, mark, work);
+    });
+
+} catch (std::exception& e) {
+    throw std::runtime_error("failed to load integer dataset at '" + ritsuko::hdf5::get_name(handle) + "'; " + std::string(e.what()));
+}
+
+template<class Host_>
+void parse_number_range(const H5::DataSet& handle, Host_* ptr, const Range& range, const Version& version, hsize_t buffer_size) try {
+    double missing_value;
+    bool has_missing = prepare_numbers(handle, version, missing_value);
+
+    bool should_compare_nan = version.lt(1, 3);
+    bool is_placeholder_nan = std::isnan(missing_value);
+    auto mark = [&](const double* values, size_t n, uint8_t* mask) -> size_t {
+        if (should_compare_nan) {
+            return mark_identical_placeholders(values, n, missing_value, mask);
+        } else if (is_placeholder_nan) {
+            return mark_nan_placeholders(values, n, mask);
+        } else {
+            return mark_equal_placeholders(values, n, missing_value, mask);
+        }
+    };
+
+    auto check = [](double) -> void {};
+    std::vector<double> buffer;
+    MissingWorkspace<double> work;
+    iterate_range_blocks(handle, range, buffer_size, [&](hsize_t offset, hsize_t n, const H5::DataSpace& mspace, const H5::DataSpace& dspace) -> void {
+        buffer.resize(n);
+        handle.read(buffer.data(), H5::PredType::NATIVE_DOUBLE, mspace, dspace);
+        fill_block_with_mask(ptr, offset, buffer.data(), n, check, has_missing, mark, work);
+    });
+
+} catch (std::exception& e) {
+    throw std::runtime_error("failed to load floating-point dataset at '" + ritsuko::hdf5::get_name(handle) + "'; " + std::string(e.what()));
+}
+
+template<class Function_>
+void load_string_range(const H5::DataSet& handle, const Range& range, hsize_t buffer_size, Function_ fun) {
+    auto dtype = handle.getDataType();
+    if (dtype.isVariableStr()) {
+        std::vector<char*> buffer;
+        iterate_range_blocks(handle, range, buffer_size, [&](hsize_t offset, hsize_t n, const H5::DataSpace& mspace, const H5::DataSpace& dspace) -> void {
+            buffer.resize(n);
+            handle.read(buffer.data(), dtype, mspace, dspace);
+            try {
+                for (hsize_t i = 0; i < n; ++i) {
+                    if (buffer[i] == NULL) {
+                        throw std::runtime_error("detected a NULL pointer for a variable length string");
+                    }
+                    fun(offset + i, std::string_view(buffer[i]));
+                }
+            } catch (...) {
+                H5Dvlen_reclaim(dtype.getId(), mspace.getId(), H5P_DEFAULT, buffer.data());
+                throw;
+            }
+            H5Dvlen_reclaim(dtype.getId(), mspace.getId(), H5P_DEFAULT, buffer.data());
+        });
+
+    } else {
+        size_t fixed_length = dtype.getSize();
+        std::vector<char> buffer;
+        iterate_range_blocks(handle, range, buffer_size, [&](hsize_t offset, hsize_t n, const H5::DataSpace& mspace, const H5::DataSpace& dspace) -> void {
+            buffer.resize(n * fixed_length);
+            handle.read(buffer.data(), dtype, mspace, dspace);
+            for (hsize_t i = 0; i < n; ++i) {
+                auto start = buffer.data() + i * fixed_length;
+                fun(offset + i, std::string_view(start, ritsuko::hdf5::find_string_length(start, fixed_length)));
+            }
+        });
+    }
+}
+
+template<class Host_, class Function_>
+void parse_string_range(const H5::DataSet& handle, Host_* ptr, const Range& range, Function_ check, hsize_t buffer_size) try {
+    auto missingness = prepare_string_like(handle);
+    load_string_range(handle, range, buffer_size, [&](hsize_t i, std::string_view x) -> void {
+        if (missingness.has_value() && x == *missingness) {
+            ptr->set_missing(i);
+        } else {
+            check(x.data(), x.size());
+            ptr->set_view(i, x);
+        }
+    });
+
+} catch (std::exception& e) {
+    throw std::runtime_error("failed to load string dataset at '" + ritsuko::hdf5::get_name(handle) + "'; " + std::string(e.what()));
+}
+
+template<class Host_>
+void parse_vls_range(const H5::DataSet& dhandle, const H5::DataSet& hhandle, Host_* ptr, const Range& range, hsize_t buffer_size) try {
+    auto missingness = ritsuko::hdf5::open_and_load_optional_string_missing_placeholder(dhandle, "missing-value-placeholder");
+    auto ptype = ritsuko::hdf5::vls::define_pointer_datatype<uint64_t, uint64_t>();
+    VlsHeapReader reader(hhandle);
+
+    std::vector<VlsPointer> pointers;
+    iterate_range_blocks(dhandle, range, buffer_size, [&](hsize_t offset, hsize_t n, const H5::DataSpace& mspace, const H5::DataSpace& dspace) -> void {
+        pointers.resize(n);
+        dhandle.read(pointers.data(), ptype, mspace, dspace);
+        reader.read(dhandle, pointers.data(), n, [&](size_t i, std::string_view x) -> void {
+            if (missingness.has_value() && x == *missingness) {
+                ptr->set_missing(offset + i);
+            } else {
+                ptr->set_view(offset + i, x);
+            }
+        });
+    });
+
+} catch (std::exception& e) {
+    throw std::runtime_error("failed to load VLS array at '" + ritsuko::hdf5::get_name(dhandle) + "'; " + std::string(e.what()));
+}
+
+// Reads a selection of elements from a vector, for parse_vector().
+struct RangeVectorReader {
+    const H5::Group& handle;
+    const H5::DataSet& dhandle;
+    size_t full_length;
+    const Range& range;
+    const Version& version;
+    hsize_t buffer_size;
+
+    template<class Host_, class Function_>
+    void integers(Host_* host, Function_ check) {
+        parse_integer_range(dhandle, host, range, std::move(check), version, buffer_size);
+    }
+
+    template<class Host_>
+    void numbers(Host_* host) {
+        parse_number_range(dhandle, host, range, version, buffer_size);
+    }
+
+    template<class Host_, class Function_>
+    void strings(Host_* host, Function_ check) {
+        parse_string_range(dhandle, host, range, std::move(check), buffer_size);
+    }
+
+    template<class Host_>
+    void vls(const H5::DataSet& hhandle, Host_* host) {
+        parse_vls_range(dhandle, hhandle, host, range, buffer_size);
+    }
+
+    template<class Host_>
+    void names(Host_* host) try {
+        auto nhandle = open_names(handle, full_length);
+        load_string_range(nhandle, range, buffer_size, [&](hsize_t i, std::string_view x) -> void {
+            host->set_name_view(i, x);
+        });
+    } catch (std::exception& e) {
+        throw std::runtime_error("failed to load names at '" + ritsuko::hdf5::get_name(handle) + "'; " + std::string(e.what()));
+    }
+};
+
+template<class Provisioner_>
+std::shared_ptr<Base> parse_range_inner(const H5::Group& handle, const Range& range, NodeFactory<Provisioner_>& nodes, const Version& version, const Options& options) try {
+    auto object_type = ritsuko::hdf5::open_and_load_scalar_string_attribute(handle, "uzuki_object");
+    if (object_type != "vector") {
+        throw std::runtime_error("range selection is only supported for vectors");
+    }
+    auto vector_type = ritsuko::hdf5::open_and_load_scalar_string_attribute(handle, "uzuki_type");
+
+    auto dhandle = ritsuko::hdf5::open_dataset(handle, "data");
+    size_t len = ritsuko::hdf5::get_1d_length(dhandle.getSpace(), true);
+    if (len == 0) {
+        throw std::runtime_error("range selection is not supported for scalar vectors");
+    }
+
+    if (range.stride == 0) {
+        throw std::runtime_error("stride of the range should be positive");
+    }
+    if (range.count && (range.start >= len || (range.count - 1) > (len - range.start - 1) / range.stride)) {
+        throw std::runtime_error("range is out of bounds for a vector of length " + std::to_string(len));
+    }
+
+    bool named = handle.exists("names");
+    std::shared_ptr<Base> output;
+    RangeVectorReader reader{ handle, dhandle, len, range, version, options.buffer_size };
+    parse_vector(handle, vector_type, dhandle, range.count, /* is_scalar = */ false, named, reader, nodes, output, version, options);
+
+    return output;
+} catch (std::exception& e) {
+    throw std::runtime_error("failed to load object at '" + ritsuko::hdf5::get_name(handle) + "'; " + std::string(e.what()));
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Parse a selection of elements from a vector inside a list in a HDF5 file, given the group handle.
+ * Only the selected elements are read from the `data` and `names` datasets via HDF5 hyperslab selections,
+ * so the cost of parsing scales with the size of the selection rather than the length of the vector.
+ * Validity checks on the values (e.g., missing value placeholders, factor codes, string formats) are only applied to the selected elements.
+ * 
+ * The vector is created by the relevant `Provisioner_::new_*()` method with length equal to `Range::count`.
+ * The `i`-th element of the resulting vector (and its name, if present) corresponds to the element at `range.start + i * range.stride` in the original vector.
+ * For factors, all levels are still loaded.
+ * `Options::deduplicate` is ignored, as only a single vector is created.
+ *
+ * @tparam Provisioner_ A class namespace defining static methods for creating new `Base` objects, see `parse()` for details.
+ *
+ * @param handle Handle for a HDF5 group corresponding to the list.
+ * @param path Path to the vector of interest, see `parse_subset()`.
+ * This should not be empty, given that the top-level object should be a list.
+ * @param range Selection of elements from the vector.
+ * @param options Optional parameters.
+ *
+ * @return A `ParsedList` containing a pointer to the vector.
+ * Any invalid representations in the selected part of the vector will cause an error to be thrown.
+ */
+template<class Provisioner_>
+ParsedList parse_range(const H5::Group& handle, const Path& path, const Range& range, const Options& options) {
+    auto version = load_version(handle);
+    auto vhandle = open_path(handle, path, options.buffer_size);
+    NodeFactory<Provisioner_> nodes;
+    auto ptr = nodes.release(parse_range_inner<Provisioner_>(vhandle, range, nodes, version, options));
+    return ParsedList(std::move(ptr), std::move(version));
+}
+
+/**
+ * Parse a selection of elements from a vector inside a list in a HDF5 file, given the file path.
+ * See the other `parse_range()` overload for details.
+ *
+ * @tparam Provisioner_ A class namespace defining static methods for creating new `Base` objects, see `parse()` for details.
+ *
+ * @param file Path to a HDF5 file.
+ * @param name Name of the HDF5 group containing the list in `file`.
+ * @param path Path to the vector of interest, see `parse_subset()`.
+ * @param range Selection of elements from the vector.
+ * @param options Optional parameters.
+ *
+ * @return A `ParsedList` containing a pointer to the vector.
+ */
+template<class Provisioner_>
+ParsedList parse_range(const std::string& file, const std::string& name, const Path& path, const Range& range, Options options = Options()) {
+    auto handle = open_file(file, options);
+    return parse_range<Provisioner_>(ritsuko::hdf5::open_group(handle, name.c_str()), path, range, options);
+}
+
+}
+
+}
+
+#endif
@@ -5,8 +5,10 @@
 #include <vector>
 #include <cctype>
 #include <string>
+#include <string_view>
 #include <stdexcept>
 #include <cmath>
+#include <limits>
 #include <unordered_map>
 #include <unordered_set>
 #include <type_traits>
@@ -16,9 +18,14 @@
 #include "ritsuko/ritsuko.hpp"
 
 #include "interfaces.hpp"
+#include "static_interfaces.hpp"
 #include "Dummy.hpp"
 #include "ExternalTracker.hpp"
 #include "ParsedList.hpp"
+#include "Arena.hpp"
+#include "DictionaryEncoder.hpp"
+#include "Deduplicator.hpp"
+#include "Base64.hpp"
 
 /**
  * @file parse_json.hpp
@@ -33,13 +40,151 @@ namespace uzuki2 {
  *
  * JSON provides an alternative to the HDF5 format handled by `hdf5::parse()` and friends.
  * JSON is simpler to parse and has less formatting-related overhead.
- * However, it does not support random access and discards some precision for floating-point numbers.
+ * However, it does not support random access, and decimal text may discard some precision for floating-point numbers;
+ * from version 1.3, number vectors can be stored losslessly as base64-encoded blocks of little-endian doubles.
  */
 namespace json {
 
+/**
+ * @brief Options for JSON file parsing.
+ */
+struct Options {
+    /**
+     * Whether parsing should be done in parallel to file I/O.
+     * If true, an extra thread is used to avoid blocking I/O operations.
+     */
+    bool parallel = false;
+
+    /**
+     * Whether to throw an error if the top-level R object is not an R list.
+     */
+    bool strict_list = true;
+
+    /**
+     * Size of the buffer to use for reading and decompressing bytes.
+     * Larger values may improve speed at the cost of memory usage.
+     */
+    size_t buffer_size = 65536;
+
+    /**
+     * Maximum number of distinct strings for dictionary encoding of string vectors.
+     * If positive, each non-scalar string vector with no more than this many distinct strings is delivered via `StringVector::set_dictionary()`.
+     * If zero, dictionary encoding is disabled.
+     */
+    size_t max_dictionary_levels = 0;
+
+    /**
+     * Whether to deduplicate identical objects in `parse()`.
+     * If true, each object is compared to those that were previously parsed, and an existing object is reused if it has the same type, values and names.
+     * Identical lists are detected after their children have been deduplicated.
+     * This reduces memory usage and provisioning time for lists with many repeated components, at the cost of staging and hashing the contents of each object and retaining a staged copy of each unique object until parsing is complete.
+     * Note that the same `Base` object may then be referenced by multiple lists.
+     * Vectors are staged in full and then replayed into the provisioned object, so the peak memory usage for each vector is about twice its size; see `deduplicate_max_size` for exceptions.
+     */
+    bool deduplicate = false;
+
+    /**
+     * Maximum size of an object's contents for deduplication, in bytes, when `deduplicate = true`.
+     * The size of a vector is determined by its length and element size, plus the lengths of its strings, levels and names;
+     * the size of a list is determined by the number of children and the lengths of its names.
+     * Larger objects (e.g., long vectors) are provisioned separately without being hashed, which avoids holding a staged copy of their contents for comparison with later objects.
+     * If a vector's length alone is enough to exceed this limit, it is not staged at all and the parser fills the provisioned object directly.
+     * Otherwise, it is still staged in full before provisioning, as described for `deduplicate`.
+     */
+    size_t deduplicate_max_size = 1048576;
+};
+
 /**
  * @cond
  */
+/*
+ * Checks on individual values that are shared with the streaming converter in
+ * convert.hpp, which tokenizes the document itself instead of using millijson.
+ * Each 'where' function is only called to build the location in an error message.
+ */
+template<class Where_>
+int32_t check_integer_value(double val, const Version& version, bool& missing, Where_ where) {
+    if (val != std::floor(val)) {
+        throw std::runtime_error("expected an integer at '" + where() + "'");
+    }
+
+    constexpr double upper = std::numeric_limits<int32_t>::max();
+    constexpr double lower = std::numeric_limits<int32_t>::min();
+    if (val < lower || val > upper) {
+        throw std::runtime_error("value at '" + where() + "' cannot be represented by a 32-bit signed integer");
+    }
+
+    missing = (version.equals(1, 0) && val == lower);
+    return val;
+}
+
+template<class Where_>
+double check_number_string(const std::string& str, Where_ where) {
+    if (str == "NaN") {
+        return std::numeric_limits<double>::quiet_NaN();
+    } else if (str == "Inf") {
+        return std::numeric_limits<double>::infinity();
+    } else if (str == "-Inf") {
+        return -std::numeric_limits<double>::infinity();
+    }
+    throw std::runtime_error("unsupported string '" + str + "' at '" + where() + "'");
+}
+
+// 'format' is NULL if the object has no 'format' property.
+inline StringVector::Format check_string_format(const std::string& type, const std::string* format, const Version& version, const std::string& path) {
+    if (version.equals(1, 0)) {
+        if (type == "date") {
+            return StringVector::DATE;
+        } else if (type == "date-time") {
+            return StringVector::DATETIME;
+        }
+    } else if (format) {
+        if (*format == "date") {
+            return StringVector::DATE;
+        } else if (*format == "date-time") {
+            return StringVector::DATETIME;
+        } else {
+            throw std::runtime_error("unsupported format '" + *format + "' at '" + path + ".format'");
+        }
+    }
+    return StringVector::NONE;
+}
+
+inline void check_string_value(StringVector::Format format, const std::string& x, const std::string& path) {
+    if (format == StringVector::DATE) {
+        if (!ritsuko::is_date(x.c_str(), x.size())) {
+            throw std::runtime_error("dates should follow YYYY-MM-DD formatting in '" + path + ".values'");
+        }
+    } else if (format == StringVector::DATETIME) {
+        if (!ritsuko::is_rfc3339(x.c_str(), x.size())) {
+            throw std::runtime_error("date-times should follow the Internet Date/Time format in '" + path + ".values'");
+        }
+    }
+}
+
+inline size_t check_external_index(double index, size_t num_external, const std::string& path) {
+    if (index != std::floor(index)) {
+        throw std::runtime_error("expected an integer at '" + path + ".index'");
+    } else if (index < 0 || index >= static_cast<double>(num_external)) {
+        throw std::runtime_error("external index out of range at '" + path + ".index'");
+    }
+    return index;
+}
+
+inline void check_encoding(const std::string& encoding, const std::string& path) {
+    if (encoding != "base64") {
+        throw std::runtime_error("unsupported encoding '" + encoding + "' at '" + path + ".encoding'");
+    }
+}
+
+template<class Where_>
+size_t check_missing_index(double idx, size_t n, Where_ where) {
+    if (idx != std::floor(idx) || idx < 0 || idx >= static_cast<double>(n)) {
+        throw std::runtime_error("expected an integer index in [0, " + std::to_string(n) + ") at '" + where() + "'");
+    }
+    return idx;
+}
+
 inline const std::vector<std::shared_ptr<millijson::Base> >& extract_array(
     const std::unordered_map<std::string, std::shared_ptr<millijson::Base> >& properties, 
     const std::string& name, 
@@ -82,7 +227,7 @@ void fill_names(const millijson::Array* names_ptr, Destination_* dest, const std
         if (names[i]->type() != millijson::STRING) {
             throw std::runtime_error("expected a string at '" + path + ".names[" + std::to_string(i) + "]'");
         }
-        dest->set_name(i, static_cast<const millijson::String*>(names[i].get())->value());
+        dest->set_name_view(i, static_cast<const millijson::String*>(names[i].get())->value());
     }
 }
 
@@ -116,11 +261,54 @@ auto process_array_or_scalar_values(
     return out_ptr;
 }
 
+/*
+ * Accumulates all values of a vector so that they can be passed to
+ * set_block() in one call. Missing values are stored as zeros and recorded
+ * in a packed bitmap that is passed to set_missing_block() afterwards.
+ */
+template<typename Type_, class Destination_>
+class BlockFiller {
+public:
+    BlockFiller(Destination_* dest, size_t n) : my_dest(dest), my_values(n) {}
+
+    void set(size_t i, Type_ value) {
+        my_values[i] = value;
+    }
+
+    void set_missing(size_t i) {
+        if (my_bitmap.empty()) {
+            my_bitmap.resize((my_values.size() + 7) / 8);
+        }
+        my_bitmap[i / 8] |= static_cast<uint8_t>(1u << (i % 8));
+    }
+
+    void flush() {
+        if (my_values.empty()) {
+            return;
+        }
+        my_dest->set_block(0, my_values.data(), my_values.size());
+        if (!my_bitmap.empty()) {
+            my_dest->set_missing_block(0, my_bitmap.data(), my_values.size());
+        }
+    }
+
+private:
+    Destination_* my_dest;
+    std::vector<Type_> my_values;
+    std::vector<uint8_t> my_bitmap;
+};
+
+template<typename Type_, class Destination_>
+BlockFiller<Type_, Destination_> make_block_filler(Destination_* dest, size_t n) {
+    return BlockFiller<Type_, Destination_>(dest, n);
+}
+
 template<class Destination_, class Function_>
 void extract_integers(const std::vector<std::shared_ptr<millijson::Base> >& values, Destination_* dest, Function_ check, const std::string& path, const Version& version) {
+    auto filler = make_block_filler<int32_t>(dest, values.size());
     for (size_t i = 0; i < values.size(); ++i) {
         if (values[i]->type() == millijson::NOTHING) {
-            dest->set_missing(i);
+            filler.set_missing(i);
             continue;
         }
 
@@ -129,25 +317,17 @@ void extract_integers(const std::vector<std::shared_ptr<millijson::Base> >& valu
         }
 
         auto val = static_cast<const millijson::Number*>(values[i].get())->value();
-        if (val != std::floor(val)) {
-            throw std::runtime_error("expected an integer at '" + path + ".values[" + std::to_string(i) + "]'");
-        }
-
-        constexpr double upper = std::numeric_limits<int32_t>::max();
-        constexpr double lower = std::numeric_limits<int32_t>::min();
-        if (val < lower || val > upper) {
-            throw std::runtime_error("value at '" + path + ".values[" + std::to_string(i) + "]' cannot be represented by a 32-bit signed integer");
-        }
-
-        int32_t ival = val;
-        if (version.equals(1, 0) && val == -2147483648) {
-            dest->set_missing(i);
+        bool missing = false;
+        int32_t ival = check_integer_value(val, version, missing, [&]() -> std::string { return path + ".values[" + std::to_string(i) + "]"; });
+        if (missing) {
+            filler.set_missing(i);
             continue;
         }
 
         check(ival);
-        dest->set(i, ival);
+        filler.set(i, ival);
     }
+    filler.flush();
 }
 
 template<class Destination_, class Function_>
@@ -164,12 +344,85 @@ void extract_strings(const std::vector<std::shared_ptr<millijson::Base> >& value
 
         const auto& str = static_cast<const millijson::String*>(values[i].get())->value();
         check(str);
-        dest->set(i, str);
+        dest->set_view(i, str);
+    }
+}
+
+/*
+ * Number vectors can be losslessly packed as base64-encoded little-endian
+ * doubles from version 1.3 onwards. The whole vector is decoded into a single
+ * buffer and passed to set_block(), with missing values listed by index.
+ */
+template<class Provisioner_>
+void parse_base64_numbers(
+    const std::unordered_map<std::string, std::shared_ptr<millijson::Base> >& properties,
+    const millijson::Base* encoding,
+    NodeFactory<Provisioner_>& nodes,
+    std::shared_ptr<Base>& output,
+    const std::string& path)
+{
+    if (encoding->type() != millijson::STRING) {
+        throw std::runtime_error("expected a string at '" + path + ".encoding'");
+    }
+    check_encoding(static_cast<const millijson::String*>(encoding)->value(), path);
+
+    auto vIt = properties.find("values");
+    if (vIt == properties.end()) {
+        throw std::runtime_error("expected 'values' property for object at '" + path + "'");
+    }
+    if (vIt->second->type() != millijson::STRING) {
+        throw std::runtime_error("expected a base64-encoded string at '" + path + ".values'");
+    }
+
+    std::vector<double> values;
+    const auto& encoded = static_cast<const millijson::String*>(vIt->second.get())->value();
+    try {
+        decode_base64_doubles(encoded.data(), encoded.size(), values);
+    } catch (std::exception& e) {
+        throw std::runtime_error(std::string(e.what()) + " at '" + path + ".values'");
+    }
+
+    auto names_ptr = has_names(properties, path);
+    auto ptr = nodes.new_Number(output, values.size(), names_ptr != NULL, false);
+    size_t n = values.size();
+    if (n) {
+        ptr->set_block(0, values.data(), n);
+    }
+
+    auto mIt = properties.find("missing");
+    if (mIt != properties.end()) {
+        if (mIt->second->type() != millijson::ARRAY) {
+            throw std::runtime_error("expected an array in '" + path + ".missing'");
+        }
+        const auto& indices = static_cast<const millijson::Array*>(mIt->second.get())->value();
+
+        std::vector<uint8_t> bitmap((n + 7) / 8);
+        for (size_t i = 0; i < indices.size(); ++i) {
+            const auto& current = indices[i];
+            if (current->type() != millijson::NUMBER) {
+                throw std::runtime_error("expected a number at '" + path + ".missing[" + std::to_string(i) + "]'");
+            }
+            auto idx = static_cast<const millijson::Number*>(current.get())->value();
+            size_t j = check_missing_index(idx, n, [&]() -> std::string { return path + ".missing[" + std::to_string(i) + "]"; });
+            uint8_t bit = static_cast<uint8_t>(1u << (j % 8));
+            if (bitmap[j / 8] & bit) {
+                throw std::runtime_error("detected duplicate index at '" + path + ".missing[" + std::to_string(i) + "]'");
+            }
+            bitmap[j / 8] |= bit;
+        }
+
+        if (!indices.empty()) {
+            ptr->set_missing_block(0, bitmap.data(), n);
+        }
+    }
+
+    if (names_ptr) {
+        fill_names(names_ptr, ptr, path);
     }
 }
 
 template<class Provisioner_, class Externals_>
-std::shared_ptr<Base> parse_object(const millijson::Base* contents, Externals_& ext, const std::string& path, const Version& version) {
+std::shared_ptr<Base> parse_object(const millijson::Base* contents, Externals_& ext, NodeFactory<Provisioner_>& nodes, const std::string& path, const Version& version, const Options& options) {
     if (contents->type() != millijson::OBJECT) {
         throw std::runtime_error("each R object should be represented by a JSON object at '" + path + "'");
     }
@@ -187,7 +440,7 @@ std::shared_ptr<Base> parse_object(const millijson::Base* contents, Externals_&
 
     std::shared_ptr<Base> output;
     if (type == "nothing") {
-        output.reset(Provisioner_::new_Nothing());
+        nodes.new_Nothing(output);
 
     } else if (type == "external") {
         auto iIt = map.find("index");
@@ -199,18 +452,11 @@ std::shared_ptr<Base> parse_object(const millijson::Base* contents, Externals_&
             throw std::runtime_error("expected a number at '" + path + ".index'");
         }
         auto index = static_cast<const millijson::Number*>(index_ptr.get())->value();
-
-        if (index != std::floor(index)) {
-            throw std::runtime_error("expected an integer at '" + path + ".index'");
-        } else if (index < 0 || index >= static_cast<double>(ext.size())) {
-            throw std::runtime_error("external index out of range at '" + path + ".index'");
-        }
-        output.reset(Provisioner_::new_External(ext.get(index)));
+        nodes.new_External(output, ext.get(check_external_index(index, ext.size(), path)));
 
     } else if (type == "integer") {
         process_array_or_scalar_values(map, path, [&](const auto& vals, bool named, bool scalar) -> auto {
-            auto ptr = Provisioner_::new_Integer(vals.size(), named, scalar);
-            output.reset(ptr);
+            auto ptr = nodes.new_Integer(output, vals.size(), named, scalar);
             extract_integers(vals, ptr, [](int32_t) -> void {}, path, version);
             return ptr;
         });
@@ -233,8 +479,7 @@ std::shared_ptr<Base> parse_object(const millijson::Base* contents, Externals_&
         const auto& lvals = extract_array(map, levels_name, path);
         int32_t nlevels = lvals.size();
         auto fptr = process_array_or_scalar_values(map, path, [&](const auto& vals, bool named, bool scalar) -> auto {
-            auto ptr = Provisioner_::new_Factor(vals.size(), named, scalar, nlevels, ordered);
-            output.reset(ptr);
+            auto ptr = nodes.new_Factor(output, vals.size(), named, scalar, nlevels, ordered);
             extract_integers(vals, ptr, [&](int32_t x) -> void {
                 if (x < 0 || x >= nlevels) {
                     throw std::runtime_error("factor indices of out of range of levels in '" + path + "'");
@@ -243,7 +488,7 @@ std::shared_ptr<Base> parse_object(const millijson::Base* contents, Externals_&
             return ptr;
         });
 
-        std::unordered_set<std::string> existing;
+        std::unordered_set<std::string_view> existing; // views into the JSON document, which outlives this loop.
         for (size_t l = 0; l < lvals.size(); ++l) {
             if (lvals[l]->type() != millijson::STRING) {
                 throw std::runtime_error("expected strings at '" + path + ".levels[" + std::to_string(l) + "]'");
@@ -253,107 +498,83 @@ std::shared_ptr<Base> parse_object(const millijson::Base* contents, Externals_&
             if (existing.find(level) != existing.end()) {
                 throw std::runtime_error("detected duplicate string at '" + path + ".levels[" + std::to_string(l) + "]'");
             }
-            fptr->set_level(l, level);
+            fptr->set_level_view(l, level);
             existing.insert(level);
         }
 
     } else if (type == "boolean") {
         process_array_or_scalar_values(map, path, [&](const auto& vals, bool named, bool scalar) -> auto {
-            auto ptr = Provisioner_::new_Boolean(vals.size(), named, scalar);
-            output.reset(ptr);
+            auto ptr = nodes.new_Boolean(output, vals.size(), named, scalar);
 
+            auto filler = make_block_filler<int32_t>(ptr, vals.size());
             for (size_t i = 0; i < vals.size(); ++i) {
                 if (vals[i]->type() == millijson::NOTHING) {
-                    ptr->set_missing(i);
+                    filler.set_missing(i);
                     continue;
                 }
 
                 if (vals[i]->type() != millijson::BOOLEAN) {
                     throw std::runtime_error("expected a boolean at '" + path + ".values[" + std::to_string(i) + "]'");
                 }
-                ptr->set(i, static_cast<const millijson::Boolean*>(vals[i].get())->value());
+                filler.set(i, static_cast<const millijson::Boolean*>(vals[i].get())->value());
             }
+            filler.flush();
 
             return ptr;
         });
 
     } else if (type == "number") {
-        process_array_or_scalar_values(map, path, [&](const auto& vals, bool named, bool scalar) -> auto {
-            auto ptr = Provisioner_::new_Number(vals.size(), named, scalar);
-            output.reset(ptr);
-
-            for (size_t i = 0; i < vals.size(); ++i) {
-                if (vals[i]->type() == millijson::NOTHING) {
-                    ptr->set_missing(i);
-                    continue;
-                }
+        auto eIt = map.find("encoding");
+        if (!version.lt(1, 3) && eIt != map.end()) {
+            parse_base64_numbers(map, eIt->second.get(), nodes, output, path);
+        } else {
+            process_array_or_scalar_values(map, path, [&](const auto& vals, bool named, bool scalar) -> auto {
+                auto ptr = nodes.new_Number(output, vals.size(), named, scalar);
+
+                auto filler = make_block_filler<double>(ptr, vals.size());
+                for (size_t i = 0; i < vals.size(); ++i) {
+                    if (vals[i]->type() == millijson::NOTHING) {
+                        filler.set_missing(i);
+                        continue;
+                    }
 
-                if (vals[i]->type() == millijson::NUMBER) {
-                    ptr->set(i, static_cast<const millijson::Number*>(vals[i].get())->value());
-                } else if (vals[i]->type() == millijson::STRING) {
-                    auto str = static_cast<const millijson::String*>(vals[i].get())->value();
-                    if (str == "NaN") {
-                        ptr->set(i, std::numeric_limits<double>::quiet_NaN());
-                    } else if (str == "Inf") {
-                        ptr->set(i, std::numeric_limits<double>::infinity());
-                    } else if (str == "-Inf") {
-                        ptr->set(i, -std::numeric_limits<double>::infinity());
+                    if (vals[i]->type() == millijson::NUMBER) {
+                        filler.set(i, static_cast<const millijson::Number*>(vals[i].get())->value());
+                    } else if (vals[i]->type() == millijson::STRING) {
+                        const auto& str = static_cast<const millijson::String*>(vals[i].get())->value();
+                        filler.set(i, check_number_string(str, [&]() -> std::string { return path + ".values[" + std::to_string(i) + "]"; }));
                     } else {
-                        throw std::runtime_error("unsupported string '" + str + "' at '" + path + ".values[" + std::to_string(i) + "]'");
+                        throw std::runtime_error("expected a number at '" + path + ".values[" + std::to_string(i) + "]'");
                     }
-                } else {
-                    throw std::runtime_error("expected a number at '" + path + ".values[" + std::to_string(i) + "]'");
                 }
-            }
+                filler.flush();
 
-            return ptr;
-        });
+                return ptr;
+            });
+        }
 
     } else if (type == "string" || (version.equals(1, 0) && (type == "date" || type == "date-time"))) {
-        StringVector::Format format = StringVector::NONE;
-        if (version.equals(1, 0)) {
-            if (type == "date") {
-                format = StringVector::DATE;
-            } else if (type == "date-time") {
-                format = StringVector::DATETIME;
-            }
-        } else {
+        const std::string* format_ptr = NULL;
+        if (!version.equals(1, 0)) {
             auto fIt = map.find("format");
             if (fIt != map.end()) {
                 if (fIt->second->type() != millijson::STRING) {
                     throw std::runtime_error("expected a string at '" + path + ".format'");
                 }
-                auto fptr = static_cast<const millijson::String*>(fIt->second.get());
-                if (fptr->value() == "date") {
-                    format = StringVector::DATE;
-                } else if (fptr->value() == "date-time") {
-                    format = StringVector::DATETIME;
-                } else {
-                    throw std::runtime_error("unsupported format '" + fptr->value() + "' at '" + path + ".format'");
-                }
+                format_ptr = &(static_cast<const millijson::String*>(fIt->second.get())->value());
             }
         }
+        auto format = check_string_format(type, format_ptr, version, path);
 
         process_array_or_scalar_values(map, path, [&](const auto& vals, bool named, bool scalar) -> auto {
-            auto ptr = Provisioner_::new_String(vals.size(), named, scalar, format);
-            output.reset(ptr);
-
-            if (format == StringVector::NONE) {
-                extract_strings(vals, ptr, [](const std::string&) -> void {}, path);
-            } else if (format == StringVector::DATE) {
-                extract_strings(vals, ptr, [&](const std::string& x) -> void {
-                    if (!ritsuko::is_date(x.c_str(), x.size())) {
-                         throw std::runtime_error("dates should follow YYYY-MM-DD formatting in '" + path + ".values'");
-                    }
-                }, path);
-            } else if (format == StringVector::DATETIME) {
-                extract_strings(vals, ptr, [&](const std::string& x) -> void {
-                    if (!ritsuko::is_rfc3339(x.c_str(), x.size())) {
-                         throw std::runtime_error("date-times should follow the Internet Date/Time format in '" + path + ".values'");
-                    }
-                }, path);
-            }
-
+            auto ptr = nodes.new_String(output, vals.size(), named, scalar, format);
+            maybe_dictionary_encode(ptr, (scalar ? 0 : options.max_dictionary_levels), [&](auto* host) -> void {
+                if (format == StringVector::NONE) {
+                    extract_strings(vals, host, [](const std::string&) -> void {}, path);
+                } else {
+                    extract_strings(vals, host, [&](const std::string& x) -> void { check_string_value(format, x, path); }, path);
+                }
+            });
             return ptr;
         });
 
@@ -363,11 +584,10 @@ std::shared_ptr<Base> parse_object(const millijson::Base* contents, Externals_&
 
         const std::string values_name = "values"; // avoid dangling reference from casting of string literal.
         const auto& vals = extract_array(map, values_name, path);
-        auto ptr = Provisioner_::new_List(vals.size(), has_names);
-        output.reset(ptr);
+        auto ptr = nodes.new_List(output, vals.size(), has_names);
 
         for (size_t i = 0; i < vals.size(); ++i) {
-            ptr->set(i, parse_object<Provisioner_>(vals[i].get(), ext, path + ".values[" + std::to_string(i) + "]", version));
+            ptr->set(i, parse_object<Provisioner_>(vals[i].get(), ext, nodes, path + ".values[" + std::to_string(i) + "]", version, options));
         }
 
         if (has_names) {
@@ -378,34 +598,12 @@ std::shared_ptr<Base> parse_object(const millijson::Base* contents, Externals_&
         throw std::runtime_error("unknown object type '" + type + "' at '" + path + ".type'");
     }
 
-    return output;
+    return nodes.finish(std::move(output));
 }
 /**
  * @endcond
  */
 
-/**
- * @brief Options for JSON file parsing.
- */
-struct Options {
-    /**
-     * Whether parsing should be done in parallel to file I/O.
-     * If true, an extra thread is used to avoid blocking I/O operations.
-     */
-    bool parallel = false;
-
-    /**
-     * Whether to throw an error if the top-level R object is not an R list.
-     */
-    bool strict_list = true;
-
-    /**
-     * Size of the buffer to use for reading and decompressing bytes.
-     * Larger values may improve speed at the cost of memory usage.
-     */
-    size_t buffer_size = 65536;
-};
-
 /**
  * Parse JSON file contents using the **uzuki2** specification, given an arbitrary input source of bytes.
  *
@@ -448,7 +646,14 @@ ParsedList parse(Reader_& reader, Externals_ ext, const Options& options) {
     }
 
     ExternalTracker etrack(std::move(ext));
-    auto output = parse_object<Provisioner_>(contents.get(), etrack, "", version);
+    std::shared_ptr<Base> output;
+    if (options.deduplicate) {
+        NodeFactory<Deduplicated<Provisioner_> > nodes(options.deduplicate_max_size);
+        output = nodes.release(parse_object<Deduplicated<Provisioner_> >(contents.get(), etrack, nodes, "", version, options));
+    } else {
+        NodeFactory<Provisioner_> nodes;
+        output = nodes.release(parse_object<Provisioner_>(contents.get(), etrack, nodes, "", version, options));
+    }
 
     if (options.strict_list && output->type() != LIST) {
         throw std::runtime_error("top-level object should represent an R list");
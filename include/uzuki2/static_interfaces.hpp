@@ -0,0 +1,208 @@
+#ifndef UZUKI2_STATIC_INTERFACES_HPP
+#define UZUKI2_STATIC_INTERFACES_HPP
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+#include "interfaces.hpp"
+
+/**
+ * @file static_interfaces.hpp
+ * @brief CRTP bases for provisioners that avoid virtual calls.
+ */
+
+namespace uzuki2 {
+
+/**
+ * @brief CRTP base for vector-like objects.
+ *
+ * @tparam Derived_ Concrete subclass, which should implement `set_missing()` and `set_name()`.
+ * @tparam Interface_ Vector interface to implement, e.g., `IntegerVector`.
+ *
+ * The parsers call the methods of the pointer type returned by the `Provisioner_::new_*()` methods (see `hdf5::parse()`).
+ * If that type is a `final` subclass of this class, the compiler can resolve all calls statically.
+ * This class additionally implements the block methods of the interface by calling the members of `Derived_` directly,
+ * so that the per-element loops in the default implementations can be inlined and vectorized.
+ */
+template<class Derived_, class Interface_>
+class StaticVector : public Interface_ {
+public:
+    /**
+     * @cond
+     */
+    void set_name_view(size_t i, std::string_view n) {
+        static_cast<Derived_*>(this)->Derived_::set_name(i, std::string(n));
+    }
+
+    void set_name_block(size_t start, const char* data, const size_t* offsets, size_t n) {
+        auto self = static_cast<Derived_*>(this);
+        for (size_t j = 0; j < n; ++j) {
+            self->Derived_::set_name(start + j, std::string(data + offsets[j], data + offsets[j + 1]));
+        }
+    }
+
+    void set_missing_block(size_t start, const uint8_t* bitmap, size_t n) {
+        auto self = static_cast<Derived_*>(this);
+        for (size_t j = 0; j < n; ++j) {
+            if (bitmap[j / 8] & (1u << (j % 8))) {
+                self->Derived_::set_missing(start + j);
+            }
+        }
+    }
+    /**
+     * @endcond
+     */
+};
+
+/**
+ * @brief CRTP base for integer vectors.
+ * @tparam Derived_ Concrete subclass, which should implement `set()`, `set_missing()` and `set_name()`.
+ */
+template<class Derived_>
+class StaticIntegerVector : public StaticVector<Derived_, IntegerVector> {
+public:
+    /**
+     * @cond
+     */
+    void set_block(size_t start, const int32_t* values, size_t n) {
+        auto self = static_cast<Derived_*>(this);
+        for (size_t j = 0; j < n; ++j) {
+            self->Derived_::set(start + j, values[j]);
+        }
+    }
+    /**
+     * @endcond
+     */
+};
+
+/**
+ * @brief CRTP base for double-precision vectors.
+ * @tparam Derived_ Concrete subclass, which should implement `set()`, `set_missing()` and `set_name()`.
+ */
+template<class Derived_>
+class StaticNumberVector : public StaticVector<Derived_, NumberVector> {
+public:
+    /**
+     * @cond
+     */
+    void set_block(size_t start, const double* values, size_t n) {
+        auto self = static_cast<Derived_*>(this);
+        for (size_t j = 0; j < n; ++j) {
+            self->Derived_::set(start + j, values[j]);
+        }
+    }
+    /**
+     * @endcond
+     */
+};
+
+/**
+ * @brief CRTP base for string vectors.
+ * @tparam Derived_ Concrete subclass, which should implement `set()`, `set_missing()` and `set_name()`.
+ */
+template<class Derived_>
+class StaticStringVector : public StaticVector<Derived_, StringVector> {
+public:
+    /**
+     * @cond
+     */
+    void set_view(size_t i, std::string_view v) {
+        static_cast<Derived_*>(this)->Derived_::set(i, std::string(v));
+    }
+
+    void set_block(size_t start, const char* data, const size_t* offsets, size_t n) {
+        auto self = static_cast<Derived_*>(this);
+        for (size_t j = 0; j < n; ++j) {
+            self->Derived_::set(start + j, std::string(data + offsets[j], data + offsets[j + 1]));
+        }
+    }
+
+    void set_dictionary(const char* data, const size_t* offsets, size_t, const int32_t* codes) {
+        auto self = static_cast<Derived_*>(this);
+        for (size_t i = 0, n = self->Derived_::size(); i < n; ++i) {
+            auto c = codes[i];
+            if (c >= 0) {
+                self->Derived_::set(i, std::string(data + offsets[c], data + offsets[c + 1]));
+            }
+        }
+    }
+    /**
+     * @endcond
+     */
+};
+
+/**
+ * @brief CRTP base for boolean vectors.
+ * @tparam Derived_ Concrete subclass, which should implement `set()`, `set_missing()` and `set_name()`.
+ */
+template<class Derived_>
+class StaticBooleanVector : public StaticVector<Derived_, BooleanVector> {
+public:
+    /**
+     * @cond
+     */
+    void set_block(size_t start, const int32_t* values, size_t n) {
+        auto self = static_cast<Derived_*>(this);
+        for (size_t j = 0; j < n; ++j) {
+            self->Derived_::set(start + j, values[j] != 0);
+        }
+    }
+    /**
+     * @endcond
+     */
+};
+
+/**
+ * @brief CRTP base for factors.
+ * @tparam Derived_ Concrete subclass, which should implement `set()`, `set_missing()`, `set_name()` and `set_level()`.
+ */
+template<class Derived_>
+class StaticFactor : public StaticVector<Derived_, Factor> {
+public:
+    /**
+     * @cond
+     */
+    void set_block(size_t start, const int32_t* values, size_t n) {
+        auto self = static_cast<Derived_*>(this);
+        for (size_t j = 0; j < n; ++j) {
+            self->Derived_::set(start + j, static_cast<size_t>(values[j]));
+        }
+    }
+
+    void set_level_view(size_t il, std::string_view vl) {
+        static_cast<Derived_*>(this)->Derived_::set_level(il, std::string(vl));
+    }
+    /**
+     * @endcond
+     */
+};
+
+/**
+ * @brief CRTP base for lists.
+ * @tparam Derived_ Concrete subclass, which should implement `size()`, `set()` and `set_name()`.
+ */
+template<class Derived_>
+class StaticList : public List {
+public:
+    /**
+     * @cond
+     */
+    void set_name_view(size_t i, std::string_view n) {
+        static_cast<Derived_*>(this)->Derived_::set_name(i, std::string(n));
+    }
+
+    void set_name_block(size_t start, const char* data, const size_t* offsets, size_t n) {
+        auto self = static_cast<Derived_*>(this);
+        for (size_t j = 0; j < n; ++j) {
+            self->Derived_::set_name(start + j, std::string(data + offsets[j], data + offsets[j + 1]));
+        }
+    }
+    /**
+     * @endcond
+     */
+};
+
+}
+
+#endif
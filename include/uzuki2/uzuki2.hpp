@@ -8,12 +8,21 @@
 
 /**
  * @namespace uzuki2
- * @brief Parse an R list from a HDF5 or JSON file.
+ * @brief Parse an R list from a HDF5, JSON or binary file.
  */
 
 #if __has_include("H5Cpp.h")
 #include "parse_hdf5.hpp"
+#include "parse_hdf5_lazy.hpp"
+#include "parse_hdf5_subset.hpp"
+#include "write_hdf5.hpp"
+#include "append_hdf5.hpp"
+#include "convert.hpp"
 #endif
 #include "parse_json.hpp"
+#include "write_json.hpp"
+#include "parse_binary.hpp"
+#include "write_binary.hpp"
+#include "Columnar.hpp"
 
 #endif
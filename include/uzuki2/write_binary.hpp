@@ -0,0 +1,505 @@
+#ifndef UZUKI2_WRITE_BINARY_HPP
+#define UZUKI2_WRITE_BINARY_HPP
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "byteme/byteme.hpp"
+
+#include "interfaces.hpp"
+#include "Columnar.hpp"
+#include "BinaryLayout.hpp"
+
+/**
+ * @file write_binary.hpp
+ * @brief Write lists to memory-mappable binary files.
+ */
+
+namespace uzuki2 {
+
+namespace binary {
+
+/**
+ * @brief Options for writing binary files.
+ */
+struct WriteOptions {
+    /**
+     * Number of elements of each vector to stage at once when converting values to their on-disk representation, e.g., to zero missing values.
+     */
+    size_t buffer_size = 65536;
+};
+
+/**
+ * @cond
+ */
+struct PlannedNode {
+    const Base* object;
+    uint8_t type;
+    uint8_t flags = 0;
+    uint8_t format = 0;
+    uint64_t length = 0;
+    uint64_t values = 0;
+    uint64_t levels = 0;
+    uint64_t num_levels = 0;
+    uint64_t missing = 0;
+    uint64_t names = 0;
+};
+
+inline uint64_t string_block_size(uint64_t n, uint64_t nchars) {
+    return (n + 1) * sizeof(uint64_t) + nchars;
+}
+
+template<class Column_>
+uint64_t column_chars(const Column_& column) {
+    uint64_t total = 0;
+    for (size_t i = 0, n = column.size(); i < n; ++i) {
+        total += column.get(i).size();
+    }
+    return total;
+}
+
+/*
+ * The first pass flattens the tree into the node table in pre-order, and
+ * assigns an offset to each block of each node. The second pass then writes
+ * the header, the tables and the blocks sequentially, so that the output can
+ * be streamed to any byteme::Writer without seeking.
+ */
+class Planner {
+public:
+    std::vector<PlannedNode> nodes;
+    std::vector<uint64_t> children;
+    std::vector<void*> externals;
+
+    uint64_t add(const Base* object) {
+        uint64_t index = nodes.size();
+        nodes.emplace_back();
+        nodes[index].object = object;
+        nodes[index].type = object->type();
+
+        switch (object->type()) {
+            case LIST:
+                {
+                    auto lptr = cast_columnar<ColumnarList>(object, "binary writing");
+                    const auto& values = lptr->values();
+                    size_t n = values.size();
+                    uint64_t start = children.size();
+                    children.resize(start + n);
+                    nodes[index].length = n;
+                    nodes[index].values = start;
+                    if (lptr->has_names()) {
+                        nodes[index].flags |= FLAG_NAMED;
+                    }
+                    for (size_t i = 0; i < n; ++i) {
+                        children[start + i] = add(values[i]);
+                    }
+                }
+                break;
+
+            case INTEGER:
+                add_vector(index, cast_columnar<ColumnarIntegerVector>(object, "binary writing"));
+                break;
+
+            case NUMBER:
+                add_vector(index, cast_columnar<ColumnarNumberVector>(object, "binary writing"));
+                break;
+
+            case BOOLEAN:
+                add_vector(index, cast_columnar<ColumnarBooleanVector>(object, "binary writing"));
+                break;
+
+            case STRING:
+                {
+                    auto sptr = cast_columnar<ColumnarStringVector>(object, "binary writing");
+                    add_vector(index, sptr);
+                    nodes[index].format = sptr->format();
+                }
+                break;
+
+            case FACTOR:
+                {
+                    auto fptr = cast_columnar<ColumnarFactor>(object, "binary writing");
+                    add_vector(index, fptr);
+                    nodes[index].num_levels = fptr->levels().size();
+                    if (fptr->is_ordered()) {
+                        nodes[index].flags |= FLAG_ORDERED;
+                    }
+                }
+                break;
+
+            case NOTHING:
+                break;
+
+            case EXTERNAL:
+                {
+                    auto eptr = cast_columnar<ColumnarExternal>(object, "binary writing");
+                    nodes[index].length = externals.size();
+                    externals.push_back(eptr->get());
+                }
+                break;
+        }
+
+        return index;
+    }
+
+    // Returns the total size of the file.
+    uint64_t layout() {
+        uint64_t position = align_block(header_size + nodes.size() * node_size);
+        position = align_block(position + children.size() * sizeof(uint64_t));
+
+        auto reserve = [&](uint64_t nbytes) -> uint64_t {
+            uint64_t output = position;
+            position = align_block(position + nbytes);
+            return output;
+        };
+
+        for (auto& node : nodes) {
+            switch (node.type) {
+                case INTEGER: case BOOLEAN:
+                    node.values = reserve(node.length * sizeof(int32_t));
+                    break;
+                case FACTOR:
+                    {
+                        node.values = reserve(node.length * sizeof(int32_t));
+                        auto fptr = static_cast<const ColumnarFactor*>(node.object);
+                        node.levels = reserve(string_block_size(node.num_levels, column_chars(fptr->levels())));
+                    }
+                    break;
+                case NUMBER:
+                    node.values = reserve(node.length * sizeof(double));
+                    break;
+                case STRING:
+                    {
+                        auto sptr = static_cast<const ColumnarStringVector*>(node.object);
+                        const auto& values = sptr->values();
+                        const auto& validity = sptr->validity();
+                        uint64_t nchars = 0;
+                        for (size_t i = 0; i < node.length; ++i) {
+                            if (!validity.is_missing(i)) {
+                                nchars += values.get(i).size();
+                            }
+                        }
+                        node.values = reserve(string_block_size(node.length, nchars));
+                    }
+                    break;
+                default:
+                    break;
+            }
+
+            if (node.flags & FLAG_MISSING) {
+                node.missing = reserve((node.length + 7) / 8);
+            }
+            if (node.flags & FLAG_NAMED) {
+                with_names(node, [&](const auto& names) -> void {
+                    node.names = reserve(string_block_size(node.length, column_chars(names)));
+                });
+            }
+        }
+
+        return position;
+    }
+
+    // List names are interned while vector names are not, so the names are passed to 'fun' with their own column type.
+    template<class Function_>
+    static void with_names(const PlannedNode& node, Function_ fun) {
+        switch (node.type) {
+            case LIST:
+                fun(static_cast<const ColumnarList*>(node.object)->names());
+                break;
+            case INTEGER:
+                fun(static_cast<const ColumnarIntegerVector*>(node.object)->names());
+                break;
+            case NUMBER:
+                fun(static_cast<const ColumnarNumberVector*>(node.object)->names());
+                break;
+            case BOOLEAN:
+                fun(static_cast<const ColumnarBooleanVector*>(node.object)->names());
+                break;
+            case STRING:
+                fun(static_cast<const ColumnarStringVector*>(node.object)->names());
+                break;
+            default:
+                fun(static_cast<const ColumnarFactor*>(node.object)->names());
+                break;
+        }
+    }
+
+    static const ColumnValidity& validity_of(const PlannedNode& node) {
+        switch (node.type) {
+            case INTEGER:
+                return static_cast<const ColumnarIntegerVector*>(node.object)->validity();
+            case NUMBER:
+                return static_cast<const ColumnarNumberVector*>(node.object)->validity();
+            case BOOLEAN:
+                return static_cast<const ColumnarBooleanVector*>(node.object)->validity();
+            case STRING:
+                return static_cast<const ColumnarStringVector*>(node.object)->validity();
+            default:
+                return static_cast<const ColumnarFactor*>(node.object)->validity();
+        }
+    }
+
+private:
+    template<class Vector_>
+    void add_vector(uint64_t index, const Vector_* ptr) {
+        auto& node = nodes[index];
+        node.length = ptr->size();
+        if (ptr->is_scalar()) {
+            node.flags |= FLAG_SCALAR;
+        }
+        if (ptr->has_names()) {
+            node.flags |= FLAG_NAMED;
+        }
+        if (ptr->validity().null_count()) {
+            node.flags |= FLAG_MISSING;
+        }
+    }
+};
+
+class BinaryOutput {
+public:
+    BinaryOutput(byteme::Writer& writer, size_t buffer_size) : my_writer(writer), my_buffer_size(std::max(buffer_size, static_cast<size_t>(1))) {}
+
+    void put(const void* data, size_t n) {
+        my_writer.write(static_cast<const unsigned char*>(data), n);
+        my_position += n;
+    }
+
+    void pad_to(uint64_t offset) {
+        if (offset < my_position) {
+            throw std::runtime_error("inconsistent layout of the binary file");
+        }
+        static const unsigned char zeros[block_alignment] = {};
+        while (my_position < offset) {
+            put(zeros, std::min(static_cast<uint64_t>(block_alignment), offset - my_position));
+        }
+    }
+
+    // 'fill' is called with the start and length of each block, and should fill the staging buffer with the values.
+    template<typename Type_, class Fill_>
+    void put_array(size_t n, Fill_ fill) {
+        my_staging.resize(std::min(n, my_buffer_size) * sizeof(Type_));
+        auto staging = reinterpret_cast<Type_*>(my_staging.data());
+        bool little_endian = is_little_endian();
+        for (size_t start = 0; start < n; start += my_buffer_size) {
+            size_t count = std::min(my_buffer_size, n - start);
+            fill(start, count, staging);
+            if (!little_endian) {
+                swap_bytes(staging, count);
+            }
+            put(staging, count * sizeof(Type_));
+        }
+    }
+
+    // 'get' should return a std::string_view for each string.
+    template<class Get_>
+    void put_strings(size_t n, Get_ get) {
+        uint64_t cumulative = 0;
+        put_array<uint64_t>(n + 1, [&](size_t start, size_t count, uint64_t* out) -> void {
+            for (size_t i = 0; i < count; ++i) {
+                out[i] = cumulative;
+                if (start + i < n) {
+                    cumulative += get(start + i).size();
+                }
+            }
+        });
+        for (size_t i = 0; i < n; ++i) {
+            auto x = get(i);
+            put(x.data(), x.size());
+        }
+    }
+
+private:
+    byteme::Writer& my_writer;
+    size_t my_buffer_size;
+    uint64_t my_position = 0;
+    std::vector<uint64_t> my_staging; // uint64_t for alignment.
+};
+
+template<typename Type_>
+void put_values(BinaryOutput& output, const Type_* values, size_t n, const ColumnValidity& validity) {
+    output.put_array<Type_>(n, [&](size_t start, size_t count, Type_* out) -> void {
+        std::copy_n(values + start, count, out);
+        if (validity.null_count()) {
+            for (size_t i = 0; i < count; ++i) {
+                if (validity.is_missing(start + i)) {
+                    out[i] = 0;
+                }
+            }
+        }
+    });
+}
+
+inline void write_node(BinaryOutput& output, const PlannedNode& node) {
+    unsigned char record[node_size] = {};
+    record[NODE_TYPE] = node.type;
+    record[NODE_FLAGS] = node.flags;
+    record[NODE_FORMAT] = node.format;
+    store_le<uint64_t>(record + NODE_LENGTH, node.length);
+    store_le<uint64_t>(record + NODE_VALUES, node.values);
+    store_le<uint64_t>(record + NODE_LEVELS, node.levels);
+    store_le<uint64_t>(record + NODE_NUM_LEVELS, node.num_levels);
+    store_le<uint64_t>(record + NODE_MISSING, node.missing);
+    store_le<uint64_t>(record + NODE_NAMES, node.names);
+    output.put(record, node_size);
+}
+
+inline void write_blocks(BinaryOutput& output, const PlannedNode& node) {
+    size_t n = node.length;
+    switch (node.type) {
+        case INTEGER:
+            {
+                auto iptr = static_cast<const ColumnarIntegerVector*>(node.object);
+                output.pad_to(node.values);
+                put_values(output, iptr->values(), n, iptr->validity());
+            }
+            break;
+
+        case NUMBER:
+            {
+                auto dptr = static_cast<const ColumnarNumberVector*>(node.object);
+                output.pad_to(node.values);
+                put_values(output, dptr->values(), n, dptr->validity());
+            }
+            break;
+
+        case BOOLEAN:
+            {
+                auto bptr = static_cast<const ColumnarBooleanVector*>(node.object);
+                const auto& validity = bptr->validity();
+                output.pad_to(node.values);
+                output.put_array<int32_t>(n, [&](size_t start, size_t count, int32_t* out) -> void {
+                    for (size_t i = 0; i < count; ++i) {
+                        out[i] = !validity.is_missing(start + i) && bptr->get(start + i);
+                    }
+                });
+            }
+            break;
+
+        case STRING:
+            {
+                auto sptr = static_cast<const ColumnarStringVector*>(node.object);
+                const auto& values = sptr->values();
+                const auto& validity = sptr->validity();
+                output.pad_to(node.values);
+                output.put_strings(n, [&](size_t i) -> std::string_view { return (validity.is_missing(i) ? std::string_view() : values.get(i)); });
+            }
+            break;
+
+        case FACTOR:
+            {
+                auto fptr = static_cast<const ColumnarFactor*>(node.object);
+                output.pad_to(node.values);
+                put_values(output, fptr->codes(), n, fptr->validity());
+                const auto& levels = fptr->levels();
+                output.pad_to(node.levels);
+                output.put_strings(levels.size(), [&](size_t l) -> std::string_view { return levels.get(l); });
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if (node.flags & FLAG_MISSING) {
+        // Columnar validity bitmaps have set bits for non-missing elements, so these are flipped for the file.
+        const auto& validity = Planner::validity_of(node);
+        auto bitmap = validity.bitmap();
+        output.pad_to(node.missing);
+        output.put_array<uint8_t>((n + 7) / 8, [&](size_t start, size_t count, uint8_t* out) -> void {
+            for (size_t b = 0; b < count; ++b) {
+                out[b] = ~bitmap[start + b];
+            }
+            if (start + count == (n + 7) / 8 && n % 8) {
+                out[count - 1] &= static_cast<uint8_t>((1u << (n % 8)) - 1);
+            }
+        });
+    }
+
+    if (node.flags & FLAG_NAMED) {
+        output.pad_to(node.names);
+        Planner::with_names(node, [&](const auto& names) -> void {
+            output.put_strings(n, [&](size_t i) -> std::string_view { return names.get(i); });
+        });
+    }
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Write a list to a memory-mappable binary file, see `parse_file()` for the corresponding parser.
+ * The output is written sequentially in a single pass after a quick planning pass over the list, so `writer` does not need to support seeking.
+ * All numeric values are stored as little-endian integers or IEEE 754 doubles, so the output is bit-exact for all values.
+ *
+ * @param object Pointer to the top-level object, typically a list.
+ * All objects in the tree should have been created by the `ColumnarProvisioner`, e.g., from `hdf5::parse()` or `json::parse()`.
+ * @param writer Destination for the file contents, e.g., a `byteme::RawFileWriter`.
+ * The caller is responsible for calling `writer.finish()` afterwards.
+ * @param options Optional parameters.
+ *
+ * @return Pointers to the external objects in the list, ordered by the index that was assigned to each of them in the file.
+ */
+inline std::vector<void*> write(const Base* object, byteme::Writer& writer, const WriteOptions& options = WriteOptions()) {
+    Planner planner;
+    planner.add(object);
+    uint64_t file_size = planner.layout();
+
+    unsigned char header[header_size] = {};
+    std::memcpy(header, magic, sizeof(magic));
+    store_le<uint32_t>(header + HEADER_MAJOR, format_major);
+    store_le<uint32_t>(header + HEADER_MINOR, format_minor);
+    store_le<uint64_t>(header + HEADER_NUM_NODES, planner.nodes.size());
+    store_le<uint64_t>(header + HEADER_NODES, header_size);
+    store_le<uint64_t>(header + HEADER_NUM_CHILDREN, planner.children.size());
+    uint64_t children_offset = align_block(header_size + planner.nodes.size() * node_size);
+    store_le<uint64_t>(header + HEADER_CHILDREN, children_offset);
+    store_le<uint64_t>(header + HEADER_FILE_SIZE, file_size);
+
+    BinaryOutput output(writer, options.buffer_size);
+    output.put(header, header_size);
+    for (const auto& node : planner.nodes) {
+        write_node(output, node);
+    }
+
+    output.pad_to(children_offset);
+    const auto& children = planner.children;
+    output.put_array<uint64_t>(children.size(), [&](size_t start, size_t count, uint64_t* out) -> void {
+        std::copy_n(children.data() + start, count, out);
+    });
+
+    for (const auto& node : planner.nodes) {
+        write_blocks(output, node);
+    }
+    output.pad_to(file_size);
+
+    return std::move(planner.externals);
+}
+
+/**
+ * Write a list to a memory-mappable binary file, given the file path.
+ * See `write()` for details.
+ *
+ * @param object Pointer to the top-level object, typically a list.
+ * @param file Path to the output file.
+ * @param options Optional parameters.
+ *
+ * @return Pointers to the external objects in the list, ordered by their assigned index.
+ */
+inline std::vector<void*> write_file(const Base* object, const std::string& file, const WriteOptions& options = WriteOptions()) {
+    byteme::RawFileWriter writer(file.c_str(), {});
+    auto output = write(object, writer, options);
+    writer.finish();
+    return output;
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,1357 @@
+#ifndef UZUKI2_WRITE_HDF5_HPP
+#define UZUKI2_WRITE_HDF5_HPP
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <limits>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cstring>
+#include <optional>
+
+#include "H5Cpp.h"
+#include "zlib.h"
+
+#include "interfaces.hpp"
+#include "Columnar.hpp"
+#include "StreamState.hpp"
+
+/**
+ * @file write_hdf5.hpp
+ * @brief Write lists to HDF5 files.
+ */
+
+namespace uzuki2 {
+
+namespace hdf5 {
+
+/**
+ * @brief Options for writing HDF5 files.
+ */
+struct WriteOptions {
+    /**
+     * Number of elements in each chunk of a chunked dataset.
+     * If zero, all datasets are stored contiguously.
+     */
+    hsize_t chunk_size = 10000;
+
+    /**
+     * Datasets with no more than this number of elements are stored contiguously, without compression.
+     * This avoids the overhead of chunk lookup and decompression for small vectors, which are common in R lists.
+     */
+    hsize_t contiguous_threshold = 10000;
+
+    /**
+     * Level of DEFLATE compression for chunked datasets, from 0 to 9.
+     * If zero, no compression is performed.
+     */
+    int compression_level = 6;
+
+    /**
+     * Whether to apply the shuffle filter before compression of chunked datasets.
+     * This is ignored if `compression_level = 0`.
+     */
+    bool shuffle = true;
+
+    /**
+     * Number of threads to use for compressing the chunks of each dataset in `write()`.
+     * If greater than 1, chunks are filtered in parallel and committed in order with `H5Dwrite_chunk()`,
+     * producing the same bytes as a regular filtered write.
+     * This is ignored if `compression_level = 0` and has no effect on the `StreamWriter`.
+     */
+    int num_threads = 1;
+
+    /**
+     * Whether to store integer, boolean and factor vectors with the narrowest integer datatype that can hold all values and the missing placeholder.
+     * If false, 32-bit signed integers are always used.
+     */
+    bool narrow_integers = true;
+
+    /**
+     * Buffer size, in terms of the number of elements, to use for writing strings to HDF5 datasets.
+     * This is also used for integer, boolean, factor and number vectors when missing placeholders need to be substituted.
+     */
+    hsize_t buffer_size = 10000;
+
+    /**
+     * Missing placeholder for integer vectors in the `StreamWriter`.
+     * As values are not known in advance, this cannot be chosen to avoid collisions, so an error is raised if a non-missing value is equal to the placeholder in a vector with missing values.
+     * The default is the same as R's `NA_integer_`.
+     */
+    int32_t stream_integer_placeholder = std::numeric_limits<int32_t>::min();
+
+    /**
+     * Missing placeholder for number vectors in the `StreamWriter`.
+     * If this is NaN, all NaNs are considered to be missing, so an error is raised if a non-missing NaN is appended to a vector with missing values.
+     */
+    double stream_number_placeholder = std::numeric_limits<double>::quiet_NaN();
+
+    /**
+     * Missing placeholder for string vectors in the `StreamWriter`.
+     * An error is raised if a non-missing string is equal to the placeholder in a vector with missing values.
+     */
+    std::string stream_string_placeholder = "NA";
+};
+
+/**
+ * @cond
+ */
+// The most recent version that does not require VLS arrays.
+inline const char* written_version() {
+    return "1.3";
+}
+
+inline H5::StrType utf8_string_type(size_t width) {
+    H5::StrType stype(H5::PredType::C_S1, width);
+    stype.setCset(H5T_CSET_UTF8);
+    stype.setStrpad(H5T_STR_NULLPAD);
+    return stype;
+}
+
+inline void write_string_attribute(const H5::H5Object& handle, const char* name, const std::string& value) {
+    H5::StrType stype(H5::PredType::C_S1, H5T_VARIABLE);
+    stype.setCset(H5T_CSET_UTF8);
+    auto ahandle = handle.createAttribute(name, stype, H5S_SCALAR);
+    ahandle.write(stype, value);
+}
+
+inline void write_scalar_string(const H5::Group& handle, const char* name, const std::string& value) {
+    auto stype = utf8_string_type(std::max(value.size(), static_cast<size_t>(1)));
+    auto dhandle = handle.createDataSet(name, stype, H5S_SCALAR);
+    dhandle.write(value.c_str(), stype);
+}
+
+inline H5::DataSet create_layout_dataset(const H5::Group& handle, const char* name, const H5::DataType& dtype, hsize_t len, bool scalar, const WriteOptions& options) {
+    if (scalar) {
+        return handle.createDataSet(name, dtype, H5S_SCALAR);
+    }
+
+    H5::DataSpace dspace(1, &len);
+    H5::DSetCreatPropList cplist;
+    if (options.chunk_size && len > options.contiguous_threshold) {
+        hsize_t chunk = std::min(options.chunk_size, len);
+        cplist.setChunk(1, &chunk);
+        if (options.compression_level > 0) {
+            if (options.shuffle) {
+                cplist.setShuffle();
+            }
+            cplist.setDeflate(options.compression_level);
+        }
+    }
+
+    return handle.createDataSet(name, dtype, dspace, cplist);
+}
+
+/*
+ * Compression is the bottleneck when writing large vectors, so chunks can be
+ * filtered on worker threads and committed with H5Dwrite_chunk(). Workers only
+ * run plain C++ and zlib code; all HDF5 calls stay on the calling thread, so
+ * this does not require a thread-safe build of the HDF5 library. Workers fill
+ * each chunk in its little-endian file representation, apply the shuffle
+ * filter and deflate it with compress2(), exactly as HDF5's own filters do.
+ * Edge chunks are zero-padded to the full chunk size, like HDF5's fill.
+ * At most two chunks per thread are held in memory at any time.
+ */
+inline bool use_parallel_chunks(hsize_t len, bool scalar, const WriteOptions& options) {
+    return !scalar && options.num_threads > 1 && options.compression_level > 0 && options.chunk_size && len > options.contiguous_threshold;
+}
+
+inline void encode_little_endian(uint64_t value, size_t nbytes, unsigned char* dest) {
+    for (size_t b = 0; b < nbytes; ++b) {
+        dest[b] = static_cast<unsigned char>(value >> (8 * b));
+    }
+}
+
+inline void shuffle_chunk(const std::vector<unsigned char>& input, size_t element_size, std::vector<unsigned char>& output) {
+    size_t nelements = input.size() / element_size;
+    output.resize(input.size());
+    for (size_t i = 0; i < nelements; ++i) {
+        for (size_t b = 0; b < element_size; ++b) {
+            output[b * nelements + i] = input[i * element_size + b];
+        }
+    }
+}
+
+template<class Fill_>
+void write_chunks_parallel(const H5::DataSet& dhandle, hsize_t len, size_t element_size, Fill_ fill, const WriteOptions& options) {
+    hsize_t chunk = std::min(options.chunk_size, len);
+    hsize_t nchunks = (len + chunk - 1) / chunk;
+    size_t nthreads = std::min(static_cast<hsize_t>(options.num_threads), nchunks);
+    size_t window = nthreads * 2;
+
+    std::vector<std::vector<unsigned char> > results(window);
+    std::vector<uint8_t> ready(window);
+    hsize_t next = 0, committed = 0;
+    bool abort = false;
+    std::exception_ptr error;
+    std::mutex mut;
+    std::condition_variable cv;
+
+    auto worker = [&]() -> void {
+        std::vector<unsigned char> raw, shuffled, compressed;
+        while (true) {
+            hsize_t c;
+            {
+                std::unique_lock lck(mut);
+                cv.wait(lck, [&]() -> bool { return abort || next >= nchunks || next < committed + window; });
+                if (abort || next >= nchunks) {
+                    return;
+                }
+                c = next++;
+            }
+
+            try {
+                hsize_t start = c * chunk;
+                hsize_t count = std::min(chunk, len - start);
+                raw.clear();
+                raw.resize(chunk * element_size);
+                for (hsize_t i = 0; i < count; ++i) {
+                    fill(start + i, raw.data() + i * element_size);
+                }
+
+                const std::vector<unsigned char>* source = &raw;
+                if (options.shuffle && element_size > 1) {
+                    shuffle_chunk(raw, element_size, shuffled);
+                    source = &shuffled;
+                }
+
+                uLongf nbytes = compressBound(source->size());
+                compressed.resize(nbytes);
+                if (compress2(compressed.data(), &nbytes, source->data(), source->size(), options.compression_level) != Z_OK) {
+                    throw std::runtime_error("failed to compress chunk " + std::to_string(c));
+                }
+                compressed.resize(nbytes);
+
+                std::lock_guard lck(mut);
+                results[c % window].swap(compressed);
+                ready[c % window] = 1;
+            } catch (...) {
+                std::lock_guard lck(mut);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                abort = true;
+            }
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(nthreads);
+    for (size_t t = 0; t < nthreads; ++t) {
+        threads.emplace_back(worker);
+    }
+
+    try {
+        std::vector<unsigned char> current;
+        for (hsize_t c = 0; c < nchunks; ++c) {
+            {
+                std::unique_lock lck(mut);
+                cv.wait(lck, [&]() -> bool { return abort || ready[c % window]; });
+                if (abort) {
+                    break;
+                }
+                current.swap(results[c % window]);
+                ready[c % window] = 0;
+            }
+
+            hsize_t offset = c * chunk;
+            if (H5Dwrite_chunk(dhandle.getId(), H5P_DEFAULT, 0, &offset, current.size(), current.data()) < 0) {
+                throw std::runtime_error("failed to write chunk " + std::to_string(c) + " of '" + dhandle.getObjName() + "'");
+            }
+
+            {
+                std::lock_guard lck(mut);
+                ++committed;
+            }
+            cv.notify_all();
+        }
+    } catch (...) {
+        std::lock_guard lck(mut);
+        if (!error) {
+            error = std::current_exception();
+        }
+        abort = true;
+    }
+
+    cv.notify_all();
+    for (auto& t : threads) {
+        t.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+inline void write_ordered(const H5::Group& handle) {
+    int32_t ordered = 1;
+    auto ohandle = handle.createDataSet("ordered", H5::PredType::STD_I8LE, H5S_SCALAR);
+    ohandle.write(&ordered, H5::PredType::NATIVE_INT32);
+}
+
+/*
+ * Integer-like vectors are stored in the narrowest datatype that holds all
+ * non-missing values, along with a placeholder that does not collide with
+ * any of them. Signed types use their minimum as the placeholder and unsigned
+ * types use their maximum.
+ */
+struct IntegerLayout {
+    const H5::PredType* type = &(H5::PredType::STD_I32LE);
+    bool has_placeholder = false;
+    int32_t placeholder = 0;
+};
+
+inline int32_t find_unused_integer(std::vector<int32_t> values) {
+    std::sort(values.begin(), values.end());
+    int64_t candidate = std::numeric_limits<int32_t>::min();
+    for (auto x : values) {
+        if (x > candidate) {
+            break;
+        } else if (x == candidate) {
+            ++candidate;
+        }
+    }
+    if (candidate > std::numeric_limits<int32_t>::max()) {
+        throw std::runtime_error("no unused 32-bit integer is available as the missing placeholder");
+    }
+    return candidate;
+}
+
+template<class Get_>
+IntegerLayout choose_integer_layout(Get_ raw, size_t n, const ColumnValidity& validity, bool narrow) {
+    IntegerLayout output;
+    output.has_placeholder = validity.null_count() > 0;
+
+    int64_t min = 0, max = 0;
+    bool first = true;
+    for (size_t i = 0; i < n; ++i) {
+        if (!validity.is_missing(i)) {
+            int64_t x = raw(i);
+            if (first) {
+                min = x;
+                max = x;
+                first = false;
+            } else {
+                min = std::min(min, x);
+                max = std::max(max, x);
+            }
+        }
+    }
+
+    if (narrow) {
+        struct Candidate {
+            const H5::PredType* type;
+            int64_t lower, upper;
+            bool is_signed;
+        };
+        const Candidate candidates[] = {
+            { &(H5::PredType::STD_I8LE), -128, 127, true },
+            { &(H5::PredType::STD_U8LE), 0, 255, false },
+            { &(H5::PredType::STD_I16LE), -32768, 32767, true },
+            { &(H5::PredType::STD_U16LE), 0, 65535, false }
+        };
+
+        for (const auto& c : candidates) {
+            int64_t lower = c.lower, upper = c.upper;
+            if (output.has_placeholder) {
+                if (c.is_signed) {
+                    ++lower;
+                } else {
+                    --upper;
+                }
+            }
+            if (min >= lower && max <= upper) {
+                output.type = c.type;
+                output.placeholder = (c.is_signed ? c.lower : c.upper);
+                return output;
+            }
+        }
+    }
+
+    if (output.has_placeholder) {
+        if (min > std::numeric_limits<int32_t>::min()) {
+            output.placeholder = std::numeric_limits<int32_t>::min(); // same as R's NA_integer_.
+        } else if (max < std::numeric_limits<int32_t>::max()) {
+            output.placeholder = std::numeric_limits<int32_t>::max();
+        } else {
+            std::vector<int32_t> present;
+            for (size_t i = 0; i < n; ++i) {
+                if (!validity.is_missing(i)) {
+                    present.push_back(raw(i));
+                }
+            }
+            output.placeholder = find_unused_integer(std::move(present));
+        }
+    }
+    return output;
+}
+
+/*
+ * Writes a dataset in blocks of `options.buffer_size` elements, filling a
+ * reusable buffer from `get()` for each block.
+ */
+template<typename Type_, class Get_>
+void write_buffered_blocks(const H5::DataSet& dhandle, size_t n, bool scalar, const H5::PredType& memtype, Get_ get, const WriteOptions& options) {
+    if (scalar) {
+        Type_ value = get(0);
+        dhandle.write(&value, memtype);
+        return;
+    }
+
+    hsize_t block = std::max(options.buffer_size, static_cast<hsize_t>(1));
+    std::vector<Type_> buffer;
+    auto fspace = dhandle.getSpace();
+    for (hsize_t start = 0; start < n; start += block) {
+        hsize_t count = std::min(block, static_cast<hsize_t>(n - start));
+        buffer.resize(count);
+        for (hsize_t j = 0; j < count; ++j) {
+            buffer[j] = get(start + j);
+        }
+
+        fspace.selectHyperslab(H5S_SELECT_SET, &count, &start);
+        H5::DataSpace mspace(1, &count);
+        dhandle.write(buffer.data(), memtype, mspace, fspace);
+    }
+}
+
+/*
+ * Values are written straight from `direct` when it is available and no
+ * placeholders need to be substituted for missing values. Otherwise, each
+ * block is filled from `raw()` into a reusable buffer; this avoids holding a
+ * second copy of the entire vector.
+ */
+template<class Get_>
+void write_integer_like(const H5::Group& handle, Get_ raw, const int32_t* direct, size_t n, const ColumnValidity& validity, bool scalar, const WriteOptions& options) {
+    auto layout = choose_integer_layout(raw, n, validity, options.narrow_integers);
+    auto get = [&](size_t i) -> int32_t {
+        return (layout.has_placeholder && validity.is_missing(i) ? layout.placeholder : static_cast<int32_t>(raw(i)));
+    };
+
+    // HDF5 converts the in-memory 32-bit integers to the narrower file datatype.
+    auto dhandle = create_layout_dataset(handle, "data", *(layout.type), n, scalar, options);
+    if (use_parallel_chunks(n, scalar, options)) {
+        size_t nbytes = layout.type->getSize();
+        write_chunks_parallel(dhandle, n, nbytes, [&](hsize_t i, unsigned char* dest) -> void {
+            encode_little_endian(static_cast<uint64_t>(static_cast<int64_t>(get(i))), nbytes, dest);
+        }, options);
+    } else if (!layout.has_placeholder && direct) {
+        dhandle.write(direct, H5::PredType::NATIVE_INT32);
+    } else {
+        write_buffered_blocks<int32_t>(dhandle, n, scalar, H5::PredType::NATIVE_INT32, get, options);
+    }
+
+    if (layout.has_placeholder) {
+        auto ahandle = dhandle.createAttribute("missing-value-placeholder", *(layout.type), H5S_SCALAR);
+        ahandle.write(H5::PredType::NATIVE_INT32, &layout.placeholder);
+    }
+}
+
+inline void write_integer_like(const H5::Group& handle, const int32_t* values, size_t n, const ColumnValidity& validity, bool scalar, const WriteOptions& options) {
+    write_integer_like(handle, [&](size_t i) -> int32_t { return values[i]; }, values, n, validity, scalar, options);
+}
+
+/*
+ * The placeholder is the smallest double, starting from -Inf, that is not
+ * present in the vector. With m non-NaN values, it must be one of the first
+ * m + 1 doubles from -Inf, so only values in that range need to be collected.
+ * Stepping towards +Inf from a negative double decrements its bit pattern.
+ */
+inline double choose_number_placeholder(const double* values, const ColumnValidity& validity, size_t n) {
+    uint64_t m = 0;
+    bool has_nan = false;
+    for (size_t i = 0; i < n; ++i) {
+        if (!validity.is_missing(i)) {
+            if (std::isnan(values[i])) {
+                has_nan = true;
+            } else {
+                ++m;
+            }
+        }
+    }
+
+    // All NaNs are considered missing with a NaN placeholder, so we can only use it if no NaNs are present.
+    if (!has_nan) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    double lowest = -std::numeric_limits<double>::infinity();
+    uint64_t bits;
+    std::memcpy(&bits, &lowest, sizeof(double));
+    bits -= m; // m is no greater than 2^53, so this stays among the finite negative doubles.
+    double bound;
+    std::memcpy(&bound, &bits, sizeof(double));
+
+    std::vector<double> near;
+    for (size_t i = 0; i < n; ++i) {
+        if (!validity.is_missing(i) && values[i] <= bound) { // NaNs compare false.
+            near.push_back(values[i]);
+        }
+    }
+
+    std::sort(near.begin(), near.end());
+    auto absent = [&](double x) -> bool { return !std::binary_search(near.begin(), near.end(), x); };
+    double candidate = lowest;
+    while (!absent(candidate)) {
+        candidate = std::nextafter(candidate, std::numeric_limits<double>::infinity());
+    }
+    return candidate;
+}
+
+/*
+ * As for integers, placeholders are substituted per block or per element,
+ * so missing values do not require a second copy of the entire vector.
+ */
+inline void write_numbers(const H5::Group& handle, const ColumnarNumberVector* ptr, const WriteOptions& options) {
+    size_t n = ptr->size();
+    const auto& validity = ptr->validity();
+    const double* values = ptr->values();
+
+    double placeholder = 0;
+    bool has_placeholder = validity.null_count() > 0;
+    if (has_placeholder) {
+        placeholder = choose_number_placeholder(values, validity, n);
+    }
+    auto get = [&](size_t i) -> double {
+        return (has_placeholder && validity.is_missing(i) ? placeholder : values[i]);
+    };
+
+    auto dhandle = create_layout_dataset(handle, "data", H5::PredType::IEEE_F64LE, n, ptr->is_scalar(), options);
+    if (use_parallel_chunks(n, ptr->is_scalar(), options)) {
+        write_chunks_parallel(dhandle, n, sizeof(double), [&](hsize_t i, unsigned char* dest) -> void {
+            double x = get(i);
+            uint64_t bits;
+            std::memcpy(&bits, &x, sizeof(double));
+            encode_little_endian(bits, sizeof(double), dest);
+        }, options);
+    } else if (!has_placeholder) {
+        dhandle.write(values, H5::PredType::NATIVE_DOUBLE);
+    } else {
+        write_buffered_blocks<double>(dhandle, n, ptr->is_scalar(), H5::PredType::NATIVE_DOUBLE, get, options);
+    }
+
+    if (has_placeholder) {
+        auto ahandle = dhandle.createAttribute("missing-value-placeholder", H5::PredType::IEEE_F64LE, H5S_SCALAR);
+        ahandle.write(H5::PredType::NATIVE_DOUBLE, &placeholder);
+    }
+}
+
+/*
+ * Strings are stored in a fixed-width datatype that is as wide as the
+ * longest string, which allows readers to load blocks of strings directly.
+ * Each block is written from a reusable buffer to avoid holding a second
+ * copy of the entire vector in memory.
+ */
+template<class Function_>
+H5::DataSet write_string_dataset(const H5::Group& handle, const char* name, size_t n, bool scalar, size_t width, Function_ get, const WriteOptions& options) {
+    width = std::max(width, static_cast<size_t>(1));
+    auto stype = utf8_string_type(width);
+    auto dhandle = create_layout_dataset(handle, name, stype, n, scalar, options);
+
+    if (scalar) {
+        std::string buffer(width, '\0');
+        auto x = get(0);
+        std::copy(x.begin(), x.end(), buffer.begin());
+        dhandle.write(buffer.data(), stype);
+        return dhandle;
+    }
+
+    if (use_parallel_chunks(n, scalar, options)) {
+        write_chunks_parallel(dhandle, n, width, [&](hsize_t i, unsigned char* dest) -> void {
+            auto x = get(i);
+            std::copy(x.begin(), x.end(), dest);
+        }, options);
+        return dhandle;
+    }
+
+    hsize_t block = std::max(options.buffer_size, static_cast<hsize_t>(1));
+    std::vector<char> buffer;
+    auto fspace = dhandle.getSpace();
+    for (hsize_t start = 0; start < n; start += block) {
+        hsize_t count = std::min(block, static_cast<hsize_t>(n - start));
+        buffer.clear();
+        buffer.resize(count * width);
+        for (hsize_t j = 0; j < count; ++j) {
+            auto x = get(start + j);
+            std::copy(x.begin(), x.end(), buffer.begin() + j * width);
+        }
+
+        fspace.selectHyperslab(H5S_SELECT_SET, &count, &start);
+        H5::DataSpace mspace(1, &count);
+        dhandle.write(buffer.data(), stype, mspace, fspace);
+    }
+
+    return dhandle;
+}
+
+// Names of lists are interned, while names of vectors are stored in a StringColumn.
+template<class Column_>
+void write_names(const H5::Group& handle, const Column_& names, const WriteOptions& options) {
+    size_t n = names.size(), width = 0;
+    for (size_t i = 0; i < n; ++i) {
+        width = std::max(width, names.get(i).size());
+    }
+    write_string_dataset(handle, "names", n, false, width, [&](size_t i) -> std::string_view { return names.get(i); }, options);
+}
+
+inline void write_strings(const H5::Group& handle, const ColumnarStringVector* ptr, const WriteOptions& options) {
+    size_t n = ptr->size();
+    const auto& validity = ptr->validity();
+    const auto& values = ptr->values();
+
+    size_t width = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (!validity.is_missing(i)) {
+            width = std::max(width, values.get(i).size());
+        }
+    }
+
+    std::string placeholder;
+    bool has_placeholder = validity.null_count() > 0;
+    if (has_placeholder) {
+        placeholder = "NA";
+        bool found = true;
+        while (found) {
+            found = false;
+            for (size_t i = 0; i < n && !found; ++i) {
+                found = (!validity.is_missing(i) && values.get(i) == placeholder);
+            }
+            if (found) {
+                placeholder += "_";
+            }
+        }
+        width = std::max(width, placeholder.size());
+    }
+
+    auto dhandle = write_string_dataset(handle, "data", n, ptr->is_scalar(), width, [&](size_t i) -> std::string_view {
+        return (validity.is_missing(i) ? std::string_view(placeholder) : values.get(i));
+    }, options);
+
+    if (has_placeholder) {
+        write_string_attribute(dhandle, "missing-value-placeholder", placeholder);
+    }
+
+    if (ptr->format() == StringVector::DATE) {
+        write_scalar_string(handle, "format", "date");
+    } else if (ptr->format() == StringVector::DATETIME) {
+        write_scalar_string(handle, "format", "date-time");
+    }
+}
+
+class Writer {
+public:
+    Writer(const WriteOptions& options, size_t first_index = 0) : my_options(options), my_first_index(first_index) {}
+
+    std::vector<void*> externals;
+
+private:
+    const WriteOptions& my_options;
+    size_t my_first_index;
+
+    template<class Vector_>
+    void write_vector_names(const H5::Group& handle, const Vector_* ptr) {
+        if (ptr->has_names()) {
+            write_names(handle, ptr->names(), my_options);
+        }
+    }
+
+public:
+    void write(const Base* object, const H5::Group& handle) {
+        switch (object->type()) {
+            case LIST:
+                {
+                    auto lptr = cast_columnar<ColumnarList>(object, "HDF5 writing");
+                    write_string_attribute(handle, "uzuki_object", "list");
+                    auto dhandle = handle.createGroup("data");
+                    const auto& values = lptr->values();
+                    for (size_t i = 0, n = values.size(); i < n; ++i) {
+                        auto istr = std::to_string(i);
+                        write(values[i], dhandle.createGroup(istr));
+                    }
+                    if (lptr->has_names()) {
+                        write_names(handle, lptr->names(), my_options);
+                    }
+                }
+                break;
+
+            case INTEGER:
+                {
+                    auto iptr = cast_columnar<ColumnarIntegerVector>(object, "HDF5 writing");
+                    write_string_attribute(handle, "uzuki_object", "vector");
+                    write_string_attribute(handle, "uzuki_type", "integer");
+                    write_integer_like(handle, iptr->values(), iptr->size(), iptr->validity(), iptr->is_scalar(), my_options);
+                    write_vector_names(handle, iptr);
+                }
+                break;
+
+            case BOOLEAN:
+                {
+                    auto bptr = cast_columnar<ColumnarBooleanVector>(object, "HDF5 writing");
+                    write_string_attribute(handle, "uzuki_object", "vector");
+                    write_string_attribute(handle, "uzuki_type", "boolean");
+                    // Booleans are stored as a bitmap, so they are converted to integers per block.
+                    write_integer_like(handle, [&](size_t i) -> int32_t { return bptr->get(i); }, nullptr, bptr->size(), bptr->validity(), bptr->is_scalar(), my_options);
+                    write_vector_names(handle, bptr);
+                }
+                break;
+
+            case FACTOR:
+                {
+                    auto fptr = cast_columnar<ColumnarFactor>(object, "HDF5 writing");
+                    write_string_attribute(handle, "uzuki_object", "vector");
+                    write_string_attribute(handle, "uzuki_type", "factor");
+                    write_integer_like(handle, fptr->codes(), fptr->size(), fptr->validity(), fptr->is_scalar(), my_options);
+
+                    const auto& levels = fptr->levels();
+                    size_t nlevels = levels.size(), width = 0;
+                    for (size_t l = 0; l < nlevels; ++l) {
+                        width = std::max(width, levels.get(l).size());
+                    }
+                    write_string_dataset(handle, "levels", nlevels, false, width, [&](size_t l) -> std::string_view { return levels.get(l); }, my_options);
+
+                    if (fptr->is_ordered()) {
+                        write_ordered(handle);
+                    }
+                    write_vector_names(handle, fptr);
+                }
+                break;
+
+            case NUMBER:
+                {
+                    auto dptr = cast_columnar<ColumnarNumberVector>(object, "HDF5 writing");
+                    write_string_attribute(handle, "uzuki_object", "vector");
+                    write_string_attribute(handle, "uzuki_type", "number");
+                    write_numbers(handle, dptr, my_options);
+                    write_vector_names(handle, dptr);
+                }
+                break;
+
+            case STRING:
+                {
+                    auto sptr = cast_columnar<ColumnarStringVector>(object, "HDF5 writing");
+                    write_string_attribute(handle, "uzuki_object", "vector");
+                    write_string_attribute(handle, "uzuki_type", "string");
+                    write_strings(handle, sptr, my_options);
+                    write_vector_names(handle, sptr);
+                }
+                break;
+
+            case NOTHING:
+                write_string_attribute(handle, "uzuki_object", "nothing");
+                break;
+
+            case EXTERNAL:
+                {
+                    auto eptr = cast_columnar<ColumnarExternal>(object, "HDF5 writing");
+                    write_string_attribute(handle, "uzuki_object", "external");
+                    int32_t index = my_first_index + externals.size();
+                    auto ihandle = handle.createDataSet("index", H5::PredType::STD_I32LE, H5S_SCALAR);
+                    ihandle.write(&index, H5::PredType::NATIVE_INT32);
+                    externals.push_back(eptr->get());
+                }
+                break;
+        }
+    }
+};
+/**
+ * @endcond
+ */
+
+/**
+ * Write a list to a HDF5 group, following the layout of the **uzuki2** specification.
+ * Integer, boolean and factor vectors use the narrowest integer datatype that can represent their values (see `WriteOptions::narrow_integers`),
+ * while strings are stored in fixed-width datatypes that are as wide as the longest string.
+ * Missing values are replaced with a placeholder that does not collide with any non-missing value, which is recorded in the `missing-value-placeholder` attribute.
+ * Small datasets are stored contiguously, while larger datasets are chunked and compressed according to `options`.
+ *
+ * @param object Pointer to the top-level object, typically a list.
+ * All objects in the tree should have been created by the `ColumnarProvisioner`, e.g., from `hdf5::parse()` or `json::parse()`.
+ * @param handle Handle to an empty HDF5 group in which to write the list.
+ * @param options Optional parameters.
+ *
+ * @return Pointers to the external objects in the list, ordered by the `index` that was assigned to each of them in the file.
+ */
+inline std::vector<void*> write(const Base* object, const H5::Group& handle, const WriteOptions& options) {
+    write_string_attribute(handle, "uzuki_version", written_version());
+    Writer writer(options);
+    writer.write(object, handle);
+    return std::move(writer.externals);
+}
+
+/**
+ * Write a list to a new HDF5 file, following the layout of the **uzuki2** specification.
+ * See the other `write()` overload for details.
+ *
+ * @param object Pointer to the top-level object, typically a list.
+ * @param file Path to the HDF5 file.
+ * Any existing file is overwritten.
+ * @param name Name of the group in which to write the list.
+ * @param options Optional parameters.
+ *
+ * @return Pointers to the external objects in the list, ordered by their `index`.
+ */
+inline std::vector<void*> write(const Base* object, const std::string& file, const std::string& name, const WriteOptions& options = WriteOptions()) {
+    H5::H5File handle(file, H5F_ACC_TRUNC);
+    return write(object, handle.createGroup(name), options);
+}
+
+/**
+ * @cond
+ */
+inline H5::StrType vls_string_type() {
+    H5::StrType stype(H5::PredType::C_S1, H5T_VARIABLE);
+    stype.setCset(H5T_CSET_UTF8);
+    return stype;
+}
+
+/*
+ * Streamed vectors are stored in extendible datasets, which must be chunked.
+ * Each block is written by extending the dataset and selecting the new
+ * region, so only the current block needs to be held in memory.
+ */
+inline H5::DataSet create_extendible_dataset(const H5::Group& handle, const char* name, const H5::DataType& dtype, const WriteOptions& options) {
+    hsize_t zero = 0, unlimited = H5S_UNLIMITED;
+    H5::DataSpace dspace(1, &zero, &unlimited);
+
+    H5::DSetCreatPropList cplist;
+    hsize_t chunk = std::max(options.chunk_size ? options.chunk_size : options.buffer_size, static_cast<hsize_t>(1));
+    cplist.setChunk(1, &chunk);
+    if (options.compression_level > 0) {
+        if (options.shuffle) {
+            cplist.setShuffle();
+        }
+        cplist.setDeflate(options.compression_level);
+    }
+
+    return handle.createDataSet(name, dtype, dspace, cplist);
+}
+
+inline void extend_and_write(H5::DataSet& handle, hsize_t offset, hsize_t n, const void* buffer, const H5::DataType& mtype) {
+    if (n == 0) {
+        return;
+    }
+    hsize_t total = offset + n;
+    handle.extend(&total);
+    auto fspace = handle.getSpace();
+    fspace.selectHyperslab(H5S_SELECT_SET, &n, &offset);
+    H5::DataSpace mspace(1, &n);
+    handle.write(buffer, mtype, mspace, fspace);
+}
+
+// Variable-length strings need null-terminated copies of each view.
+class VlsBlock {
+public:
+    template<class Function_>
+    const char** fill(size_t n, Function_ get) {
+        my_positions.clear();
+        my_chars.clear();
+        for (size_t i = 0; i < n; ++i) {
+            auto x = get(i);
+            my_positions.push_back(my_chars.size());
+            my_chars.insert(my_chars.end(), x.begin(), x.end());
+            my_chars.push_back('\0');
+        }
+
+        my_pointers.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            my_pointers[i] = my_chars.data() + my_positions[i];
+        }
+        return my_pointers.data();
+    }
+
+private:
+    std::vector<char> my_chars;
+    std::vector<size_t> my_positions;
+    std::vector<const char*> my_pointers;
+};
+
+struct StreamFrame {
+    H5::Group handle;
+    H5::Group data;
+    H5::DataSet values;
+    const H5::PredType* type = NULL;
+    bool has_missing = false;
+    bool collides = false;
+
+    // Placeholder for missing values in this vector, and where it came from, for error messages.
+    int32_t integer_placeholder = -1;
+    double number_placeholder = 0;
+    std::string string_placeholder;
+    const char* placeholder_source = "";
+
+    H5::DataSet names;
+    hsize_t names_written = 0;
+    std::vector<std::string> pending_names;
+};
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Write a list to a HDF5 group incrementally.
+ *
+ * This allows applications to write lists that are too large to be held in memory.
+ * Lists are constructed with `begin_list()` and `end_list()`, while vectors are constructed with one of the `begin_*()` methods,
+ * zero or more calls to the corresponding `append_*()` method with blocks of values, and `end_vector()`.
+ * Each child of a named list should be preceded by a call to `name()`.
+ * For named vectors, the names are supplied alongside each block of values.
+ * Once the top-level object is complete, `finish()` should be called to validate the external indices.
+ *
+ * Each vector is stored in an extendible chunked dataset that grows with each block, so memory usage depends on the block sizes and nesting depth, not on the size of the list.
+ * Strings and names are stored as variable-length strings, as their maximum length is not known in advance.
+ * Missing values are replaced by the placeholders in `WriteOptions`, e.g., `WriteOptions::stream_integer_placeholder`,
+ * unless a placeholder is supplied for a specific vector in the corresponding `begin_*()` call.
+ * Non-missing values may be equal to the placeholder as long as the vector has no missing values;
+ * otherwise, an error is raised by whichever `append_*()` call completes the collision.
+ */
+class StreamWriter {
+public:
+    /**
+     * @param handle Handle to an empty HDF5 group in which to write the list.
+     * @param options Optional parameters.
+     */
+    StreamWriter(const H5::Group& handle, const WriteOptions& options = WriteOptions()) : my_handle(handle), my_options(options) {
+        write_string_attribute(my_handle, "uzuki_version", written_version());
+    }
+
+private:
+    H5::Group my_handle;
+    WriteOptions my_options;
+    StreamState my_state;
+    std::vector<StreamFrame> my_frames;
+
+    VlsBlock my_vls;
+    std::vector<int32_t> my_integers;
+    std::vector<double> my_numbers;
+
+    H5::Group begin_object() {
+        bool root = my_state.empty();
+        size_t position = my_state.add_object();
+        if (root) {
+            return my_handle;
+        }
+
+        auto& parent = my_frames.back();
+        if (my_state.top().named) {
+            parent.pending_names.push_back(my_state.name());
+            if (parent.pending_names.size() >= my_options.buffer_size) {
+                flush_list_names(parent);
+            }
+        }
+        return parent.data.createGroup(std::to_string(position));
+    }
+
+    void flush_list_names(StreamFrame& frame) {
+        auto& pending = frame.pending_names;
+        auto ptrs = my_vls.fill(pending.size(), [&](size_t i) -> std::string_view { return pending[i]; });
+        extend_and_write(frame.names, frame.names_written, pending.size(), ptrs, vls_string_type());
+        frame.names_written += pending.size();
+        pending.clear();
+    }
+
+    StreamFrame& begin_vector(const char* type, Type type_enum, bool named, bool scalar, int32_t num_levels = 0) {
+        auto handle = begin_object();
+        my_state.push(type_enum, named, scalar, num_levels);
+        my_frames.emplace_back();
+        auto& frame = my_frames.back();
+        frame.handle = handle;
+        write_string_attribute(handle, "uzuki_object", "vector");
+        write_string_attribute(handle, "uzuki_type", type);
+        if (named) {
+            frame.names = create_extendible_dataset(handle, "names", vls_string_type(), my_options);
+        }
+        return frame;
+    }
+
+    void create_values(StreamFrame& frame, const H5::DataType& dtype, bool scalar) {
+        if (scalar) {
+            frame.values = frame.handle.createDataSet("data", dtype, H5S_SCALAR);
+        } else {
+            frame.values = create_extendible_dataset(frame.handle, "data", dtype, my_options);
+        }
+    }
+
+    void write_values(StreamFrame& frame, size_t offset, size_t n, const void* buffer, const H5::DataType& mtype) {
+        if (my_state.top().scalar) {
+            if (n) {
+                frame.values.write(buffer, mtype);
+            }
+        } else {
+            extend_and_write(frame.values, offset, n, buffer, mtype);
+        }
+    }
+
+    // A collision with the placeholder is only a problem if the vector also has missing values, in any block.
+    // This is checked before the block is committed, so a failed append is not counted.
+    void update_missing(StreamFrame& frame, bool has_missing, bool collides) {
+        has_missing = has_missing || frame.has_missing;
+        collides = collides || frame.collides;
+        if (has_missing && collides) {
+            throw std::runtime_error("non-missing value collides with the missing placeholder, see '" + std::string(frame.placeholder_source) + "'");
+        }
+        frame.has_missing = has_missing;
+        frame.collides = collides;
+    }
+
+    template<class Function_>
+    void append_integer_like(Type type, size_t n, const uint8_t* missing, const std::string_view* names, Function_ get) {
+        size_t offset = my_state.check_append(type, n, names != NULL);
+        auto& frame = my_frames.back();
+        int32_t placeholder = frame.integer_placeholder;
+        bool has_missing = false, collides = false;
+        my_integers.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            if (missing && missing[i]) {
+                my_integers[i] = placeholder;
+                has_missing = true;
+            } else {
+                my_integers[i] = get(i);
+                collides = collides || my_integers[i] == placeholder;
+            }
+        }
+
+        update_missing(frame, has_missing, collides);
+        my_state.commit_append(n);
+        write_values(frame, offset, n, my_integers.data(), H5::PredType::NATIVE_INT32);
+        if (names) {
+            append_names(names, n);
+        }
+    }
+
+public:
+    /**
+     * Supply the name of the next child of the current list.
+     * This should be called before each child of a named list.
+     *
+     * @param name Name of the next child.
+     */
+    void name(std::string_view name) {
+        my_state.set_name(name);
+    }
+
+    /**
+     * Start a new list.
+     *
+     * @param named Whether the list is named.
+     */
+    void begin_list(bool named) {
+        auto handle = begin_object();
+        my_state.push(LIST, named);
+        my_frames.emplace_back();
+        auto& frame = my_frames.back();
+        frame.handle = handle;
+        write_string_attribute(handle, "uzuki_object", "list");
+        frame.data = handle.createGroup("data");
+        if (named) {
+            frame.names = create_extendible_dataset(handle, "names", vls_string_type(), my_options);
+        }
+    }
+
+    /**
+     * End the current list.
+     */
+    void end_list() {
+        auto info = my_state.pop(true);
+        if (info.named) {
+            flush_list_names(my_frames.back());
+        }
+        my_frames.pop_back();
+    }
+
+    /**
+     * Start a new integer vector, to be filled by `append_integers()`.
+     *
+     * @param named Whether the vector is named.
+     * @param scalar Whether to represent a length-1 vector as a scalar.
+     * @param placeholder Missing placeholder for this vector.
+     * If not supplied, `WriteOptions::stream_integer_placeholder` is used.
+     */
+    void begin_integer(bool named, bool scalar = false, std::optional<int32_t> placeholder = std::nullopt) {
+        auto& frame = begin_vector("integer", INTEGER, named, scalar);
+        frame.type = &(H5::PredType::STD_I32LE);
+        frame.integer_placeholder = placeholder.value_or(my_options.stream_integer_placeholder);
+        frame.placeholder_source = (placeholder ? "placeholder' argument of 'begin_integer()" : "WriteOptions::stream_integer_placeholder");
+        create_values(frame, *(frame.type), scalar);
+    }
+
+    /**
+     * Start a new number vector, to be filled by `append_numbers()`.
+     *
+     * @param named Whether the vector is named.
+     * @param scalar Whether to represent a length-1 vector as a scalar.
+     * @param placeholder Missing placeholder for this vector.
+     * If not supplied, `WriteOptions::stream_number_placeholder` is used.
+     */
+    void begin_number(bool named, bool scalar = false, std::optional<double> placeholder = std::nullopt) {
+        auto& frame = begin_vector("number", NUMBER, named, scalar);
+        frame.type = &(H5::PredType::IEEE_F64LE);
+        frame.number_placeholder = placeholder.value_or(my_options.stream_number_placeholder);
+        frame.placeholder_source = (placeholder ? "placeholder' argument of 'begin_number()" : "WriteOptions::stream_number_placeholder");
+        create_values(frame, *(frame.type), scalar);
+    }
+
+    /**
+     * Start a new boolean vector, to be filled by `append_booleans()`.
+     *
+     * @param named Whether the vector is named.
+     * @param scalar Whether to represent a length-1 vector as a scalar.
+     */
+    void begin_boolean(bool named, bool scalar = false) {
+        auto& frame = begin_vector("boolean", BOOLEAN, named, scalar);
+        frame.type = &(H5::PredType::STD_I8LE);
+        create_values(frame, *(frame.type), scalar);
+    }
+
+    /**
+     * Start a new string vector, to be filled by `append_strings()`.
+     *
+     * @param named Whether the vector is named.
+     * @param scalar Whether to represent a length-1 vector as a scalar.
+     * @param format Format constraint on the strings.
+     * @param placeholder Missing placeholder for this vector.
+     * If not supplied, `WriteOptions::stream_string_placeholder` is used.
+     */
+    void begin_string(bool named, bool scalar = false, StringVector::Format format = StringVector::NONE, std::optional<std::string> placeholder = std::nullopt) {
+        auto& frame = begin_vector("string", STRING, named, scalar);
+        frame.string_placeholder = (placeholder ? std::move(*placeholder) : my_options.stream_string_placeholder);
+        frame.placeholder_source = (placeholder ? "placeholder' argument of 'begin_string()" : "WriteOptions::stream_string_placeholder");
+        create_values(frame, vls_string_type(), scalar);
+        if (format == StringVector::DATE) {
+            write_scalar_string(frame.handle, "format", "date");
+        } else if (format == StringVector::DATETIME) {
+            write_scalar_string(frame.handle, "format", "date-time");
+        }
+    }
+
+    /**
+     * Start a new factor, to be filled by `append_codes()`.
+     * If `WriteOptions::narrow_integers = true`, the codes are stored in the narrowest integer datatype that can hold all levels.
+     *
+     * @param levels Unique levels of the factor.
+     * @param ordered Whether the levels are ordered.
+     * @param named Whether the factor is named.
+     * @param scalar Whether to represent a length-1 factor as a scalar.
+     */
+    void begin_factor(const std::vector<std::string>& levels, bool ordered, bool named, bool scalar = false) {
+        std::unordered_set<std::string_view> present(levels.begin(), levels.end());
+        if (present.size() != levels.size()) {
+            throw std::runtime_error("levels should be unique");
+        }
+
+        auto& frame = begin_vector("factor", FACTOR, named, scalar, levels.size());
+        frame.type = &(H5::PredType::STD_I32LE);
+        if (my_options.narrow_integers) {
+            if (levels.size() <= 128) {
+                frame.type = &(H5::PredType::STD_I8LE);
+            } else if (levels.size() <= 32768) {
+                frame.type = &(H5::PredType::STD_I16LE);
+            }
+        }
+        create_values(frame, *(frame.type), scalar);
+
+        size_t width = 0;
+        for (const auto& l : levels) {
+            width = std::max(width, l.size());
+        }
+        write_string_dataset(frame.handle, "levels", levels.size(), false, width, [&](size_t l) -> std::string_view { return levels[l]; }, my_options);
+        if (ordered) {
+            write_ordered(frame.handle);
+        }
+    }
+
+    /**
+     * Append a block of values to the current integer vector.
+     *
+     * @param values Pointer to an array of length `n` containing the values.
+     * @param n Number of values.
+     * @param missing Pointer to an array of length `n` indicating whether each value is missing.
+     * If NULL, no values are missing.
+     * @param names Pointer to an array of length `n` containing the names of the values.
+     * If non-NULL, the vector should be named; otherwise, names should be supplied with `append_names()`.
+     */
+    void append_integers(const int32_t* values, size_t n, const uint8_t* missing = NULL, const std::string_view* names = NULL) {
+        append_integer_like(INTEGER, n, missing, names, [&](size_t i) -> int32_t { return values[i]; });
+    }
+
+    /**
+     * Append a block of values to the current number vector.
+     *
+     * @param values Pointer to an array of length `n` containing the values.
+     * @param n Number of values.
+     * @param missing Pointer to an array of length `n` indicating whether each value is missing.
+     * If NULL, no values are missing.
+     * @param names Pointer to an array of length `n` containing the names of the values.
+     * If non-NULL, the vector should be named; otherwise, names should be supplied with `append_names()`.
+     */
+    void append_numbers(const double* values, size_t n, const uint8_t* missing = NULL, const std::string_view* names = NULL) {
+        size_t offset = my_state.check_append(NUMBER, n, names != NULL);
+        auto& frame = my_frames.back();
+        double placeholder = frame.number_placeholder;
+        bool is_placeholder_nan = std::isnan(placeholder);
+
+        bool has_missing = false, collides = false;
+        my_numbers.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            if (missing && missing[i]) {
+                my_numbers[i] = placeholder;
+                has_missing = true;
+            } else {
+                my_numbers[i] = values[i];
+                collides = collides || (is_placeholder_nan ? std::isnan(values[i]) : values[i] == placeholder);
+            }
+        }
+
+        update_missing(frame, has_missing, collides);
+        my_state.commit_append(n);
+        write_values(frame, offset, n, my_numbers.data(), H5::PredType::NATIVE_DOUBLE);
+        if (names) {
+            append_names(names, n);
+        }
+    }
+
+    /**
+     * Append a block of values to the current boolean vector.
+     *
+     * @param values Pointer to an array of length `n` containing the values, where non-zero values are treated as true.
+     * @param n Number of values.
+     * @param missing Pointer to an array of length `n` indicating whether each value is missing.
+     * If NULL, no values are missing.
+     * @param names Pointer to an array of length `n` containing the names of the values.
+     * If non-NULL, the vector should be named; otherwise, names should be supplied with `append_names()`.
+     */
+    void append_booleans(const uint8_t* values, size_t n, const uint8_t* missing = NULL, const std::string_view* names = NULL) {
+        append_integer_like(BOOLEAN, n, missing, names, [&](size_t i) -> int32_t { return values[i] != 0; });
+    }
+
+    /**
+     * Append a block of values to the current string vector.
+     *
+     * @param values Pointer to an array of length `n` containing the values.
+     * @param n Number of values.
+     * @param missing Pointer to an array of length `n` indicating whether each value is missing.
+     * If NULL, no values are missing.
+     * @param names Pointer to an array of length `n` containing the names of the values.
+     * If non-NULL, the vector should be named; otherwise, names should be supplied with `append_names()`.
+     */
+    void append_strings(const std::string_view* values, size_t n, const uint8_t* missing = NULL, const std::string_view* names = NULL) {
+        size_t offset = my_state.check_append(STRING, n, names != NULL);
+        auto& frame = my_frames.back();
+        const auto& placeholder = frame.string_placeholder;
+
+        bool has_missing = false, collides = false;
+        auto ptrs = my_vls.fill(n, [&](size_t i) -> std::string_view {
+            if (missing && missing[i]) {
+                has_missing = true;
+                return placeholder;
+            }
+            collides = collides || values[i] == placeholder;
+            return values[i];
+        });
+
+        update_missing(frame, has_missing, collides);
+        my_state.commit_append(n);
+        write_values(frame, offset, n, ptrs, vls_string_type());
+        if (names) {
+            append_names(names, n);
+        }
+    }
+
+    /**
+     * Append a block of codes to the current factor.
+     *
+     * @param codes Pointer to an array of length `n` containing the codes, which should be indices into the levels.
+     * @param n Number of codes.
+     * @param missing Pointer to an array of length `n` indicating whether each code is missing.
+     * If NULL, no codes are missing.
+     * @param names Pointer to an array of length `n` containing the names of the codes.
+     * If non-NULL, the factor should be named; otherwise, names should be supplied with `append_names()`.
+     */
+    void append_codes(const int32_t* codes, size_t n, const uint8_t* missing = NULL, const std::string_view* names = NULL) {
+        if (!my_state.empty() && my_state.top().type == FACTOR) {
+            my_state.check_codes(codes, n, missing);
+        }
+        append_integer_like(FACTOR, n, missing, names, [&](size_t i) -> int32_t { return codes[i]; });
+    }
+
+    /**
+     * Append a block of names to the current vector or factor, separately from its values.
+     * This is an alternative to passing `names` to the `append_*()` methods,
+     * for applications where the names are generated after the values.
+     * The total number of names should be equal to the length of the vector when `end_vector()` is called.
+     *
+     * @param names Pointer to an array of length `n` containing the names.
+     * @param n Number of names.
+     */
+    void append_names(const std::string_view* names, size_t n) {
+        size_t offset = my_state.append_names(n);
+        auto ptrs = my_vls.fill(n, [&](size_t i) -> std::string_view { return names[i]; });
+        extend_and_write(my_frames.back().names, offset, n, ptrs, vls_string_type());
+    }
+
+    /**
+     * End the current vector or factor.
+     * This adds the missing placeholder attribute if any missing values were appended.
+     */
+    void end_vector() {
+        auto info = my_state.pop(false);
+        auto& frame = my_frames.back();
+
+        if (frame.has_missing) {
+            const char* placeholder_name = "missing-value-placeholder";
+            if (info.type == STRING) {
+                write_string_attribute(frame.values, placeholder_name, frame.string_placeholder);
+            } else if (info.type == NUMBER) {
+                auto ahandle = frame.values.createAttribute(placeholder_name, *(frame.type), H5S_SCALAR);
+                ahandle.write(H5::PredType::NATIVE_DOUBLE, &(frame.number_placeholder));
+            } else {
+                auto ahandle = frame.values.createAttribute(placeholder_name, *(frame.type), H5S_SCALAR);
+                ahandle.write(H5::PredType::NATIVE_INT32, &(frame.integer_placeholder));
+            }
+        }
+
+        my_frames.pop_back();
+    }
+
+    /**
+     * Add a "nothing" object, i.e., R's `NULL`.
+     */
+    void nothing() {
+        auto handle = begin_object();
+        write_string_attribute(handle, "uzuki_object", "nothing");
+    }
+
+    /**
+     * Add a reference to an external object.
+     * Across the entire list, the indices should be unique and consecutive from zero; this is checked in `finish()`.
+     *
+     * @param index Index of the external object.
+     */
+    void external(size_t index) {
+        auto handle = begin_object();
+        my_state.add_external(index);
+        write_string_attribute(handle, "uzuki_object", "external");
+        int32_t converted = index;
+        auto ihandle = handle.createDataSet("index", H5::PredType::STD_I32LE, H5S_SCALAR);
+        ihandle.write(&converted, H5::PredType::NATIVE_INT32);
+    }
+
+    /**
+     * Check that the top-level object is complete and that the external indices are valid.
+     */
+    void finish() {
+        my_state.finish();
+    }
+};
+
+}
+
+}
+
+#endif
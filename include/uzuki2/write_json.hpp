@@ -0,0 +1,853 @@
+#ifndef UZUKI2_WRITE_JSON_HPP
+#define UZUKI2_WRITE_JSON_HPP
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <stdexcept>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <algorithm>
+#include <unordered_set>
+#include <cstdio>
+#include <optional>
+
+#include "byteme/byteme.hpp"
+
+#include "interfaces.hpp"
+#include "Columnar.hpp"
+#include "StreamState.hpp"
+#include "Base64.hpp"
+
+/**
+ * @file write_json.hpp
+ * @brief Write lists to JSON files.
+ */
+
+namespace uzuki2 {
+
+namespace json {
+
+/**
+ * @brief Options for writing JSON files.
+ */
+struct WriteOptions {
+    /**
+     * Size of the buffer in which the JSON text is accumulated before it is passed to the `byteme::Writer`.
+     */
+    size_t buffer_size = 65536;
+
+    /**
+     * Whether to Gzip-compress the file in `write_file()`.
+     */
+    bool gzip = false;
+
+    /**
+     * Whether to store non-scalar number vectors in `write()` as base64-encoded little-endian doubles.
+     * This is bit-exact for all values, including the payloads of NaNs, and is much faster to parse than decimal text.
+     * If true, the file is written with version 1.3 of the specification.
+     * This has no effect on the `StreamWriter`.
+     */
+    bool base64_numbers = false;
+};
+
+/**
+ * @cond
+ */
+inline const char* written_version(bool base64_numbers = false) {
+    return (base64_numbers ? "1.3" : "1.2");
+}
+
+/*
+ * Accumulates the JSON text in a fixed-size buffer that is flushed to the
+ * byteme::Writer whenever it fills up, so no DOM or full copy of the output
+ * is ever held in memory. Numbers are formatted with std::to_chars, which
+ * gives the shortest representation that round-trips to the same double.
+ */
+class JsonOutput {
+public:
+    JsonOutput(byteme::Writer& writer, size_t buffer_size, bool reserve = true) : my_writer(writer), my_capacity(std::max(buffer_size, static_cast<size_t>(64))) {
+        if (reserve) {
+            my_buffer.reserve(my_capacity);
+        }
+    }
+
+    void put(char c) {
+        if (my_buffer.size() == my_capacity) {
+            flush();
+        }
+        my_buffer.push_back(c);
+    }
+
+    void put(std::string_view x) {
+        if (my_buffer.size() + x.size() > my_capacity) {
+            flush();
+            if (x.size() > my_capacity) {
+                my_writer.write(reinterpret_cast<const unsigned char*>(x.data()), x.size());
+                return;
+            }
+        }
+        my_buffer.append(x);
+    }
+
+    void put_string(std::string_view x) {
+        put('"');
+        size_t last = 0;
+        for (size_t i = 0, n = x.size(); i < n; ++i) {
+            unsigned char c = x[i];
+            if (c != '"' && c != '\\' && c >= 0x20) {
+                continue;
+            }
+
+            put(x.substr(last, i - last));
+            last = i + 1;
+            switch (c) {
+                case '"': put("\\\""); break;
+                case '\\': put("\\\\"); break;
+                case '\n': put("\\n"); break;
+                case '\t': put("\\t"); break;
+                case '\r': put("\\r"); break;
+                case '\b': put("\\b"); break;
+                case '\f': put("\\f"); break;
+                default:
+                    {
+                        const char* hex = "0123456789abcdef";
+                        char escaped[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+                        put(std::string_view(escaped, sizeof(escaped)));
+                    }
+            }
+        }
+        put(x.substr(last));
+        put('"');
+    }
+
+    void put_integer(int64_t x) {
+        char tmp[24];
+        auto res = std::to_chars(tmp, tmp + sizeof(tmp), x);
+        put(std::string_view(tmp, res.ptr - tmp));
+    }
+
+    void put_number(double x) {
+        if (std::isnan(x)) {
+            put("\"NaN\"");
+        } else if (std::isinf(x)) {
+            put(x > 0 ? "\"Inf\"" : "\"-Inf\"");
+        } else {
+            char tmp[32];
+            auto res = std::to_chars(tmp, tmp + sizeof(tmp), x);
+            put(std::string_view(tmp, res.ptr - tmp));
+        }
+    }
+
+    void flush() {
+        if (!my_buffer.empty()) {
+            my_writer.write(reinterpret_cast<const unsigned char*>(my_buffer.data()), my_buffer.size());
+            my_buffer.clear();
+        }
+    }
+
+private:
+    byteme::Writer& my_writer;
+    size_t my_capacity;
+    std::string my_buffer;
+};
+
+template<class Function_>
+void write_values(JsonOutput& output, size_t n, bool scalar, const ColumnValidity& validity, Function_ fun) {
+    output.put(",\"values\":");
+    if (!scalar) {
+        output.put('[');
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (i) {
+            output.put(',');
+        }
+        if (validity.is_missing(i)) {
+            output.put("null");
+        } else {
+            fun(i);
+        }
+    }
+    if (!scalar) {
+        output.put(']');
+    }
+}
+
+// Missing values are zeroed and listed in the 'missing' property instead.
+inline void write_base64_numbers(JsonOutput& output, const ColumnarNumberVector* ptr) {
+    output.put(",\"encoding\":\"base64\",\"values\":\"");
+
+    // Blocks are a multiple of 3 bytes, so that padding is only needed at the end.
+    constexpr size_t block_size = 3072;
+    size_t n = ptr->size();
+    const double* values = ptr->values();
+    const auto& validity = ptr->validity();
+    bool little_endian = is_little_endian();
+    std::vector<double> buffer;
+    std::string encoded;
+
+    for (size_t start = 0; start < n; start += block_size) {
+        size_t count = std::min(block_size, n - start);
+        buffer.assign(values + start, values + start + count);
+        for (size_t i = 0; i < count; ++i) {
+            if (validity.is_missing(start + i)) {
+                buffer[i] = 0;
+            }
+        }
+        if (!little_endian) {
+            swap_bytes(buffer.data(), count);
+        }
+        encoded.clear();
+        encode_base64(reinterpret_cast<const unsigned char*>(buffer.data()), count * sizeof(double), encoded);
+        output.put(encoded);
+    }
+    output.put('"');
+
+    if (validity.null_count()) {
+        output.put(",\"missing\":[");
+        bool first = true;
+        for (size_t i = 0; i < n; ++i) {
+            if (validity.is_missing(i)) {
+                if (!first) {
+                    output.put(',');
+                }
+                output.put_integer(i);
+                first = false;
+            }
+        }
+        output.put(']');
+    }
+}
+
+template<class Column_>
+void write_names(JsonOutput& output, const Column_& names) {
+    output.put(",\"names\":[");
+    for (size_t i = 0, n = names.size(); i < n; ++i) {
+        if (i) {
+            output.put(',');
+        }
+        output.put_string(names.get(i));
+    }
+    output.put(']');
+}
+
+class Writer {
+public:
+    Writer(JsonOutput& output, bool base64_numbers = false) : my_output(output), my_base64_numbers(base64_numbers) {}
+
+    std::vector<void*> externals;
+
+private:
+    JsonOutput& my_output;
+    bool my_base64_numbers;
+
+    template<class Vector_>
+    void write_vector_names(const Vector_* ptr) {
+        if (ptr->has_names()) {
+            write_names(my_output, ptr->names());
+        }
+    }
+
+public:
+    void write(const Base* object) {
+        switch (object->type()) {
+            case LIST:
+                {
+                    auto lptr = cast_columnar<ColumnarList>(object, "JSON writing");
+                    my_output.put("\"type\":\"list\",\"values\":[");
+                    const auto& values = lptr->values();
+                    for (size_t i = 0, n = values.size(); i < n; ++i) {
+                        if (i) {
+                            my_output.put(',');
+                        }
+                        my_output.put('{');
+                        write(values[i]);
+                        my_output.put('}');
+                    }
+                    my_output.put(']');
+                    if (lptr->has_names()) {
+                        write_names(my_output, lptr->names());
+                    }
+                }
+                break;
+
+            case INTEGER:
+                {
+                    auto iptr = cast_columnar<ColumnarIntegerVector>(object, "JSON writing");
+                    my_output.put("\"type\":\"integer\"");
+                    auto values = iptr->values();
+                    write_values(my_output, iptr->size(), iptr->is_scalar(), iptr->validity(), [&](size_t i) -> void { my_output.put_integer(values[i]); });
+                    write_vector_names(iptr);
+                }
+                break;
+
+            case NUMBER:
+                {
+                    auto dptr = cast_columnar<ColumnarNumberVector>(object, "JSON writing");
+                    my_output.put("\"type\":\"number\"");
+                    if (my_base64_numbers && !dptr->is_scalar()) {
+                        write_base64_numbers(my_output, dptr);
+                    } else {
+                        auto values = dptr->values();
+                        write_values(my_output, dptr->size(), dptr->is_scalar(), dptr->validity(), [&](size_t i) -> void { my_output.put_number(values[i]); });
+                    }
+                    write_vector_names(dptr);
+                }
+                break;
+
+            case BOOLEAN:
+                {
+                    auto bptr = cast_columnar<ColumnarBooleanVector>(object, "JSON writing");
+                    my_output.put("\"type\":\"boolean\"");
+                    write_values(my_output, bptr->size(), bptr->is_scalar(), bptr->validity(), [&](size_t i) -> void { my_output.put(bptr->get(i) ? "true" : "false"); });
+                    write_vector_names(bptr);
+                }
+                break;
+
+            case STRING:
+                {
+                    auto sptr = cast_columnar<ColumnarStringVector>(object, "JSON writing");
+                    my_output.put("\"type\":\"string\"");
+                    if (sptr->format() == StringVector::DATE) {
+                        my_output.put(",\"format\":\"date\"");
+                    } else if (sptr->format() == StringVector::DATETIME) {
+                        my_output.put(",\"format\":\"date-time\"");
+                    }
+                    const auto& values = sptr->values();
+                    write_values(my_output, sptr->size(), sptr->is_scalar(), sptr->validity(), [&](size_t i) -> void { my_output.put_string(values.get(i)); });
+                    write_vector_names(sptr);
+                }
+                break;
+
+            case FACTOR:
+                {
+                    auto fptr = cast_columnar<ColumnarFactor>(object, "JSON writing");
+                    my_output.put("\"type\":\"factor\"");
+                    auto codes = fptr->codes();
+                    write_values(my_output, fptr->size(), fptr->is_scalar(), fptr->validity(), [&](size_t i) -> void { my_output.put_integer(codes[i]); });
+
+                    my_output.put(",\"levels\":[");
+                    const auto& levels = fptr->levels();
+                    for (size_t l = 0, nl = levels.size(); l < nl; ++l) {
+                        if (l) {
+                            my_output.put(',');
+                        }
+                        my_output.put_string(levels.get(l));
+                    }
+                    my_output.put(']');
+
+                    if (fptr->is_ordered()) {
+                        my_output.put(",\"ordered\":true");
+                    }
+                    write_vector_names(fptr);
+                }
+                break;
+
+            case NOTHING:
+                my_output.put("\"type\":\"nothing\"");
+                break;
+
+            case EXTERNAL:
+                {
+                    auto eptr = cast_columnar<ColumnarExternal>(object, "JSON writing");
+                    my_output.put("\"type\":\"external\",\"index\":");
+                    my_output.put_integer(externals.size());
+                    externals.push_back(eptr->get());
+                }
+                break;
+        }
+    }
+};
+/**
+ * @endcond
+ */
+
+/**
+ * Write a list to a JSON file in a single streaming pass, following the **uzuki2** specification.
+ * Floating-point numbers are written in the shortest form that parses back to the same `double`,
+ * with `"NaN"`, `"Inf"` and `"-Inf"` for the IEEE special values.
+ * The output is passed to `writer` in blocks of `WriteOptions::buffer_size` bytes.
+ *
+ * @param object Pointer to the top-level object, typically a list.
+ * All objects in the tree should have been created by the `ColumnarProvisioner`, e.g., from `hdf5::parse()` or `json::parse()`.
+ * @param writer Destination for the JSON text, e.g., a `byteme::RawFileWriter` or `byteme::GzipFileWriter`.
+ * The caller is responsible for calling `writer.finish()` afterwards.
+ * @param options Optional parameters.
+ *
+ * @return Pointers to the external objects in the list, ordered by the `index` that was assigned to each of them in the file.
+ */
+inline std::vector<void*> write(const Base* object, byteme::Writer& writer, const WriteOptions& options) {
+    JsonOutput output(writer, options.buffer_size);
+    output.put("{\"version\":\"");
+    output.put(written_version(options.base64_numbers));
+    output.put("\",");
+
+    Writer jwriter(output, options.base64_numbers);
+    jwriter.write(object);
+    output.put('}');
+    output.flush();
+    return std::move(jwriter.externals);
+}
+
+/**
+ * Write a list to a JSON file, following the **uzuki2** specification.
+ * See `write()` for details.
+ *
+ * @param object Pointer to the top-level object, typically a list.
+ * @param file Path to the output file.
+ * This is Gzip-compressed if `WriteOptions::gzip = true`.
+ * @param options Optional parameters.
+ *
+ * @return Pointers to the external objects in the list, ordered by their `index`.
+ */
+inline std::vector<void*> write_file(const Base* object, const std::string& file, const WriteOptions& options = WriteOptions()) {
+    std::unique_ptr<byteme::Writer> ptr;
+    if (options.gzip) {
+        ptr.reset(new byteme::GzipFileWriter(file.c_str(), {}));
+    } else {
+        ptr.reset(new byteme::RawFileWriter(file.c_str(), {}));
+    }
+    auto output = write(object, *ptr, options);
+    ptr->finish();
+    return output;
+}
+
+/**
+ * @cond
+ */
+/*
+ * In JSON, the names of a list or vector follow its values, so the names
+ * supplied during streaming need to be held until the object is ended. They
+ * are kept in memory up to the buffer size and spilled to a temporary file
+ * beyond that, so that long named vectors do not defeat the streaming.
+ */
+class NameSpill final : public byteme::Writer {
+public:
+    NameSpill(size_t limit) : my_limit(limit) {}
+
+    ~NameSpill() {
+        if (my_file) {
+            std::fclose(my_file);
+        }
+    }
+
+    void write(const unsigned char* buffer, size_t n) {
+        if (!my_file) {
+            if (my_memory.size() + n <= my_limit) {
+                my_memory.insert(my_memory.end(), buffer, buffer + n);
+                return;
+            }
+            my_file = std::tmpfile();
+            if (!my_file) {
+                throw std::runtime_error("failed to create a temporary file for the names");
+            }
+            flush_memory();
+        }
+        if (std::fwrite(buffer, 1, n, my_file) != n) {
+            throw std::runtime_error("failed to write names to a temporary file");
+        }
+    }
+
+    void finish() {}
+
+    void replay(JsonOutput& output) {
+        if (!my_file) {
+            output.put(std::string_view(my_memory.data(), my_memory.size()));
+            return;
+        }
+
+        std::rewind(my_file);
+        my_memory.resize(std::max(my_limit, static_cast<size_t>(1)));
+        size_t n;
+        while ((n = std::fread(my_memory.data(), 1, my_memory.size(), my_file)) > 0) {
+            output.put(std::string_view(my_memory.data(), n));
+        }
+    }
+
+private:
+    void flush_memory() {
+        if (std::fwrite(my_memory.data(), 1, my_memory.size(), my_file) != my_memory.size()) {
+            throw std::runtime_error("failed to write names to a temporary file");
+        }
+        my_memory.clear();
+    }
+
+    size_t my_limit;
+    std::vector<char> my_memory;
+    FILE* my_file = NULL;
+};
+
+struct StreamNames {
+    // Not reserving the buffer, as one is created for each named object and most names are much shorter than the buffer.
+    StreamNames(size_t buffer_size) : spill(buffer_size), output(spill, buffer_size, false) {}
+    NameSpill spill;
+    JsonOutput output;
+};
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Write a list to a JSON file incrementally.
+ *
+ * This allows applications to write lists that are too large to be held in memory.
+ * Lists are constructed with `begin_list()` and `end_list()`, while vectors are constructed with one of the `begin_*()` methods,
+ * zero or more calls to the corresponding `append_*()` method with blocks of values, and `end_vector()`.
+ * Each child of a named list should be preceded by a call to `name()`.
+ * For named vectors, the names are supplied alongside each block of values or separately with `append_names()`.
+ * Once the top-level object is complete, `finish()` should be called to validate the external indices and flush the output.
+ *
+ * Memory usage depends on the block sizes and nesting depth, not on the size of the list.
+ * The names of each object are buffered until the object is ended, and are spilled to a temporary file if they exceed `WriteOptions::buffer_size`.
+ */
+class StreamWriter {
+public:
+    /**
+     * @param writer Destination for the JSON text.
+     * This should remain valid for the lifetime of the `StreamWriter`.
+     * The caller is responsible for calling `writer.finish()` after `finish()`.
+     * @param options Optional parameters.
+     */
+    StreamWriter(byteme::Writer& writer, const WriteOptions& options = WriteOptions()) : my_options(options), my_output(writer, options.buffer_size) {}
+
+private:
+    WriteOptions my_options;
+    JsonOutput my_output;
+    StreamState my_state;
+    std::vector<std::unique_ptr<StreamNames> > my_names;
+
+    void begin_object() {
+        bool root = my_state.empty();
+        size_t position = my_state.add_object();
+        if (position) {
+            my_output.put(',');
+        }
+
+        if (!root && my_state.top().named) {
+            auto& names = my_names.back()->output;
+            if (position) {
+                names.put(',');
+            }
+            names.put_string(my_state.name());
+        }
+
+        my_output.put('{');
+        if (root) {
+            my_output.put("\"version\":\"");
+            my_output.put(written_version());
+            my_output.put("\",");
+        }
+    }
+
+    void push(Type type, bool named, bool scalar = false, int32_t num_levels = 0) {
+        my_state.push(type, named, scalar, num_levels);
+        my_names.emplace_back(named ? new StreamNames(my_options.buffer_size) : NULL);
+    }
+
+    void begin_vector(const char* type, Type type_enum, bool named, bool scalar) {
+        begin_object();
+        push(type_enum, named, scalar);
+        my_output.put("\"type\":\"");
+        my_output.put(type);
+        my_output.put('"');
+    }
+
+    void begin_values(bool scalar) {
+        my_output.put(",\"values\":");
+        if (!scalar) {
+            my_output.put('[');
+        }
+    }
+
+    template<class Function_>
+    void append_values(Type type, size_t n, const uint8_t* missing, const std::string_view* names, Function_ fun) {
+        size_t offset = my_state.check_append(type, n, names != NULL);
+        my_state.commit_append(n);
+        for (size_t i = 0; i < n; ++i) {
+            if (offset + i) {
+                my_output.put(',');
+            }
+            if (missing && missing[i]) {
+                my_output.put("null");
+            } else {
+                fun(i);
+            }
+        }
+
+        if (names) {
+            append_names(names, n);
+        }
+    }
+
+    void end_object(const StreamState::Frame& frame) {
+        if (!frame.scalar) {
+            my_output.put(']');
+        }
+        if (frame.named) {
+            my_output.put(",\"names\":[");
+            auto& names = *(my_names.back());
+            names.output.flush();
+            names.spill.replay(my_output);
+            my_output.put(']');
+        }
+        my_names.pop_back();
+        my_output.put('}');
+    }
+
+public:
+    /**
+     * Supply the name of the next child of the current list.
+     * This should be called before each child of a named list.
+     *
+     * @param name Name of the next child.
+     */
+    void name(std::string_view name) {
+        my_state.set_name(name);
+    }
+
+    /**
+     * Start a new list.
+     *
+     * @param named Whether the list is named.
+     */
+    void begin_list(bool named) {
+        begin_object();
+        push(LIST, named);
+        my_output.put("\"type\":\"list\",\"values\":[");
+    }
+
+    /**
+     * End the current list.
+     */
+    void end_list() {
+        end_object(my_state.pop(true));
+    }
+
+    /**
+     * Start a new integer vector, to be filled by `append_integers()`.
+     *
+     * @param named Whether the vector is named.
+     * @param scalar Whether to represent a length-1 vector as a scalar.
+     * @param placeholder Ignored, as missing values are always written as `null`.
+     * This is only provided for compatibility with `hdf5::StreamWriter::begin_integer()`.
+     */
+    void begin_integer(bool named, bool scalar = false, std::optional<int32_t> placeholder = std::nullopt) {
+        (void)placeholder;
+        begin_vector("integer", INTEGER, named, scalar);
+        begin_values(scalar);
+    }
+
+    /**
+     * Start a new number vector, to be filled by `append_numbers()`.
+     *
+     * @param named Whether the vector is named.
+     * @param scalar Whether to represent a length-1 vector as a scalar.
+     * @param placeholder Ignored, as missing values are always written as `null`.
+     * This is only provided for compatibility with `hdf5::StreamWriter::begin_number()`.
+     */
+    void begin_number(bool named, bool scalar = false, std::optional<double> placeholder = std::nullopt) {
+        (void)placeholder;
+        begin_vector("number", NUMBER, named, scalar);
+        begin_values(scalar);
+    }
+
+    /**
+     * Start a new boolean vector, to be filled by `append_booleans()`.
+     *
+     * @param named Whether the vector is named.
+     * @param scalar Whether to represent a length-1 vector as a scalar.
+     */
+    void begin_boolean(bool named, bool scalar = false) {
+        begin_vector("boolean", BOOLEAN, named, scalar);
+        begin_values(scalar);
+    }
+
+    /**
+     * Start a new string vector, to be filled by `append_strings()`.
+     *
+     * @param named Whether the vector is named.
+     * @param scalar Whether to represent a length-1 vector as a scalar.
+     * @param format Format constraint on the strings.
+     * @param placeholder Ignored, as missing values are always written as `null`.
+     * This is only provided for compatibility with `hdf5::StreamWriter::begin_string()`.
+     */
+    void begin_string(bool named, bool scalar = false, StringVector::Format format = StringVector::NONE, std::optional<std::string> placeholder = std::nullopt) {
+        (void)placeholder;
+        begin_vector("string", STRING, named, scalar);
+        if (format == StringVector::DATE) {
+            my_output.put(",\"format\":\"date\"");
+        } else if (format == StringVector::DATETIME) {
+            my_output.put(",\"format\":\"date-time\"");
+        }
+        begin_values(scalar);
+    }
+
+    /**
+     * Start a new factor, to be filled by `append_codes()`.
+     *
+     * @param levels Unique levels of the factor.
+     * @param ordered Whether the levels are ordered.
+     * @param named Whether the factor is named.
+     * @param scalar Whether to represent a length-1 factor as a scalar.
+     */
+    void begin_factor(const std::vector<std::string>& levels, bool ordered, bool named, bool scalar = false) {
+        std::unordered_set<std::string_view> present(levels.begin(), levels.end());
+        if (present.size() != levels.size()) {
+            throw std::runtime_error("levels should be unique");
+        }
+
+        begin_object();
+        push(FACTOR, named, scalar, levels.size());
+        my_output.put("\"type\":\"factor\",\"levels\":[");
+        for (size_t l = 0, nl = levels.size(); l < nl; ++l) {
+            if (l) {
+                my_output.put(',');
+            }
+            my_output.put_string(levels[l]);
+        }
+        my_output.put(']');
+        if (ordered) {
+            my_output.put(",\"ordered\":true");
+        }
+        begin_values(scalar);
+    }
+
+    /**
+     * Append a block of values to the current integer vector.
+     *
+     * @param values Pointer to an array of length `n` containing the values.
+     * @param n Number of values.
+     * @param missing Pointer to an array of length `n` indicating whether each value is missing.
+     * If NULL, no values are missing.
+     * @param names Pointer to an array of length `n` containing the names of the values.
+     * If non-NULL, the vector should be named; otherwise, names should be supplied with `append_names()`.
+     */
+    void append_integers(const int32_t* values, size_t n, const uint8_t* missing = NULL, const std::string_view* names = NULL) {
+        append_values(INTEGER, n, missing, names, [&](size_t i) -> void { my_output.put_integer(values[i]); });
+    }
+
+    /**
+     * Append a block of values to the current number vector.
+     * IEEE special values are written as the `"NaN"`, `"Inf"` and `"-Inf"` strings.
+     *
+     * @param values Pointer to an array of length `n` containing the values.
+     * @param n Number of values.
+     * @param missing Pointer to an array of length `n` indicating whether each value is missing.
+     * If NULL, no values are missing.
+     * @param names Pointer to an array of length `n` containing the names of the values.
+     * If non-NULL, the vector should be named; otherwise, names should be supplied with `append_names()`.
+     */
+    void append_numbers(const double* values, size_t n, const uint8_t* missing = NULL, const std::string_view* names = NULL) {
+        append_values(NUMBER, n, missing, names, [&](size_t i) -> void { my_output.put_number(values[i]); });
+    }
+
+    /**
+     * Append a block of values to the current boolean vector.
+     *
+     * @param values Pointer to an array of length `n` containing the values, where non-zero values are treated as true.
+     * @param n Number of values.
+     * @param missing Pointer to an array of length `n` indicating whether each value is missing.
+     * If NULL, no values are missing.
+     * @param names Pointer to an array of length `n` containing the names of the values.
+     * If non-NULL, the vector should be named; otherwise, names should be supplied with `append_names()`.
+     */
+    void append_booleans(const uint8_t* values, size_t n, const uint8_t* missing = NULL, const std::string_view* names = NULL) {
+        append_values(BOOLEAN, n, missing, names, [&](size_t i) -> void { my_output.put(values[i] ? "true" : "false"); });
+    }
+
+    /**
+     * Append a block of values to the current string vector.
+     *
+     * @param values Pointer to an array of length `n` containing the values.
+     * @param n Number of values.
+     * @param missing Pointer to an array of length `n` indicating whether each value is missing.
+     * If NULL, no values are missing.
+     * @param names Pointer to an array of length `n` containing the names of the values.
+     * If non-NULL, the vector should be named; otherwise, names should be supplied with `append_names()`.
+     */
+    void append_strings(const std::string_view* values, size_t n, const uint8_t* missing = NULL, const std::string_view* names = NULL) {
+        append_values(STRING, n, missing, names, [&](size_t i) -> void { my_output.put_string(values[i]); });
+    }
+
+    /**
+     * Append a block of codes to the current factor.
+     *
+     * @param codes Pointer to an array of length `n` containing the codes, which should be indices into the levels.
+     * @param n Number of codes.
+     * @param missing Pointer to an array of length `n` indicating whether each code is missing.
+     * If NULL, no codes are missing.
+     * @param names Pointer to an array of length `n` containing the names of the codes.
+     * If non-NULL, the factor should be named; otherwise, names should be supplied with `append_names()`.
+     */
+    void append_codes(const int32_t* codes, size_t n, const uint8_t* missing = NULL, const std::string_view* names = NULL) {
+        if (!my_state.empty() && my_state.top().type == FACTOR) {
+            my_state.check_codes(codes, n, missing);
+        }
+        append_values(FACTOR, n, missing, names, [&](size_t i) -> void { my_output.put_integer(codes[i]); });
+    }
+
+    /**
+     * Append a block of names to the current vector or factor, separately from its values.
+     * This is an alternative to passing `names` to the `append_*()` methods,
+     * for applications where the names are generated after the values.
+     * The total number of names should be equal to the length of the vector when `end_vector()` is called.
+     *
+     * @param names Pointer to an array of length `n` containing the names.
+     * @param n Number of names.
+     */
+    void append_names(const std::string_view* names, size_t n) {
+        size_t offset = my_state.append_names(n);
+        auto& output = my_names.back()->output;
+        for (size_t i = 0; i < n; ++i) {
+            if (offset + i) {
+                output.put(',');
+            }
+            output.put_string(names[i]);
+        }
+    }
+
+    /**
+     * End the current vector or factor.
+     */
+    void end_vector() {
+        end_object(my_state.pop(false));
+    }
+
+    /**
+     * Add a "nothing" object, i.e., R's `NULL`.
+     */
+    void nothing() {
+        begin_object();
+        my_output.put("\"type\":\"nothing\"}");
+    }
+
+    /**
+     * Add a reference to an external object.
+     * Across the entire list, the indices should be unique and consecutive from zero; this is checked in `finish()`.
+     *
+     * @param index Index of the external object.
+     */
+    void external(size_t index) {
+        begin_object();
+        my_state.add_external(index);
+        my_output.put("\"type\":\"external\",\"index\":");
+        my_output.put_integer(index);
+        my_output.put('}');
+    }
+
+    /**
+     * Check that the top-level object is complete and that the external indices are valid, and flush the output to the `byteme::Writer`.
+     */
+    void finish() {
+        my_state.finish();
+        my_output.flush();
+    }
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki2/parse_hdf5.hpp"
+#include "uzuki2/parse_json.hpp"
+#include "uzuki2/write_hdf5.hpp"
+#include "uzuki2/append_hdf5.hpp"
+
+#include "test_subclass.h"
+#include "utils.h"
+
+#include <string>
+
+// Appended elements need not be lists.
+static uzuki2::ParsedList parse_columnar_lenient(const std::string& contents, size_t num_external = 0) {
+    return parse_columnar(contents, num_external, false);
+}
+
+TEST(Hdf5AppendTest, Basic) {
+    auto path = "TEST-append.h5";
+    {
+        auto parsed = parse_columnar_lenient("{ \"type\": \"list\", \"values\": ["
+            "{ \"type\": \"integer\", \"values\": [ 1, 2 ] },"
+            "{ \"type\": \"external\", \"index\": 0 },"
+            "{ \"type\": \"list\", \"values\": [] }"
+            "], \"names\": [ \"a\", \"b\", \"c\" ] }", 1);
+        uzuki2::hdf5::write(parsed.get(), path, "foo");
+    }
+
+    auto first = parse_columnar_lenient("{ \"type\": \"string\", \"values\": [ \"x\", null ] }");
+    auto externals = uzuki2::hdf5::append(path, "foo", first.get(), "d", 1);
+    EXPECT_TRUE(externals.empty());
+
+    // Second append re-uses the extendible names, and assigns the next external index.
+    auto second = parse_columnar_lenient("{ \"type\": \"list\", \"values\": [ { \"type\": \"external\", \"index\": 0 } ] }", 1);
+    externals = uzuki2::hdf5::append(path, "foo", second.get(), "a longer name", 1);
+    ASSERT_EQ(externals.size(), 1);
+    EXPECT_EQ(externals[0], reinterpret_cast<void*>(1));
+
+    // Appending to a nested list.
+    auto third = parse_columnar_lenient("{ \"type\": \"number\", \"values\": 2.5 }");
+    uzuki2::hdf5::AppendOptions opt;
+    opt.path = uzuki2::hdf5::Path{ "c" };
+    uzuki2::hdf5::append(path, "foo", third.get(), std::nullopt, 2, opt);
+
+    auto reloaded = uzuki2::hdf5::parse<DefaultProvisioner>(path, "foo", DefaultExternals(2), uzuki2::hdf5::Options());
+    auto lptr = static_cast<const DefaultList*>(reloaded.get());
+    ASSERT_EQ(lptr->size(), 5);
+    EXPECT_EQ(lptr->names, std::vector<std::string>({ "a", "b", "c", "d", "a longer name" }));
+
+    auto sptr = static_cast<const DefaultStringVector*>(lptr->values[3].get());
+    EXPECT_EQ(sptr->base.values, std::vector<std::string>({ "x", "ich bin missing" }));
+
+    auto nested = static_cast<const DefaultList*>(lptr->values[4].get());
+    ASSERT_EQ(nested->size(), 1);
+    EXPECT_EQ(static_cast<const DefaultExternal*>(nested->values[0].get())->ptr, reinterpret_cast<void*>(2));
+
+    auto extended = static_cast<const DefaultList*>(lptr->values[2].get());
+    ASSERT_EQ(extended->size(), 1);
+    EXPECT_EQ(static_cast<const DefaultNumberVector*>(extended->values[0].get())->base.values, std::vector<double>({ 2.5 }));
+}
+
+static void expect_append_error(const std::string& path, const uzuki2::Base* object, const std::optional<std::string>& name, const std::string& msg, const uzuki2::hdf5::AppendOptions& opt = uzuki2::hdf5::AppendOptions(), size_t num_external = 0) {
+    EXPECT_ANY_THROW({
+        try {
+            uzuki2::hdf5::append(path, "foo", object, name, num_external, opt);
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr(msg));
+            throw;
+        }
+    });
+}
+
+TEST(Hdf5AppendTest, Errors) {
+    auto path = "TEST-append.h5";
+    auto parsed = parse_columnar_lenient("{ \"type\": \"list\", \"values\": [ { \"type\": \"nothing\" } ], \"names\": [ \"a\" ] }");
+    uzuki2::hdf5::write(parsed.get(), path, "foo");
+
+    auto child = parse_columnar_lenient("{ \"type\": \"nothing\" }");
+    expect_append_error(path, child.get(), std::nullopt, "name should be supplied");
+
+    uzuki2::hdf5::AppendOptions opt;
+    opt.path = uzuki2::hdf5::Path{ 0 };
+    expect_append_error(path, child.get(), std::nullopt, "only be appended to a list", opt);
+
+    // Objects from other provisioners cannot be written, and nothing is left behind.
+    auto other = load_json("{ \"type\": \"list\", \"values\": [] }");
+    expect_append_error(path, other.get(), "b", "ColumnarProvisioner");
+    auto reloaded = uzuki2::hdf5::parse<DefaultProvisioner>(path, "foo", DefaultExternals(0), uzuki2::hdf5::Options());
+    EXPECT_EQ(static_cast<const DefaultList*>(reloaded.get())->size(), 1);
+
+    // Failures in rewriting the names also remove the new element.
+    uzuki2::hdf5::AppendOptions bad;
+    bad.write.compression_level = 20;
+    expect_append_error(path, child.get(), "b", "", bad);
+    {
+        H5::H5File handle(path, H5F_ACC_RDONLY);
+        auto ghandle = handle.openGroup("foo");
+        EXPECT_FALSE(ghandle.exists("names.tmp"));
+        EXPECT_FALSE(ghandle.exists("names.old"));
+        EXPECT_EQ(ghandle.openGroup("data").getNumObjs(), 1);
+    }
+    reloaded = uzuki2::hdf5::parse<DefaultProvisioner>(path, "foo", DefaultExternals(0), uzuki2::hdf5::Options());
+    EXPECT_EQ(static_cast<const DefaultList*>(reloaded.get())->names, std::vector<std::string>({ "a" }));
+
+    // The number of externals should match the file, if requested.
+    uzuki2::hdf5::AppendOptions checked;
+    checked.check_num_external = true;
+    expect_append_error(path, child.get(), "b", "num_external", checked, 1);
+
+    // Otherwise, the rest of the file is not scanned for external references.
+    uzuki2::hdf5::append(path, "foo", child.get(), "b", 1);
+    reloaded = uzuki2::hdf5::parse<DefaultProvisioner>(path, "foo", DefaultExternals(0), uzuki2::hdf5::Options());
+    EXPECT_EQ(static_cast<const DefaultList*>(reloaded.get())->names, std::vector<std::string>({ "a", "b" }));
+
+    // Older versions are not supported.
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        auto ghandle = list_opener(handle, "foo");
+        ghandle.createGroup("data");
+    }
+    expect_append_error(path, child.get(), std::nullopt, "1.3 or later");
+}
@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki2/parse_hdf5.hpp"
+#include "uzuki2/parse_json.hpp"
+#include "uzuki2/Arena.hpp"
+
+#include "test_subclass.h"
+#include "utils.h"
+
+#include <cstdint>
+#include <array>
+
+TEST(ArenaTest, Basic) {
+    std::vector<int> destroyed;
+    struct Tracked {
+        Tracked(std::vector<int>& d, int i) : destroyed(d), id(i) {}
+        ~Tracked() { destroyed.push_back(id); }
+        std::vector<int>& destroyed;
+        int id;
+    };
+
+    {
+        uzuki2::Arena arena(64);
+        auto first = arena.create<Tracked>(destroyed, 1);
+        auto x = arena.create<char>('a');
+        auto y = arena.create<double>(2.5);
+        auto second = arena.create<Tracked>(destroyed, 2);
+        EXPECT_EQ(first->id, 1);
+        EXPECT_EQ(*x, 'a');
+        EXPECT_EQ(*y, 2.5);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(y) % alignof(double), 0);
+        EXPECT_EQ(second->id, 2);
+
+        // Large objects get their own block.
+        auto big = arena.create<std::array<double, 100> >();
+        EXPECT_EQ(big->size(), 100);
+        EXPECT_GE(arena.num_blocks(), 2);
+        EXPECT_TRUE(destroyed.empty());
+    }
+
+    EXPECT_EQ(destroyed, std::vector<int>({ 2, 1 }));
+}
+
+static int num_alive = 0;
+
+struct CountedNothing : public uzuki2::Nothing {
+    CountedNothing() { ++num_alive; }
+    ~CountedNothing() { --num_alive; }
+};
+
+struct ArenaList : public uzuki2::List {
+    ArenaList(size_t l, bool) : values(l) {}
+    size_t size() const { return values.size(); }
+    void set(size_t i, std::shared_ptr<uzuki2::Base> ptr) { values[i] = ptr.get(); }
+    void set_name(size_t, std::string) {}
+    std::vector<uzuki2::Base*> values;
+};
+
+struct ArenaProvisioner {
+    static CountedNothing* new_Nothing(uzuki2::Arena& arena) { return arena.create<CountedNothing>(); }
+
+    static DefaultExternal* new_External(uzuki2::Arena& arena, void* p) { return arena.create<DefaultExternal>(p); }
+
+    static ArenaList* new_List(uzuki2::Arena& arena, size_t l, bool n) { return arena.create<ArenaList>(l, n); }
+
+    template<class ... Args_>
+    static DefaultIntegerVector* new_Integer(uzuki2::Arena& arena, Args_&& ... args) { return arena.create<DefaultIntegerVector>(std::forward<Args_>(args)...); }
+
+    template<class ... Args_>
+    static DefaultNumberVector* new_Number(uzuki2::Arena& arena, Args_&& ... args) { return arena.create<DefaultNumberVector>(std::forward<Args_>(args)...); }
+
+    template<class ... Args_>
+    static DefaultStringVector* new_String(uzuki2::Arena& arena, Args_&& ... args) { return arena.create<DefaultStringVector>(std::forward<Args_>(args)...); }
+
+    template<class ... Args_>
+    static DefaultBooleanVector* new_Boolean(uzuki2::Arena& arena, Args_&& ... args) { return arena.create<DefaultBooleanVector>(std::forward<Args_>(args)...); }
+
+    template<class ... Args_>
+    static DefaultFactor* new_Factor(uzuki2::Arena& arena, Args_&& ... args) { return arena.create<DefaultFactor>(std::forward<Args_>(args)...); }
+};
+
+static_assert(uzuki2::uses_arena<ArenaProvisioner>::value);
+static_assert(!uzuki2::uses_arena<DefaultProvisioner>::value);
+
+static void check_arena_contents(uzuki2::ParsedList parsed) {
+    EXPECT_EQ(num_alive, 2);
+    auto lptr = static_cast<const ArenaList*>(parsed.get());
+    ASSERT_EQ(lptr->size(), 3);
+
+    auto iptr = static_cast<const DefaultIntegerVector*>(lptr->values[0]);
+    EXPECT_EQ(iptr->base.values, std::vector<int32_t>({ 1, 2, 3 }));
+    EXPECT_EQ(lptr->values[1]->type(), uzuki2::NOTHING);
+
+    auto nested = static_cast<const ArenaList*>(lptr->values[2]);
+    ASSERT_EQ(nested->size(), 1);
+    EXPECT_EQ(nested->values[0]->type(), uzuki2::NOTHING);
+
+    // Child pointers keep the entire tree alive.
+    std::shared_ptr<uzuki2::Base> child(parsed.ptr, lptr->values[2]);
+    parsed.ptr.reset();
+    EXPECT_EQ(num_alive, 2);
+    child.reset();
+    EXPECT_EQ(num_alive, 0);
+}
+
+TEST(ArenaTest, Hdf5) {
+    auto path = "TEST-arena.h5";
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        auto ghandle = list_opener(handle, "foo");
+        auto dhandle = ghandle.createGroup("data");
+
+        auto ihandle = vector_opener(dhandle, "0", "integer");
+        create_dataset<int>(ihandle, "data", { 1, 2, 3 }, H5::PredType::NATIVE_INT);
+        nothing_opener(dhandle, "1");
+
+        auto lhandle = list_opener(dhandle, "2");
+        auto ldhandle = lhandle.createGroup("data");
+        nothing_opener(ldhandle, "0");
+    }
+
+    auto parsed = uzuki2::hdf5::parse<ArenaProvisioner>(path, "foo", uzuki2::DummyExternals(0), uzuki2::hdf5::Options());
+    check_arena_contents(std::move(parsed));
+}
+
+TEST(ArenaTest, Json) {
+    std::string contents = "{ \"type\": \"list\", \"values\": [ { \"type\": \"integer\", \"values\": [ 1, 2, 3 ] }, { \"type\": \"nothing\" }, { \"type\": \"list\", \"values\": [ { \"type\": \"nothing\" } ] } ] }";
+    auto parsed = uzuki2::json::parse_buffer<ArenaProvisioner>(reinterpret_cast<const unsigned char*>(contents.c_str()), contents.size(), uzuki2::DummyExternals(0), uzuki2::json::Options());
+    check_arena_contents(std::move(parsed));
+}
+
+struct OwningArenaList : public uzuki2::List {
+    OwningArenaList(size_t l, bool) : values(l) {}
+    size_t size() const { return values.size(); }
+    void set(size_t i, std::shared_ptr<uzuki2::Base> ptr) { values[i] = std::move(ptr); }
+    void set_name(size_t, std::string) {}
+    std::vector<std::shared_ptr<uzuki2::Base> > values;
+};
+
+struct OwningArenaProvisioner : public ArenaProvisioner {
+    static OwningArenaList* new_List(uzuki2::Arena& arena, size_t l, bool n) { return arena.create<OwningArenaList>(l, n); }
+};
+
+TEST(ArenaTest, NoCycle) {
+    // Lists that hold the shared pointers of their children should not keep the arena alive.
+    std::string contents = "{ \"type\": \"list\", \"values\": [ { \"type\": \"nothing\" }, { \"type\": \"list\", \"values\": [ { \"type\": \"nothing\" } ] } ] }";
+    for (bool dedup : { false, true }) {
+        uzuki2::json::Options opt;
+        opt.deduplicate = dedup;
+        auto parsed = uzuki2::json::parse_buffer<OwningArenaProvisioner>(reinterpret_cast<const unsigned char*>(contents.c_str()), contents.size(), uzuki2::DummyExternals(0), opt);
+        EXPECT_GT(num_alive, 0);
+
+        std::weak_ptr<uzuki2::Base> observer = parsed.ptr;
+        auto lptr = static_cast<const OwningArenaList*>(parsed.get());
+        EXPECT_EQ(lptr->values[1]->type(), uzuki2::LIST);
+        parsed.ptr.reset();
+        EXPECT_TRUE(observer.expired());
+        EXPECT_EQ(num_alive, 0);
+    }
+}
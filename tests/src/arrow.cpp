@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki2/parse_json.hpp"
+#include "uzuki2/Columnar.hpp"
+#include "uzuki2/export_arrow.hpp"
+
+#include "test_subclass.h"
+#include "utils.h"
+
+#include <string>
+#include <cstring>
+
+static bool is_valid(const ArrowArray* array, size_t i) {
+    auto bitmap = static_cast<const uint8_t*>(array->buffers[0]);
+    return bitmap == NULL || (bitmap[i / 8] & (1u << (i % 8)));
+}
+
+TEST(ArrowExportTest, Vectors) {
+    auto parsed = parse_columnar("{ \"type\": \"list\", \"values\": ["
+        "{ \"type\": \"integer\", \"values\": [ 1, null, 3 ] },"
+        "{ \"type\": \"number\", \"values\": [ 1.5, 2.5 ] },"
+        "{ \"type\": \"boolean\", \"values\": [ true, false, null, true ] },"
+        "{ \"type\": \"string\", \"values\": [ \"foo\", null, \"whee\" ] },"
+        "{ \"type\": \"factor\", \"values\": [ 1, 0, 1 ], \"levels\": [ \"A\", \"B\" ], \"ordered\": true }"
+        "] }");
+    const auto& values = static_cast<const uzuki2::ColumnarList*>(parsed.get())->values();
+
+    {
+        ArrowArray array;
+        ArrowSchema schema;
+        uzuki2::arrow::export_object(std::shared_ptr<const uzuki2::Base>(parsed.ptr, values[0]), &array, &schema);
+        EXPECT_STREQ(schema.format, "i");
+        EXPECT_EQ(array.length, 3);
+        EXPECT_EQ(array.null_count, 1);
+        EXPECT_EQ(array.n_buffers, 2);
+        EXPECT_FALSE(is_valid(&array, 1));
+        EXPECT_TRUE(is_valid(&array, 2));
+        auto ptr = static_cast<const int32_t*>(array.buffers[1]);
+        EXPECT_EQ(ptr, static_cast<const uzuki2::ColumnarIntegerVector*>(values[0])->values()); // no copy.
+        EXPECT_EQ(ptr[2], 3);
+        array.release(&array);
+        schema.release(&schema);
+        EXPECT_EQ(array.release, nullptr);
+        EXPECT_EQ(schema.release, nullptr);
+    }
+
+    {
+        ArrowArray array;
+        ArrowSchema schema;
+        uzuki2::arrow::export_object(std::shared_ptr<const uzuki2::Base>(parsed.ptr, values[1]), &array, &schema);
+        EXPECT_STREQ(schema.format, "g");
+        EXPECT_EQ(array.null_count, 0);
+        EXPECT_EQ(array.buffers[0], nullptr);
+        EXPECT_EQ(static_cast<const double*>(array.buffers[1])[1], 2.5);
+        array.release(&array);
+        schema.release(&schema);
+    }
+
+    {
+        ArrowArray array;
+        ArrowSchema schema;
+        uzuki2::arrow::export_object(std::shared_ptr<const uzuki2::Base>(parsed.ptr, values[2]), &array, &schema);
+        EXPECT_STREQ(schema.format, "b");
+        EXPECT_EQ(array.length, 4);
+        EXPECT_EQ(array.null_count, 1);
+        EXPECT_FALSE(is_valid(&array, 2));
+        auto bits = static_cast<const uint8_t*>(array.buffers[1]);
+        EXPECT_EQ(bits[0] & 0xB, 0x9);
+        array.release(&array);
+        schema.release(&schema);
+    }
+
+    {
+        ArrowArray array;
+        ArrowSchema schema;
+        uzuki2::arrow::export_object(std::shared_ptr<const uzuki2::Base>(parsed.ptr, values[3]), &array, &schema);
+        EXPECT_STREQ(schema.format, "u");
+        EXPECT_EQ(array.n_buffers, 3);
+        EXPECT_FALSE(is_valid(&array, 1));
+        auto offsets = static_cast<const int32_t*>(array.buffers[1]);
+        auto chars = static_cast<const char*>(array.buffers[2]);
+        EXPECT_EQ(std::string(chars + offsets[0], chars + offsets[1]), "foo");
+        EXPECT_EQ(std::string(chars + offsets[2], chars + offsets[3]), "whee");
+        array.release(&array);
+        schema.release(&schema);
+    }
+
+    {
+        ArrowArray array;
+        ArrowSchema schema;
+        uzuki2::arrow::export_object(std::shared_ptr<const uzuki2::Base>(parsed.ptr, values[4]), &array, &schema);
+        EXPECT_STREQ(schema.format, "i");
+        EXPECT_TRUE(schema.flags & ARROW_FLAG_DICTIONARY_ORDERED);
+        ASSERT_NE(schema.dictionary, nullptr);
+        EXPECT_STREQ(schema.dictionary->format, "u");
+        ASSERT_NE(array.dictionary, nullptr);
+        EXPECT_EQ(array.dictionary->length, 2);
+        auto offsets = static_cast<const int32_t*>(array.dictionary->buffers[1]);
+        auto chars = static_cast<const char*>(array.dictionary->buffers[2]);
+        EXPECT_EQ(std::string(chars + offsets[1], chars + offsets[2]), "B");
+        EXPECT_EQ(static_cast<const int32_t*>(array.buffers[1])[0], 1);
+        array.release(&array);
+        schema.release(&schema);
+    }
+}
+
+TEST(ArrowExportTest, Lists) {
+    auto parsed = parse_columnar("{ \"type\": \"list\", \"values\": ["
+        "{ \"type\": \"integer\", \"values\": [ 1, 2, 3 ] },"
+        "{ \"type\": \"list\", \"values\": [ { \"type\": \"string\", \"values\": [ \"x\" ] } ] },"
+        "{ \"type\": \"nothing\" }"
+        "], \"names\": [ \"a\", \"b\", \"c\" ] }");
+
+    ArrowArray array;
+    ArrowSchema schema;
+    uzuki2::arrow::export_object(parsed.ptr, &array, &schema);
+    parsed.ptr.reset(); // exported arrays should keep the objects alive.
+
+    EXPECT_STREQ(schema.format, "+s");
+    EXPECT_EQ(array.length, 1);
+    ASSERT_EQ(schema.n_children, 3);
+    ASSERT_EQ(array.n_children, 3);
+
+    EXPECT_STREQ(schema.children[0]->name, "a");
+    EXPECT_STREQ(schema.children[0]->format, "+l");
+    auto offsets = static_cast<const int32_t*>(array.children[0]->buffers[1]);
+    EXPECT_EQ(offsets[0], 0);
+    EXPECT_EQ(offsets[1], 3);
+    ASSERT_EQ(array.children[0]->n_children, 1);
+    EXPECT_STREQ(schema.children[0]->children[0]->format, "i");
+    EXPECT_EQ(static_cast<const int32_t*>(array.children[0]->children[0]->buffers[1])[2], 3);
+
+    EXPECT_STREQ(schema.children[1]->name, "b");
+    EXPECT_STREQ(schema.children[1]->format, "+s");
+    ASSERT_EQ(schema.children[1]->n_children, 1);
+    EXPECT_STREQ(schema.children[1]->children[0]->name, "");
+    EXPECT_STREQ(schema.children[1]->children[0]->format, "+l");
+
+    EXPECT_STREQ(schema.children[2]->format, "n");
+    EXPECT_EQ(array.children[2]->null_count, 1);
+
+    array.release(&array);
+    schema.release(&schema);
+}
+
+TEST(ArrowExportTest, Errors) {
+    std::string contents = "{ \"type\": \"list\", \"values\": [ { \"type\": \"integer\", \"values\": [ 1, 2, 3 ] } ] }";
+    auto parsed = uzuki2::json::parse_buffer<DefaultProvisioner>(reinterpret_cast<const unsigned char*>(contents.c_str()), contents.size(), uzuki2::DummyExternals(0), uzuki2::json::Options());
+
+    ArrowArray array;
+    ArrowSchema schema;
+    try {
+        uzuki2::arrow::export_object(parsed.ptr, &array, &schema);
+        FAIL() << "expected an error";
+    } catch (std::exception& e) {
+        EXPECT_THAT(e.what(), ::testing::HasSubstr("ColumnarProvisioner"));
+    }
+    EXPECT_EQ(array.release, nullptr);
+    EXPECT_EQ(schema.release, nullptr);
+}
@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki2/parse_json.hpp"
+#include "uzuki2/parse_binary.hpp"
+#include "uzuki2/write_binary.hpp"
+
+#include "test_subclass.h"
+#include "utils.h"
+
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static std::vector<unsigned char> write_to_buffer(const uzuki2::Base* object, size_t buffer_size = 65536) {
+    byteme::RawBufferWriter writer({});
+    uzuki2::binary::WriteOptions opt;
+    opt.buffer_size = buffer_size;
+    uzuki2::binary::write(object, writer, opt);
+    writer.finish();
+    return writer.get_output();
+}
+
+TEST(BinaryTest, RoundTrip) {
+    auto parsed = parse_columnar(round_trip_json(), 1);
+
+    auto path = "TEST-binary.bin";
+    auto externals = uzuki2::binary::write_file(parsed.get(), path);
+    ASSERT_EQ(externals.size(), 1);
+    EXPECT_EQ(externals[0], reinterpret_cast<void*>(1));
+
+    auto reloaded = uzuki2::binary::parse_file<DefaultProvisioner>(path, DefaultExternals(1), uzuki2::binary::Options());
+    EXPECT_EQ(reloaded.version.major, 1);
+    EXPECT_EQ(reloaded.version.minor, 0);
+    check_round_trip(reloaded.get());
+
+    // Same bytes with a tiny staging buffer, and after a round trip through the ColumnarProvisioner.
+    auto contents = write_to_buffer(parsed.get());
+    EXPECT_EQ(write_to_buffer(parsed.get(), 1), contents);
+    auto recolumnar = uzuki2::binary::parse_buffer<uzuki2::ColumnarProvisioner>(contents.data(), contents.size(), DefaultExternals(1), uzuki2::binary::Options());
+    EXPECT_EQ(write_to_buffer(recolumnar.get()), contents);
+
+    // Unaligned buffers are copied before parsing.
+    std::vector<unsigned char> shifted(contents.size() + 1);
+    std::copy(contents.begin(), contents.end(), shifted.begin() + 1);
+    auto unaligned = uzuki2::binary::parse_buffer<DefaultProvisioner>(shifted.data() + 1, contents.size(), DefaultExternals(1), uzuki2::binary::Options());
+    check_round_trip(unaligned.get());
+}
+
+TEST(BinaryTest, Empty) {
+    // Unlike HDF5, the binary format distinguishes zero-length vectors from scalars.
+    auto parsed = parse_columnar("{ \"type\": \"list\", \"values\": [ { \"type\": \"integer\", \"values\": [] }, { \"type\": \"string\", \"values\": [] }, { \"type\": \"list\", \"values\": [] } ] }");
+    auto contents = write_to_buffer(parsed.get());
+    auto reloaded = uzuki2::binary::parse_buffer<DefaultProvisioner>(contents.data(), contents.size(), DefaultExternals(0), uzuki2::binary::Options());
+
+    auto lptr = static_cast<const DefaultList*>(reloaded.get());
+    ASSERT_EQ(lptr->size(), 3);
+    auto iptr = static_cast<const DefaultIntegerVector*>(lptr->values[0].get());
+    EXPECT_EQ(iptr->size(), 0);
+    EXPECT_FALSE(iptr->base.scalar);
+    EXPECT_EQ(static_cast<const DefaultStringVector*>(lptr->values[1].get())->size(), 0);
+    EXPECT_EQ(static_cast<const DefaultList*>(lptr->values[2].get())->size(), 0);
+}
+
+TEST(BinaryTest, BitExact) {
+    // Signed zeros and NaN payloads do not survive a trip through decimal text.
+    auto parsed = parse_columnar("{ \"type\": \"list\", \"values\": [ { \"type\": \"number\", \"values\": [ 0, 0, 0 ] } ] }");
+    uint64_t payload = 0x7ff8000000abcdefULL;
+    double values[3];
+    std::memcpy(values, &payload, sizeof(double));
+    values[1] = -0.0;
+    values[2] = 5e-324;
+    auto dptr = const_cast<uzuki2::ColumnarNumberVector*>(static_cast<const uzuki2::ColumnarNumberVector*>(static_cast<const uzuki2::ColumnarList*>(parsed.get())->values()[0]));
+    dptr->set_block(0, values, 3);
+
+    auto contents = write_to_buffer(parsed.get());
+    auto reloaded = uzuki2::binary::parse_buffer<uzuki2::ColumnarProvisioner>(contents.data(), contents.size(), DefaultExternals(0), uzuki2::binary::Options());
+    auto rptr = static_cast<const uzuki2::ColumnarNumberVector*>(static_cast<const uzuki2::ColumnarList*>(reloaded.get())->values()[0]);
+    EXPECT_EQ(std::memcmp(rptr->values(), values, sizeof(values)), 0);
+}
+
+struct ViewIntegerVector : public DefaultIntegerVector {
+    ViewIntegerVector(size_t l, bool n, bool s) : DefaultIntegerVector(l, n, s) {}
+    void set_block(size_t, const int32_t* values, size_t) { view = values; }
+    const int32_t* view = NULL;
+};
+
+struct ViewProvisioner : public DefaultProvisioner {
+    static ViewIntegerVector* new_Integer(size_t l, bool n, bool s) { return new ViewIntegerVector(l, n, s); }
+};
+
+TEST(BinaryTest, MappingLifetime) {
+    auto parsed = parse_columnar("{ \"type\": \"list\", \"values\": [ { \"type\": \"integer\", \"values\": [ 5, 6, 7 ] } ] }");
+    auto path = "TEST-binary.bin";
+    uzuki2::binary::write_file(parsed.get(), path);
+
+    // Block pointers remain valid after parsing, as the mapping is owned by the top-level pointer.
+    auto reloaded = uzuki2::binary::parse_file<ViewProvisioner>(path, DefaultExternals(0), uzuki2::binary::Options());
+    auto child = static_cast<const DefaultList*>(reloaded.get())->values[0];
+    auto view = static_cast<const ViewIntegerVector*>(child.get())->view;
+    if (uzuki2::is_little_endian()) {
+        ASSERT_TRUE(view != NULL);
+        EXPECT_EQ(std::vector<int32_t>(view, view + 3), std::vector<int32_t>({ 5, 6, 7 }));
+    }
+}
+
+static void expect_binary_error(const std::vector<unsigned char>& contents, const std::string& msg, int num_external = 0, size_t len = -1) {
+    EXPECT_ANY_THROW({
+        try {
+            uzuki2::binary::validate_buffer(contents.data(), std::min(len, contents.size()), num_external, uzuki2::binary::Options());
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr(msg));
+            throw;
+        }
+    });
+}
+
+TEST(BinaryTest, Errors) {
+    auto parsed = parse_columnar("{ \"type\": \"list\", \"values\": [ { \"type\": \"factor\", \"values\": [ 1, 0 ], \"levels\": [ \"A\", \"B\" ] } ] }");
+    auto contents = write_to_buffer(parsed.get());
+    uzuki2::binary::validate_buffer(contents.data(), contents.size(), 0, uzuki2::binary::Options());
+
+    expect_binary_error(contents, "too small", 0, 10);
+    expect_binary_error(contents, "does not match", 0, contents.size() - 8);
+    expect_binary_error(contents, "fewer instances", 1);
+
+    auto copy = contents;
+    copy[0] = 'X';
+    expect_binary_error(copy, "signature");
+
+    // The factor is the second node.
+    auto factor = uzuki2::binary::header_size + uzuki2::binary::node_size;
+    copy = contents;
+    copy[factor + uzuki2::binary::NODE_TYPE] = 20;
+    expect_binary_error(copy, "unknown object type");
+
+    copy = contents;
+    copy[factor + uzuki2::binary::NODE_FLAGS] = uzuki2::binary::FLAG_SCALAR;
+    expect_binary_error(copy, "length 1");
+
+    copy = contents;
+    copy[uzuki2::binary::HEADER_RESERVED + 3] = 1;
+    expect_binary_error(copy, "header should be zero");
+
+    copy = contents;
+    copy[factor + uzuki2::binary::NODE_RESERVED + 2] = 1;
+    expect_binary_error(copy, "node should be zero");
+
+    copy = contents;
+    copy[factor + uzuki2::binary::NODE_RESERVED_TAIL] = 1;
+    expect_binary_error(copy, "node should be zero");
+
+    copy = contents;
+    auto values = uzuki2::binary::load_le<uint64_t>(copy.data() + factor + uzuki2::binary::NODE_VALUES);
+    copy[values] = 5;
+    expect_binary_error(copy, "out of range");
+
+    copy = contents;
+    uzuki2::binary::store_le<uint64_t>(copy.data() + factor + uzuki2::binary::NODE_VALUES, contents.size());
+    expect_binary_error(copy, "past the end");
+
+    copy = contents;
+    auto levels = uzuki2::binary::load_le<uint64_t>(copy.data() + factor + uzuki2::binary::NODE_LEVELS);
+    copy[levels + 3 * sizeof(uint64_t) + 1] = 'A';
+    expect_binary_error(copy, "duplicate string");
+
+    // The root should be a list.
+    std::string vjson = "{ \"type\": \"integer\", \"values\": [ 1 ] }";
+    uzuki2::json::Options jopt;
+    jopt.strict_list = false;
+    auto vector = uzuki2::json::parse_buffer<uzuki2::ColumnarProvisioner>(reinterpret_cast<const unsigned char*>(vjson.c_str()), vjson.size(), DefaultExternals(0), jopt);
+    auto vcontents = write_to_buffer(vector.get());
+    expect_binary_error(vcontents, "top-level object");
+
+    // Only columnar objects can be written.
+    auto other = load_json("{ \"type\": \"list\", \"values\": [] }");
+    EXPECT_ANY_THROW({
+        try {
+            write_to_buffer(other.get());
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("ColumnarProvisioner"));
+            throw;
+        }
+    });
+}
@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki2/parse_hdf5.hpp"
+#include "uzuki2/parse_json.hpp"
+#include "uzuki2/Columnar.hpp"
+
+#include "utils.h"
+
+#include <cmath>
+
+static void check_columnar_contents(const uzuki2::ParsedList& parsed) {
+    ASSERT_EQ(parsed->type(), uzuki2::LIST);
+    auto lptr = static_cast<const uzuki2::ColumnarList*>(parsed.get());
+    ASSERT_EQ(lptr->size(), 6);
+    EXPECT_TRUE(lptr->has_names());
+    EXPECT_EQ(lptr->names().get(0), "ints");
+    EXPECT_EQ(lptr->names().get(5), "nothing");
+
+    auto iptr = static_cast<const uzuki2::ColumnarIntegerVector*>(lptr->values()[0]);
+    EXPECT_EQ(iptr->size(), 4);
+    EXPECT_EQ(iptr->values()[0], 1);
+    EXPECT_EQ(iptr->values()[3], 4);
+    EXPECT_FALSE(iptr->validity().is_missing(0));
+    EXPECT_TRUE(iptr->validity().is_missing(2));
+    EXPECT_EQ(iptr->validity().null_count(), 1);
+    EXPECT_TRUE(iptr->has_names());
+    EXPECT_EQ(iptr->names().get(1), "b");
+
+    auto dptr = static_cast<const uzuki2::ColumnarNumberVector*>(lptr->values()[1]);
+    EXPECT_TRUE(dptr->is_scalar());
+    EXPECT_EQ(dptr->values()[0], 2.5);
+    EXPECT_EQ(dptr->validity().bitmap(), nullptr);
+
+    auto bptr = static_cast<const uzuki2::ColumnarBooleanVector*>(lptr->values()[2]);
+    EXPECT_EQ(bptr->size(), 3);
+    EXPECT_TRUE(bptr->get(0));
+    EXPECT_FALSE(bptr->get(1));
+    EXPECT_TRUE(bptr->validity().is_missing(2));
+
+    auto sptr = static_cast<const uzuki2::ColumnarStringVector*>(lptr->values()[3]);
+    EXPECT_EQ(sptr->values().get(0), "foo");
+    EXPECT_TRUE(sptr->validity().is_missing(1));
+    EXPECT_EQ(sptr->values().get(2), "whee");
+
+    auto fptr = static_cast<const uzuki2::ColumnarFactor*>(lptr->values()[4]);
+    EXPECT_EQ(fptr->codes()[0], 1);
+    EXPECT_EQ(fptr->codes()[1], 0);
+    EXPECT_EQ(fptr->levels().size(), 2);
+    EXPECT_EQ(fptr->levels().get(1), "B");
+    EXPECT_FALSE(fptr->is_ordered());
+
+    EXPECT_EQ(lptr->values()[5]->type(), uzuki2::NOTHING);
+}
+
+TEST(ColumnarTest, Hdf5) {
+    auto path = "TEST-columnar.h5";
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        auto ghandle = list_opener(handle, "foo");
+        create_dataset(ghandle, "names", { "ints", "number", "bools", "strings", "factor", "nothing" });
+        auto dhandle = ghandle.createGroup("data");
+
+        auto ihandle = vector_opener(dhandle, "0", "integer");
+        create_dataset<int>(ihandle, "data", { 1, 2, -2147483648, 4 }, H5::PredType::NATIVE_INT);
+        create_dataset(ihandle, "names", { "a", "b", "c", "d" });
+
+        auto nhandle = vector_opener(dhandle, "1", "number");
+        write_scalar(nhandle, "data", 2.5, H5::PredType::NATIVE_DOUBLE);
+
+        auto bhandle = vector_opener(dhandle, "2", "boolean");
+        create_dataset<int>(bhandle, "data", { 1, 0, -2147483648 }, H5::PredType::NATIVE_INT);
+
+        auto shandle = vector_opener(dhandle, "3", "string");
+        auto sdhandle = create_dataset(shandle, "data", { "foo", "NA", "whee" });
+        H5::StrType stype(0, H5T_VARIABLE);
+        auto ahandle = sdhandle.createAttribute("missing-value-placeholder", stype, H5S_SCALAR);
+        ahandle.write(stype, std::string("NA"));
+
+        auto fhandle = vector_opener(dhandle, "4", "factor");
+        create_dataset<int>(fhandle, "data", { 1, 0 }, H5::PredType::NATIVE_INT);
+        create_dataset(fhandle, "levels", { "A", "B" });
+
+        nothing_opener(dhandle, "5");
+    }
+
+    auto parsed = uzuki2::hdf5::parse<uzuki2::ColumnarProvisioner>(path, "foo", uzuki2::DummyExternals(0), uzuki2::hdf5::Options());
+    check_columnar_contents(parsed);
+}
+
+TEST(ColumnarTest, Json) {
+    std::string contents = "{ \"type\": \"list\", \"values\": ["
+        "{ \"type\": \"integer\", \"values\": [ 1, 2, null, 4 ], \"names\": [ \"a\", \"b\", \"c\", \"d\" ] },"
+        "{ \"type\": \"number\", \"values\": 2.5 },"
+        "{ \"type\": \"boolean\", \"values\": [ true, false, null ] },"
+        "{ \"type\": \"string\", \"values\": [ \"foo\", null, \"whee\" ] },"
+        "{ \"type\": \"factor\", \"values\": [ 1, 0 ], \"levels\": [ \"A\", \"B\" ] },"
+        "{ \"type\": \"nothing\" }"
+        "], \"names\": [ \"ints\", \"number\", \"bools\", \"strings\", \"factor\", \"nothing\" ] }";
+    auto parsed = uzuki2::json::parse_buffer<uzuki2::ColumnarProvisioner>(reinterpret_cast<const unsigned char*>(contents.c_str()), contents.size(), uzuki2::DummyExternals(0), uzuki2::json::Options());
+    check_columnar_contents(parsed);
+}
+
+TEST(ColumnarTest, Storage) {
+    uzuki2::ColumnBuffer<double> scalar(1);
+    scalar.data()[0] = 5;
+    EXPECT_EQ(scalar.size(), 1);
+    EXPECT_EQ(scalar.data()[0], 5);
+
+    uzuki2::ColumnValidity validity(20);
+    EXPECT_EQ(validity.bitmap(), nullptr);
+    std::vector<uint8_t> bitmap { 0x81, 0x00, 0x02 };
+    validity.set_missing_block(2, bitmap.data(), 18);
+    EXPECT_EQ(validity.null_count(), 3);
+    EXPECT_TRUE(validity.is_missing(2));
+    EXPECT_TRUE(validity.is_missing(9));
+    EXPECT_TRUE(validity.is_missing(19));
+    EXPECT_FALSE(validity.is_missing(3));
+    validity.set_missing(2);
+    EXPECT_EQ(validity.null_count(), 3);
+
+    uzuki2::StringColumn strings(3);
+    std::string concatenated = "abcdef";
+    std::vector<size_t> offsets { 0, 2, 2, 6 };
+    strings.set_block(0, concatenated.data(), offsets.data(), 3);
+    EXPECT_EQ(strings.get(0), "ab");
+    EXPECT_EQ(strings.get(1), "");
+    EXPECT_EQ(strings.get(2), "cdef");
+    strings.set(1, "xyz", 3);
+    EXPECT_EQ(strings.get(1), "xyz");
+    EXPECT_EQ(strings.chars_size(), 9);
+
+    std::string levels = "foobar";
+    std::vector<size_t> level_offsets { 0, 3, 6 };
+    std::vector<int32_t> codes { 1, -1, 1 };
+    strings.set_dictionary(levels.data(), level_offsets.data(), 2, codes.data());
+    EXPECT_EQ(strings.get(0), "bar");
+    EXPECT_EQ(strings.get(1), "xyz");
+    EXPECT_EQ(strings.get(2), "bar");
+    EXPECT_EQ(strings.get(0).data(), strings.get(2).data());
+}
+
+TEST(ColumnarTest, Interning) {
+    std::string contents = "{ \"type\": \"list\", \"values\": ["
+        "{ \"type\": \"list\", \"values\": [ { \"type\": \"number\", \"values\": 1 }, { \"type\": \"number\", \"values\": 2 } ], \"names\": [ \"mean\", \"sd\" ] },"
+        "{ \"type\": \"list\", \"values\": [ { \"type\": \"number\", \"values\": 3 }, { \"type\": \"number\", \"values\": 4 } ], \"names\": [ \"mean\", \"sd\" ] },"
+        "{ \"type\": \"factor\", \"values\": [ 0, 1 ], \"levels\": [ \"sd\", \"mean\" ], \"names\": [ \"mean\", \"x\" ] }"
+        "] }";
+    auto parsed = uzuki2::json::parse_buffer<uzuki2::ColumnarProvisioner>(reinterpret_cast<const unsigned char*>(contents.c_str()), contents.size(), uzuki2::DummyExternals(0), uzuki2::json::Options());
+    auto lptr = static_cast<const uzuki2::ColumnarList*>(parsed.get());
+
+    auto first = static_cast<const uzuki2::ColumnarList*>(lptr->values()[0]);
+    auto second = static_cast<const uzuki2::ColumnarList*>(lptr->values()[1]);
+    EXPECT_EQ(first->names().get(0), "mean");
+    EXPECT_EQ(first->names().get(0).data(), second->names().get(0).data());
+    EXPECT_EQ(first->names().get(1).data(), second->names().get(1).data());
+
+    auto fptr = static_cast<const uzuki2::ColumnarFactor*>(lptr->values()[2]);
+    EXPECT_EQ(fptr->levels().get(0), "sd");
+    EXPECT_EQ(fptr->levels().get(0).data(), first->names().get(1).data());
+    EXPECT_EQ(fptr->levels().get(1).data(), first->names().get(0).data());
+    EXPECT_EQ(fptr->names().get(0), "mean"); // names of vector elements are not interned.
+    EXPECT_EQ(fptr->names().get(1), "x");
+
+    uzuki2::Arena arena;
+    auto x = arena.intern(std::string("foo"));
+    EXPECT_EQ(arena.intern("foo").data(), x.data());
+    EXPECT_NE(arena.intern("bar").data(), x.data());
+    EXPECT_EQ(arena.num_interned(), 2);
+}
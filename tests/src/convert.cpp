@@ -0,0 +1,329 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki2/convert.hpp"
+
+#include "test_subclass.h"
+#include "utils.h"
+
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+static void dump_json(const std::string& path, const std::string& contents) {
+    std::ofstream handle(path);
+    handle << contents;
+}
+
+static void check_converted(const uzuki2::Base* ptr) {
+    auto lptr = static_cast<const DefaultList*>(ptr);
+    ASSERT_EQ(lptr->size(), 7);
+    EXPECT_EQ(lptr->names, std::vector<std::string>({ "ints", "nums", "strs", "fac", "bools", "scalar", "nested" }));
+
+    auto iptr = static_cast<const DefaultIntegerVector*>(lptr->values[0].get());
+    EXPECT_EQ(iptr->base.values, std::vector<int32_t>({ 1, -123456789, -3, 4, 5 }));
+    EXPECT_EQ(iptr->base.names, std::vector<std::string>({ "a", "b", "c", "d", "e" }));
+
+    auto dptr = static_cast<const DefaultNumberVector*>(lptr->values[1].get());
+    ASSERT_EQ(dptr->base.values.size(), 4);
+    EXPECT_EQ(dptr->base.values[0], 0.1);
+    EXPECT_EQ(dptr->base.values[1], -123456789);
+    EXPECT_EQ(dptr->base.values[2], std::numeric_limits<double>::infinity());
+    EXPECT_TRUE(std::isnan(dptr->base.values[3]));
+
+    auto sptr = static_cast<const DefaultStringVector*>(lptr->values[2].get());
+    EXPECT_EQ(sptr->format, uzuki2::StringVector::DATE);
+    EXPECT_EQ(sptr->base.values, std::vector<std::string>({ "2020-01-01", "ich bin missing", "2021-12-31" }));
+
+    auto fptr = static_cast<const DefaultFactor*>(lptr->values[3].get());
+    EXPECT_EQ(fptr->vbase.values, std::vector<size_t>({ 2, 0, static_cast<size_t>(-1), 1 }));
+    EXPECT_EQ(fptr->levels, std::vector<std::string>({ "x", "y", "z" }));
+    EXPECT_TRUE(fptr->ordered);
+    EXPECT_EQ(fptr->vbase.names, std::vector<std::string>({ "A", "B", "C", "D" }));
+
+    auto bptr = static_cast<const DefaultBooleanVector*>(lptr->values[4].get());
+    EXPECT_EQ(bptr->base.values, std::vector<uint8_t>({ 1, 0, 255 }));
+
+    auto scalar = static_cast<const DefaultStringVector*>(lptr->values[5].get());
+    EXPECT_TRUE(scalar->base.scalar);
+    EXPECT_EQ(scalar->base.values, std::vector<std::string>({ "quote\"\u00e9" }));
+
+    auto nested = static_cast<const DefaultList*>(lptr->values[6].get());
+    ASSERT_EQ(nested->size(), 3);
+    EXPECT_EQ(nested->values[0]->type(), uzuki2::NOTHING);
+    EXPECT_EQ(static_cast<const DefaultExternal*>(nested->values[1].get())->ptr, reinterpret_cast<void*>(2));
+    EXPECT_EQ(static_cast<const DefaultExternal*>(nested->values[2].get())->ptr, reinterpret_cast<void*>(1));
+}
+
+TEST(ConvertTest, RoundTrip) {
+    // Names and levels are deliberately placed after the values.
+    std::string json_path = "TEST-convert.json";
+    dump_json(json_path, "{ \"type\": \"list\", \"values\": [\n"
+        "  { \"values\": [ 1, null, -3, 4, 5 ], \"type\": \"integer\", \"names\": [ \"a\", \"b\", \"c\", \"d\", \"e\" ] },\n"
+        "  { \"type\": \"number\", \"values\": [ 0.1, null, \"Inf\", \"NaN\" ] },\n"
+        "  { \"type\": \"string\", \"format\": \"date\", \"values\": [ \"2020-01-01\", null, \"2021-12-31\" ] },\n"
+        "  { \"type\": \"factor\", \"values\": [ 2, 0, null, 1 ], \"names\": [ \"A\", \"B\", \"C\", \"D\" ], \"levels\": [ \"x\", \"y\", \"z\" ], \"ordered\": true },\n"
+        "  { \"type\": \"boolean\", \"values\": [ true, false, null ] },\n"
+        "  { \"type\": \"string\", \"values\": \"quote\\\"\\u00e9\" },\n"
+        "  { \"type\": \"list\", \"values\": [ { \"type\": \"nothing\" }, { \"index\": 1, \"type\": \"external\" }, { \"type\": \"external\", \"index\": 0 } ] }\n"
+        "], \"names\": [ \"ints\", \"nums\", \"strs\", \"fac\", \"bools\", \"scalar\", \"nested\" ], \"version\": \"1.2\" }"
+    );
+
+    uzuki2::ConvertOptions opt;
+    opt.buffer_size = 2; // forces multiple blocks per vector.
+    opt.hdf5_options.chunk_size = 2;
+
+    std::string hdf5_path = "TEST-convert.h5";
+    uzuki2::json_to_hdf5(json_path, hdf5_path, "foo", opt);
+    auto parsed = uzuki2::hdf5::parse<DefaultProvisioner>(hdf5_path, "foo", DefaultExternals(2), uzuki2::hdf5::Options());
+    check_converted(parsed.get());
+
+    std::string back_path = "TEST-convert-back.json.gz";
+    opt.json_options.gzip = true;
+    uzuki2::hdf5_to_json(hdf5_path, "foo", back_path, opt);
+    auto reparsed = uzuki2::json::parse_file<DefaultProvisioner>(back_path, DefaultExternals(2), uzuki2::json::Options());
+    check_converted(reparsed.get());
+}
+
+TEST(ConvertTest, Writers) {
+    // Same fixture as the writers, for consistency with their output.
+    std::string json_path = "TEST-convert.json";
+    dump_json(json_path, round_trip_json());
+
+    // The first pass is used to choose placeholders that avoid the literal "NA" string.
+    uzuki2::ConvertOptions opt;
+    std::string hdf5_path = "TEST-convert.h5";
+    uzuki2::json_to_hdf5(json_path, hdf5_path, "foo", opt);
+    auto parsed = uzuki2::hdf5::parse<DefaultProvisioner>(hdf5_path, "foo", DefaultExternals(1), uzuki2::hdf5::Options());
+    check_round_trip(parsed.get());
+
+    {
+        H5::H5File handle(hdf5_path, H5F_ACC_RDONLY);
+        auto shandle = handle.openDataSet("foo/data/3/data");
+        EXPECT_EQ(ritsuko::hdf5::open_and_load_scalar_string_attribute(shandle, "missing-value-placeholder"), "NA_");
+    }
+
+    std::string back_path = "TEST-convert-back.json";
+    uzuki2::hdf5_to_json(hdf5_path, "foo", back_path, opt);
+    auto reparsed = uzuki2::json::parse_file<DefaultProvisioner>(back_path, DefaultExternals(1), uzuki2::json::Options());
+    check_round_trip(reparsed.get());
+}
+
+TEST(ConvertTest, Placeholders) {
+    std::string json_path = "TEST-convert.json";
+    dump_json(json_path, "{ \"version\": \"1.1\", \"type\": \"list\", \"values\": ["
+        "{ \"type\": \"integer\", \"values\": [ -2147483648, null, 2147483647 ] },"
+        "{ \"type\": \"number\", \"values\": [ \"NaN\", null, \"-Inf\" ] },"
+        "{ \"type\": \"string\", \"values\": [ \"NA\", null, \"NA_\" ] }"
+        "] }");
+
+    std::string hdf5_path = "TEST-convert.h5";
+    uzuki2::json_to_hdf5(json_path, hdf5_path, "foo");
+    auto parsed = uzuki2::hdf5::parse<DefaultProvisioner>(hdf5_path, "foo", DefaultExternals(0), uzuki2::hdf5::Options());
+    auto lptr = static_cast<const DefaultList*>(parsed.get());
+    ASSERT_EQ(lptr->size(), 3);
+
+    auto iptr = static_cast<const DefaultIntegerVector*>(lptr->values[0].get());
+    EXPECT_EQ(iptr->base.values, std::vector<int32_t>({ std::numeric_limits<int32_t>::min(), -123456789, std::numeric_limits<int32_t>::max() }));
+
+    auto dptr = static_cast<const DefaultNumberVector*>(lptr->values[1].get());
+    ASSERT_EQ(dptr->base.values.size(), 3);
+    EXPECT_TRUE(std::isnan(dptr->base.values[0]));
+    EXPECT_EQ(dptr->base.values[1], -123456789);
+    EXPECT_EQ(dptr->base.values[2], -std::numeric_limits<double>::infinity());
+
+    auto sptr = static_cast<const DefaultStringVector*>(lptr->values[2].get());
+    EXPECT_EQ(sptr->base.values, std::vector<std::string>({ "NA", "ich bin missing", "NA_" }));
+
+    H5::H5File handle(hdf5_path, H5F_ACC_RDONLY);
+    int32_t iplaceholder;
+    handle.openDataSet("foo/data/0/data").openAttribute("missing-value-placeholder").read(H5::PredType::NATIVE_INT32, &iplaceholder);
+    EXPECT_EQ(iplaceholder, -2147483647);
+    double dplaceholder;
+    handle.openDataSet("foo/data/1/data").openAttribute("missing-value-placeholder").read(H5::PredType::NATIVE_DOUBLE, &dplaceholder);
+    EXPECT_EQ(dplaceholder, std::numeric_limits<double>::lowest());
+    EXPECT_EQ(ritsuko::hdf5::open_and_load_scalar_string_attribute(handle.openDataSet("foo/data/2/data"), "missing-value-placeholder"), "NA__");
+}
+
+TEST(ConvertTest, OldVersions) {
+    // Version 1.0 has dedicated types for dates and ordered factors, and uses -2^31 as the integer missing value.
+    std::string json_path = "TEST-convert.json";
+    dump_json(json_path, "{ \"type\": \"list\", \"values\": ["
+        "{ \"type\": \"integer\", \"values\": [ -2147483648, 2 ] },"
+        "{ \"type\": \"date\", \"values\": [ \"2020-01-01\" ] },"
+        "{ \"type\": \"ordered\", \"values\": [ 0 ], \"levels\": [ \"A\" ] }"
+        "] }"
+    );
+
+    std::string hdf5_path = "TEST-convert.h5";
+    uzuki2::json_to_hdf5(json_path, hdf5_path, "foo");
+    auto parsed = uzuki2::hdf5::parse<DefaultProvisioner>(hdf5_path, "foo", DefaultExternals(0), uzuki2::hdf5::Options());
+    auto lptr = static_cast<const DefaultList*>(parsed.get());
+    ASSERT_EQ(lptr->size(), 3);
+    EXPECT_EQ(static_cast<const DefaultIntegerVector*>(lptr->values[0].get())->base.values, std::vector<int32_t>({ -123456789, 2 }));
+    EXPECT_EQ(static_cast<const DefaultStringVector*>(lptr->values[1].get())->format, uzuki2::StringVector::DATE);
+    EXPECT_TRUE(static_cast<const DefaultFactor*>(lptr->values[2].get())->ordered);
+}
+
+TEST(ConvertTest, Spill) {
+    // Names before and after the values, and objects nested in the values of a non-list, which should not shift the metadata of later objects.
+    std::string json_path = "TEST-convert.json";
+    dump_json(json_path, "{ \"type\": \"list\", \"names\": [ \"first\", \"second\", \"third\" ], \"values\": ["
+        "{ \"type\": \"nothing\", \"values\": [ { \"type\": \"integer\", \"values\": [ 1 ] } ] },"
+        "{ \"type\": \"list\", \"values\": [ { \"type\": \"factor\", \"values\": [ 1 ], \"levels\": [ \"lo\", \"hi\" ] } ], \"names\": [ \"inner\" ] },"
+        "{ \"type\": \"string\", \"values\": [ \"x\" ] }"
+        "] }"
+    );
+
+    // Zero forces all metadata into the temporary file.
+    uzuki2::ConvertOptions opt;
+    opt.buffer_size = 1;
+    opt.spill_limit = 0;
+    std::string hdf5_path = "TEST-convert.h5";
+    uzuki2::json_to_hdf5(json_path, hdf5_path, "foo", opt);
+
+    auto parsed = uzuki2::hdf5::parse<DefaultProvisioner>(hdf5_path, "foo", DefaultExternals(0), uzuki2::hdf5::Options());
+    auto lptr = static_cast<const DefaultList*>(parsed.get());
+    EXPECT_EQ(lptr->names, std::vector<std::string>({ "first", "second", "third" }));
+    EXPECT_EQ(lptr->values[0]->type(), uzuki2::NOTHING);
+
+    auto nested = static_cast<const DefaultList*>(lptr->values[1].get());
+    EXPECT_EQ(nested->names, std::vector<std::string>({ "inner" }));
+    auto fptr = static_cast<const DefaultFactor*>(nested->values[0].get());
+    EXPECT_EQ(fptr->levels, std::vector<std::string>({ "lo", "hi" }));
+    EXPECT_EQ(fptr->vbase.values, std::vector<size_t>({ 1 }));
+
+    auto sptr = static_cast<const DefaultStringVector*>(lptr->values[2].get());
+    EXPECT_EQ(sptr->base.values, std::vector<std::string>({ "x" }));
+
+    // Many objects, so that the records are moved to the temporary file partway through the first pass.
+    std::string many = "{ \"type\": \"list\", \"values\": [";
+    for (int i = 0; i < 200; ++i) {
+        many += (i ? ", " : " ");
+        many += "{ \"values\": [ " + std::to_string(i) + " ], \"type\": \"integer\" }";
+    }
+    many += " ] }";
+    dump_json(json_path, many);
+
+    opt.buffer_size = 100;
+    opt.spill_limit = 1000;
+    uzuki2::json_to_hdf5(json_path, hdf5_path, "foo", opt);
+    auto mparsed = uzuki2::hdf5::parse<DefaultProvisioner>(hdf5_path, "foo", DefaultExternals(0), uzuki2::hdf5::Options());
+    auto mptr = static_cast<const DefaultList*>(mparsed.get());
+    ASSERT_EQ(mptr->size(), 200);
+    for (int i = 0; i < 200; ++i) {
+        EXPECT_EQ(static_cast<const DefaultIntegerVector*>(mptr->values[i].get())->base.values, std::vector<int32_t>({ i }));
+    }
+}
+
+static void expect_convert_error(const std::string& contents, const std::string& msg) {
+    std::string json_path = "TEST-convert.json";
+    dump_json(json_path, contents);
+    EXPECT_ANY_THROW({
+        try {
+            uzuki2::json_to_hdf5(json_path, "TEST-convert.h5", "foo");
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr(msg));
+            throw;
+        }
+    });
+}
+
+TEST(ConvertTest, Errors) {
+    expect_convert_error("{ \"type\": \"integer\", \"values\": [ 1.5 ] }", "expected an integer");
+    expect_convert_error("{ \"type\": \"factor\", \"values\": [ 1 ] }", "expected 'levels'");
+    expect_convert_error("{ \"type\": \"factor\", \"values\": [ 1 ], \"levels\": [ \"A\" ] }", "less than the number of levels");
+    expect_convert_error("{ \"type\": \"string\", \"values\": [ \"foo\" ], \"format\": \"date\", \"version\": \"1.1\" }", "YYYY-MM-DD");
+    expect_convert_error("{ \"type\": \"list\", \"values\": [ { \"type\": \"nothing\" } ], \"names\": [] }", "should be the same");
+    expect_convert_error("{ \"type\": \"integer\", \"values\": [ 1 ], \"names\": [] }", "number of names");
+    expect_convert_error("{ \"type\": \"list\", \"values\": [ ", "end of the JSON document");
+    expect_convert_error("{ \"type\": \"list\", \"values\": [ 1 ] }", "JSON object at '.values[0]'");
+    expect_convert_error("{ \"type\": \"list\", \"values\": [ { \"type\": \"nothing\" }, \"foo\" ] }", "JSON object at '.values[1]'");
+
+    // Same messages as in the JSON parser, including the location of the offending value.
+    expect_convert_error("{ \"type\": \"list\", \"values\": [ { \"type\": \"integer\", \"values\": [ 1, 3000000000 ] } ] }", "value at '.values[0].values[1]' cannot be represented");
+    expect_convert_error("{ \"type\": \"number\", \"values\": [ \"foo\" ] }", "unsupported string 'foo' at '.values[0]'");
+    expect_convert_error("{ \"type\": \"string\", \"values\": [ \"foo\" ], \"format\": \"bar\", \"version\": \"1.2\" }", "unsupported format 'bar' at '.format'");
+}
+
+TEST(ConvertTest, Malformed) {
+    // The converter should reject the same documents as the JSON parser.
+    std::vector<std::pair<std::string, std::string> > cases {
+        { "{ \"type\": \"string\", \"values\": [ \"\\ud800\\u0041\" ] }", "unpaired surrogate" },
+        { "{ \"type\": \"string\", \"values\": [ \"\\udc00\" ] }", "unpaired surrogate" },
+        { "{ \"type\": \"string\", \"values\": [ \"\\ud800\" ] }", "unpaired surrogate" },
+        { "{ \"type\": \"nothing\" } []", "trailing non-space" },
+        { "{ \"type\": \"nothing\" } }", "trailing non-space" },
+        { "{ \"type\": \"number\", \"values\": [ 007 ] }", "invalid number" },
+        { "{ \"type\": \"number\", \"values\": [ +1 ] }", "" },
+        { "{ \"type\": \"number\", \"values\": [ 1. ] }", "invalid number" },
+        { "{ \"type\": \"number\", \"values\": [ .5 ] }", "" },
+        { "{ \"type\": \"number\", \"values\": [ 1e ] }", "invalid number" },
+        { "{ \"type\": \"number\", \"values\": [ -- 1 ] }", "invalid number" },
+        { "{ \"type\": \"external\", \"index\": 00 }", "invalid number" }
+    };
+    for (const auto& c : cases) {
+        expect_json_error(c.first, "");
+        expect_convert_error(c.first, c.second);
+    }
+
+    // Raw control characters must be escaped inside strings.
+    expect_convert_error("{ \"type\": \"string\", \"values\": [ \"foo\nbar\" ] }", "unescaped control character");
+    expect_convert_error("{ \"type\": \"string\", \"values\": [ \"foo\tbar\" ] }", "unescaped control character");
+
+    // Surrogate pairs are still accepted.
+    std::string json_path = "TEST-convert.json";
+    dump_json(json_path, "{ \"type\": \"list\", \"values\": [ { \"type\": \"string\", \"values\": [ \"\\ud83d\\ude00\" ] } ] }  \n");
+    uzuki2::json_to_hdf5(json_path, "TEST-convert.h5", "foo");
+    auto parsed = uzuki2::hdf5::parse<DefaultProvisioner>("TEST-convert.h5", "foo", DefaultExternals(0), uzuki2::hdf5::Options());
+    auto sptr = static_cast<const DefaultStringVector*>(static_cast<const DefaultList*>(parsed.get())->values[0].get());
+    EXPECT_EQ(sptr->base.values, std::vector<std::string>({ "\xF0\x9F\x98\x80" }));
+}
+
+TEST(ConvertTest, Base64) {
+    std::string json_path = "TEST-convert.json";
+    dump_json(json_path, "{ \"version\": \"1.3\", \"type\": \"list\", \"values\": ["
+        "{ \"values\": \"AAAAAAAA8D8AAAAAAAAEwAAAAAAAAAAA\", \"missing\": [ 2 ], \"type\": \"number\", \"encoding\": \"base64\" }"
+        "] }"
+    );
+
+    uzuki2::ConvertOptions opt;
+    opt.buffer_size = 2;
+    std::string hdf5_path = "TEST-convert.h5";
+    uzuki2::json_to_hdf5(json_path, hdf5_path, "foo", opt);
+    auto parsed = uzuki2::hdf5::parse<DefaultProvisioner>(hdf5_path, "foo", DefaultExternals(0), uzuki2::hdf5::Options());
+    auto lptr = static_cast<const DefaultList*>(parsed.get());
+    ASSERT_EQ(lptr->size(), 1);
+    auto dptr = static_cast<const DefaultNumberVector*>(lptr->values[0].get());
+    EXPECT_FALSE(dptr->base.scalar);
+    EXPECT_EQ(dptr->base.values, std::vector<double>({ 1.0, -2.5, -123456789 }));
+
+    // Long strings are decoded in pieces of 32 characters with this buffer size, with unsorted missing indices.
+    dump_json(json_path, "{ \"version\": \"1.3\", \"type\": \"list\", \"values\": ["
+        "{ \"type\": \"number\", \"encoding\": \"base64\", \"missing\": [ 6, 0, 4 ], \"values\": \"AAAAAAAA+D8AAAAAAAAAQAAAAAAAAAhAAAAAAAAAEEAAAAAAAAAUQAAAAAAAABhAAAAAAAAAHEA=\" }"
+        "] }"
+    );
+    uzuki2::json_to_hdf5(json_path, hdf5_path, "foo", opt);
+    auto pieced = uzuki2::hdf5::parse<DefaultProvisioner>(hdf5_path, "foo", DefaultExternals(0), uzuki2::hdf5::Options());
+    auto pptr = static_cast<const DefaultNumberVector*>(static_cast<const DefaultList*>(pieced.get())->values[0].get());
+    EXPECT_EQ(pptr->base.values, std::vector<double>({ -123456789, 2, 3, 4, -123456789, 6, -123456789 }));
+
+    expect_convert_error("{ \"version\": \"1.3\", \"type\": \"number\", \"encoding\": \"base64\", \"values\": \"AAAAAAAA8D8=\", \"missing\": [ 1 ] }", "missing[0]");
+    expect_convert_error("{ \"version\": \"1.3\", \"type\": \"number\", \"encoding\": \"base64\", \"values\": \"AAAAAAAA8D8=\", \"missing\": [ 0, 0 ] }", "duplicate index at '.missing[1]'");
+    expect_convert_error("{ \"version\": \"1.3\", \"type\": \"number\", \"encoding\": \"base64\", \"values\": \"AAAAAAAA8D\" }", "multiple of 4");
+
+    // Padding at the end of a piece is still detected when more characters follow.
+    dump_json(json_path, "{ \"version\": \"1.3\", \"type\": \"number\", \"encoding\": \"base64\", \"values\": \"" + std::string(31, 'A') + "=" + std::string(32, 'A') + "\" }");
+    EXPECT_ANY_THROW({
+        try {
+            uzuki2::json_to_hdf5(json_path, hdf5_path, "foo", opt);
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("invalid character"));
+            throw;
+        }
+    });
+    expect_convert_error("{ \"version\": \"1.3\", \"type\": \"number\", \"encoding\": \"base64\", \"values\": \"AAAAAA!A8D8=\" }", "invalid character");
+    expect_convert_error("{ \"version\": \"1.3\", \"type\": \"number\", \"encoding\": \"base64\", \"values\": \"AAAAAAAA8D9=\" }", "padding bits");
+}
@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki2/parse_hdf5.hpp"
+#include "uzuki2/parse_hdf5_subset.hpp"
+#include "uzuki2/parse_hdf5_lazy.hpp"
+#include "uzuki2/parse_json.hpp"
+
+#include "test_subclass.h"
+#include "utils.h"
+
+static std::string deduplicate_json() {
+    std::string block = "{ \"type\": \"list\", \"values\": [ "
+        "{ \"type\": \"integer\", \"values\": [ 1, null, 3 ] }, "
+        "{ \"type\": \"string\", \"values\": [ \"a\", \"b\", \"a\" ] }, "
+        "{ \"type\": \"factor\", \"values\": [ 0, 1 ], \"levels\": [ \"x\", \"y\" ] } "
+    "], \"names\": [ \"i\", \"s\", ";
+
+    return "{ \"type\": \"list\", \"values\": [ " +
+        block + "\"f\" ] }, " +
+        block + "\"f\" ] }, " +
+        block + "\"g\" ] }, " +
+        "{ \"type\": \"number\", \"values\": [ 1.5, null ] }, "
+        "{ \"type\": \"number\", \"values\": [ 1.5, null ] }, "
+        "{ \"type\": \"number\", \"values\": [ 1.5, 2.5 ] }, "
+        "{ \"type\": \"nothing\" }, "
+        "{ \"type\": \"nothing\" } "
+    "] }";
+}
+
+TEST(DeduplicateTest, Json) {
+    auto contents = deduplicate_json();
+    uzuki2::json::Options opt;
+    opt.deduplicate = true;
+    opt.max_dictionary_levels = 5;
+    auto parsed = uzuki2::json::parse_buffer<DefaultProvisioner>(reinterpret_cast<const unsigned char*>(contents.c_str()), contents.size(), uzuki2::DummyExternals(0), opt);
+
+    auto lptr = static_cast<const DefaultList*>(parsed.get());
+    ASSERT_EQ(lptr->size(), 8);
+
+    // Identical sub-lists are the same object.
+    EXPECT_EQ(lptr->values[0], lptr->values[1]);
+    EXPECT_NE(lptr->values[0], lptr->values[2]);
+    auto first = static_cast<const DefaultList*>(lptr->values[0].get());
+    auto third = static_cast<const DefaultList*>(lptr->values[2].get());
+    EXPECT_EQ(first->names, std::vector<std::string>({ "i", "s", "f" }));
+    EXPECT_EQ(third->names, std::vector<std::string>({ "i", "s", "g" }));
+
+    // Only the names differ, so the children are still shared.
+    for (size_t i = 0; i < 3; ++i) {
+        EXPECT_EQ(first->values[i], third->values[i]);
+    }
+
+    // Contents are correctly replayed into the provisioned objects.
+    auto iptr = static_cast<const DefaultIntegerVector*>(first->values[0].get());
+    EXPECT_EQ(iptr->base.values, std::vector<int32_t>({ 1, -123456789, 3 }));
+    auto sptr = static_cast<const DefaultStringVector*>(first->values[1].get());
+    EXPECT_EQ(sptr->base.values, std::vector<std::string>({ "a", "b", "a" }));
+    auto fptr = static_cast<const DefaultFactor*>(first->values[2].get());
+    EXPECT_EQ(fptr->vbase.values, std::vector<size_t>({ 0, 1 }));
+    EXPECT_EQ(fptr->levels, std::vector<std::string>({ "x", "y" }));
+
+    EXPECT_EQ(lptr->values[3], lptr->values[4]);
+    EXPECT_NE(lptr->values[3], lptr->values[5]);
+    auto dptr = static_cast<const DefaultNumberVector*>(lptr->values[3].get());
+    EXPECT_EQ(dptr->base.values, std::vector<double>({ 1.5, -123456789 }));
+
+    EXPECT_EQ(lptr->values[6], lptr->values[7]);
+
+    // Without the option, each object is provisioned separately.
+    auto undup = load_json(contents);
+    auto uptr = static_cast<const DefaultList*>(undup.get());
+    EXPECT_NE(uptr->values[0], uptr->values[1]);
+    EXPECT_NE(uptr->values[6], uptr->values[7]);
+}
+
+TEST(DeduplicateTest, Hdf5) {
+    auto path = "TEST-deduplicate.h5";
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        auto ghandle = list_opener(handle, "foo");
+        auto dhandle = ghandle.createGroup("data");
+
+        for (int i = 0; i < 3; ++i) {
+            auto lhandle = list_opener(dhandle, std::to_string(i));
+            auto ldhandle = lhandle.createGroup("data");
+            create_dataset(lhandle, "names", { "alpha", "bravo" });
+
+            auto ihandle = vector_opener(ldhandle, "0", "integer");
+            create_dataset<int>(ihandle, "data", { 1, 2, (i == 2 ? 4 : 3) }, H5::PredType::NATIVE_INT);
+
+            auto shandle = vector_opener(ldhandle, "1", "string");
+            create_dataset(shandle, "data", { "foo", "bar" });
+            create_dataset(shandle, "names", { "x", "y" });
+        }
+
+        auto ohandle1 = external_opener(dhandle, "3");
+        write_scalar(ohandle1, "index", 0, H5::PredType::NATIVE_INT);
+        auto ohandle2 = external_opener(dhandle, "4");
+        write_scalar(ohandle2, "index", 1, H5::PredType::NATIVE_INT);
+    }
+
+    uzuki2::hdf5::Options opt;
+    opt.deduplicate = true;
+    DefaultExternals ext(2);
+    auto parsed = uzuki2::hdf5::parse<DefaultProvisioner>(path, "foo", ext, opt);
+
+    auto lptr = static_cast<const DefaultList*>(parsed.get());
+    ASSERT_EQ(lptr->size(), 5);
+    EXPECT_EQ(lptr->values[0], lptr->values[1]);
+    EXPECT_NE(lptr->values[0], lptr->values[2]);
+    EXPECT_NE(lptr->values[3], lptr->values[4]); // different external objects.
+
+    auto first = static_cast<const DefaultList*>(lptr->values[0].get());
+    auto third = static_cast<const DefaultList*>(lptr->values[2].get());
+    EXPECT_EQ(first->names, std::vector<std::string>({ "alpha", "bravo" }));
+    EXPECT_NE(first->values[0], third->values[0]);
+    EXPECT_EQ(first->values[1], third->values[1]);
+
+    auto iptr = static_cast<const DefaultIntegerVector*>(third->values[0].get());
+    EXPECT_EQ(iptr->base.values, std::vector<int32_t>({ 1, 2, 4 }));
+    auto sptr = static_cast<const DefaultStringVector*>(first->values[1].get());
+    EXPECT_EQ(sptr->base.values, std::vector<std::string>({ "foo", "bar" }));
+    EXPECT_EQ(sptr->base.names, std::vector<std::string>({ "x", "y" }));
+
+    // Also respected when parsing subsets, where the placeholders for unselected elements are deduplicated as well.
+    auto subset = uzuki2::hdf5::parse_subset<DefaultProvisioner>(path, "foo", { uzuki2::hdf5::Path{ 0 }, uzuki2::hdf5::Path{ 1 }, uzuki2::hdf5::Path{ 2 } }, DefaultExternals(2), opt);
+    auto subptr = static_cast<const DefaultList*>(subset.get());
+    EXPECT_EQ(subptr->values[0], subptr->values[1]);
+    EXPECT_NE(subptr->values[0], subptr->values[2]);
+    EXPECT_EQ(subptr->values[3], subptr->values[4]);
+
+    // And when loading from a lazy object.
+    auto lazy = uzuki2::hdf5::parse_lazy(path, "foo", DefaultExternals(2), opt);
+    auto loaded = lazy.root.load<DefaultProvisioner>();
+    auto loadptr = static_cast<const DefaultList*>(loaded.get());
+    EXPECT_EQ(loadptr->values[0], loadptr->values[1]);
+    EXPECT_NE(loadptr->values[0], loadptr->values[2]);
+}
+
+TEST(DeduplicateTest, MaxSize) {
+    std::string contents = "{ \"type\": \"list\", \"values\": [ "
+        "{ \"type\": \"integer\", \"values\": [ 1, 2, 3, 4, 5, 6, 7, 8 ] }, "
+        "{ \"type\": \"integer\", \"values\": [ 1, 2, 3, 4, 5, 6, 7, 8 ] }, "
+        "{ \"type\": \"integer\", \"values\": [ 1 ] }, "
+        "{ \"type\": \"integer\", \"values\": [ 1 ] } "
+    "] }";
+
+    uzuki2::json::Options opt;
+    opt.deduplicate = true;
+    opt.deduplicate_max_size = 40;
+    auto parsed = uzuki2::json::parse_buffer<DefaultProvisioner>(reinterpret_cast<const unsigned char*>(contents.c_str()), contents.size(), uzuki2::DummyExternals(0), opt);
+
+    // Long vectors are provisioned separately, but their contents are still correct.
+    auto lptr = static_cast<const DefaultList*>(parsed.get());
+    ASSERT_EQ(lptr->size(), 4);
+    EXPECT_NE(lptr->values[0], lptr->values[1]);
+    EXPECT_EQ(lptr->values[2], lptr->values[3]);
+    auto iptr = static_cast<const DefaultIntegerVector*>(lptr->values[1].get());
+    EXPECT_EQ(iptr->base.values, std::vector<int32_t>({ 1, 2, 3, 4, 5, 6, 7, 8 }));
+
+    opt.deduplicate_max_size = 1000;
+    auto reparsed = uzuki2::json::parse_buffer<DefaultProvisioner>(reinterpret_cast<const unsigned char*>(contents.c_str()), contents.size(), uzuki2::DummyExternals(0), opt);
+    auto rptr = static_cast<const DefaultList*>(reparsed.get());
+    EXPECT_EQ(rptr->values[0], rptr->values[1]);
+
+    // The size is the length times the element size, plus the fixed-size fields.
+    size_t expected = sizeof(uzuki2::Type) + sizeof(size_t) + 2 * sizeof(bool) + 8 * (sizeof(uint8_t) + sizeof(int32_t));
+    opt.deduplicate_max_size = expected;
+    reparsed = uzuki2::json::parse_buffer<DefaultProvisioner>(reinterpret_cast<const unsigned char*>(contents.c_str()), contents.size(), uzuki2::DummyExternals(0), opt);
+    rptr = static_cast<const DefaultList*>(reparsed.get());
+    EXPECT_EQ(rptr->values[0], rptr->values[1]);
+
+    opt.deduplicate_max_size = expected - 1;
+    reparsed = uzuki2::json::parse_buffer<DefaultProvisioner>(reinterpret_cast<const unsigned char*>(contents.c_str()), contents.size(), uzuki2::DummyExternals(0), opt);
+    rptr = static_cast<const DefaultList*>(reparsed.get());
+    EXPECT_NE(rptr->values[0], rptr->values[1]);
+
+    // Lengths of the strings are also included.
+    std::string long_string(100, 'x');
+    std::string scontents = "{ \"type\": \"list\", \"values\": [ "
+        "{ \"type\": \"string\", \"values\": [ \"" + long_string + "\" ] }, "
+        "{ \"type\": \"string\", \"values\": [ \"" + long_string + "\" ] } "
+    "] }";
+    opt.deduplicate_max_size = 100;
+    auto sparsed = uzuki2::json::parse_buffer<DefaultProvisioner>(reinterpret_cast<const unsigned char*>(scontents.c_str()), scontents.size(), uzuki2::DummyExternals(0), opt);
+    auto sptr = static_cast<const DefaultList*>(sparsed.get());
+    EXPECT_NE(sptr->values[0], sptr->values[1]);
+    EXPECT_EQ(static_cast<const DefaultStringVector*>(sptr->values[1].get())->base.values, std::vector<std::string>({ long_string }));
+
+    opt.deduplicate_max_size = 1000;
+    sparsed = uzuki2::json::parse_buffer<DefaultProvisioner>(reinterpret_cast<const unsigned char*>(scontents.c_str()), scontents.size(), uzuki2::DummyExternals(0), opt);
+    sptr = static_cast<const DefaultList*>(sparsed.get());
+    EXPECT_EQ(sptr->values[0], sptr->values[1]);
+}
@@ -44,6 +44,29 @@ TEST(Hdf5FactorTest, SimpleLoading) {
         EXPECT_FALSE(fptr->ordered);
     }
 
+    // Variable-length levels work, and duplicates are caught for both string types.
+    for (bool variable : { false, true }) {
+        {
+            H5::H5File handle(path, H5F_ACC_TRUNC);
+            auto vhandle = vector_opener(handle, "blub", "factor");
+            create_dataset<int>(vhandle, "data", { 0, 1, 2 }, H5::PredType::NATIVE_INT);
+            create_dataset(vhandle, "levels", { "Albo", "", "Gillard" }, variable);
+        }
+        {
+            auto parsed = load_hdf5(path, "blub");
+            auto fptr = static_cast<const DefaultFactor*>(parsed.get());
+            EXPECT_EQ(fptr->levels, std::vector<std::string>({ "Albo", "", "Gillard" }));
+        }
+
+        {
+            H5::H5File handle(path, H5F_ACC_TRUNC);
+            auto vhandle = vector_opener(handle, "blub", "factor");
+            create_dataset<int>(vhandle, "data", { 0, 1, 2 }, H5::PredType::NATIVE_INT);
+            create_dataset(vhandle, "levels", { "Albo", "Rudd", "Albo" }, variable);
+        }
+        expect_hdf5_error(path, "blub", "levels should be unique");
+    }
+
     /********************************************
      *** See integer.cpp for tests for names. ***
      ********************************************/
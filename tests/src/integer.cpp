@@ -145,6 +145,49 @@ TEST(Hdf5IntegerTest, MissingValues) {
     }
 }
 
+struct BlockIntegerVector : public DefaultIntegerVector {
+    BlockIntegerVector(size_t l, bool n, bool s) : DefaultIntegerVector(l, n, s) {}
+
+    void set_block(size_t start, const int32_t* values, size_t n) {
+        blocks.emplace_back(start, n);
+        std::copy_n(values, n, base.values.begin() + start);
+    }
+
+    void set_missing_block(size_t start, const uint8_t* bitmap, size_t n) {
+        missing_blocks.emplace_back(start, n);
+        bitmaps.insert(bitmaps.end(), bitmap, bitmap + (n + 7) / 8);
+        DefaultIntegerVector::set_missing_block(start, bitmap, n);
+    }
+
+    std::vector<std::pair<size_t, size_t> > blocks;
+    std::vector<std::pair<size_t, size_t> > missing_blocks;
+    std::vector<uint8_t> bitmaps;
+};
+
+struct BlockIntegerProvisioner : public DefaultProvisioner {
+    template<class ... Args_>
+    static uzuki2::IntegerVector* new_Integer(Args_&& ... args) { return (new BlockIntegerVector(std::forward<Args_>(args)...)); }
+};
+
+TEST(Hdf5IntegerTest, BlockSetters) {
+    auto path = "TEST-integer.h5";
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        auto vhandle = vector_opener(handle, "blub", "integer");
+        create_dataset<int>(vhandle, "data", { 1, 2, -2147483648, 4, 5, -2147483648, -2147483648, 8 }, H5::PredType::NATIVE_INT);
+    }
+
+    uzuki2::hdf5::Options opt;
+    opt.strict_list = false;
+    auto parsed = uzuki2::hdf5::parse<BlockIntegerProvisioner>(path, "blub", uzuki2::DummyExternals(), opt);
+    auto iptr = static_cast<const BlockIntegerVector*>(parsed.get());
+    std::vector<std::pair<size_t, size_t> > expected_blocks { { 0, 8 } };
+    EXPECT_EQ(iptr->blocks, expected_blocks);
+    EXPECT_EQ(iptr->missing_blocks, expected_blocks);
+    EXPECT_EQ(iptr->bitmaps, std::vector<uint8_t>{ 0x64 });
+    EXPECT_EQ(iptr->base.values, std::vector<int32_t>({ 1, 2, -123456789, 4, 5, -123456789, -123456789, 8 }));
+}
+
 TEST(Hdf5IntegerTest, ForbiddenType) {
     auto path = "TEST-forbidden.h5";
 
@@ -285,6 +328,19 @@ TEST(JsonIntegerTest, MissingValues) {
     }
 }
 
+TEST(JsonIntegerTest, BlockSetters) {
+    std::string contents = "{ \"type\": \"integer\", \"values\": [ 1, 2, null, 4, 5, null, null, 8 ] }";
+    uzuki2::json::Options opt;
+    opt.strict_list = false;
+    auto parsed = uzuki2::json::parse_buffer<BlockIntegerProvisioner>(reinterpret_cast<const unsigned char*>(contents.c_str()), contents.size(), uzuki2::DummyExternals(), opt);
+    auto iptr = static_cast<const BlockIntegerVector*>(parsed.get());
+    std::vector<std::pair<size_t, size_t> > expected_blocks { { 0, 8 } };
+    EXPECT_EQ(iptr->blocks, expected_blocks);
+    EXPECT_EQ(iptr->missing_blocks, expected_blocks);
+    EXPECT_EQ(iptr->bitmaps, std::vector<uint8_t>{ 0x64 });
+    EXPECT_EQ(iptr->base.values, std::vector<int32_t>({ 1, 2, -123456789, 4, 5, -123456789, -123456789, 8 }));
+}
+
 TEST(JsonIntegerTest, CheckError) {
     expect_json_error("{ \"type\": \"integer\" }", "expected 'values' property");
     expect_json_error("{ \"type\": \"integer\", \"values\": \"foo\"}", "expected a number");
@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki2/parse_hdf5_lazy.hpp"
+
+#include "test_subclass.h"
+#include "utils.h"
+
+TEST(Hdf5LazyTest, Structure) {
+    auto path = "TEST-lazy.h5";
+
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        auto ghandle = list_opener(handle, "foo");
+        create_dataset(ghandle, "names", { "A", "B", "C", "D" });
+        auto dhandle = ghandle.createGroup("data");
+        nothing_opener(dhandle, "0");
+
+        auto vhandle = vector_opener(dhandle, "1", "integer");
+        create_dataset<int>(vhandle, "data", { 1, 2, 3, 4, 5 }, H5::PredType::NATIVE_INT);
+        create_dataset(vhandle, "names", { "a", "b", "c", "d", "e" });
+
+        auto lhandle = list_opener(dhandle, "2");
+        auto dhandle2 = lhandle.createGroup("data");
+        auto shandle = vector_opener(dhandle2, "0", "string");
+        write_string(shandle, "data", "whee");
+
+        auto ehandle = external_opener(dhandle, "3");
+        write_scalar(ehandle, "index", 0, H5::PredType::NATIVE_INT);
+    }
+
+    auto lazy = uzuki2::hdf5::parse_lazy(path, "foo", DefaultExternals(1));
+    const auto& root = lazy.root;
+    EXPECT_EQ(root.type(), uzuki2::LIST);
+    EXPECT_EQ(root.size(), 4);
+    EXPECT_TRUE(root.has_names());
+    EXPECT_EQ(root.names(), std::vector<std::string>({ "A", "B", "C", "D" }));
+
+    EXPECT_EQ(root.get(0).type(), uzuki2::NOTHING);
+
+    const auto& ivec = root.get(1);
+    EXPECT_EQ(ivec.type(), uzuki2::INTEGER);
+    EXPECT_EQ(ivec.size(), 5);
+    EXPECT_FALSE(ivec.is_scalar());
+    EXPECT_EQ(ivec.path(), "data/1");
+    {
+        auto loaded = ivec.load<DefaultProvisioner>();
+        auto iptr = static_cast<const DefaultIntegerVector*>(loaded.get());
+        EXPECT_EQ(iptr->base.values, std::vector<int32_t>({ 1, 2, 3, 4, 5 }));
+        EXPECT_EQ(iptr->base.names.back(), "e");
+    }
+
+    const auto& nested = root.get(2);
+    EXPECT_EQ(nested.type(), uzuki2::LIST);
+    EXPECT_FALSE(nested.has_names());
+    EXPECT_EQ(nested.get(0).type(), uzuki2::STRING);
+    EXPECT_TRUE(nested.get(0).is_scalar());
+    EXPECT_EQ(nested.get(0).path(), "data/2/data/0");
+    {
+        auto loaded = nested.load<DefaultProvisioner>();
+        auto lptr = static_cast<const DefaultList*>(loaded.get());
+        auto sptr = static_cast<const DefaultStringVector*>(lptr->values[0].get());
+        EXPECT_EQ(sptr->base.values.front(), "whee");
+    }
+
+    const auto& ext = root.get(3);
+    EXPECT_EQ(ext.type(), uzuki2::EXTERNAL);
+    {
+        auto loaded = ext.load<DefaultProvisioner>();
+        auto eptr = static_cast<const DefaultExternal*>(loaded.get());
+        EXPECT_EQ(eptr->ptr, reinterpret_cast<void*>(static_cast<uintptr_t>(1)));
+    }
+
+    // Loading the entire thing is the same as a full parse.
+    {
+        auto loaded = root.load<DefaultProvisioner>();
+        auto lptr = static_cast<const DefaultList*>(loaded.get());
+        EXPECT_EQ(lptr->size(), 4);
+        EXPECT_EQ(lptr->names[3], "D");
+    }
+}
+
+TEST(Hdf5LazyTest, DeferredChecks) {
+    auto path = "TEST-lazy.h5";
+
+    // Value-level errors are only caught upon loading.
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        auto ghandle = list_opener(handle, "foo");
+        auto dhandle = ghandle.createGroup("data");
+        auto vhandle = vector_opener(dhandle, "0", "boolean");
+        create_dataset<int>(vhandle, "data", { 1, 0, 2 }, H5::PredType::NATIVE_INT);
+    }
+    {
+        auto lazy = uzuki2::hdf5::parse_lazy(path, "foo", uzuki2::DummyExternals());
+        EXPECT_EQ(lazy.root.get(0).type(), uzuki2::BOOLEAN);
+        EXPECT_ANY_THROW({
+            try {
+                lazy.root.get(0).load<DefaultProvisioner>();
+            } catch (std::exception& e) {
+                EXPECT_THAT(e.what(), ::testing::HasSubstr("boolean values should be 0 or 1"));
+                throw;
+            }
+        });
+    }
+}
+
+TEST(Hdf5LazyTest, StructuralErrors) {
+    auto path = "TEST-lazy.h5";
+
+    auto expect_lazy_error = [&](std::string msg, size_t nexternal = 0) -> void {
+        EXPECT_ANY_THROW({
+            try {
+                uzuki2::hdf5::parse_lazy(path, "foo", uzuki2::DummyExternals(nexternal));
+            } catch (std::exception& e) {
+                EXPECT_THAT(e.what(), ::testing::HasSubstr(msg));
+                throw;
+            }
+        });
+    };
+
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        auto ghandle = list_opener(handle, "foo");
+        auto dhandle = ghandle.createGroup("data");
+        auto vhandle = vector_opener(dhandle, "0", "number");
+        create_dataset<int>(vhandle, "data", { 1, 2, 3 }, H5::PredType::NATIVE_INT);
+    }
+    expect_lazy_error("expected a floating-point dataset");
+
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        auto ghandle = list_opener(handle, "foo");
+        auto dhandle = ghandle.createGroup("data");
+        auto vhandle = vector_opener(dhandle, "0", "integer");
+        create_dataset<int>(vhandle, "data", { 1, 2, 3 }, H5::PredType::NATIVE_INT);
+        create_dataset(vhandle, "names", { "a", "b" });
+    }
+    expect_lazy_error("number of names should be equal");
+
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        auto ghandle = list_opener(handle, "foo");
+        auto dhandle = ghandle.createGroup("data");
+        auto ehandle = external_opener(dhandle, "0");
+        write_scalar(ehandle, "index", 1, H5::PredType::NATIVE_INT);
+    }
+    expect_lazy_error("external index out of range", 1);
+    expect_lazy_error("fewer instances of type \"external\" than expected", 2);
+
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        nothing_opener(handle, "foo");
+    }
+    expect_lazy_error("top-level object should represent an R list");
+}
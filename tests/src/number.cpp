@@ -181,6 +181,45 @@ TEST(Hdf5NumberTest, MissingValues) {
     }
 }
 
+TEST(Hdf5NumberTest, BlockMissingValues) {
+    auto path = "TEST-number.h5";
+
+    // Spanning several blocks, so that some blocks have no missing values at all.
+    auto missing = ritsuko::r_missing_value();
+    auto nan = std::numeric_limits<double>::quiet_NaN();
+    std::vector<double> collected(25000);
+    for (size_t i = 0; i < collected.size(); ++i) {
+        collected[i] = i * 1.5; 
+    }
+    collected[1] = missing;
+    collected[9999] = nan;
+    collected[20001] = missing;
+
+    for (auto version : std::vector<std::string>{ "1.2", "1.3" }) {
+        {
+            H5::H5File handle(path, H5F_ACC_TRUNC);
+            auto vhandle = vector_opener(handle, "blub", "number");
+            add_version(vhandle, version);
+            auto dhandle = create_dataset<double>(vhandle, "data", collected, H5::PredType::NATIVE_DOUBLE, /* compressed */ true);
+            auto ahandle = dhandle.createAttribute("missing-value-placeholder", H5::PredType::NATIVE_DOUBLE, H5S_SCALAR);
+            ahandle.write(H5::PredType::NATIVE_DOUBLE, &missing);
+        }
+
+        auto parsed = load_hdf5(path, "blub");
+        auto nptr = static_cast<const DefaultNumberVector*>(parsed.get());
+        EXPECT_EQ(nptr->base.values[0], 0);
+        EXPECT_EQ(nptr->base.values[1], -123456789);
+        EXPECT_EQ(nptr->base.values[20001], -123456789);
+        EXPECT_EQ(nptr->base.values[24999], 24999 * 1.5);
+
+        if (version == "1.2") {
+            EXPECT_TRUE(std::isnan(nptr->base.values[9999])); // payload differs, so not missing.
+        } else {
+            EXPECT_EQ(nptr->base.values[9999], -123456789);
+        }
+    }
+}
+
 TEST(Hdf5NumberTest, ForbiddenTypes) {
     auto path = "TEST-forbidden.h5";
 
@@ -288,3 +327,24 @@ TEST(JsonNumberTest, CheckError) {
     expect_json_error("{ \"type\": \"number\", \"values\": [true]}", "expected a number");
     expect_json_error("{ \"type\": \"number\", \"values\": [\"nan\"]}", "unsupported string");
 }
+
+TEST(JsonNumberTest, Base64) {
+    auto parsed = load_json("{ \"version\": \"1.3\", \"type\": \"number\", \"encoding\": \"base64\", \"values\": \"AAAAAAAA8D8AAAAAAAAEwAAAAAAAAAAA\", \"missing\": [ 2 ] }");
+    EXPECT_EQ(parsed->type(), uzuki2::NUMBER);
+    auto bptr = static_cast<const DefaultNumberVector*>(parsed.get());
+    EXPECT_FALSE(bptr->base.scalar);
+    EXPECT_EQ(bptr->base.values, std::vector<double>({ 1.0, -2.5, -123456789 }));
+
+    // Encoding is ignored in older versions, in which case the string is treated as a scalar.
+    expect_json_error("{ \"version\": \"1.2\", \"type\": \"number\", \"encoding\": \"base64\", \"values\": \"AAAAAAAA8D8=\" }", "unsupported string");
+
+    expect_json_error("{ \"version\": \"1.3\", \"type\": \"number\", \"encoding\": \"hex\", \"values\": \"AAAAAAAA8D8=\" }", "unsupported encoding");
+    expect_json_error("{ \"version\": \"1.3\", \"type\": \"number\", \"encoding\": \"base64\", \"values\": [ 1 ] }", "base64-encoded string");
+    expect_json_error("{ \"version\": \"1.3\", \"type\": \"number\", \"encoding\": \"base64\", \"values\": \"AAAAAAAA8D8\" }", "multiple of 4");
+    expect_json_error("{ \"version\": \"1.3\", \"type\": \"number\", \"encoding\": \"base64\", \"values\": \"AAAAAAAA\" }", "multiple of 8");
+    expect_json_error("{ \"version\": \"1.3\", \"type\": \"number\", \"encoding\": \"base64\", \"values\": \"AAAAAA!A8D8=\" }", "invalid character");
+    expect_json_error("{ \"version\": \"1.3\", \"type\": \"number\", \"encoding\": \"base64\", \"values\": \"AAAAAAAA8D9=\" }", "padding bits");
+    expect_json_error("{ \"version\": \"1.3\", \"type\": \"number\", \"encoding\": \"base64\", \"values\": \"AAAAAAAAAAAAAAAAAAAAAB==\" }", "padding bits");
+    expect_json_error("{ \"version\": \"1.3\", \"type\": \"number\", \"encoding\": \"base64\", \"values\": \"AAAAAAAA8D8=\", \"missing\": [ 1 ] }", "integer index");
+    expect_json_error("{ \"version\": \"1.3\", \"type\": \"number\", \"encoding\": \"base64\", \"values\": \"AAAAAAAA8D8=\", \"missing\": [ 0, 0 ] }", "duplicate index");
+}
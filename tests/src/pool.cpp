@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki2/parse_hdf5.hpp"
+#include "uzuki2/FilePool.hpp"
+
+#include "test_subclass.h"
+#include "utils.h"
+
+#include <filesystem>
+#include <chrono>
+
+static void create_pooled_file(const std::string& path, std::vector<int> values) {
+    H5::H5File handle(path, H5F_ACC_TRUNC);
+    auto ghandle = list_opener(handle, "foo");
+    auto dhandle = ghandle.createGroup("data");
+    auto vhandle = vector_opener(dhandle, "0", "integer");
+    create_dataset<int>(vhandle, "data", values, H5::PredType::NATIVE_INT);
+}
+
+TEST(Hdf5FilePoolTest, Reuse) {
+    std::string path = "TEST-pool.h5";
+    create_pooled_file(path, { 1, 2, 3 });
+
+    uzuki2::hdf5::FilePool pool(2);
+    auto first = pool.open(path);
+    auto second = pool.open(path);
+    EXPECT_EQ(first.getId(), second.getId());
+    EXPECT_EQ(pool.size(), 1);
+
+    uzuki2::hdf5::Options opt;
+    opt.file_pool = &pool;
+    auto parsed = uzuki2::hdf5::parse<DefaultProvisioner>(path, "foo", uzuki2::DummyExternals(0), opt);
+    auto lptr = static_cast<const DefaultList*>(parsed.get());
+    auto iptr = static_cast<const DefaultIntegerVector*>(lptr->values[0].get());
+    EXPECT_EQ(iptr->base.values, std::vector<int32_t>({ 1, 2, 3 }));
+    EXPECT_EQ(pool.size(), 1);
+
+    uzuki2::hdf5::validate(path, "foo", 0, opt);
+    EXPECT_EQ(pool.size(), 1);
+
+    pool.clear();
+    EXPECT_EQ(pool.size(), 0);
+}
+
+TEST(Hdf5FilePoolTest, Modified) {
+    std::string path = "TEST-pool.h5";
+    create_pooled_file(path, { 1, 2, 3 });
+
+    uzuki2::hdf5::FilePool pool(2);
+    uzuki2::hdf5::Options opt;
+    opt.file_pool = &pool;
+    uzuki2::hdf5::validate(path, "foo", 0, opt);
+
+    // Rewriting the file; the pool needs to release its handle first, otherwise HDF5 refuses to truncate it.
+    pool.clear();
+    create_pooled_file(path, { 4, 5 });
+    auto handle = pool.open(path);
+    std::filesystem::last_write_time(path, std::filesystem::last_write_time(path) + std::chrono::hours(1));
+
+    auto parsed = uzuki2::hdf5::parse<DefaultProvisioner>(path, "foo", uzuki2::DummyExternals(0), opt);
+    auto lptr = static_cast<const DefaultList*>(parsed.get());
+    auto iptr = static_cast<const DefaultIntegerVector*>(lptr->values[0].get());
+    EXPECT_EQ(iptr->base.values, std::vector<int32_t>({ 4, 5 }));
+
+    // Old handle was replaced due to the new modification time.
+    auto replacement = pool.open(path);
+    EXPECT_NE(handle.getId(), replacement.getId());
+    EXPECT_EQ(pool.size(), 1);
+}
+
+TEST(Hdf5FilePoolTest, Replaced) {
+    std::string path = "TEST-pool.h5";
+    create_pooled_file(path, { 1, 2, 3 });
+
+    uzuki2::hdf5::FilePool pool(2);
+    uzuki2::hdf5::Options opt;
+    opt.file_pool = &pool;
+    auto handle = pool.open(path);
+    auto old_mtime = std::filesystem::last_write_time(path);
+
+    // Replacing the file while the pool still holds a handle to the original,
+    // and restoring the modification time so that only the file's identity has changed.
+    std::string temp = "TEST-pool-temp.h5";
+    create_pooled_file(temp, { 4, 5 });
+    std::filesystem::rename(temp, path);
+    std::filesystem::last_write_time(path, old_mtime);
+
+    auto parsed = uzuki2::hdf5::parse<DefaultProvisioner>(path, "foo", uzuki2::DummyExternals(0), opt);
+    auto lptr = static_cast<const DefaultList*>(parsed.get());
+    auto iptr = static_cast<const DefaultIntegerVector*>(lptr->values[0].get());
+    EXPECT_EQ(iptr->base.values, std::vector<int32_t>({ 4, 5 }));
+    EXPECT_NE(pool.open(path).getId(), handle.getId());
+    EXPECT_EQ(pool.size(), 1);
+}
+
+TEST(Hdf5FilePoolTest, Eviction) {
+    std::vector<std::string> paths { "TEST-pool1.h5", "TEST-pool2.h5", "TEST-pool3.h5" };
+    for (const auto& p : paths) {
+        create_pooled_file(p, { 1 });
+    }
+
+    uzuki2::hdf5::FilePool pool(2);
+    EXPECT_EQ(pool.capacity(), 2);
+    auto first = pool.open(paths[0]);
+    pool.open(paths[1]);
+    pool.open(paths[0]); // first is now the most recently used.
+    pool.open(paths[2]);
+    EXPECT_EQ(pool.size(), 2);
+
+    // First file should still be in the pool.
+    EXPECT_EQ(pool.open(paths[0]).getId(), first.getId());
+
+    // No caching at all.
+    uzuki2::hdf5::FilePool empty(0);
+    empty.open(paths[0]);
+    EXPECT_EQ(empty.size(), 0);
+
+    EXPECT_ANY_THROW(pool.open("TEST-pool-missing.h5"));
+}
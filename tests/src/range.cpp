@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki2/parse_hdf5_subset.hpp"
+
+#include "test_subclass.h"
+#include "utils.h"
+
+typedef uzuki2::hdf5::Path Path;
+typedef uzuki2::hdf5::Range Range;
+
+class Hdf5RangeTest : public ::testing::Test {
+protected:
+    inline static const char* path = "TEST-range.h5";
+
+    static void SetUpTestSuite() {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        auto ghandle = list_opener(handle, "foo");
+        add_version(ghandle, "1.4");
+        create_dataset(ghandle, "names", { "ints", "nested" });
+        auto dhandle = ghandle.createGroup("data");
+
+        auto ihandle = vector_opener(dhandle, "0", "integer");
+        std::vector<int> ivalues(100);
+        for (size_t i = 0; i < ivalues.size(); ++i) {
+            ivalues[i] = i * 10;
+        }
+        ivalues[21] = -1;
+        auto idhandle = create_dataset<int>(ihandle, "data", ivalues, H5::PredType::NATIVE_INT, true);
+        int placeholder = -1;
+        auto ahandle = idhandle.createAttribute("missing-value-placeholder", H5::PredType::NATIVE_INT, H5S_SCALAR);
+        ahandle.write(H5::PredType::NATIVE_INT, &placeholder);
+        std::vector<std::string> inames;
+        for (size_t i = 0; i < ivalues.size(); ++i) {
+            inames.push_back("N" + std::to_string(i));
+        }
+        create_dataset(ihandle, "names", inames, true);
+
+        auto lhandle = list_opener(dhandle, "1");
+        auto dhandle2 = lhandle.createGroup("data");
+
+        auto nhandle = vector_opener(dhandle2, "0", "number");
+        create_dataset<double>(nhandle, "data", { 0.5, 1.5, 2.5, 3.5, 4.5 }, H5::PredType::NATIVE_DOUBLE);
+
+        auto shandle = vector_opener(dhandle2, "1", "string");
+        create_dataset(shandle, "data", { "A", "BB", "CCC", "DDDD" }, false);
+
+        auto fhandle = vector_opener(dhandle2, "2", "factor");
+        create_dataset<int>(fhandle, "data", { 0, 1, 2, 5, 1 }, H5::PredType::NATIVE_INT);
+        create_dataset(fhandle, "levels", { "x", "y", "z" }, true);
+
+        auto vhandle = vector_opener(dhandle2, "3", "vls");
+        std::string heap = "abcdefghij";
+        auto hhandle = create_dataset(vhandle, "heap", heap.size(), H5::PredType::NATIVE_UINT8);
+        hhandle.write(heap.c_str(), H5::PredType::NATIVE_CHAR);
+        std::vector<ritsuko::hdf5::vls::Pointer<uint64_t, uint64_t> > pointers(5);
+        for (size_t i = 0; i < pointers.size(); ++i) {
+            pointers[i].offset = i * 2;
+            pointers[i].length = (i % 2) + 1;
+        }
+        auto ptype = ritsuko::hdf5::vls::define_pointer_datatype<uint64_t, uint64_t>();
+        auto phandle = create_dataset(vhandle, "data", pointers.size(), ptype);
+        phandle.write(pointers.data(), ptype);
+
+        auto schandle = vector_opener(dhandle2, "4", "number");
+        write_scalar(schandle, "data", 2.5, H5::PredType::NATIVE_DOUBLE);
+
+        // VLS array with an invalid placeholder, to check the error context.
+        auto bvhandle = vector_opener(dhandle2, "5", "vls");
+        auto bhhandle = create_dataset(bvhandle, "heap", heap.size(), H5::PredType::NATIVE_UINT8);
+        bhhandle.write(heap.c_str(), H5::PredType::NATIVE_CHAR);
+        auto bphandle = create_dataset(bvhandle, "data", pointers.size(), ptype);
+        bphandle.write(pointers.data(), ptype);
+        int bplaceholder = 1;
+        bphandle.createAttribute("missing-value-placeholder", H5::PredType::NATIVE_INT, H5S_SCALAR).write(H5::PredType::NATIVE_INT, &bplaceholder);
+    }
+};
+
+TEST_F(Hdf5RangeTest, Integer) {
+    uzuki2::hdf5::Options opt;
+    opt.buffer_size = 7; // forcing multiple blocks.
+
+    Range range;
+    range.start = 5;
+    range.count = 10;
+    range.stride = 4;
+
+    auto parsed = uzuki2::hdf5::parse_range<DefaultProvisioner>(path, "foo", Path{ "ints" }, range, opt);
+    EXPECT_EQ(parsed->type(), uzuki2::INTEGER);
+    auto iptr = static_cast<const DefaultIntegerVector*>(parsed.get());
+    EXPECT_EQ(iptr->size(), 10);
+
+    std::vector<int32_t> expected;
+    std::vector<std::string> expected_names;
+    for (size_t i = 0; i < 10; ++i) {
+        size_t j = 5 + i * 4;
+        expected.push_back(j == 21 ? -123456789 : j * 10);
+        expected_names.push_back("N" + std::to_string(j));
+    }
+    EXPECT_EQ(iptr->base.values, expected);
+    EXPECT_EQ(iptr->base.names, expected_names);
+
+    // Empty ranges are fine.
+    auto empty = uzuki2::hdf5::parse_range<DefaultProvisioner>(path, "foo", Path{ 0 }, Range(), opt);
+    EXPECT_EQ(static_cast<const DefaultIntegerVector*>(empty.get())->size(), 0);
+}
+
+TEST_F(Hdf5RangeTest, Others) {
+    Range range;
+    range.start = 1;
+    range.count = 3;
+
+    {
+        auto parsed = uzuki2::hdf5::parse_range<DefaultProvisioner>(path, "foo", Path{ "nested", 0 }, range);
+        auto nptr = static_cast<const DefaultNumberVector*>(parsed.get());
+        EXPECT_EQ(nptr->base.values, std::vector<double>({ 1.5, 2.5, 3.5 }));
+    }
+
+    {
+        auto parsed = uzuki2::hdf5::parse_range<DefaultProvisioner>(path, "foo", Path{ "nested", 1 }, range);
+        auto sptr = static_cast<const DefaultStringVector*>(parsed.get());
+        EXPECT_EQ(sptr->base.values, std::vector<std::string>({ "BB", "CCC", "DDDD" }));
+    }
+
+    {
+        Range vrange;
+        vrange.start = 0;
+        vrange.count = 3;
+        vrange.stride = 2;
+        auto parsed = uzuki2::hdf5::parse_range<DefaultProvisioner>(path, "foo", Path{ "nested", 3 }, vrange);
+        auto sptr = static_cast<const DefaultStringVector*>(parsed.get());
+        EXPECT_EQ(sptr->base.values, std::vector<std::string>({ "a", "e", "i" }));
+    }
+
+    {
+        // Only the selected codes are checked.
+        Range frange;
+        frange.count = 3;
+        auto parsed = uzuki2::hdf5::parse_range<DefaultProvisioner>(path, "foo", Path{ "nested", 2 }, frange);
+        auto fptr = static_cast<const DefaultFactor*>(parsed.get());
+        EXPECT_EQ(fptr->vbase.values, std::vector<size_t>({ 0, 1, 2 }));
+        EXPECT_EQ(fptr->levels, std::vector<std::string>({ "x", "y", "z" }));
+
+        frange.count = 4;
+        EXPECT_ANY_THROW(uzuki2::hdf5::parse_range<DefaultProvisioner>(path, "foo", Path{ "nested", 2 }, frange));
+    }
+}
+
+TEST_F(Hdf5RangeTest, Errors) {
+    auto expect_range_error = [&](Path vpath, Range range, std::string msg) -> void {
+        EXPECT_ANY_THROW({
+            try {
+                uzuki2::hdf5::parse_range<DefaultProvisioner>(path, "foo", vpath, range);
+            } catch (std::exception& e) {
+                EXPECT_THAT(e.what(), ::testing::HasSubstr(msg));
+                throw;
+            }
+        });
+    };
+
+    Range range;
+    range.count = 1;
+
+    range.start = 100;
+    expect_range_error(Path{ 0 }, range, "out of bounds");
+
+    range.start = 0;
+    range.count = 2;
+    range.stride = 100;
+    expect_range_error(Path{ 0 }, range, "out of bounds");
+
+    range.stride = 0;
+    expect_range_error(Path{ 0 }, range, "stride");
+
+    range.stride = 1;
+    expect_range_error(Path{ 1 }, range, "only supported for vectors");
+    expect_range_error(Path{ "nested", 4 }, range, "scalar");
+    expect_range_error(Path{ 0, 0 }, range, "non-list");
+    expect_range_error(Path{ "missing" }, range, "missing");
+    expect_range_error(Path{ "nested", 5 }, range, "failed to load VLS array at '/foo/data/1/data/5/data'");
+}
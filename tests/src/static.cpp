@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki2/parse_hdf5.hpp"
+#include "uzuki2/parse_json.hpp"
+#include "uzuki2/static_interfaces.hpp"
+
+#include "test_subclass.h"
+#include "utils.h"
+
+#include <type_traits>
+
+class StaticIntegers final : public uzuki2::StaticIntegerVector<StaticIntegers> {
+public:
+    StaticIntegers(size_t l, bool n, bool) : values(l), names(n ? l : 0) {}
+    size_t size() const { return values.size(); }
+    void set(size_t i, int32_t v) { values[i] = v; }
+    void set_missing(size_t i) { values[i] = -1; }
+    void set_name(size_t i, std::string n) { names[i] = std::move(n); }
+    std::vector<int32_t> values;
+    std::vector<std::string> names;
+};
+
+class StaticStrings final : public uzuki2::StaticStringVector<StaticStrings> {
+public:
+    StaticStrings(size_t l, bool n, bool, uzuki2::StringVector::Format) : values(l), names(n ? l : 0) {}
+    size_t size() const { return values.size(); }
+    void set(size_t i, std::string v) { values[i] = std::move(v); }
+    void set_missing(size_t i) { values[i] = "NA"; }
+    void set_name(size_t i, std::string n) { names[i] = std::move(n); }
+    std::vector<std::string> values;
+    std::vector<std::string> names;
+};
+
+struct StaticProvisioner : public DefaultProvisioner {
+    static StaticIntegers* new_Integer(size_t l, bool n, bool s) { return new StaticIntegers(l, n, s); }
+    static StaticStrings* new_String(size_t l, bool n, bool s, uzuki2::StringVector::Format f) { return new StaticStrings(l, n, s, f); }
+};
+
+static_assert(std::is_same<decltype(StaticProvisioner::new_Integer(1, false, false)), StaticIntegers*>::value);
+
+TEST(StaticProvisionerTest, Hdf5) {
+    auto path = "TEST-static.h5";
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        auto ghandle = list_opener(handle, "foo");
+        auto dhandle = ghandle.createGroup("data");
+
+        auto ihandle = vector_opener(dhandle, "0", "integer");
+        create_dataset<int>(ihandle, "data", { 1, -2147483648, 3 }, H5::PredType::NATIVE_INT);
+        create_dataset(ihandle, "names", { "A", "B", "C" });
+
+        auto shandle = vector_opener(dhandle, "1", "string");
+        create_dataset(shandle, "data", { "x", "yy", "zzz" });
+        create_dataset(shandle, "names", { "a", "b", "c" }, /* variable = */ true);
+    }
+
+    auto parsed = uzuki2::hdf5::parse<StaticProvisioner>(path, "foo", uzuki2::DummyExternals(0), uzuki2::hdf5::Options());
+    auto lptr = static_cast<const DefaultList*>(parsed.get());
+
+    auto iptr = static_cast<const StaticIntegers*>(lptr->values[0].get());
+    EXPECT_EQ(iptr->values, std::vector<int32_t>({ 1, -1, 3 }));
+    EXPECT_EQ(iptr->names, std::vector<std::string>({ "A", "B", "C" }));
+
+    auto sptr = static_cast<const StaticStrings*>(lptr->values[1].get());
+    EXPECT_EQ(sptr->values, std::vector<std::string>({ "x", "yy", "zzz" }));
+    EXPECT_EQ(sptr->names, std::vector<std::string>({ "a", "b", "c" }));
+}
+
+TEST(StaticProvisionerTest, Json) {
+    std::string contents = "{ \"type\": \"list\", \"values\": [ { \"type\": \"integer\", \"values\": [ 1, null, 3 ], \"names\": [ \"A\", \"B\", \"C\" ] }, { \"type\": \"string\", \"values\": [ \"x\", null ] } ] }";
+    auto parsed = uzuki2::json::parse_buffer<StaticProvisioner>(reinterpret_cast<const unsigned char*>(contents.c_str()), contents.size(), uzuki2::DummyExternals(0), uzuki2::json::Options());
+    auto lptr = static_cast<const DefaultList*>(parsed.get());
+
+    auto iptr = static_cast<const StaticIntegers*>(lptr->values[0].get());
+    EXPECT_EQ(iptr->values, std::vector<int32_t>({ 1, -1, 3 }));
+    EXPECT_EQ(iptr->names, std::vector<std::string>({ "A", "B", "C" }));
+
+    auto sptr = static_cast<const StaticStrings*>(lptr->values[1].get());
+    EXPECT_EQ(sptr->values, std::vector<std::string>({ "x", "NA" }));
+}
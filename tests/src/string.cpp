@@ -2,6 +2,7 @@
 #include <gmock/gmock.h>
 
 #include "uzuki2/parse_hdf5.hpp"
+#include "uzuki2/DictionaryEncoder.hpp"
 
 #include "test_subclass.h"
 #include "utils.h"
@@ -134,6 +135,139 @@ TEST(Hdf5StringTest, BlockLoading) {
     }
 }
 
+struct BlockStringVector : public DefaultStringVector {
+    BlockStringVector(size_t l, bool n, bool s, uzuki2::StringVector::Format f) : DefaultStringVector(l, n, s, f) {}
+
+    void set_block(size_t start, const char* data, const size_t* offsets, size_t n) {
+        ++value_blocks;
+        DefaultStringVector::set_block(start, data, offsets, n);
+    }
+
+    void set_name_block(size_t start, const char* data, const size_t* offsets, size_t n) {
+        ++name_blocks;
+        DefaultStringVector::set_name_block(start, data, offsets, n);
+    }
+
+    void set_view(size_t i, std::string_view v) {
+        ++value_views;
+        DefaultStringVector::set_view(i, v);
+    }
+
+    void set_name_view(size_t i, std::string_view n) {
+        ++name_views;
+        DefaultStringVector::set_name_view(i, n);
+    }
+
+    void set_dictionary(const char* data, const size_t* offsets, size_t nlevels, const int32_t* codes) {
+        dictionary_levels.push_back(nlevels);
+        DefaultStringVector::set_dictionary(data, offsets, nlevels, codes);
+    }
+
+    size_t value_blocks = 0;
+    size_t name_blocks = 0;
+    size_t value_views = 0;
+    size_t name_views = 0;
+    std::vector<size_t> dictionary_levels;
+};
+
+struct BlockStringProvisioner : public DefaultProvisioner {
+    template<class ... Args_>
+    static uzuki2::StringVector* new_String(Args_&& ... args) { return (new BlockStringVector(std::forward<Args_>(args)...)); }
+};
+
+TEST(Hdf5StringTest, ContiguousBlocks) {
+    auto path = "TEST-string.h5";
+
+    std::vector<std::string> collected { "alpha", "", "gamma", "NA", "epsilon", "zeta-zeta" };
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        auto vhandle = vector_opener(handle, "blub", "string");
+        auto dhandle = create_dataset(vhandle, "data", collected, /* variable */ false);
+        H5::StrType stype(0, H5T_VARIABLE);
+        auto ahandle = dhandle.createAttribute("missing-value-placeholder", stype, H5S_SCALAR);
+        ahandle.write(stype, std::string("NA"));
+        create_dataset(vhandle, "names", { "A", "BB", "CCC", "DDDD", "EEEEE", "FFFFFF" }, /* variable */ false);
+    }
+
+    uzuki2::hdf5::Options opt;
+    opt.strict_list = false;
+    opt.buffer_size = 4;
+    auto parsed = uzuki2::hdf5::parse<BlockStringProvisioner>(path, "blub", uzuki2::DummyExternals(), opt);
+    auto sptr = static_cast<const BlockStringVector*>(parsed.get());
+    EXPECT_EQ(sptr->value_blocks, 2);
+    EXPECT_EQ(sptr->name_blocks, 2);
+
+    collected[3] = "ich bin missing";
+    EXPECT_EQ(sptr->base.values, collected);
+    EXPECT_EQ(sptr->base.names, std::vector<std::string>({ "A", "BB", "CCC", "DDDD", "EEEEE", "FFFFFF" }));
+}
+
+TEST(Hdf5StringTest, DictionaryEncoding) {
+    auto path = "TEST-string.h5";
+
+    std::vector<std::string> collected { "A", "B", "NA", "A", "A", "B", "NA", "B" };
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        auto vhandle = vector_opener(handle, "blub", "string");
+        auto dhandle = create_dataset(vhandle, "data", collected, /* variable */ false);
+        H5::StrType stype(0, H5T_VARIABLE);
+        auto ahandle = dhandle.createAttribute("missing-value-placeholder", stype, H5S_SCALAR);
+        ahandle.write(stype, std::string("NA"));
+    }
+
+    auto expected = collected;
+    expected[2] = "ich bin missing";
+    expected[6] = "ich bin missing";
+
+    uzuki2::hdf5::Options opt;
+    opt.strict_list = false;
+    opt.buffer_size = 3;
+    opt.max_dictionary_levels = 5;
+    {
+        auto parsed = uzuki2::hdf5::parse<BlockStringProvisioner>(path, "blub", uzuki2::DummyExternals(), opt);
+        auto sptr = static_cast<const BlockStringVector*>(parsed.get());
+        EXPECT_EQ(sptr->dictionary_levels, std::vector<size_t>{ 2 }); // placeholder is not a level.
+        EXPECT_EQ(sptr->value_blocks, 0);
+        EXPECT_EQ(sptr->base.values, expected);
+    }
+
+    // The placeholder does not count towards the limit, even though it is part of each fixed-width block.
+    opt.max_dictionary_levels = 2;
+    {
+        auto parsed = uzuki2::hdf5::parse<BlockStringProvisioner>(path, "blub", uzuki2::DummyExternals(), opt);
+        auto sptr = static_cast<const BlockStringVector*>(parsed.get());
+        EXPECT_EQ(sptr->dictionary_levels, std::vector<size_t>{ 2 });
+        EXPECT_EQ(sptr->base.values, expected);
+    }
+
+    // Falls back to the usual delivery if there are too many distinct strings.
+    opt.max_dictionary_levels = 1;
+    {
+        auto parsed = uzuki2::hdf5::parse<BlockStringProvisioner>(path, "blub", uzuki2::DummyExternals(), opt);
+        auto sptr = static_cast<const BlockStringVector*>(parsed.get());
+        EXPECT_TRUE(sptr->dictionary_levels.empty());
+        EXPECT_EQ(sptr->base.values, expected);
+    }
+}
+
+TEST(Hdf5StringTest, DictionaryEncodingAbandoned) {
+    // Encoding is abandoned inside a single block that exceeds the limit, without waiting for finish().
+    std::string data = "ABCDENA";
+    std::vector<size_t> offsets { 0, 1, 2, 3, 4, 5, 7 };
+    std::vector<uint8_t> bitmap { 1u << 5 };
+
+    BlockStringVector host(6, false, false, uzuki2::StringVector::NONE);
+    uzuki2::DictionaryEncoder<BlockStringVector> encoder(&host, 2);
+    encoder.set_block(0, data.data(), offsets.data(), 6);
+    EXPECT_EQ(host.value_views, 6);
+    EXPECT_EQ(host.value_blocks, 0);
+
+    encoder.set_missing_block(0, bitmap.data(), 6);
+    encoder.finish();
+    EXPECT_TRUE(host.dictionary_levels.empty());
+    EXPECT_EQ(host.base.values, std::vector<std::string>({ "A", "B", "C", "D", "E", "ich bin missing" }));
+}
+
 TEST(Hdf5StringTest, MissingValues) {
     auto path = "TEST-string.h5";
 
@@ -237,3 +371,39 @@ TEST(JsonStringTest, CheckError) {
 }
 
 
+
+TEST(JsonStringTest, Views) {
+    std::string contents = "{\"type\":\"string\", \"values\":[\"alpha\", null, \"charlie\"], \"names\":[\"A\", \"B\", \"C\"] }";
+    uzuki2::json::Options opt;
+    opt.strict_list = false;
+    auto parsed = uzuki2::json::parse_buffer<BlockStringProvisioner>(reinterpret_cast<const unsigned char*>(contents.c_str()), contents.size(), uzuki2::DummyExternals(), opt);
+    auto sptr = static_cast<const BlockStringVector*>(parsed.get());
+    EXPECT_EQ(sptr->value_views, 2);
+    EXPECT_EQ(sptr->name_views, 3);
+    EXPECT_EQ(sptr->base.values, std::vector<std::string>({ "alpha", "ich bin missing", "charlie" }));
+    EXPECT_EQ(sptr->base.names, std::vector<std::string>({ "A", "B", "C" }));
+}
+
+TEST(JsonStringTest, DictionaryEncoding) {
+    std::string contents = "{\"type\":\"string\", \"values\":[\"alpha\", null, \"bravo\", \"alpha\", \"bravo\"] }";
+    uzuki2::json::Options opt;
+    opt.strict_list = false;
+    opt.max_dictionary_levels = 2;
+    std::vector<std::string> expected { "alpha", "ich bin missing", "bravo", "alpha", "bravo" };
+
+    {
+        auto parsed = uzuki2::json::parse_buffer<BlockStringProvisioner>(reinterpret_cast<const unsigned char*>(contents.c_str()), contents.size(), uzuki2::DummyExternals(), opt);
+        auto sptr = static_cast<const BlockStringVector*>(parsed.get());
+        EXPECT_EQ(sptr->dictionary_levels, std::vector<size_t>{ 2 });
+        EXPECT_EQ(sptr->value_views, 4); // via the default set_dictionary().
+        EXPECT_EQ(sptr->base.values, expected);
+    }
+
+    opt.max_dictionary_levels = 1;
+    {
+        auto parsed = uzuki2::json::parse_buffer<BlockStringProvisioner>(reinterpret_cast<const unsigned char*>(contents.c_str()), contents.size(), uzuki2::DummyExternals(), opt);
+        auto sptr = static_cast<const BlockStringVector*>(parsed.get());
+        EXPECT_TRUE(sptr->dictionary_levels.empty());
+        EXPECT_EQ(sptr->base.values, expected);
+    }
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki2/parse_hdf5_subset.hpp"
+
+#include "test_subclass.h"
+#include "utils.h"
+
+typedef uzuki2::hdf5::Path Path;
+
+class Hdf5SubsetTest : public ::testing::Test {
+protected:
+    inline static const char* path = "TEST-subset.h5";
+
+    static void SetUpTestSuite() {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        auto ghandle = list_opener(handle, "foo");
+        auto dhandle = ghandle.createGroup("data");
+
+        nothing_opener(dhandle, "0");
+
+        auto vhandle = vector_opener(dhandle, "1", "integer");
+        create_dataset<int>(vhandle, "data", { 1, 2, 3 }, H5::PredType::NATIVE_INT);
+
+        auto lhandle = list_opener(dhandle, "2");
+        create_dataset(lhandle, "names", { "metrics", "other" });
+        auto dhandle2 = lhandle.createGroup("data");
+        auto mhandle = vector_opener(dhandle2, "0", "number");
+        create_dataset<double>(mhandle, "data", { 0.5, 1.5 }, H5::PredType::NATIVE_DOUBLE);
+        auto ohandle = external_opener(dhandle2, "1");
+        write_scalar(ohandle, "index", 0, H5::PredType::NATIVE_INT);
+
+        // Deliberately broken so that we can check that it's never visited.
+        vector_opener(dhandle, "3", "BLAH");
+    }
+};
+
+TEST_F(Hdf5SubsetTest, ByIndex) {
+    auto parsed = uzuki2::hdf5::parse_subset<DefaultProvisioner>(path, "foo", { Path{ 1 } }, DefaultExternals(1));
+    auto lptr = static_cast<const DefaultList*>(parsed.get());
+    EXPECT_EQ(lptr->size(), 4);
+    EXPECT_EQ(lptr->values[0]->type(), uzuki2::NOTHING);
+    EXPECT_EQ(lptr->values[1]->type(), uzuki2::INTEGER);
+    EXPECT_EQ(lptr->values[2]->type(), uzuki2::NOTHING);
+    EXPECT_EQ(lptr->values[3]->type(), uzuki2::NOTHING);
+
+    auto iptr = static_cast<const DefaultIntegerVector*>(lptr->values[1].get());
+    EXPECT_EQ(iptr->base.values, std::vector<int32_t>({ 1, 2, 3 }));
+
+    // Any integer type can be used as an index.
+    EXPECT_EQ(Path{ static_cast<int64_t>(1) }[0].index(), 1);
+    EXPECT_EQ(Path{ static_cast<uint16_t>(2) }[0].index(), 2);
+    EXPECT_EQ(Path{ 3L }[0].index(), 3);
+    EXPECT_EQ(Path{ static_cast<size_t>(4) }[0].index(), 4);
+    EXPECT_ANY_THROW(Path{ static_cast<int64_t>(-1) });
+}
+
+TEST_F(Hdf5SubsetTest, ByName) {
+    auto parsed = uzuki2::hdf5::parse_subset<DefaultProvisioner>(path, "foo", { Path{ 2, "metrics" } }, DefaultExternals(1));
+    auto lptr = static_cast<const DefaultList*>(parsed.get());
+    EXPECT_EQ(lptr->values[2]->type(), uzuki2::LIST);
+
+    auto nested = static_cast<const DefaultList*>(lptr->values[2].get());
+    EXPECT_TRUE(nested->has_names);
+    EXPECT_EQ(nested->names[0], "metrics");
+    EXPECT_EQ(nested->values[1]->type(), uzuki2::NOTHING);
+
+    auto nptr = static_cast<const DefaultNumberVector*>(nested->values[0].get());
+    EXPECT_EQ(nptr->base.values, std::vector<double>({ 0.5, 1.5 }));
+}
+
+TEST_F(Hdf5SubsetTest, MultiplePaths) {
+    auto parsed = uzuki2::hdf5::parse_subset<DefaultProvisioner>(path, "foo", { Path{ 2, "other" }, Path{ 2, 0 }, Path{ 1 } }, DefaultExternals(1));
+    auto lptr = static_cast<const DefaultList*>(parsed.get());
+    EXPECT_EQ(lptr->values[1]->type(), uzuki2::INTEGER);
+
+    auto nested = static_cast<const DefaultList*>(lptr->values[2].get());
+    EXPECT_EQ(nested->values[0]->type(), uzuki2::NUMBER);
+    EXPECT_EQ(nested->values[1]->type(), uzuki2::EXTERNAL);
+
+    // Empty paths just parse everything, which fails here due to the broken element.
+    EXPECT_ANY_THROW(uzuki2::hdf5::parse_subset<DefaultProvisioner>(path, "foo", { Path{} }, DefaultExternals(1)));
+
+    // No paths means that all elements are placeholders.
+    auto empty = uzuki2::hdf5::parse_subset<DefaultProvisioner>(path, "foo", {}, DefaultExternals(1));
+    auto eptr = static_cast<const DefaultList*>(empty.get());
+    EXPECT_EQ(eptr->size(), 4);
+    EXPECT_EQ(eptr->values[1]->type(), uzuki2::NOTHING);
+}
+
+TEST_F(Hdf5SubsetTest, Errors) {
+    auto expect_subset_error = [&](std::vector<uzuki2::hdf5::Path> paths, std::string msg, size_t nexternal = 1) -> void {
+        EXPECT_ANY_THROW({
+            try {
+                uzuki2::hdf5::parse_subset<DefaultProvisioner>(path, "foo", paths, DefaultExternals(nexternal));
+            } catch (std::exception& e) {
+                EXPECT_THAT(e.what(), ::testing::HasSubstr(msg));
+                throw;
+            }
+        });
+    };
+
+    expect_subset_error({ Path{ 5 } }, "out of range");
+    expect_subset_error({ Path{ "whee" } }, "no list element named 'whee'");
+    expect_subset_error({ Path{ 1, 0 } }, "non-list object");
+    expect_subset_error({ Path{ 3 } }, "expected a dataset");
+    expect_subset_error({ Path{ 2, "other" } }, "external index out of range", 0);
+}
@@ -6,6 +6,8 @@
 #include <vector>
 #include <string>
 #include <type_traits>
+#include <cmath>
+#include <limits>
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
@@ -172,6 +174,69 @@ inline auto load_json_strict(std::string x, bool parallel = false) {
     return uzuki2::json::parse_buffer<DefaultProvisioner>(reinterpret_cast<const unsigned char*>(x.c_str()), x.size(), uzuki2::DummyExternals(), std::move(opt));
 }
 
+inline uzuki2::ParsedList parse_columnar(const std::string& contents, size_t num_external = 0, bool strict_list = true) {
+    uzuki2::json::Options opt;
+    opt.strict_list = strict_list;
+    return uzuki2::json::parse_buffer<uzuki2::ColumnarProvisioner>(reinterpret_cast<const unsigned char*>(contents.c_str()), contents.size(), DefaultExternals(num_external), std::move(opt));
+}
+
+/*
+ * Shared fixture for the writers, covering each type with missing values,
+ * names, special numbers, strings that need escaping or collide with the
+ * default placeholder, and a nested list with an external reference.
+ */
+inline std::string round_trip_json() {
+    return "{ \"version\": \"1.2\", \"type\": \"list\", \"values\": ["
+        "{ \"type\": \"integer\", \"values\": [ 1, null, -3 ], \"names\": [ \"a\", \"b\", \"c\" ] },"
+        "{ \"type\": \"number\", \"values\": [ 1.5, null, \"NaN\", \"-Inf\" ] },"
+        "{ \"type\": \"boolean\", \"values\": [ true, false, null ] },"
+        "{ \"type\": \"string\", \"values\": [ \"foo\", null, \"\", \"NA\", \"quote\\\"\\n\\u0001\" ] },"
+        "{ \"type\": \"string\", \"values\": \"2020-01-01\", \"format\": \"date\" },"
+        "{ \"type\": \"factor\", \"values\": [ 1, 0, null ], \"levels\": [ \"A\", \"B\" ], \"ordered\": true },"
+        "{ \"type\": \"list\", \"values\": [ { \"type\": \"nothing\" }, { \"type\": \"external\", \"index\": 0 } ], \"names\": [ \"x\", \"y\" ] }"
+        "], \"names\": [ \"ints\", \"nums\", \"bools\", \"strs\", \"date\", \"fac\", \"nested\" ] }";
+}
+
+inline void check_round_trip(const uzuki2::Base* ptr) {
+    auto lptr = static_cast<const DefaultList*>(ptr);
+    ASSERT_EQ(lptr->size(), 7);
+    EXPECT_EQ(lptr->names, std::vector<std::string>({ "ints", "nums", "bools", "strs", "date", "fac", "nested" }));
+
+    auto iptr = static_cast<const DefaultIntegerVector*>(lptr->values[0].get());
+    EXPECT_EQ(iptr->base.values, std::vector<int32_t>({ 1, -123456789, -3 }));
+    EXPECT_EQ(iptr->base.names, std::vector<std::string>({ "a", "b", "c" }));
+
+    auto dptr = static_cast<const DefaultNumberVector*>(lptr->values[1].get());
+    ASSERT_EQ(dptr->base.values.size(), 4);
+    EXPECT_EQ(dptr->base.values[0], 1.5);
+    EXPECT_EQ(dptr->base.values[1], -123456789);
+    EXPECT_TRUE(std::isnan(dptr->base.values[2]));
+    EXPECT_EQ(dptr->base.values[3], -std::numeric_limits<double>::infinity());
+
+    auto bptr = static_cast<const DefaultBooleanVector*>(lptr->values[2].get());
+    EXPECT_EQ(bptr->base.values, std::vector<uint8_t>({ 1, 0, 255 }));
+
+    auto sptr = static_cast<const DefaultStringVector*>(lptr->values[3].get());
+    EXPECT_EQ(sptr->base.values, std::vector<std::string>({ "foo", "ich bin missing", "", "NA", "quote\"\n\x01" }));
+    EXPECT_FALSE(sptr->base.scalar);
+
+    auto scalar = static_cast<const DefaultStringVector*>(lptr->values[4].get());
+    EXPECT_TRUE(scalar->base.scalar);
+    EXPECT_EQ(scalar->format, uzuki2::StringVector::DATE);
+    EXPECT_EQ(scalar->base.values, std::vector<std::string>({ "2020-01-01" }));
+
+    auto fptr = static_cast<const DefaultFactor*>(lptr->values[5].get());
+    EXPECT_EQ(fptr->vbase.values, std::vector<size_t>({ 1, 0, static_cast<size_t>(-1) }));
+    EXPECT_EQ(fptr->levels, std::vector<std::string>({ "A", "B" }));
+    EXPECT_TRUE(fptr->ordered);
+
+    auto nested = static_cast<const DefaultList*>(lptr->values[6].get());
+    ASSERT_EQ(nested->size(), 2);
+    EXPECT_EQ(nested->names, std::vector<std::string>({ "x", "y" }));
+    EXPECT_EQ(nested->values[0]->type(), uzuki2::NOTHING);
+    EXPECT_EQ(static_cast<const DefaultExternal*>(nested->values[1].get())->ptr, reinterpret_cast<void*>(1));
+}
+
 inline void expect_hdf5_error(std::string file, std::string name, std::string msg) {
     EXPECT_ANY_THROW({
         try {
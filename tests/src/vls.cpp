@@ -189,3 +189,39 @@ TEST(Hdf5VlsTest, Scalar) {
         EXPECT_EQ(sptr->base.values.front(), "ich bin missing");
     }
 }
+
+TEST(Hdf5VlsTest, Shuffled) {
+    auto path = "TEST-vls.h5";
+    std::string heap = "abcdefghijklmno";
+
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        auto vhandle = vector_opener(handle, "blub", "vls");
+        add_version(vhandle, "1.4");
+
+        auto hhandle = create_dataset(vhandle, "heap", heap.size(), H5::PredType::NATIVE_UINT8);
+        const unsigned char* hptr = reinterpret_cast<const unsigned char*>(heap.c_str());
+        hhandle.write(hptr, H5::PredType::NATIVE_UCHAR);
+
+        // Unsorted, overlapping, duplicated, empty and disjoint slices of the heap.
+        std::vector<std::pair<uint64_t, uint64_t> > slices { { 10, 3 }, { 0, 2 }, { 1, 3 }, { 10, 3 }, { 5, 0 }, { 14, 1 }, { 2, 2 } };
+        std::vector<ritsuko::hdf5::vls::Pointer<uint64_t, uint64_t> > pointers(slices.size());
+        for (size_t i = 0; i < slices.size(); ++i) {
+            pointers[i].offset = slices[i].first;
+            pointers[i].length = slices[i].second;
+        }
+        auto ptype = ritsuko::hdf5::vls::define_pointer_datatype<uint64_t, uint64_t>();
+        auto phandle = create_dataset(vhandle, "data", pointers.size(), ptype);
+        phandle.write(pointers.data(), ptype);
+    }
+
+    std::vector<std::string> expected { "klm", "ab", "bcd", "klm", "", "o", "cd" };
+    for (hsize_t buffer_size : { 1, 3, 100 }) {
+        uzuki2::hdf5::Options opt;
+        opt.strict_list = false;
+        opt.buffer_size = buffer_size;
+        auto parsed = uzuki2::hdf5::parse<DefaultProvisioner>(path, "blub", uzuki2::DummyExternals(), opt);
+        auto sptr = static_cast<const DefaultStringVector*>(parsed.get());
+        EXPECT_EQ(sptr->base.values, expected);
+    }
+}
@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki2/parse_hdf5.hpp"
+#include "uzuki2/parse_json.hpp"
+#include "uzuki2/write_hdf5.hpp"
+
+#include "test_subclass.h"
+#include "utils.h"
+
+#include <cmath>
+#include <string>
+
+TEST(Hdf5WriteTest, RoundTrip) {
+    auto parsed = parse_columnar(round_trip_json(), 1);
+
+    auto path = "TEST-write.h5";
+    auto externals = uzuki2::hdf5::write(parsed.get(), path, "foo");
+    ASSERT_EQ(externals.size(), 1);
+    EXPECT_EQ(externals[0], reinterpret_cast<void*>(1));
+
+    auto reloaded = uzuki2::hdf5::parse<DefaultProvisioner>(path, "foo", DefaultExternals(1), uzuki2::hdf5::Options());
+    EXPECT_EQ(reloaded.version.major, 1);
+    EXPECT_EQ(reloaded.version.minor, 3);
+    check_round_trip(reloaded.get());
+
+    // Placeholders avoid collisions with non-missing values.
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto nhandle = handle.openDataSet("foo/data/1/data");
+    double placeholder;
+    nhandle.openAttribute("missing-value-placeholder").read(H5::PredType::NATIVE_DOUBLE, &placeholder);
+    EXPECT_EQ(placeholder, std::numeric_limits<double>::lowest()); // not NaN or -Inf, as both are present.
+
+    auto shandle = handle.openDataSet("foo/data/3/data");
+    EXPECT_EQ(ritsuko::hdf5::open_and_load_scalar_string_attribute(shandle, "missing-value-placeholder"), "NA_");
+}
+
+TEST(Hdf5WriteTest, Layout) {
+    std::string big = "[ 0";
+    for (int i = 1; i < 20000; ++i) {
+        big += ", " + std::to_string(i);
+    }
+    big += " ]";
+
+    auto parsed = parse_columnar("{ \"type\": \"list\", \"values\": ["
+        "{ \"type\": \"integer\", \"values\": " + big + " },"
+        "{ \"type\": \"integer\", \"values\": [ 1, 2, null ] },"
+        "{ \"type\": \"integer\", \"values\": [ 1, 200 ] },"
+        "{ \"type\": \"integer\", \"values\": [ 1, 100000 ] }"
+        "] }");
+
+    auto path = "TEST-write.h5";
+    uzuki2::hdf5::write(parsed.get(), path, "foo");
+
+    {
+        H5::H5File handle(path, H5F_ACC_RDONLY);
+        auto bhandle = handle.openDataSet("foo/data/0/data");
+        EXPECT_EQ(bhandle.getIntType(), H5::PredType::STD_I16LE);
+        auto cplist = bhandle.getCreatePlist();
+        EXPECT_EQ(cplist.getLayout(), H5D_CHUNKED);
+        EXPECT_EQ(cplist.getNfilters(), 2);
+
+        auto shandle = handle.openDataSet("foo/data/1/data");
+        EXPECT_EQ(shandle.getIntType(), H5::PredType::STD_I8LE);
+        EXPECT_EQ(shandle.getCreatePlist().getLayout(), H5D_CONTIGUOUS);
+        int32_t placeholder;
+        shandle.openAttribute("missing-value-placeholder").read(H5::PredType::NATIVE_INT32, &placeholder);
+        EXPECT_EQ(placeholder, -128);
+
+        EXPECT_EQ(handle.openDataSet("foo/data/2/data").getIntType(), H5::PredType::STD_U8LE);
+        EXPECT_EQ(handle.openDataSet("foo/data/3/data").getIntType(), H5::PredType::STD_I32LE);
+    }
+
+    // Contents are preserved with the narrower types.
+    auto reloaded = uzuki2::hdf5::parse<DefaultProvisioner>(path, "foo", uzuki2::DummyExternals(0), uzuki2::hdf5::Options());
+    auto lptr = static_cast<const DefaultList*>(reloaded.get());
+    auto first = static_cast<const DefaultIntegerVector*>(lptr->values[0].get());
+    EXPECT_EQ(first->base.values.size(), 20000);
+    EXPECT_EQ(first->base.values.back(), 19999);
+    auto second = static_cast<const DefaultIntegerVector*>(lptr->values[1].get());
+    EXPECT_EQ(second->base.values, std::vector<int32_t>({ 1, 2, -123456789 }));
+
+    // Turning off the layout optimizations.
+    uzuki2::hdf5::WriteOptions opt;
+    opt.narrow_integers = false;
+    opt.chunk_size = 0;
+    uzuki2::hdf5::write(parsed.get(), path, "foo", opt);
+    {
+        H5::H5File handle(path, H5F_ACC_RDONLY);
+        auto bhandle = handle.openDataSet("foo/data/0/data");
+        EXPECT_EQ(bhandle.getIntType(), H5::PredType::STD_I32LE);
+        EXPECT_EQ(bhandle.getCreatePlist().getLayout(), H5D_CONTIGUOUS);
+    }
+}
+
+TEST(Hdf5WriteTest, PlaceholderBlocks) {
+    auto parsed = parse_columnar("{ \"type\": \"list\", \"values\": ["
+        "{ \"type\": \"integer\", \"values\": [ 1, null, 3, 4, null ] },"
+        "{ \"type\": \"integer\", \"values\": null },"
+        "{ \"type\": \"boolean\", \"values\": [ true, null, false, true, null ] },"
+        "{ \"type\": \"number\", \"values\": [ 1.5, null, 3, 4.5, null ] }"
+        "] }");
+
+    // Placeholders are substituted across multiple blocks.
+    auto path = "TEST-write.h5";
+    uzuki2::hdf5::WriteOptions opt;
+    opt.buffer_size = 2;
+    uzuki2::hdf5::write(parsed.get(), path, "foo", opt);
+
+    auto reloaded = uzuki2::hdf5::parse<DefaultProvisioner>(path, "foo", uzuki2::DummyExternals(0), uzuki2::hdf5::Options());
+    auto lptr = static_cast<const DefaultList*>(reloaded.get());
+    auto first = static_cast<const DefaultIntegerVector*>(lptr->values[0].get());
+    EXPECT_EQ(first->base.values, std::vector<int32_t>({ 1, -123456789, 3, 4, -123456789 }));
+    auto second = static_cast<const DefaultIntegerVector*>(lptr->values[1].get());
+    EXPECT_EQ(second->base.values, std::vector<int32_t>({ -123456789 }));
+    auto third = static_cast<const DefaultBooleanVector*>(lptr->values[2].get());
+    EXPECT_EQ(third->base.values, std::vector<unsigned char>({ 1, 255, 0, 1, 255 }));
+    auto fourth = static_cast<const DefaultNumberVector*>(lptr->values[3].get());
+    EXPECT_EQ(fourth->base.values, std::vector<double>({ 1.5, -123456789, 3, 4.5, -123456789 }));
+}
+
+static std::vector<std::vector<unsigned char> > read_raw_chunks(const std::string& path, const std::string& name) {
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto dhandle = handle.openDataSet(name);
+    auto dspace = dhandle.getSpace();
+    hsize_t nchunks;
+    H5Dget_num_chunks(dhandle.getId(), dspace.getId(), &nchunks);
+
+    std::vector<std::vector<unsigned char> > output;
+    for (hsize_t c = 0; c < nchunks; ++c) {
+        hsize_t offset;
+        unsigned filter_mask;
+        haddr_t addr;
+        hsize_t size;
+        H5Dget_chunk_info(dhandle.getId(), dspace.getId(), c, &offset, &filter_mask, &addr, &size);
+        output.emplace_back(size);
+        uint32_t mask;
+        H5Dread_chunk(dhandle.getId(), H5P_DEFAULT, &offset, &mask, output.back().data());
+    }
+    return output;
+}
+
+TEST(Hdf5WriteTest, Parallel) {
+    std::string ints = "[ null", nums = "[ 0.5", strs = "[ \"a\"";
+    for (int i = 1; i < 2501; ++i) {
+        ints += ", " + std::to_string(i * 7);
+        nums += ", " + (i % 10 == 0 ? std::string("null") : std::to_string(i / 3.0));
+        strs += ", \"" + std::string(i % 5 + 1, 'a' + i % 26) + "\"";
+    }
+    ints += " ]";
+    nums += " ]";
+    strs += " ]";
+
+    auto parsed = parse_columnar("{ \"type\": \"list\", \"values\": ["
+        "{ \"type\": \"integer\", \"values\": " + ints + " },"
+        "{ \"type\": \"number\", \"values\": " + nums + " },"
+        "{ \"type\": \"string\", \"values\": " + strs + " }"
+        "] }");
+
+    uzuki2::hdf5::WriteOptions opt;
+    opt.chunk_size = 300; // not a multiple of the length, to check the padding of the last chunk.
+    opt.contiguous_threshold = 0;
+    auto serial_path = "TEST-write-serial.h5";
+    uzuki2::hdf5::write(parsed.get(), serial_path, "foo", opt);
+
+    opt.num_threads = 3;
+    auto parallel_path = "TEST-write-parallel.h5";
+    uzuki2::hdf5::write(parsed.get(), parallel_path, "foo", opt);
+
+    // Chunks should be byte-for-byte identical to those from HDF5's own filters.
+    for (int i = 0; i < 3; ++i) {
+        auto name = "foo/data/" + std::to_string(i) + "/data";
+        auto expected = read_raw_chunks(serial_path, name);
+        EXPECT_EQ(expected.size(), 9);
+        EXPECT_EQ(read_raw_chunks(parallel_path, name), expected);
+    }
+
+    auto reloaded = uzuki2::hdf5::parse<DefaultProvisioner>(parallel_path, "foo", uzuki2::DummyExternals(0), uzuki2::hdf5::Options());
+    auto lptr = static_cast<const DefaultList*>(reloaded.get());
+    auto iptr = static_cast<const DefaultIntegerVector*>(lptr->values[0].get());
+    EXPECT_EQ(iptr->base.values.front(), -123456789);
+    EXPECT_EQ(iptr->base.values.back(), 2500 * 7);
+    auto sptr = static_cast<const DefaultStringVector*>(lptr->values[2].get());
+    EXPECT_EQ(sptr->base.values[1], "bb");
+}
+
+TEST(Hdf5WriteTest, Errors) {
+    auto parsed = load_json("{ \"type\": \"list\", \"values\": [] }");
+    EXPECT_ANY_THROW({
+        try {
+            uzuki2::hdf5::write(parsed.get(), "TEST-write.h5", "foo");
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("ColumnarProvisioner"));
+            throw;
+        }
+    });
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki2/parse_json.hpp"
+#include "uzuki2/write_json.hpp"
+
+#include "test_subclass.h"
+#include "utils.h"
+
+#include <cmath>
+#include <cstring>
+#include <string>
+
+static std::string write_to_string(const uzuki2::Base* object, size_t buffer_size = 65536) {
+    byteme::RawBufferWriter writer({});
+    uzuki2::json::WriteOptions opt;
+    opt.buffer_size = buffer_size;
+    uzuki2::json::write(object, writer, opt);
+    writer.finish();
+    const auto& output = writer.get_output();
+    return std::string(output.begin(), output.end());
+}
+
+TEST(JsonWriteTest, RoundTrip) {
+    auto parsed = parse_columnar(round_trip_json(), 1);
+
+    auto path = "TEST-write.json";
+    auto externals = uzuki2::json::write_file(parsed.get(), path);
+    ASSERT_EQ(externals.size(), 1);
+    EXPECT_EQ(externals[0], reinterpret_cast<void*>(1));
+
+    auto reloaded = uzuki2::json::parse_file<DefaultProvisioner>(path, DefaultExternals(1), uzuki2::json::Options());
+    EXPECT_EQ(reloaded.version.major, 1);
+    EXPECT_EQ(reloaded.version.minor, 2);
+    check_round_trip(reloaded.get());
+
+    // Same contents with a tiny buffer, which forces many flushes.
+    auto compressed = "TEST-write.json.gz";
+    uzuki2::json::WriteOptions opt;
+    opt.gzip = true;
+    opt.buffer_size = 1;
+    uzuki2::json::write_file(parsed.get(), compressed, opt);
+    auto rezipped = uzuki2::json::parse_file<DefaultProvisioner>(compressed, DefaultExternals(1), uzuki2::json::Options());
+    check_round_trip(rezipped.get());
+}
+
+TEST(JsonWriteTest, Formatting) {
+    auto parsed = parse_columnar("{ \"type\": \"list\", \"values\": ["
+        "{ \"type\": \"number\", \"values\": [ 0.1, 1e300, -2, 5e-324, \"Inf\", \"-Inf\", \"NaN\", null ] },"
+        "{ \"type\": \"integer\", \"values\": -2147483647 }"
+        "] }");
+
+    auto output = write_to_string(parsed.get());
+    EXPECT_EQ(output,
+        "{\"version\":\"1.2\",\"type\":\"list\",\"values\":["
+        "{\"type\":\"number\",\"values\":[0.1,1e+300,-2,5e-324,\"Inf\",\"-Inf\",\"NaN\",null]},"
+        "{\"type\":\"integer\",\"values\":-2147483647}"
+        "]}"
+    );
+
+    // Shortest representations still round-trip exactly.
+    auto reparsed = parse_columnar(output);
+    auto dptr = static_cast<const uzuki2::ColumnarNumberVector*>(static_cast<const uzuki2::ColumnarList*>(reparsed.get())->values()[0]);
+    EXPECT_EQ(dptr->values()[0], 0.1);
+    EXPECT_EQ(dptr->values()[1], 1e300);
+    EXPECT_EQ(dptr->values()[3], 5e-324);
+
+    EXPECT_EQ(write_to_string(parsed.get(), 1), output);
+}
+
+TEST(JsonWriteTest, Base64) {
+    // Bit patterns that do not survive a decimal round trip, i.e., signed zeros and NaN payloads.
+    uint64_t payload = 0x7ff8000000abcdefULL;
+    double custom_nan;
+    std::memcpy(&custom_nan, &payload, sizeof(double));
+    std::vector<double> expected { 0.1, -0.0, custom_nan, 5e-324, 0, 1e300 };
+
+    std::string contents = "{ \"type\": \"list\", \"values\": [ { \"type\": \"number\", \"values\": [ 0.1, 0, 0, 5e-324, null, 1e300 ], \"names\": [ \"a\", \"b\", \"c\", \"d\", \"e\", \"f\" ] }, { \"type\": \"number\", \"values\": 2 } ] }";
+    auto parsed = parse_columnar(contents);
+    auto lptr = static_cast<const uzuki2::ColumnarList*>(parsed.get());
+    auto dptr = const_cast<uzuki2::ColumnarNumberVector*>(static_cast<const uzuki2::ColumnarNumberVector*>(lptr->values()[0]));
+    dptr->set_block(0, expected.data(), 4);
+
+    byteme::RawBufferWriter writer({});
+    uzuki2::json::WriteOptions opt;
+    opt.base64_numbers = true;
+    uzuki2::json::write(parsed.get(), writer, opt);
+    writer.finish();
+    std::string output(writer.get_output().begin(), writer.get_output().end());
+    EXPECT_THAT(output, ::testing::HasSubstr("\"version\":\"1.3\""));
+    EXPECT_THAT(output, ::testing::HasSubstr("\"encoding\":\"base64\""));
+    EXPECT_THAT(output, ::testing::HasSubstr("\"missing\":[4]"));
+    EXPECT_THAT(output, ::testing::HasSubstr("{\"type\":\"number\",\"values\":2}")); // scalars are left as-is.
+
+    auto reparsed = parse_columnar(output);
+    auto rptr = static_cast<const uzuki2::ColumnarNumberVector*>(static_cast<const uzuki2::ColumnarList*>(reparsed.get())->values()[0]);
+    ASSERT_EQ(rptr->size(), expected.size());
+    EXPECT_EQ(std::memcmp(rptr->values(), expected.data(), 4 * sizeof(double)), 0);
+    EXPECT_EQ(rptr->values()[5], 1e300);
+    EXPECT_TRUE(rptr->validity().is_missing(4));
+    EXPECT_EQ(rptr->validity().null_count(), 1);
+    EXPECT_EQ(rptr->names().size(), 6);
+}
+
+TEST(JsonWriteTest, Errors) {
+    auto parsed = load_json("{ \"type\": \"list\", \"values\": [] }");
+    EXPECT_ANY_THROW({
+        try {
+            write_to_string(parsed.get());
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("ColumnarProvisioner"));
+            throw;
+        }
+    });
+}
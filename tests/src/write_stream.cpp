@@ -0,0 +1,321 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki2/parse_hdf5.hpp"
+#include "uzuki2/parse_json.hpp"
+#include "uzuki2/write_hdf5.hpp"
+#include "uzuki2/write_json.hpp"
+
+#include "test_subclass.h"
+#include "utils.h"
+
+#include <cmath>
+#include <string>
+
+template<class Writer_>
+static void stream_example(Writer_& writer) {
+    writer.begin_list(true);
+
+    // Integers in multiple blocks with names.
+    writer.name("ints");
+    writer.begin_integer(true);
+    for (int b = 0; b < 3; ++b) {
+        std::vector<int32_t> values{ b * 10, b * 10 + 1 };
+        std::vector<uint8_t> missing{ 0, static_cast<uint8_t>(b == 1) };
+        std::vector<std::string> nstore{ "x" + std::to_string(b), "y" + std::to_string(b) };
+        std::vector<std::string_view> names(nstore.begin(), nstore.end());
+        writer.append_integers(values.data(), values.size(), missing.data(), names.data());
+    }
+    writer.end_vector();
+
+    writer.name("num");
+    writer.begin_number(false, true);
+    double val = 0.1;
+    writer.append_numbers(&val, 1);
+    writer.end_vector();
+
+    writer.name("dates");
+    writer.begin_string(false, false, uzuki2::StringVector::DATE);
+    std::vector<std::string_view> dates{ "2020-01-01", "", "2023-12-31" };
+    std::vector<uint8_t> dmissing{ 0, 1, 0 };
+    writer.append_strings(dates.data(), 2, dmissing.data());
+    writer.append_strings(dates.data() + 2, 1, dmissing.data() + 2);
+    writer.end_vector();
+
+    writer.name("fac");
+    writer.begin_factor({ "A", "B", "C" }, true, false);
+    std::vector<int32_t> codes{ 2, 0, 1, 0 };
+    std::vector<uint8_t> cmissing{ 0, 0, 0, 1 };
+    writer.append_codes(codes.data(), codes.size(), cmissing.data());
+    writer.end_vector();
+
+    writer.name("bools");
+    writer.begin_boolean(false);
+    std::vector<uint8_t> bools{ 1, 0, 1 };
+    writer.append_booleans(bools.data(), bools.size());
+    writer.end_vector();
+
+    writer.name("nested");
+    writer.begin_list(false);
+    writer.nothing();
+    writer.external(1);
+    writer.external(0);
+    writer.begin_list(true);
+    writer.end_list();
+    writer.end_list();
+
+    writer.end_list();
+    writer.finish();
+}
+
+static void check_example(const uzuki2::Base* ptr) {
+    auto lptr = static_cast<const DefaultList*>(ptr);
+    ASSERT_EQ(lptr->size(), 6);
+    EXPECT_EQ(lptr->names, std::vector<std::string>({ "ints", "num", "dates", "fac", "bools", "nested" }));
+
+    auto iptr = static_cast<const DefaultIntegerVector*>(lptr->values[0].get());
+    EXPECT_EQ(iptr->base.values, std::vector<int32_t>({ 0, 1, 10, -123456789, 20, 21 }));
+    EXPECT_EQ(iptr->base.names, std::vector<std::string>({ "x0", "y0", "x1", "y1", "x2", "y2" }));
+
+    auto dptr = static_cast<const DefaultNumberVector*>(lptr->values[1].get());
+    EXPECT_TRUE(dptr->base.scalar);
+    EXPECT_EQ(dptr->base.values, std::vector<double>({ 0.1 }));
+
+    auto sptr = static_cast<const DefaultStringVector*>(lptr->values[2].get());
+    EXPECT_EQ(sptr->format, uzuki2::StringVector::DATE);
+    EXPECT_EQ(sptr->base.values, std::vector<std::string>({ "2020-01-01", "ich bin missing", "2023-12-31" }));
+
+    auto fptr = static_cast<const DefaultFactor*>(lptr->values[3].get());
+    EXPECT_EQ(fptr->vbase.values, std::vector<size_t>({ 2, 0, 1, static_cast<size_t>(-1) }));
+    EXPECT_EQ(fptr->levels, std::vector<std::string>({ "A", "B", "C" }));
+    EXPECT_TRUE(fptr->ordered);
+
+    auto bptr = static_cast<const DefaultBooleanVector*>(lptr->values[4].get());
+    EXPECT_EQ(bptr->base.values, std::vector<uint8_t>({ 1, 0, 1 }));
+
+    auto nested = static_cast<const DefaultList*>(lptr->values[5].get());
+    ASSERT_EQ(nested->size(), 4);
+    EXPECT_EQ(nested->values[0]->type(), uzuki2::NOTHING);
+    EXPECT_EQ(static_cast<const DefaultExternal*>(nested->values[1].get())->ptr, reinterpret_cast<void*>(2));
+    EXPECT_EQ(static_cast<const DefaultExternal*>(nested->values[2].get())->ptr, reinterpret_cast<void*>(1));
+    auto empty = static_cast<const DefaultList*>(nested->values[3].get());
+    EXPECT_EQ(empty->size(), 0);
+    EXPECT_TRUE(empty->names.empty());
+}
+
+TEST(StreamWriteTest, Json) {
+    byteme::RawBufferWriter output({});
+    {
+        uzuki2::json::WriteOptions opt;
+        opt.buffer_size = 1; // forces the names to be spilled to a temporary file.
+        uzuki2::json::StreamWriter writer(output, opt);
+        stream_example(writer);
+    }
+    output.finish();
+
+    const auto& contents = output.get_output();
+    auto parsed = uzuki2::json::parse_buffer<DefaultProvisioner>(contents.data(), contents.size(), DefaultExternals(2), uzuki2::json::Options());
+    check_example(parsed.get());
+}
+
+TEST(StreamWriteTest, Hdf5) {
+    auto path = "TEST-stream.h5";
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        uzuki2::hdf5::WriteOptions opt;
+        opt.chunk_size = 2;
+        opt.buffer_size = 2; // flushes the list names in blocks.
+        uzuki2::hdf5::StreamWriter writer(handle.createGroup("foo"), opt);
+        stream_example(writer);
+    }
+
+    auto parsed = uzuki2::hdf5::parse<DefaultProvisioner>(path, "foo", DefaultExternals(2), uzuki2::hdf5::Options());
+    check_example(parsed.get());
+
+    H5::H5File handle(path, H5F_ACC_RDONLY);
+    auto ihandle = handle.openDataSet("foo/data/0/data");
+    EXPECT_EQ(ihandle.getCreatePlist().getLayout(), H5D_CHUNKED);
+    int32_t placeholder;
+    ihandle.openAttribute("missing-value-placeholder").read(H5::PredType::NATIVE_INT32, &placeholder);
+    EXPECT_EQ(placeholder, std::numeric_limits<int32_t>::min());
+    EXPECT_EQ(handle.openDataSet("foo/data/3/data").getIntType(), H5::PredType::STD_I8LE);
+    EXPECT_FALSE(handle.openDataSet("foo/data/4/data").attrExists("missing-value-placeholder"));
+}
+
+template<class Function_>
+static void expect_stream_error(Function_ fun, const std::string& msg) {
+    std::string path = "TEST-stream.h5";
+    H5::H5File handle(path, H5F_ACC_TRUNC);
+    uzuki2::hdf5::StreamWriter hwriter(handle.createGroup("foo"));
+    EXPECT_ANY_THROW({
+        try {
+            fun(hwriter);
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr(msg));
+            throw;
+        }
+    });
+
+    byteme::RawBufferWriter output({});
+    uzuki2::json::StreamWriter jwriter(output);
+    EXPECT_ANY_THROW({
+        try {
+            fun(jwriter);
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr(msg));
+            throw;
+        }
+    });
+}
+
+TEST(StreamWriteTest, Errors) {
+    expect_stream_error([](auto& writer) -> void {
+        writer.begin_list(true);
+        writer.nothing();
+    }, "should have a name");
+
+    expect_stream_error([](auto& writer) -> void {
+        writer.begin_list(false);
+        writer.name("foo");
+    }, "children of a named list");
+
+    expect_stream_error([](auto& writer) -> void {
+        writer.begin_integer(false);
+        double x = 1;
+        writer.append_numbers(&x, 1);
+    }, "does not match");
+
+    expect_stream_error([](auto& writer) -> void {
+        writer.begin_integer(true);
+        int32_t x = 1;
+        writer.append_integers(&x, 1);
+        writer.end_vector();
+    }, "number of names should be equal");
+
+    expect_stream_error([](auto& writer) -> void {
+        writer.begin_integer(false);
+        std::string_view name = "foo";
+        writer.append_names(&name, 1);
+    }, "unnamed vector");
+
+    expect_stream_error([](auto& writer) -> void {
+        writer.begin_integer(false, true);
+        writer.end_vector();
+    }, "exactly one value");
+
+    expect_stream_error([](auto& writer) -> void {
+        writer.begin_factor({ "A", "B" }, false, false);
+        int32_t x = 2;
+        writer.append_codes(&x, 1);
+    }, "less than the number of levels");
+
+    expect_stream_error([](auto& writer) -> void {
+        writer.begin_factor({ "A", "A" }, false, false);
+    }, "unique");
+
+    expect_stream_error([](auto& writer) -> void {
+        writer.begin_list(false);
+        writer.external(0);
+        writer.external(2);
+        writer.end_list();
+        writer.finish();
+    }, "consecutive");
+
+    expect_stream_error([](auto& writer) -> void {
+        writer.begin_list(false);
+        writer.end_vector();
+    }, "no vector to end");
+
+    expect_stream_error([](auto& writer) -> void {
+        writer.begin_list(false);
+        writer.finish();
+    }, "should be ended");
+
+    expect_stream_error([](auto& writer) -> void {
+        writer.nothing();
+        writer.nothing();
+    }, "only one top-level object");
+
+    // Placeholder collisions are only relevant for HDF5.
+    {
+        H5::H5File handle("TEST-stream.h5", H5F_ACC_TRUNC);
+        uzuki2::hdf5::StreamWriter writer(handle.createGroup("foo"));
+        writer.begin_list(false);
+        writer.begin_number(false);
+        std::vector<double> values{ 1.5, std::numeric_limits<double>::quiet_NaN() };
+        writer.append_numbers(values.data(), values.size()); // collision is fine without any missing values...
+
+        double x = 0;
+        uint8_t missing = 1;
+        EXPECT_ANY_THROW({
+            try {
+                writer.append_numbers(&x, 1, &missing); // ... until a later block adds a missing value.
+            } catch (std::exception& e) {
+                EXPECT_THAT(e.what(), ::testing::HasSubstr("stream_number_placeholder"));
+                throw;
+            }
+        });
+
+        // A failed append is not counted, so the writer can continue.
+        x = 2.5;
+        writer.append_numbers(&x, 1);
+        writer.end_vector();
+        writer.end_list();
+        writer.finish();
+    }
+
+    auto parsed = uzuki2::hdf5::parse<DefaultProvisioner>("TEST-stream.h5", "foo", DefaultExternals(0), uzuki2::hdf5::Options());
+    auto lptr = static_cast<const DefaultList*>(parsed.get());
+    ASSERT_EQ(lptr->size(), 1);
+    const auto& nvalues = static_cast<const DefaultNumberVector*>(lptr->values[0].get())->base.values;
+    ASSERT_EQ(nvalues.size(), 3);
+    EXPECT_EQ(nvalues[0], 1.5);
+    EXPECT_TRUE(std::isnan(nvalues[1]));
+    EXPECT_EQ(nvalues[2], 2.5);
+}
+
+TEST(StreamWriteTest, PlaceholderCollisions) {
+    auto path = "TEST-stream.h5";
+    {
+        H5::H5File handle(path, H5F_ACC_TRUNC);
+        uzuki2::hdf5::StreamWriter writer(handle.createGroup("foo"));
+        writer.begin_list(false);
+
+        // Values equal to the placeholders are allowed when nothing is missing.
+        writer.begin_string(false);
+        std::vector<std::string_view> strings{ "NA", "foo" };
+        writer.append_strings(strings.data(), strings.size());
+        writer.end_vector();
+
+        writer.begin_integer(false);
+        int32_t x = std::numeric_limits<int32_t>::min();
+        writer.append_integers(&x, 1);
+        writer.end_vector();
+
+        writer.end_list();
+        writer.finish();
+    }
+
+    auto parsed = uzuki2::hdf5::parse<DefaultProvisioner>(path, "foo", DefaultExternals(0), uzuki2::hdf5::Options());
+    auto lptr = static_cast<const DefaultList*>(parsed.get());
+    ASSERT_EQ(lptr->size(), 2);
+    EXPECT_EQ(static_cast<const DefaultStringVector*>(lptr->values[0].get())->base.values, std::vector<std::string>({ "NA", "foo" }));
+    EXPECT_EQ(static_cast<const DefaultIntegerVector*>(lptr->values[1].get())->base.values, std::vector<int32_t>({ std::numeric_limits<int32_t>::min() }));
+
+    // Missing values in an earlier block also cause a later collision to fail.
+    H5::H5File handle(path, H5F_ACC_TRUNC);
+    uzuki2::hdf5::StreamWriter writer(handle.createGroup("foo"));
+    writer.begin_string(false);
+    std::string_view empty;
+    uint8_t missing = 1;
+    writer.append_strings(&empty, 1, &missing);
+    std::string_view na = "NA";
+    EXPECT_ANY_THROW({
+        try {
+            writer.append_strings(&na, 1);
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("stream_string_placeholder"));
+            throw;
+        }
+    });
+}